@@ -15,14 +15,20 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(engine.pri)
+
 SOURCES += \
-    game.cpp \
+    gametreedialog.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    qubicdialog.cpp \
+    ultimatedialog.cpp
 
 HEADERS += \
-    game.h \
-    mainwindow.h
+    gametreedialog.h \
+    mainwindow.h \
+    qubicdialog.h \
+    ultimatedialog.h
 
 FORMS += \
     mainwindow.ui
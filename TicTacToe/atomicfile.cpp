@@ -0,0 +1,139 @@
+#include "atomicfile.h"
+#include <cerrno>
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------------------------
+// @name                    : SyncFile
+//
+// @description             : Flushes a closed file's data to the disk
+//
+// @return                  : true if the data reached the disk
+//--------------------------------------------------------------------------------
+static bool SyncFile(const std::string & path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    bool bSynced = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return bSynced;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool bSynced = fsync(fd) == 0;
+    close(fd);
+    return bSynced;
+#endif
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CommitFile
+//
+// @description             : Syncs 'temporary' and renames it over 'path'.
+//                            rename() replaces an existing file atomically on
+//                            POSIX; Windows needs MoveFileEx for that. The
+//                            target is never removed first: a crash between
+//                            a remove and the rename would leave no file at
+//                            all. On POSIX the directory is synced too, so
+//                            the rename itself survives a power loss.
+//
+// @return                  : true if 'path' now holds the new contents
+//--------------------------------------------------------------------------------
+bool CommitFile(const std::string & temporary, const std::string & path)
+{
+    if (!SyncFile(temporary))
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+#else
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    size_t slash = path.find_last_of('/');
+    std::string directory = (slash == std::string::npos) ? "." : path.substr(0, slash + 1);
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+#endif
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AppendFile
+//
+// @description             : Appends 'data' to 'path', creating it if needed,
+//                            and syncs it before returning. A short write or
+//                            a failed sync is an error.
+//
+// @return                  : true if all of 'data' reached the disk
+//--------------------------------------------------------------------------------
+bool AppendFile(const std::string & path, const std::string & data)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    DWORD written = 0;
+    bool bWritten = WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) != 0 &&
+                    written == data.size();
+    bool bSynced = bWritten && FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return bSynced;
+#else
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        ssize_t written = write(fd, data.data() + offset, data.size() - offset);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            close(fd);
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+
+    bool bSynced = fsync(fd) == 0;
+    return (close(fd) == 0) && bSynced;
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+#include <string>
+
+//------------------------------------------------------------------------
+// Files written under a temporary name are put in place with
+// CommitFile: the temporary is flushed to disk and then renamed over the
+// target in one step, so after a crash or power loss the target holds
+// either the old contents or the new ones, never neither.
+//------------------------------------------------------------------------
+bool CommitFile(const std::string & temporary, const std::string & path);
+
+//------------------------------------------------------------------------
+// Appends 'data' to the end of 'path' and flushes it to disk before
+// returning, so records reported written survive a crash.
+//------------------------------------------------------------------------
+bool AppendFile(const std::string & path, const std::string & data);
+
+#endif // ATOMICFILE_H
@@ -0,0 +1,290 @@
+#include "batcheval.h"
+#include "simd.h"
+#include <cassert>
+
+//--------------------------------------------------------------------------------
+// @name                    : EvaluateScalar
+//
+// @description             : One board at a time through the win table
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void EvaluateScalar(const BoardMask_t * first, const BoardMask_t * second, uint8_t * status, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (IsWinMask(first[i]))
+        {
+            status[i] = BOARD_FIRST_WINS;
+        }
+        else if (IsWinMask(second[i]))
+        {
+            status[i] = BOARD_SECOND_WINS;
+        }
+        else if ((first[i] | second[i]) == FULL_BOARD_MASK)
+        {
+            status[i] = BOARD_DRAW;
+        }
+        else
+        {
+            status[i] = BOARD_ONGOING;
+        }
+    }
+}
+
+#ifdef SIMD_X86
+//--------------------------------------------------------------------------------
+// @name                    : EvaluateSse2
+//
+// @description             : Eight boards per 128 bit register, one 16 bit lane
+//                            per board. Every win mask is tested on all lanes
+//                            with an and + compare.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void EvaluateSse2(const BoardMask_t * first, const BoardMask_t * second, uint8_t * status, size_t count)
+{
+    const __m128i full = _mm_set1_epi16(FULL_BOARD_MASK);
+    const __m128i one = _mm_set1_epi16(BOARD_FIRST_WINS);
+    const __m128i two = _mm_set1_epi16(BOARD_SECOND_WINS);
+    const __m128i three = _mm_set1_epi16(BOARD_DRAW);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(second + i));
+
+        __m128i winA = _mm_setzero_si128();
+        __m128i winB = _mm_setzero_si128();
+        for (size_t w = 0; w < 8; w++)
+        {
+            __m128i line = _mm_set1_epi16(static_cast<short>(WIN_MASKS[w]));
+            winA = _mm_or_si128(winA, _mm_cmpeq_epi16(_mm_and_si128(a, line), line));
+            winB = _mm_or_si128(winB, _mm_cmpeq_epi16(_mm_and_si128(b, line), line));
+        }
+        __m128i isFull = _mm_cmpeq_epi16(_mm_or_si128(a, b), full);
+
+        // First player's win takes precedence, a full board without a win is a draw
+        __m128i result = _mm_and_si128(winA, one);
+        result = _mm_or_si128(result, _mm_and_si128(_mm_andnot_si128(winA, winB), two));
+        result = _mm_or_si128(result, _mm_and_si128(_mm_andnot_si128(_mm_or_si128(winA, winB), isFull), three));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(status + i), _mm_packus_epi16(result, result));
+    }
+
+    EvaluateScalar(first + i, second + i, status + i, count - i);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : EvaluateAvx2
+//
+// @description             : Same as EvaluateSse2 with 16 boards per register
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+TARGET_AVX2 static void EvaluateAvx2(const BoardMask_t * first, const BoardMask_t * second,
+                                     uint8_t * status, size_t count)
+{
+    const __m256i full = _mm256_set1_epi16(FULL_BOARD_MASK);
+    const __m256i one = _mm256_set1_epi16(BOARD_FIRST_WINS);
+    const __m256i two = _mm256_set1_epi16(BOARD_SECOND_WINS);
+    const __m256i three = _mm256_set1_epi16(BOARD_DRAW);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(second + i));
+
+        __m256i winA = _mm256_setzero_si256();
+        __m256i winB = _mm256_setzero_si256();
+        for (size_t w = 0; w < 8; w++)
+        {
+            __m256i line = _mm256_set1_epi16(static_cast<short>(WIN_MASKS[w]));
+            winA = _mm256_or_si256(winA, _mm256_cmpeq_epi16(_mm256_and_si256(a, line), line));
+            winB = _mm256_or_si256(winB, _mm256_cmpeq_epi16(_mm256_and_si256(b, line), line));
+        }
+        __m256i isFull = _mm256_cmpeq_epi16(_mm256_or_si256(a, b), full);
+
+        __m256i result = _mm256_and_si256(winA, one);
+        result = _mm256_or_si256(result, _mm256_and_si256(_mm256_andnot_si256(winA, winB), two));
+        result = _mm256_or_si256(result,
+                                 _mm256_and_si256(_mm256_andnot_si256(_mm256_or_si256(winA, winB), isFull), three));
+
+        // Pack the two 128 bit halves to 16 bytes in board order
+        __m128i low = _mm256_castsi256_si128(result);
+        __m128i high = _mm256_extracti128_si256(result, 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(status + i), _mm_packus_epi16(low, high));
+    }
+
+    EvaluateSse2(first + i, second + i, status + i, count - i);
+}
+#endif
+
+//--------------------------------------------------------------------------------
+// @name                    : GetBestBatchIsa
+//
+// @description             : Widest instruction set this CPU (and OS) supports
+//
+// @return                  : BatchIsa_t
+//--------------------------------------------------------------------------------
+BatchIsa_t GetBestBatchIsa()
+{
+#if defined(SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool bSse2 = (info[3] & (1 << 26)) != 0;
+    bool bOsAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                  (_xgetbv(0) & 0x6) == 0x6;
+
+    bool bAvx2 = false;
+    if (maxLeaf >= 7 && bOsAvx)
+    {
+        __cpuidex(info, 7, 0);
+        bAvx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    return bAvx2 ? BATCH_ISA_AVX2 : (bSse2 ? BATCH_ISA_SSE2 : BATCH_ISA_SCALAR);
+#elif defined(SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return BATCH_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return BATCH_ISA_SSE2;
+    }
+    return BATCH_ISA_SCALAR;
+#else
+    return BATCH_ISA_SCALAR;
+#endif
+}
+
+const char * GetBatchIsaName(BatchIsa_t isa)
+{
+    switch (isa)
+    {
+    case BATCH_ISA_AVX2:
+        return "avx2";
+    case BATCH_ISA_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : EvaluateBoards
+//
+// @description             : Status of every board. The variant taking an ISA
+//                            is for benchmarks; it must be one the CPU supports.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void EvaluateBoards(BatchIsa_t isa, const BoardMask_t * first, const BoardMask_t * second,
+                    uint8_t * status, size_t count)
+{
+#ifdef SIMD_X86
+    if (isa == BATCH_ISA_AVX2)
+    {
+        EvaluateAvx2(first, second, status, count);
+        return;
+    }
+    if (isa == BATCH_ISA_SSE2)
+    {
+        EvaluateSse2(first, second, status, count);
+        return;
+    }
+#else
+    (void)isa;
+#endif
+    EvaluateScalar(first, second, status, count);
+}
+
+void EvaluateBoards(const BoardMask_t * first, const BoardMask_t * second, uint8_t * status, size_t count)
+{
+    // CPU features do not change while running, detect once
+    static const BatchIsa_t isa = GetBestBatchIsa();
+    EvaluateBoards(isa, first, second, status, count);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Run
+//
+// @description             : Plays 'count' random games from the position. All
+//                            boards are at the same ply, so the same side moves
+//                            on every board. Finished boards are swapped out of
+//                            the active range so each ply only checks live ones.
+//
+// @return                  : wins, draws and losses of the side to move
+//--------------------------------------------------------------------------------
+PlayoutTally BatchPlayouts::Run(BoardMask_t own, BoardMask_t opponent, size_t count, std::mt19937 & rng)
+{
+    assert((own & opponent) == 0);
+
+    m_first.assign(count, own);
+    m_second.assign(count, opponent);
+    m_status.resize(count);
+
+    PlayoutTally tally = {0, 0, 0};
+    size_t active = count;
+    bool bFirstToMove = true;
+
+    while (active > 0)
+    {
+        EvaluateBoards(m_first.data(), m_second.data(), m_status.data(), active);
+
+        for (size_t i = 0; i < active; )
+        {
+            uint8_t status = m_status[i];
+            if (status != BOARD_ONGOING)
+            {
+                if (status == BOARD_FIRST_WINS)
+                {
+                    tally.wins++;
+                }
+                else if (status == BOARD_SECOND_WINS)
+                {
+                    tally.losses++;
+                }
+                else
+                {
+                    tally.draws++;
+                }
+
+                active--;
+                m_first[i] = m_first[active];
+                m_second[i] = m_second[active];
+                m_status[i] = m_status[active];
+                continue;
+            }
+
+            // Random empty cell: skip a random number of set bits
+            uint32_t empty = ~(m_first[i] | m_second[i]) & FULL_BOARD_MASK;
+            for (int skip = static_cast<int>(rng() % static_cast<uint32_t>(CountBits(empty))); skip > 0; skip--)
+            {
+                empty &= empty - 1;
+            }
+            BoardMask_t bit = static_cast<BoardMask_t>(empty & (0u - empty));
+
+            if (bFirstToMove)
+            {
+                m_first[i] |= bit;
+            }
+            else
+            {
+                m_second[i] |= bit;
+            }
+            i++;
+        }
+
+        bFirstToMove = !bFirstToMove;
+    }
+
+    return tally;
+}
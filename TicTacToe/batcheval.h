@@ -0,0 +1,68 @@
+#ifndef BATCHEVAL_H
+#define BATCHEVAL_H
+#include "bitboard.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Win and game-over detection for many 3x3 boards at once.
+//
+// Boards are passed structure-of-arrays: one array with the masks of the
+// player who moved first on each board, one with the masks of the other
+// player. The SSE2 path checks 8 boards per instruction, the AVX2 path
+// 16; the widest one the CPU supports is picked at runtime, with a
+// scalar fallback for other CPUs.
+//------------------------------------------------------------------------
+typedef enum BoardStatus_tag
+{
+    BOARD_ONGOING,
+    BOARD_FIRST_WINS,
+    BOARD_SECOND_WINS,
+    BOARD_DRAW
+}BoardStatus_t;
+
+typedef enum BatchIsa_tag
+{
+    BATCH_ISA_SCALAR,
+    BATCH_ISA_SSE2,
+    BATCH_ISA_AVX2
+}BatchIsa_t;
+
+BatchIsa_t GetBestBatchIsa();
+const char * GetBatchIsaName(BatchIsa_t isa);
+
+// 'status' receives one BoardStatus_t per board
+void EvaluateBoards(const BoardMask_t * first, const BoardMask_t * second, uint8_t * status, size_t count);
+void EvaluateBoards(BatchIsa_t isa, const BoardMask_t * first, const BoardMask_t * second,
+                    uint8_t * status, size_t count);
+
+struct PlayoutTally
+{
+    unsigned long wins;
+    unsigned long draws;
+    unsigned long losses;
+};
+
+//------------------------------------------------------------------------
+// Random games played to the end in lockstep, all boards checked with one
+// batched call per ply. Results are for the side to move at the start.
+//
+// Only MctsEngine uses this. On 3x3 a single win check is one WIN_TABLE
+// lookup, so the time goes to drawing random moves, which stays scalar,
+// and BatchBench measures batched and one-at-a-time random games at the
+// same rate. SelfPlay searches m,n,k boards without random playouts and
+// SelfPlayFarm times whole engine moves, so neither is built on it.
+//------------------------------------------------------------------------
+class BatchPlayouts
+{
+private:
+    std::vector<BoardMask_t> m_first;
+    std::vector<BoardMask_t> m_second;
+    std::vector<uint8_t> m_status;
+
+public:
+    PlayoutTally Run(BoardMask_t own, BoardMask_t opponent, size_t count, std::mt19937 & rng);
+};
+
+#endif // BATCHEVAL_H
@@ -0,0 +1,39 @@
+#include "bitboard.h"
+
+WinTable::WinTable()
+{
+    for (size_t mask = 0; mask <= FULL_BOARD_MASK; mask++)
+    {
+        isWin[mask] = false;
+        for (size_t i = 0; i < 8; i++)
+        {
+            if ((mask & WIN_MASKS[i]) == WIN_MASKS[i])
+            {
+                isWin[mask] = true;
+                break;
+            }
+        }
+    }
+}
+
+const WinTable WIN_TABLE;
+
+//--------------------------------------------------------------------------------
+// @name                    : GetPlayerMask
+//
+// @description             : Converts the player's positions on the game board
+//                            to a mask.
+//
+// @return                  : BoardMask_t
+//--------------------------------------------------------------------------------
+BoardMask_t GetPlayerMask(const Game & game, Player_t player)
+{
+    BoardMask_t mask = 0;
+    std::vector<size_t> pattern = game.GetPlayerPattern(player);
+    for (auto it = pattern.begin(); it != pattern.end(); it++)
+    {
+        mask |= static_cast<BoardMask_t>(1u << *it);
+    }
+
+    return mask;
+}
@@ -0,0 +1,66 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+#include "game.h"
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------
+// Compact 3x3 board: one 9 bit mask per player, bit N is board position N.
+//------------------------------------------------------------------------
+typedef uint16_t BoardMask_t;
+
+const BoardMask_t FULL_BOARD_MASK = 0x1FF;
+
+const BoardMask_t WIN_MASKS[8] = {
+    0x007, 0x038, 0x1C0,    // rows
+    0x049, 0x092, 0x124,    // columns
+    0x111, 0x054            // diagonals
+};
+
+//------------------------------------------------------------------------
+// Lookup table of all 512 masks: true if the mask contains a winning line
+//------------------------------------------------------------------------
+struct WinTable
+{
+    bool isWin[FULL_BOARD_MASK + 1];
+
+    WinTable();
+};
+
+extern const WinTable WIN_TABLE;
+
+// Inline: Ultimate tic-tac-toe playouts look up two masks per move
+inline bool IsWinMask(BoardMask_t mask)
+{
+    return WIN_TABLE.isWin[mask & FULL_BOARD_MASK];
+}
+
+BoardMask_t GetPlayerMask(const Game & game, Player_t player);
+
+//------------------------------------------------------------------------
+// Bit helpers for the larger bitboards
+//------------------------------------------------------------------------
+inline int CountBits(uint64_t mask)
+{
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(mask));
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+// Index of the lowest set bit, mask must not be 0
+inline size_t GetLowestBitIndex(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(mask));
+#endif
+}
+
+#endif // BITBOARD_H
@@ -0,0 +1,71 @@
+#ifndef CONCURRENTSET_H
+#define CONCURRENTSET_H
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//------------------------------------------------------------------------
+// Lock-free set of 64-bit hash keys, shared by any number of threads.
+//
+// Open addressing with linear probing over a fixed array of atomics: a key
+// is claimed by compare-and-swap on the first empty slot of its probe
+// sequence, so two threads inserting the same key agree on which of them
+// inserted it. Keys are expected to be hashes already (Zobrist keys) and
+// are used as their own slot index. Zero marks an empty slot, so key 0 is
+// stored as 1. The capacity is fixed up front; keep the table at most
+// half full.
+//------------------------------------------------------------------------
+class ConcurrentHashSet
+{
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> m_slots;
+    size_t m_mask;
+    std::atomic<size_t> m_size;
+
+public:
+    // Room for at least 'capacity' keys, rounded up to a power of two
+    explicit ConcurrentHashSet(size_t capacity) : m_size(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_slots.reset(new std::atomic<uint64_t>[size]());
+        m_mask = size - 1;
+    }
+
+    // Returns true if 'key' was not in the set before
+    bool Insert(uint64_t key)
+    {
+        key = (key == 0) ? 1 : key;
+        for (size_t probe = 0; probe <= m_mask; probe++)
+        {
+            std::atomic<uint64_t> & slot = m_slots[(key + probe) & m_mask];
+            uint64_t current = slot.load(std::memory_order_relaxed);
+            if (current == 0)
+            {
+                if (slot.compare_exchange_strong(current, key, std::memory_order_relaxed))
+                {
+                    m_size.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                // Lost the slot to another thread, 'current' is now its key
+            }
+            if (current == key)
+            {
+                return false;
+            }
+        }
+
+        assert(!"ConcurrentHashSet is full");
+        return false;
+    }
+
+    size_t GetSize() const { return m_size.load(std::memory_order_relaxed); }
+    size_t GetCapacity() const { return m_mask + 1; }
+};
+
+#endif // CONCURRENTSET_H
@@ -0,0 +1,466 @@
+#include "dataset.h"
+#include "atomicfile.h"
+#include "trace.h"
+#include <QByteArray>
+#include <QThread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+const char DATASET_MAGIC[8] = {'T', 'T', 'T', 'D', 'A', 'T', 'A', '1'};
+const char DATASET_INDEX_MAGIC[8] = {'T', 'T', 'T', 'D', 'I', 'D', 'X', '1'};
+
+// Bytes of one row over all columns
+const size_t DATASET_ROW_BYTES = 2 * sizeof(uint64_t) + 3 * sizeof(uint8_t) + sizeof(int32_t);
+
+struct DatasetHeader
+{
+    char magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint32_t k;
+    uint32_t chunkRows;
+};
+
+struct DatasetChunkHeader
+{
+    uint32_t rows;
+    uint32_t compressedBytes;
+    uint32_t checksum;          // of the compressed bytes
+};
+
+// Last bytes of the file, after the chunk offsets
+struct DatasetTrailer
+{
+    uint64_t indexOffset;
+    uint64_t chunks;
+    uint64_t rows;
+    char magic[8];
+};
+
+//------------------------------------------------------------------------
+// Compresses and writes the chunks DatasetWriter hands over
+//------------------------------------------------------------------------
+class DatasetWriterThread: public QThread
+{
+private:
+    DatasetWriter & m_writer;
+
+public:
+    explicit DatasetWriterThread(DatasetWriter & writer) : QThread(), m_writer(writer) {}
+
+    void run()
+    {
+        TRACE_THREAD_NAME("DatasetWriter");
+        m_writer.WriteChunks();
+    }
+};
+
+// FNV-1a
+static uint32_t Checksum(const char * data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AppendShuffled
+//
+// @description             : Appends a column byte by byte: the first byte of
+//                            every value, then the second byte of every value,
+//                            and so on
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+template <typename T> static void AppendShuffled(std::string & out, const std::vector<T> & values)
+{
+    size_t start = out.size();
+    out.resize(start + values.size() * sizeof(T));
+    for (size_t byte = 0; byte < sizeof(T); byte++)
+    {
+        char * column = &out[start + byte * values.size()];
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            column[i] = reinterpret_cast<const char *>(&values[i])[byte];
+        }
+    }
+}
+
+template <typename T> static void ReadShuffled(const char * data, size_t count, std::vector<T> & values)
+{
+    values.assign(count, T());
+    for (size_t byte = 0; byte < sizeof(T); byte++)
+    {
+        const char * column = data + byte * count;
+        for (size_t i = 0; i < count; i++)
+        {
+            reinterpret_cast<char *>(&values[i])[byte] = column[i];
+        }
+    }
+}
+
+DatasetWriter::DatasetWriter()
+{
+    m_chunkRows = DATASET_CHUNK_ROWS;
+    m_compressionLevel = 6;
+    m_bClosing = false;
+    m_bFailed = false;
+    m_thread = nullptr;
+    m_stats = DatasetStats();
+}
+
+DatasetWriter::~DatasetWriter()
+{
+    Close();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Open
+//
+// @description             : Starts a dataset of an m,n,k board at 'path' and
+//                            the thread that writes it
+//
+// @return                  : true if the file could be created
+//--------------------------------------------------------------------------------
+bool DatasetWriter::Open(const std::string & path, size_t width, size_t height, size_t k, uint32_t chunkRows,
+                         int compressionLevel)
+{
+    Close();
+
+    m_path = path;
+    m_chunkRows = (chunkRows > 0) ? chunkRows : DATASET_CHUNK_ROWS;
+    m_compressionLevel = compressionLevel;
+    m_bClosing = false;
+    m_bFailed = false;
+    m_current.clear();
+    m_current.reserve(m_chunkRows);
+    m_chunks.clear();
+    m_chunkOffsets.clear();
+    m_stats = DatasetStats();
+
+    std::string temporary = path + ".tmp";
+    m_file.open(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        return false;
+    }
+
+    DatasetHeader header;
+    memcpy(header.magic, DATASET_MAGIC, sizeof(header.magic));
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.k = static_cast<uint32_t>(k);
+    header.chunkRows = m_chunkRows;
+    m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    m_thread = new DatasetWriterThread(*this);
+    m_thread->start();
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Append
+//
+// @description             : Adds rows to the chunk being filled. A full chunk
+//                            goes to the writer thread; the caller only waits
+//                            when the writer is DATASET_MAX_QUEUED_CHUNKS
+//                            chunks behind.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void DatasetWriter::Append(const std::vector<DatasetRow> & rows)
+{
+    QMutexLocker lock(&m_mutex);
+    for (auto it = rows.begin(); it != rows.end(); it++)
+    {
+        m_current.push_back(*it);
+        m_stats.rows++;
+        if (m_current.size() < m_chunkRows)
+        {
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        while (m_chunks.size() >= DATASET_MAX_QUEUED_CHUNKS)
+        {
+            m_written.wait(&m_mutex);
+        }
+        m_stats.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        m_chunks.push_back(std::vector<DatasetRow>());
+        m_chunks.back().swap(m_current);
+        m_current.reserve(m_chunkRows);
+        m_queued.wakeOne();
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : WriteChunks
+//
+// @description             : Writer thread loop, until Close and the last chunk
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void DatasetWriter::WriteChunks()
+{
+    for (;;)
+    {
+        std::vector<DatasetRow> chunk;
+        {
+            QMutexLocker lock(&m_mutex);
+            while (m_chunks.empty() && !m_bClosing)
+            {
+                m_queued.wait(&m_mutex);
+            }
+            if (m_chunks.empty())
+            {
+                return;
+            }
+            chunk.swap(m_chunks.front());
+            m_chunks.pop_front();
+            m_written.wakeAll();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool bWritten = WriteChunk(chunk);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        QMutexLocker lock(&m_mutex);
+        m_bFailed = m_bFailed || !bWritten;
+        m_stats.writerSeconds += seconds;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : WriteChunk
+//
+// @description             : Lays the rows out by column, compresses them and
+//                            appends the chunk to the file. Only the writer
+//                            thread calls this.
+//
+// @return                  : true if the chunk was written
+//--------------------------------------------------------------------------------
+bool DatasetWriter::WriteChunk(const std::vector<DatasetRow> & rows)
+{
+    TRACE_SCOPE("DatasetWriter::WriteChunk");
+
+    std::vector<uint64_t> first(rows.size());
+    std::vector<uint64_t> second(rows.size());
+    std::vector<uint8_t> side(rows.size());
+    std::vector<uint8_t> move(rows.size());
+    std::vector<int8_t> outcome(rows.size());
+    std::vector<int32_t> value(rows.size());
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        first[i] = rows[i].first;
+        second[i] = rows[i].second;
+        side[i] = rows[i].side;
+        move[i] = rows[i].move;
+        outcome[i] = rows[i].outcome;
+        value[i] = rows[i].value;
+    }
+
+    std::string columns;
+    columns.reserve(rows.size() * DATASET_ROW_BYTES);
+    AppendShuffled(columns, first);
+    AppendShuffled(columns, second);
+    AppendShuffled(columns, side);
+    AppendShuffled(columns, move);
+    AppendShuffled(columns, outcome);
+    AppendShuffled(columns, value);
+
+    QByteArray compressed = qCompress(reinterpret_cast<const uchar *>(columns.data()),
+                                      static_cast<int>(columns.size()), m_compressionLevel);
+
+    DatasetChunkHeader header;
+    header.rows = static_cast<uint32_t>(rows.size());
+    header.compressedBytes = static_cast<uint32_t>(compressed.size());
+    header.checksum = Checksum(compressed.constData(), compressed.size());
+
+    m_chunkOffsets.push_back(static_cast<uint64_t>(m_file.tellp()));
+    m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_file.write(compressed.constData(), compressed.size());
+
+    m_stats.chunks++;
+    m_stats.rawBytes += columns.size();
+    m_stats.compressedBytes += sizeof(header) + compressed.size();
+    return static_cast<bool>(m_file);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Close
+//
+// @description             : Writes the partly filled chunk, waits for the
+//                            writer thread, appends the chunk index and moves
+//                            the file into place
+//
+// @return                  : true if the whole dataset was written
+//--------------------------------------------------------------------------------
+bool DatasetWriter::Close()
+{
+    if (!m_thread)
+    {
+        return false;
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_current.empty())
+        {
+            m_chunks.push_back(std::vector<DatasetRow>());
+            m_chunks.back().swap(m_current);
+        }
+        m_bClosing = true;
+        m_queued.wakeAll();
+    }
+
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    DatasetTrailer trailer;
+    trailer.indexOffset = static_cast<uint64_t>(m_file.tellp());
+    trailer.chunks = m_chunkOffsets.size();
+    trailer.rows = m_stats.rows;
+    memcpy(trailer.magic, DATASET_INDEX_MAGIC, sizeof(trailer.magic));
+    m_file.write(reinterpret_cast<const char *>(m_chunkOffsets.data()), m_chunkOffsets.size() * sizeof(uint64_t));
+    m_file.write(reinterpret_cast<const char *>(&trailer), sizeof(trailer));
+    m_file.close();
+
+    std::string temporary = m_path + ".tmp";
+    if (m_bFailed || !m_file)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return CommitFile(temporary, m_path);
+}
+
+DatasetReader::DatasetReader()
+{
+    m_rows = 0;
+    m_width = 0;
+    m_height = 0;
+    m_k = 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Open
+//
+// @description             : Reads the header and the chunk index
+//
+// @return                  : true if the file is a complete dataset
+//--------------------------------------------------------------------------------
+bool DatasetReader::Open(const std::string & path)
+{
+    m_file.close();
+    m_file.clear();
+    m_chunkOffsets.clear();
+    m_rows = 0;
+
+    m_file.open(path.c_str(), std::ios::binary);
+    DatasetHeader header;
+    if (!m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, DATASET_MAGIC, sizeof(header.magic)) != 0)
+    {
+        return false;
+    }
+
+    DatasetTrailer trailer;
+    m_file.seekg(-static_cast<std::streamoff>(sizeof(trailer)), std::ios::end);
+    std::streamoff trailerOffset = m_file.tellg();
+    if (!m_file.read(reinterpret_cast<char *>(&trailer), sizeof(trailer)) ||
+        memcmp(trailer.magic, DATASET_INDEX_MAGIC, sizeof(trailer.magic)) != 0 ||
+        trailer.indexOffset + trailer.chunks * sizeof(uint64_t) != static_cast<uint64_t>(trailerOffset))
+    {
+        return false;
+    }
+
+    m_chunkOffsets.resize(trailer.chunks);
+    m_file.seekg(static_cast<std::streamoff>(trailer.indexOffset));
+    if (!m_file.read(reinterpret_cast<char *>(m_chunkOffsets.data()), trailer.chunks * sizeof(uint64_t)))
+    {
+        m_chunkOffsets.clear();
+        return false;
+    }
+
+    m_rows = trailer.rows;
+    m_width = header.width;
+    m_height = header.height;
+    m_k = header.k;
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : ReadChunk
+//
+// @description             : Decompresses chunk 'chunk' into rows
+//
+// @return                  : false if the chunk is damaged
+//--------------------------------------------------------------------------------
+bool DatasetReader::ReadChunk(size_t chunk, std::vector<DatasetRow> & rows)
+{
+    if (chunk >= m_chunkOffsets.size())
+    {
+        return false;
+    }
+
+    DatasetChunkHeader header;
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(m_chunkOffsets[chunk]));
+    if (!m_file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        return false;
+    }
+
+    std::string compressed(header.compressedBytes, '\0');
+    if (!m_file.read(&compressed[0], compressed.size()) ||
+        Checksum(compressed.data(), compressed.size()) != header.checksum)
+    {
+        return false;
+    }
+
+    QByteArray columns = qUncompress(reinterpret_cast<const uchar *>(compressed.data()),
+                                     static_cast<int>(compressed.size()));
+    size_t count = header.rows;
+    if (static_cast<size_t>(columns.size()) != count * DATASET_ROW_BYTES)
+    {
+        return false;
+    }
+
+    const char * data = columns.constData();
+    std::vector<uint64_t> first;
+    std::vector<uint64_t> second;
+    std::vector<uint8_t> side;
+    std::vector<uint8_t> move;
+    std::vector<int8_t> outcome;
+    std::vector<int32_t> value;
+    ReadShuffled(data, count, first);
+    data += count * sizeof(uint64_t);
+    ReadShuffled(data, count, second);
+    data += count * sizeof(uint64_t);
+    ReadShuffled(data, count, side);
+    data += count;
+    ReadShuffled(data, count, move);
+    data += count;
+    ReadShuffled(data, count, outcome);
+    data += count;
+    ReadShuffled(data, count, value);
+
+    rows.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        rows[i].first = first[i];
+        rows[i].second = second[i];
+        rows[i].side = side[i];
+        rows[i].move = move[i];
+        rows[i].outcome = outcome[i];
+        rows[i].value = value[i];
+    }
+    return true;
+}
@@ -0,0 +1,114 @@
+#ifndef DATASET_H
+#define DATASET_H
+#include <QMutex>
+#include <QWaitCondition>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Rows per chunk; every chunk is compressed on its own
+const uint32_t DATASET_CHUNK_ROWS = 65536;
+
+// Full chunks waiting for the writer thread before Append blocks
+const size_t DATASET_MAX_QUEUED_CHUNKS = 4;
+
+//------------------------------------------------------------------------
+// One training sample: a position of an m,n,k board of up to 64 cells,
+// the move played there and how things turned out for the side to move
+//------------------------------------------------------------------------
+struct DatasetRow
+{
+    uint64_t first;         // stones of the player who moved first
+    uint64_t second;        // stones of the player who moved second
+    uint8_t side;           // 0 if the first player is to move, 1 otherwise
+    uint8_t move;           // cell
+    int8_t outcome;         // final result for the side to move: 1 win, 0 draw, -1 loss
+    int32_t value;          // search score for the side to move
+};
+
+struct DatasetStats
+{
+    uint64_t rows;
+    uint64_t chunks;
+    uint64_t rawBytes;              // columns before compression
+    uint64_t compressedBytes;
+    double writerSeconds;           // spent compressing and writing
+    double stallSeconds;            // callers blocked waiting for the writer
+};
+
+class DatasetWriterThread;
+
+//------------------------------------------------------------------------
+// Streaming writer of self-play datasets.
+//
+// The file is a header, a series of chunks and an index of the chunks.
+// A chunk holds up to DATASET_CHUNK_ROWS rows stored by column, each
+// column byte-shuffled (all first bytes, then all second bytes, ...) so
+// the mostly zero high bytes compress away, and the chunk is compressed
+// as a whole. Rows are buffered until a chunk is full; a writer thread
+// compresses and writes full chunks while the callers carry on. Append
+// may be called from any number of threads. The file is written under a
+// temporary name and renamed by Close.
+//------------------------------------------------------------------------
+class DatasetWriter
+{
+    friend class DatasetWriterThread;
+
+private:
+    std::string m_path;
+    std::ofstream m_file;
+    QMutex m_mutex;
+    QWaitCondition m_queued;
+    QWaitCondition m_written;
+    std::vector<DatasetRow> m_current;                  // chunk being filled
+    std::deque<std::vector<DatasetRow> > m_chunks;      // full chunks for the writer
+    std::vector<uint64_t> m_chunkOffsets;
+    uint32_t m_chunkRows;
+    int m_compressionLevel;
+    bool m_bClosing;
+    bool m_bFailed;
+    DatasetWriterThread * m_thread;
+    DatasetStats m_stats;
+
+    void WriteChunks();
+    bool WriteChunk(const std::vector<DatasetRow> & rows);
+
+public:
+    DatasetWriter();
+    ~DatasetWriter();
+
+    bool Open(const std::string & path, size_t width, size_t height, size_t k,
+              uint32_t chunkRows = DATASET_CHUNK_ROWS, int compressionLevel = 6);
+    void Append(const std::vector<DatasetRow> & rows);
+    bool Close();
+    const DatasetStats & GetStats() const { return m_stats; }
+};
+
+//------------------------------------------------------------------------
+// Reads a dataset back one chunk at a time
+//------------------------------------------------------------------------
+class DatasetReader
+{
+private:
+    std::ifstream m_file;
+    std::vector<uint64_t> m_chunkOffsets;
+    uint64_t m_rows;
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+
+public:
+    DatasetReader();
+
+    bool Open(const std::string & path);
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetK() const { return m_k; }
+    uint64_t GetRowCount() const { return m_rows; }
+    size_t GetChunkCount() const { return m_chunkOffsets.size(); }
+    bool ReadChunk(size_t chunk, std::vector<DatasetRow> & rows);
+};
+
+#endif // DATASET_H
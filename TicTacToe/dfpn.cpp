@@ -0,0 +1,553 @@
+#include "dfpn.h"
+#include "atomicfile.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+const char CHECKPOINT_MAGIC[8] = {'D', 'F', 'P', 'N', 'C', 'K', 'P', '1'};
+
+// Added to the position key so both proofs can share one table
+const uint64_t ATTACKER_KEYS[2] = {0x3C6EF372FE94F82AULL, 0xA54FF53A5F1D36F1ULL};
+
+// Keys come from a fixed seed so checkpoints stay valid between runs
+const uint64_t DFPN_HASH_SEED = 0x6A09E667F3BCC909ULL;
+
+static uint32_t SaturatingAdd(uint32_t a, uint32_t b)
+{
+    return (a >= PROOF_INFINITY - b) ? PROOF_INFINITY : a + b;
+}
+
+static int PlayerIndex(Player_t player)
+{
+    return (player == PLAYER_USER) ? 0 : 1;
+}
+
+DfpnSolver::DfpnSolver(size_t tableMegabytes)
+{
+    // Largest power of two that fits, so the key can be masked
+    size_t entries = 2;
+    while (entries * 2 * sizeof(TableEntry) <= tableMegabytes * 1024 * 1024)
+    {
+        entries *= 2;
+    }
+
+    TableEntry empty = {0, 0, 0, 0};
+    m_table.assign(entries, empty);
+
+    m_masks[0] = 0;
+    m_masks[1] = 0;
+    m_width = 0;
+    m_height = 0;
+    m_k = 0;
+    m_attacker = PLAYER_USER;
+    m_nodes = 0;
+    m_sliceEnd = 0;
+    m_stopped = false;
+    m_seconds = 0.0;
+    m_winProof.pn = m_winProof.dn = 1;
+    m_lossProof.pn = m_lossProof.dn = 1;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetBoard
+//
+// @description             : Builds the keys, symmetry transforms and winning
+//                            lines for the board of 'game'. The table is only
+//                            cleared when the board changes.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void DfpnSolver::SetBoard(const MnkGame & game)
+{
+    assert(game.GetCellCount() <= 64);
+
+    if (game.GetWidth() == m_width && game.GetHeight() == m_height && game.GetK() == m_k)
+    {
+        return;
+    }
+
+    TableEntry empty = {0, 0, 0, 0};
+    std::fill(m_table.begin(), m_table.end(), empty);
+    m_width = game.GetWidth();
+    m_height = game.GetHeight();
+    m_k = game.GetK();
+
+    m_hasher = CanonicalHasher(m_width, m_height, DFPN_HASH_SEED);
+
+    m_lines = GetMnkLineMasks(m_width, m_height, m_k);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetKeys
+//
+// @description             : Zobrist key of the position under every symmetry
+//                            of the board, for the proof that 'attacker' wins
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void DfpnSolver::GetKeys(const MnkGame & game, Player_t attacker, uint64_t keys[SYMMETRY_COUNT]) const
+{
+    for (int symmetry = 0; symmetry < m_hasher.GetSymmetryCount(); symmetry++)
+    {
+        keys[symmetry] = ATTACKER_KEYS[PlayerIndex(attacker)];
+        for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+        {
+            if (game.GetCell(cell) != PLAYER_NONE)
+            {
+                keys[symmetry] ^= m_hasher.GetStoneKey(cell, PlayerIndex(game.GetCell(cell)), symmetry);
+            }
+        }
+    }
+}
+
+uint64_t DfpnSolver::GetCanonicalKey(const uint64_t keys[SYMMETRY_COUNT]) const
+{
+    uint64_t key = keys[0];
+    for (int symmetry = 1; symmetry < m_hasher.GetSymmetryCount(); symmetry++)
+    {
+        key = std::min(key, keys[symmetry]);
+    }
+
+    return key;
+}
+
+// Can 'player' still complete any line?
+bool DfpnSolver::HasLiveLine(Player_t player) const
+{
+    uint64_t opponent = m_masks[1 - PlayerIndex(player)];
+    for (auto it = m_lines.begin(); it != m_lines.end(); it++)
+    {
+        if ((*it & opponent) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Lookup / Store
+//
+// @description             : Two-way buckets. A new position replaces the entry
+//                            that took less work to compute, so large proven
+//                            subtrees survive when the table is full.
+//
+// @return                  : Lookup: true if the key was found
+//--------------------------------------------------------------------------------
+bool DfpnSolver::Lookup(uint64_t key, ProofNumbers & numbers) const
+{
+    size_t bucket = static_cast<size_t>(key) & (m_table.size() - 2);
+    for (size_t i = bucket; i < bucket + 2; i++)
+    {
+        if (m_table[i].key == key)
+        {
+            numbers.pn = m_table[i].pn;
+            numbers.dn = m_table[i].dn;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DfpnSolver::Store(uint64_t key, ProofNumbers numbers, uint64_t work)
+{
+    size_t bucket = static_cast<size_t>(key) & (m_table.size() - 2);
+    size_t slot = bucket;
+    if (m_table[bucket].key != key)
+    {
+        if (m_table[bucket + 1].key == key || m_table[bucket + 1].work < m_table[bucket].work)
+        {
+            slot = bucket + 1;
+        }
+    }
+
+    TableEntry & entry = m_table[slot];
+    entry.key = key;
+    entry.pn = numbers.pn;
+    entry.dn = numbers.dn;
+    entry.work = work;
+}
+
+size_t DfpnSolver::GetTableEntriesUsed() const
+{
+    size_t used = 0;
+    for (auto it = m_table.begin(); it != m_table.end(); it++)
+    {
+        if (it->key != 0)
+        {
+            used++;
+        }
+    }
+
+    return used;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Mid
+//
+// @description             : Expands the node until its proof number reaches
+//                            thresholds.pn or its disproof number reaches
+//                            thresholds.dn. The attacker picks at OR nodes,
+//                            the defender at AND nodes. A draw counts as a
+//                            disproof, the same as a defender win.
+//
+// @return                  : numbers of the node, also stored in the table
+//--------------------------------------------------------------------------------
+void DfpnSolver::Mid(MnkGame & game, const uint64_t keys[SYMMETRY_COUNT], ProofNumbers thresholds,
+                     ProofNumbers & numbers)
+{
+    struct Child
+    {
+        size_t cell;
+        uint64_t keys[SYMMETRY_COUNT];
+        uint64_t key;
+        ProofNumbers numbers;
+    };
+
+    unsigned long long startNodes = m_nodes++;
+    if (m_nodes >= m_sliceEnd)
+    {
+        m_stopped = true;
+    }
+
+    uint64_t key = GetCanonicalKey(keys);
+    Player_t mover = game.GetTurn();
+    bool bOrNode = (mover == m_attacker);
+    int moverIndex = PlayerIndex(mover);
+
+    std::vector<Child> children;
+    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+    {
+        if (game.GetCell(cell) != PLAYER_NONE)
+        {
+            continue;
+        }
+
+        Child child = Child();
+        child.cell = cell;
+        for (int symmetry = 0; symmetry < m_hasher.GetSymmetryCount(); symmetry++)
+        {
+            child.keys[symmetry] = keys[symmetry] ^ m_hasher.GetStoneKey(cell, moverIndex, symmetry);
+        }
+        child.key = GetCanonicalKey(child.keys);
+
+        game.AddPlayerMarkToBoard(cell);
+        m_masks[moverIndex] |= 1ULL << cell;
+        if (game.CheckWin() != PLAYER_NONE)
+        {
+            bool bAttackerWins = (game.CheckWin() == m_attacker);
+            child.numbers.pn = bAttackerWins ? 0 : PROOF_INFINITY;
+            child.numbers.dn = bAttackerWins ? PROOF_INFINITY : 0;
+        }
+        else if (game.GameOver() || !HasLiveLine(m_attacker))
+        {
+            child.numbers.pn = PROOF_INFINITY;
+            child.numbers.dn = 0;
+        }
+        else if (!Lookup(child.key, child.numbers))
+        {
+            child.numbers.pn = 1;
+            child.numbers.dn = 1;
+        }
+        m_masks[moverIndex] &= ~(1ULL << cell);
+        game.UndoMove();
+
+        // One winning reply decides the node without expanding the rest
+        if ((bOrNode && child.numbers.pn == 0) || (!bOrNode && child.numbers.dn == 0))
+        {
+            numbers = child.numbers;
+            Store(key, numbers, m_nodes - startNodes);
+            return;
+        }
+        children.push_back(child);
+    }
+    assert(!children.empty());
+
+    while (true)
+    {
+        // Sum over the children on one side, minimum on the other
+        uint32_t minimum = PROOF_INFINITY;
+        uint32_t second = PROOF_INFINITY;
+        uint32_t sum = 0;
+        size_t best = 0;
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            Lookup(children[i].key, children[i].numbers);
+
+            uint32_t selector = bOrNode ? children[i].numbers.pn : children[i].numbers.dn;
+            uint32_t other = bOrNode ? children[i].numbers.dn : children[i].numbers.pn;
+            if (selector < minimum)
+            {
+                second = minimum;
+                minimum = selector;
+                best = i;
+            }
+            else if (selector < second)
+            {
+                second = selector;
+            }
+            sum = SaturatingAdd(sum, other);
+        }
+
+        numbers.pn = bOrNode ? minimum : sum;
+        numbers.dn = bOrNode ? sum : minimum;
+        if (numbers.pn >= thresholds.pn || numbers.dn >= thresholds.dn || m_stopped)
+        {
+            break;
+        }
+
+        Child & child = children[best];
+        ProofNumbers childThresholds;
+        if (bOrNode)
+        {
+            childThresholds.pn = std::min(thresholds.pn, SaturatingAdd(second, 1));
+            childThresholds.dn = thresholds.dn - numbers.dn + child.numbers.dn;
+        }
+        else
+        {
+            childThresholds.pn = thresholds.pn - numbers.pn + child.numbers.pn;
+            childThresholds.dn = std::min(thresholds.dn, SaturatingAdd(second, 1));
+        }
+
+        game.AddPlayerMarkToBoard(child.cell);
+        m_masks[moverIndex] |= 1ULL << child.cell;
+        Mid(game, child.keys, childThresholds, child.numbers);
+        m_masks[moverIndex] &= ~(1ULL << child.cell);
+        game.UndoMove();
+    }
+
+    Store(key, numbers, m_nodes - startNodes);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Prove
+//
+// @description             : Runs df-pn from the root in slices of
+//                            checkpointNodes nodes, saving a checkpoint after
+//                            every slice, until 'attacker' is proven to win or
+//                            not to win, or maxNodes is reached.
+//
+// @return                  : true if the proof completed
+//--------------------------------------------------------------------------------
+bool DfpnSolver::Prove(MnkGame & game, Player_t attacker, unsigned long long maxNodes,
+                       unsigned long long checkpointNodes, const std::string & checkpointPath,
+                       ProofNumbers & numbers)
+{
+    auto start = std::chrono::steady_clock::now();
+    double startSeconds = m_seconds;
+
+    m_attacker = attacker;
+    uint64_t keys[SYMMETRY_COUNT];
+    GetKeys(game, attacker, keys);
+    if (!Lookup(GetCanonicalKey(keys), numbers))
+    {
+        numbers.pn = 1;
+        numbers.dn = 1;
+    }
+
+    while (numbers.pn != 0 && numbers.dn != 0)
+    {
+        if (maxNodes != 0 && m_nodes >= maxNodes)
+        {
+            return false;
+        }
+
+        m_sliceEnd = m_nodes + checkpointNodes;
+        if (maxNodes != 0)
+        {
+            m_sliceEnd = std::min(m_sliceEnd, maxNodes);
+        }
+        m_stopped = false;
+
+        ProofNumbers thresholds = {PROOF_INFINITY, PROOF_INFINITY};
+        Mid(game, keys, thresholds, numbers);
+
+        m_seconds = startSeconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!checkpointPath.empty())
+        {
+            SaveCheckpoint(checkpointPath, game, m_seconds);
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Solve
+//
+// @description             : Proves the position for the side to move: a win
+//                            if it can force one, a loss if the opponent can,
+//                            otherwise a draw
+//
+// @return                  : ProofResult_t
+//--------------------------------------------------------------------------------
+ProofResult_t DfpnSolver::Solve(const MnkGame & game, unsigned long long maxNodes,
+                                const std::string & checkpointPath, unsigned long long checkpointNodes)
+{
+    assert(checkpointNodes > 0);
+
+    SetBoard(game);
+    m_masks[0] = 0;
+    m_masks[1] = 0;
+    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+    {
+        if (game.GetCell(cell) != PLAYER_NONE)
+        {
+            m_masks[PlayerIndex(game.GetCell(cell))] |= 1ULL << cell;
+        }
+    }
+
+    m_nodes = 0;
+    m_seconds = 0.0;
+    m_winProof.pn = m_winProof.dn = 1;
+    m_lossProof.pn = m_lossProof.dn = 1;
+
+    Player_t mover = game.GetTurn();
+    if (game.GameOver())
+    {
+        if (game.CheckWin() == PLAYER_NONE)
+        {
+            return PROOF_DRAW;
+        }
+        return (game.CheckWin() == mover) ? PROOF_WIN : PROOF_LOSS;
+    }
+
+    if (!checkpointPath.empty())
+    {
+        LoadCheckpoint(checkpointPath, game);
+    }
+
+    MnkGame position = game;
+    if (!Prove(position, mover, maxNodes, checkpointNodes, checkpointPath, m_winProof))
+    {
+        return PROOF_UNKNOWN;
+    }
+    if (m_winProof.pn == 0)
+    {
+        return PROOF_WIN;
+    }
+
+    Player_t opponent = (mover == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    if (!Prove(position, opponent, maxNodes, checkpointNodes, checkpointPath, m_lossProof))
+    {
+        return PROOF_UNKNOWN;
+    }
+
+    return (m_lossProof.pn == 0) ? PROOF_LOSS : PROOF_DRAW;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SaveCheckpoint
+//
+// @description             : Writes the root position, counters and every used
+//                            table entry. The file is written under a temporary
+//                            name and renamed, so a crash never leaves a torn
+//                            checkpoint behind.
+//
+// @return                  : true on success
+//--------------------------------------------------------------------------------
+bool DfpnSolver::SaveCheckpoint(const std::string & path, const MnkGame & game, double seconds) const
+{
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    uint64_t header[6] = {game.GetWidth(), game.GetHeight(), game.GetK(), m_table.size(),
+                          m_nodes, GetTableEntriesUsed()};
+    file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&seconds), sizeof(seconds));
+    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+    {
+        uint8_t owner = static_cast<uint8_t>(game.GetCell(cell));
+        file.write(reinterpret_cast<const char *>(&owner), sizeof(owner));
+    }
+
+    for (size_t i = 0; i < m_table.size(); i++)
+    {
+        if (m_table[i].key != 0)
+        {
+            uint64_t index = i;
+            file.write(reinterpret_cast<const char *>(&index), sizeof(index));
+            file.write(reinterpret_cast<const char *>(&m_table[i]), sizeof(TableEntry));
+        }
+    }
+
+    file.close();
+    if (!file)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return CommitFile(temporary, path);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : LoadCheckpoint
+//
+// @description             : Restores the table and counters if the checkpoint
+//                            belongs to the same position and table size
+//
+// @return                  : true if a checkpoint was resumed
+//--------------------------------------------------------------------------------
+bool DfpnSolver::LoadCheckpoint(const std::string & path, const MnkGame & game)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint64_t header[6];
+    double seconds;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    file.read(reinterpret_cast<char *>(&seconds), sizeof(seconds));
+    if (!file || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+        header[0] != game.GetWidth() || header[1] != game.GetHeight() || header[2] != game.GetK() ||
+        header[3] != m_table.size())
+    {
+        return false;
+    }
+
+    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+    {
+        uint8_t owner;
+        file.read(reinterpret_cast<char *>(&owner), sizeof(owner));
+        if (!file || owner != static_cast<uint8_t>(game.GetCell(cell)))
+        {
+            return false;
+        }
+    }
+
+    std::vector<TableEntry> table(m_table.size());
+    TableEntry empty = {0, 0, 0, 0};
+    std::fill(table.begin(), table.end(), empty);
+    for (uint64_t i = 0; i < header[5]; i++)
+    {
+        uint64_t index;
+        TableEntry entry;
+        file.read(reinterpret_cast<char *>(&index), sizeof(index));
+        file.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+        if (!file || index >= table.size())
+        {
+            return false;
+        }
+        table[index] = entry;
+    }
+
+    m_table.swap(table);
+    m_nodes = header[4];
+    m_seconds = seconds;
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef DFPN_H
+#define DFPN_H
+#include "mnkgame.h"
+#include "symmetry.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Depth-first proof-number search (df-pn) for m,n,k positions.
+//
+// A position is solved with two proofs: can the side to move force a win,
+// and if not, can the opponent. Proof and disproof numbers live in a
+// fixed-size transposition table, so memory stays bounded however long
+// the proof runs. The table can be written to a checkpoint file at
+// regular intervals and loaded again to resume an interrupted proof.
+// The table is kept between Solve calls on the same board, so positions
+// shared by several roots are proven only once. Positions are stored
+// under their smallest key over the board symmetries, and a node where
+// the attacker has no line left to complete is disproven on the spot.
+// Boards are limited to 64 cells.
+//------------------------------------------------------------------------
+typedef enum ProofResult_tag
+{
+    PROOF_UNKNOWN,
+    PROOF_WIN,
+    PROOF_DRAW,
+    PROOF_LOSS
+}ProofResult_t;
+
+const uint32_t PROOF_INFINITY = 0x7FFFFFFF;
+
+struct ProofNumbers
+{
+    uint32_t pn;
+    uint32_t dn;
+};
+
+class DfpnSolver
+{
+private:
+    struct TableEntry
+    {
+        uint64_t key;
+        uint32_t pn;
+        uint32_t dn;
+        uint64_t work;
+    };
+
+    std::vector<TableEntry> m_table;
+    CanonicalHasher m_hasher;               // stone kinds by player, not side to move
+    std::vector<uint64_t> m_lines;
+    uint64_t m_masks[2];
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    Player_t m_attacker;
+    unsigned long long m_nodes;
+    unsigned long long m_sliceEnd;
+    bool m_stopped;
+    double m_seconds;
+    ProofNumbers m_winProof;
+    ProofNumbers m_lossProof;
+
+    void SetBoard(const MnkGame & game);
+    void GetKeys(const MnkGame & game, Player_t attacker, uint64_t keys[SYMMETRY_COUNT]) const;
+    uint64_t GetCanonicalKey(const uint64_t keys[SYMMETRY_COUNT]) const;
+    bool HasLiveLine(Player_t player) const;
+    bool Lookup(uint64_t key, ProofNumbers & numbers) const;
+    void Store(uint64_t key, ProofNumbers numbers, uint64_t work);
+    void Mid(MnkGame & game, const uint64_t keys[SYMMETRY_COUNT], ProofNumbers thresholds, ProofNumbers & numbers);
+    bool Prove(MnkGame & game, Player_t attacker, unsigned long long maxNodes,
+               unsigned long long checkpointNodes, const std::string & checkpointPath, ProofNumbers & numbers);
+    bool SaveCheckpoint(const std::string & path, const MnkGame & game, double seconds) const;
+    bool LoadCheckpoint(const std::string & path, const MnkGame & game);
+
+public:
+    explicit DfpnSolver(size_t tableMegabytes);
+
+    // Solves 'game' for the side to move. Stops with PROOF_UNKNOWN after
+    // maxNodes (0 = no limit). With a checkpoint path the table is saved
+    // every checkpointNodes nodes and a matching checkpoint is resumed.
+    ProofResult_t Solve(const MnkGame & game, unsigned long long maxNodes = 0,
+                        const std::string & checkpointPath = std::string(),
+                        unsigned long long checkpointNodes = 1000000);
+
+    unsigned long long GetNodes() const { return m_nodes; }
+    double GetSeconds() const { return m_seconds; }
+    ProofNumbers GetWinProof() const { return m_winProof; }
+    ProofNumbers GetLossProof() const { return m_lossProof; }
+    size_t GetTableBytes() const { return m_table.size() * sizeof(TableEntry); }
+    size_t GetTableEntriesUsed() const;
+};
+
+#endif // DFPN_H
@@ -0,0 +1,504 @@
+#include "engine.h"
+#include "symmetry.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <cmath>
+
+// Score of a win found 'ply' moves into the search; quicker wins score higher
+const int WIN_SCORE = 10;
+
+const size_t MCTS_ITERATIONS = 1000;
+const size_t MCTS_MAX_TIMED_ITERATIONS = 50000;
+const size_t MCTS_PLAYOUTS_PER_LEAF = 32;
+const double MCTS_EXPLORATION = 1.4;
+const size_t MCTS_NO_NODE = static_cast<size_t>(-1);
+
+// Searches look at the clock this often (nodes for minimax, iterations for
+// MCTS); both must be a power of two minus one
+const unsigned long long MINIMAX_CLOCK_CHECK_MASK = 1023;
+const size_t MCTS_CLOCK_CHECK_MASK = 63;
+
+// Share of the soft time limit used when the search is still changing its
+// mind, and when it has settled
+const int UNSTABLE_TIME_PERCENT = 200;
+const int STABLE_TIME_PERCENT = 50;
+
+// Root visit share of the runner up below which the MCTS best move is settled
+const double MCTS_SETTLED_RATIO = 0.5;
+
+RandomEngine::RandomEngine() : m_rng(std::random_device()())
+{
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Picks any available move at random
+//
+// @return                  : position of the move on the board
+//--------------------------------------------------------------------------------
+size_t RandomEngine::SelectMove(const Game & game, Player_t player)
+{
+    (void)player;
+    std::vector<size_t> moves = game.GetAvailableMoves();
+    std::uniform_int_distribution<size_t> pick(0, moves.size() - 1);
+    return moves[pick(m_rng)];
+}
+
+HeuristicEngine::HeuristicEngine() : m_rng(std::random_device()())
+{
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Delegates to the game's built-in heuristic
+//
+// @return                  : position of the move on the board
+//--------------------------------------------------------------------------------
+size_t HeuristicEngine::SelectMove(const Game & game, Player_t player)
+{
+    return game.GetBestMove(player, m_rng);
+}
+
+MinimaxEngine::MinimaxEngine() : m_rng(std::random_device()()), m_nodes(0), m_stopped(false)
+{
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Negamax
+//
+// @description             : Depth limited alpha-beta search. 'own' is the side
+//                            to move and 'opponent' the side that just moved.
+//                            Positions at the horizon score as a draw. Fills the
+//                            principal variation table from 'ply' onwards. Once
+//                            the hard time limit passes it unwinds without
+//                            searching further and the result is meaningless.
+//
+// @return                  : score from the point of view of the side to move
+//--------------------------------------------------------------------------------
+int MinimaxEngine::Negamax(BoardMask_t own, BoardMask_t opponent, int ply, int depth, int alpha, int beta)
+{
+    m_nodes++;
+    m_pvLength[ply] = static_cast<size_t>(ply);
+
+    if ((m_nodes & MINIMAX_CLOCK_CHECK_MASK) == 0 && IsOutOfTime())
+    {
+        m_stopped = true;
+    }
+    if (m_stopped)
+    {
+        return 0;
+    }
+
+    if (IsWinMask(opponent))
+    {
+        return -(WIN_SCORE - ply);
+    }
+
+    BoardMask_t empty = static_cast<BoardMask_t>(~(own | opponent) & FULL_BOARD_MASK);
+    if (empty == 0 || depth == 0)
+    {
+        return 0;
+    }
+
+    for (size_t pos = 0; pos < 9; pos++)
+    {
+        BoardMask_t bit = static_cast<BoardMask_t>(1u << pos);
+        if (empty & bit)
+        {
+            int score = -Negamax(opponent, own | bit, ply + 1, depth - 1, -beta, -alpha);
+            if (score > alpha)
+            {
+                alpha = score;
+
+                m_pv[ply][ply] = pos;
+                for (size_t i = ply + 1; i < m_pvLength[ply + 1]; i++)
+                {
+                    m_pv[ply][i] = m_pv[ply + 1][i];
+                }
+                m_pvLength[ply] = m_pvLength[ply + 1];
+
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return alpha;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Scores every root move exactly at increasing depth
+//                            until the result is proven or the board is full,
+//                            and picks one of the best at random. Root moves
+//                            equivalent by symmetry are searched only once.
+//                            On the clock the next depth is only started within
+//                            the soft limit, doubled while the score or the
+//                            best moves still change between depths and halved
+//                            once they hold. A depth cut off by the hard limit
+//                            is discarded.
+//
+// @return                  : position of the move on the board
+//--------------------------------------------------------------------------------
+size_t MinimaxEngine::SelectMove(const Game & game, Player_t player)
+{
+    Player_t opponent = (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    BoardMask_t own = GetPlayerMask(game, player);
+    BoardMask_t opp = GetPlayerMask(game, opponent);
+    std::vector<size_t> moves = game.GetSymmetryReducedMoves();
+    std::vector<size_t> bestMoves = moves;
+    int maxDepth = static_cast<int>(game.GetPositionsAvailable());
+    int lastScore = 0;
+    bool bStable = false;
+    m_nodes = 0;
+    m_stopped = false;
+    StartSearchClock();
+
+    // Every move is as good as any other, there is nothing to search
+    for (int depth = 1; depth <= maxDepth && moves.size() > 1; depth++)
+    {
+        if (depth > 1 && !IsWithinSoftLimit(bStable ? STABLE_TIME_PERCENT : UNSTABLE_TIME_PERCENT))
+        {
+            break;
+        }
+
+        SearchProgress progress;
+        int bestScore = -WIN_SCORE - 1;
+        std::vector<size_t> depthBestMoves;
+
+        for (auto it = moves.begin(); it != moves.end(); it++)
+        {
+            BoardMask_t bit = static_cast<BoardMask_t>(1u << *it);
+            int score = -Negamax(opp, own | bit, 1, depth - 1, -WIN_SCORE - 1, WIN_SCORE + 1);
+            if (m_stopped)
+            {
+                break;
+            }
+            if (score > bestScore)
+            {
+                bestScore = score;
+                depthBestMoves.clear();
+
+                progress.pv[0] = *it;
+                progress.pvLength = 1;
+                for (size_t i = 1; i < m_pvLength[1] && i < MAX_PV_LENGTH; i++)
+                {
+                    progress.pv[progress.pvLength++] = m_pv[1][i];
+                }
+            }
+            if (score == bestScore)
+            {
+                depthBestMoves.push_back(*it);
+            }
+        }
+
+        if (m_stopped)
+        {
+            break;
+        }
+
+        bStable = (depth > 1 && bestScore == lastScore && depthBestMoves == bestMoves);
+        bestMoves = depthBestMoves;
+        lastScore = bestScore;
+
+        progress.depth = depth;
+        progress.score = bestScore;
+        progress.nodes = m_nodes;
+        ReportProgress(progress);
+
+        // A win or loss found within the horizon is exact
+        if (bestScore != 0)
+        {
+            break;
+        }
+    }
+
+    // Pick a best move, then any of its symmetric equivalents
+    std::uniform_int_distribution<size_t> pick(0, bestMoves.size() - 1);
+    std::vector<size_t> equivalentMoves = GetEquivalentMoves(game.GetCells(), 3, bestMoves[pick(m_rng)]);
+    std::uniform_int_distribution<size_t> pickEquivalent(0, equivalentMoves.size() - 1);
+    return equivalentMoves[pickEquivalent(m_rng)];
+}
+
+TablebaseEngine::TablebaseEngine(const std::string & dataDirectory) : m_rng(std::random_device()())
+{
+    // Engines are created on several threads at once, generate the file once
+    static QMutex mutex;
+    QMutexLocker lock(&mutex);
+
+    std::string path = dataDirectory + "/" + GetTablebaseFileName(3, 3, 3);
+    if (!m_tablebase.Open(path))
+    {
+        TablebaseStats stats;
+        if (GenerateTablebase(3, 3, 3, path, static_cast<size_t>(QThread::idealThreadCount()), stats))
+        {
+            m_tablebase.Open(path);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Looks the move up in the tablebase. Falls back to
+//                            the heuristic if the file could not be opened.
+//
+// @return                  : position of the move on the board
+//--------------------------------------------------------------------------------
+size_t TablebaseEngine::SelectMove(const Game & game, Player_t player)
+{
+    if (!m_tablebase.IsOpen())
+    {
+        return game.GetBestMove(player, m_rng);
+    }
+
+    return m_tablebase.SelectMove(game.GetCells(), player, m_rng);
+}
+
+MctsEngine::MctsEngine() : m_rng(std::random_device()())
+{
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectChild
+//
+// @description             : UCB1 over the children; unvisited children first
+//
+// @return                  : index of the child node
+//--------------------------------------------------------------------------------
+size_t MctsEngine::SelectChild(const Node & node) const
+{
+    size_t best = node.firstChild;
+    double bestValue = -1.0;
+    double logVisits = std::log(node.visits);
+
+    for (size_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+    {
+        const Node & child = m_nodes[i];
+        if (child.visits == 0)
+        {
+            return i;
+        }
+
+        double value = child.score / child.visits + MCTS_EXPLORATION * std::sqrt(logVisits / child.visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Expand
+//
+// @description             : Adds one child per empty cell. Children are stored
+//                            next to each other, so the node keeps a range.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MctsEngine::Expand(size_t index)
+{
+    Node node = m_nodes[index];
+    uint32_t empty = ~(node.own | node.opponent) & FULL_BOARD_MASK;
+
+    m_nodes[index].firstChild = m_nodes.size();
+    m_nodes[index].childCount = CountBits(empty);
+
+    for (; empty; empty &= empty - 1)
+    {
+        size_t move = GetLowestBitIndex(empty);
+        Node child = Node();
+        child.own = node.opponent;
+        child.opponent = static_cast<BoardMask_t>(node.own | (1u << move));
+        child.move = move;
+        child.parent = index;
+        child.firstChild = MCTS_NO_NODE;
+        m_nodes.push_back(child);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Simulate
+//
+// @description             : Scores a leaf with a batch of random playouts, or
+//                            exactly if the game is already over
+//
+// @return                  : score in [0, 1] for the side that moved into 'node'
+//--------------------------------------------------------------------------------
+double MctsEngine::Simulate(const Node & node)
+{
+    if (IsWinMask(node.opponent))
+    {
+        return 1.0;
+    }
+    if ((node.own | node.opponent) == FULL_BOARD_MASK)
+    {
+        return 0.5;
+    }
+
+    PlayoutTally tally = m_playouts.Run(node.own, node.opponent, MCTS_PLAYOUTS_PER_LEAF, m_rng);
+    return (tally.losses + 0.5 * tally.draws) / MCTS_PLAYOUTS_PER_LEAF;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetBestChild
+//
+// @description             : Finds the two most visited root moves. 'runnerUp'
+//                            is MCTS_NO_NODE if the root has a single child.
+//
+// @return                  : index of the most visited child of the root
+//--------------------------------------------------------------------------------
+size_t MctsEngine::GetBestChild(size_t & runnerUp) const
+{
+    const Node & rootNode = m_nodes[0];
+    size_t best = rootNode.firstChild;
+    runnerUp = MCTS_NO_NODE;
+    for (size_t i = rootNode.firstChild + 1; i < rootNode.firstChild + rootNode.childCount; i++)
+    {
+        if (m_nodes[i].visits > m_nodes[best].visits)
+        {
+            runnerUp = best;
+            best = i;
+        }
+        else if (runnerUp == MCTS_NO_NODE || m_nodes[i].visits > m_nodes[runnerUp].visits)
+        {
+            runnerUp = i;
+        }
+    }
+
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Grows the tree and plays the most visited root
+//                            move. Untimed it runs a fixed number of iterations.
+//                            On the clock it runs until the soft limit, doubled
+//                            while the runner up is close to the best move and
+//                            halved once the best move dominates, or until the
+//                            hard limit.
+//
+// @return                  : position of the move on the board
+//--------------------------------------------------------------------------------
+size_t MctsEngine::SelectMove(const Game & game, Player_t player)
+{
+    Player_t opponent = (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+
+    Node root = Node();
+    root.own = GetPlayerMask(game, player);
+    root.opponent = GetPlayerMask(game, opponent);
+    root.parent = MCTS_NO_NODE;
+    root.firstChild = MCTS_NO_NODE;
+    m_nodes.clear();
+    m_nodes.push_back(root);
+    Expand(0);
+    StartSearchClock();
+
+    size_t iterations = IsTimed() ? MCTS_MAX_TIMED_ITERATIONS : MCTS_ITERATIONS;
+    for (size_t iteration = 0; iteration < iterations && m_nodes[0].childCount > 1; iteration++)
+    {
+        if (iteration > 0 && (iteration & MCTS_CLOCK_CHECK_MASK) == 0 && (IsTimed() || IsStopRequested()))
+        {
+            size_t runnerUp;
+            size_t best = GetBestChild(runnerUp);
+            bool bSettled = m_nodes[runnerUp].visits < MCTS_SETTLED_RATIO * m_nodes[best].visits;
+            if (IsOutOfTime() || !IsWithinSoftLimit(bSettled ? STABLE_TIME_PERCENT : UNSTABLE_TIME_PERCENT))
+            {
+                break;
+            }
+        }
+
+        size_t index = 0;
+        while (m_nodes[index].firstChild != MCTS_NO_NODE && m_nodes[index].childCount > 0)
+        {
+            index = SelectChild(m_nodes[index]);
+        }
+
+        // Expand a leaf the second time it is reached, unless the game is over there
+        const Node & leaf = m_nodes[index];
+        if (leaf.visits > 0 && !IsWinMask(leaf.opponent) && (leaf.own | leaf.opponent) != FULL_BOARD_MASK)
+        {
+            Expand(index);
+            index = m_nodes[index].firstChild;
+        }
+
+        double score = Simulate(m_nodes[index]);
+        for (; index != MCTS_NO_NODE; index = m_nodes[index].parent)
+        {
+            m_nodes[index].visits += 1;
+            m_nodes[index].score += score;
+            score = 1.0 - score;
+        }
+    }
+
+    size_t runnerUp;
+    size_t best = GetBestChild(runnerUp);
+
+    // The score shown is the expected result of the move in percent
+    SearchProgress progress;
+    progress.depth = 1;
+    progress.score = (m_nodes[best].visits > 0) ?
+                     static_cast<int>(std::lround(100 * m_nodes[best].score / m_nodes[best].visits)) : 50;
+    progress.nodes = m_nodes.size();
+    progress.pvLength = 1;
+    progress.pv[0] = m_nodes[best].move;
+    ReportProgress(progress);
+
+    return m_nodes[best].move;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetEngineNames
+//
+// @description             : Lists the registered engines
+//
+// @return                  : vector of engine names
+//--------------------------------------------------------------------------------
+std::vector<std::string> GetEngineNames()
+{
+    return {"random", "heuristic", "minimax", "tablebase", "mcts"};
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CreateEngine
+//
+// @description             : Creates a registered engine by name. Engines that
+//                            need data files keep them in 'dataDirectory'. The
+//                            caller owns the returned engine.
+//
+// @return                  : Engine, or nullptr if the name is unknown
+//--------------------------------------------------------------------------------
+Engine * CreateEngine(const std::string & name, const std::string & dataDirectory)
+{
+    if (name == "random")
+    {
+        return new RandomEngine();
+    }
+    else if (name == "heuristic")
+    {
+        return new HeuristicEngine();
+    }
+    else if (name == "minimax")
+    {
+        return new MinimaxEngine();
+    }
+    else if (name == "tablebase")
+    {
+        return new TablebaseEngine(dataDirectory);
+    }
+    else if (name == "mcts")
+    {
+        return new MctsEngine();
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,197 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+#include "game.h"
+#include "batcheval.h"
+#include "bitboard.h"
+#include "spscqueue.h"
+#include "tablebase.h"
+#include "timecontrol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+
+const size_t MAX_PV_LENGTH = 16;
+
+// Directory engines keep their data files in when the caller names none
+const char ENGINE_DATA_DIRECTORY[] = ".";
+
+//------------------------------------------------------------------------
+// Snapshot of a running search, streamed from the engine thread to the UI
+//------------------------------------------------------------------------
+struct SearchProgress
+{
+    int depth;
+    int score;
+    unsigned long long nodes;
+    size_t pvLength;
+    size_t pv[MAX_PV_LENGTH];
+};
+
+typedef SpscQueue<SearchProgress, 64> ProgressChannel;
+
+//------------------------------------------------------------------------
+// A move selection strategy that can play either side of a Game.
+// Engines keep per-instance state, so use one instance per thread.
+//------------------------------------------------------------------------
+class Engine
+{
+private:
+    ProgressChannel * m_progress;
+    MoveTime m_moveTime;
+    std::chrono::steady_clock::time_point m_searchStart;
+    std::atomic<bool> m_bStopRequested;
+
+protected:
+    // Never blocks: the update is dropped if the consumer has fallen behind
+    void ReportProgress(const SearchProgress & progress)
+    {
+        if (m_progress)
+        {
+            m_progress->TryPush(progress);
+        }
+    }
+
+    // Time checks for engines that search until their time is up
+    void StartSearchClock() { m_searchStart = std::chrono::steady_clock::now(); }
+    bool IsTimed() const { return m_moveTime.hardMs > 0; }
+    int GetElapsedMs() const
+    {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_searchStart).count());
+    }
+    bool IsStopRequested() const { return m_bStopRequested.load(std::memory_order_relaxed); }
+    bool IsOutOfTime() const { return IsStopRequested() || (IsTimed() && GetElapsedMs() >= m_moveTime.hardMs); }
+
+    // 'percent' of the soft limit stretches it for unstable searches and
+    // shortens it for settled ones, never past the hard limit
+    bool IsWithinSoftLimit(int percent) const
+    {
+        return !IsTimed() || GetElapsedMs() < std::min(m_moveTime.softMs * percent / 100, m_moveTime.hardMs);
+    }
+
+public:
+    Engine() : m_progress(nullptr), m_bStopRequested(false) { m_moveTime.softMs = 0; m_moveTime.hardMs = 0; }
+    virtual ~Engine() {}
+    void SetProgressChannel(ProgressChannel * channel) { m_progress = channel; }
+
+    // Applies to the moves selected from now on, MoveTime() with both
+    // limits 0 to search without a clock
+    void SetMoveTime(const MoveTime & moveTime) { m_moveTime = moveTime; }
+
+    // Safe from any thread: a running search returns its best move so far
+    // soon after. The engine stays stopped, so it is not reused afterwards.
+    void RequestStop() { m_bStopRequested.store(true, std::memory_order_relaxed); }
+    virtual std::string GetName() const = 0;
+    virtual size_t SelectMove(const Game & game, Player_t player) = 0;
+};
+
+//------------------------------------------------------------------------
+// Plays a uniformly random available move
+//------------------------------------------------------------------------
+class RandomEngine : public Engine
+{
+private:
+    std::mt19937 m_rng;
+
+public:
+    RandomEngine();
+    std::string GetName() const { return "random"; }
+    size_t SelectMove(const Game & game, Player_t player);
+};
+
+//------------------------------------------------------------------------
+// The original computer player: win, else block, else random
+//------------------------------------------------------------------------
+class HeuristicEngine : public Engine
+{
+private:
+    std::mt19937 m_rng;
+
+public:
+    HeuristicEngine();
+    std::string GetName() const { return "heuristic"; }
+    size_t SelectMove(const Game & game, Player_t player);
+};
+
+//------------------------------------------------------------------------
+// Perfect play through an iterative deepening alpha-beta negamax search
+// over board masks. Reports the principal variation after every depth.
+// Ties between equally good moves are broken randomly. On the clock it
+// deepens while the soft limit allows and abandons a depth at the hard
+// limit, playing the best move of the last completed depth.
+//------------------------------------------------------------------------
+class MinimaxEngine : public Engine
+{
+private:
+    std::mt19937 m_rng;
+    unsigned long long m_nodes;
+    bool m_stopped;
+    size_t m_pv[10][10];
+    size_t m_pvLength[10];
+
+    int Negamax(BoardMask_t own, BoardMask_t opponent, int ply, int depth, int alpha, int beta);
+
+public:
+    MinimaxEngine();
+    std::string GetName() const { return "minimax"; }
+    size_t SelectMove(const Game & game, Player_t player);
+};
+
+//------------------------------------------------------------------------
+// Perfect play from the 3x3 tablebase, one mapped lookup per move. The
+// file is read from 'dataDirectory' and generated there if missing.
+//------------------------------------------------------------------------
+class TablebaseEngine : public Engine
+{
+private:
+    std::mt19937 m_rng;
+    Tablebase m_tablebase;
+
+public:
+    explicit TablebaseEngine(const std::string & dataDirectory);
+    std::string GetName() const { return "tablebase"; }
+    size_t SelectMove(const Game & game, Player_t player);
+};
+
+//------------------------------------------------------------------------
+// Monte Carlo tree search (UCT). Every new leaf is scored by a batch of
+// random playouts run in lockstep through the batched board evaluator.
+// On the clock it keeps iterating for as long as the time allows, longer
+// while the top two root moves are close.
+//------------------------------------------------------------------------
+class MctsEngine : public Engine
+{
+private:
+    struct Node
+    {
+        BoardMask_t own;        // side to move at this node
+        BoardMask_t opponent;
+        size_t move;
+        size_t parent;
+        size_t firstChild;
+        size_t childCount;
+        double visits;
+        double score;           // for the side that moved into this node
+    };
+
+    std::mt19937 m_rng;
+    BatchPlayouts m_playouts;
+    std::vector<Node> m_nodes;
+
+    size_t SelectChild(const Node & node) const;
+    size_t GetBestChild(size_t & runnerUp) const;
+    void Expand(size_t index);
+    double Simulate(const Node & node);
+
+public:
+    MctsEngine();
+    std::string GetName() const { return "mcts"; }
+    size_t SelectMove(const Game & game, Player_t player);
+};
+
+std::vector<std::string> GetEngineNames();
+Engine * CreateEngine(const std::string & name, const std::string & dataDirectory = ENGINE_DATA_DIRECTORY);
+
+#endif // ENGINE_H
@@ -0,0 +1,53 @@
+# Game model and engine sources shared by the GUI and the command line tools.
+INCLUDEPATH += $$PWD
+
+# Chrome trace profiling, enable with: qmake CONFIG+=trace
+trace: DEFINES += TICTACTOE_TRACE
+
+SOURCES += \
+    $$PWD/atomicfile.cpp \
+    $$PWD/batcheval.cpp \
+    $$PWD/bitboard.cpp \
+    $$PWD/dataset.cpp \
+    $$PWD/dfpn.cpp \
+    $$PWD/engine.cpp \
+    $$PWD/game.cpp \
+    $$PWD/gomoku.cpp \
+    $$PWD/mnkengine.cpp \
+    $$PWD/mnkgame.cpp \
+    $$PWD/mnkmcts.cpp \
+    $$PWD/nnue.cpp \
+    $$PWD/openingbook.cpp \
+    $$PWD/qubic.cpp \
+    $$PWD/statsstore.cpp \
+    $$PWD/symmetry.cpp \
+    $$PWD/tablebase.cpp \
+    $$PWD/timecontrol.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/ultimate.cpp
+
+HEADERS += \
+    $$PWD/atomicfile.h \
+    $$PWD/batcheval.h \
+    $$PWD/bitboard.h \
+    $$PWD/concurrentset.h \
+    $$PWD/dataset.h \
+    $$PWD/dfpn.h \
+    $$PWD/engine.h \
+    $$PWD/game.h \
+    $$PWD/gomoku.h \
+    $$PWD/mnkengine.h \
+    $$PWD/mnkgame.h \
+    $$PWD/mnkmcts.h \
+    $$PWD/nnue.h \
+    $$PWD/openingbook.h \
+    $$PWD/qubic.h \
+    $$PWD/rules.h \
+    $$PWD/simd.h \
+    $$PWD/spscqueue.h \
+    $$PWD/statsstore.h \
+    $$PWD/symmetry.h \
+    $$PWD/tablebase.h \
+    $$PWD/timecontrol.h \
+    $$PWD/trace.h \
+    $$PWD/ultimate.h
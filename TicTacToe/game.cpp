@@ -1,7 +1,10 @@
 #include "game.h"
-#include <iostream>
+#include "engine.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <time.h>
-#include <Windows.h>
 
 const std::vector<std::vector<size_t>> WIN_PATTERNS = {
     {0,1,2},
@@ -19,17 +22,7 @@ Game::Game()
 {
     srand(static_cast<int>(time(nullptr)));
 
-    // Initialize scores
-    m_userScore = 0;
-    m_computerScore = 0;
-
-    m_isGameOver = false;
-
-    // Initialize the board map
-    for (size_t i = 0; i < 9; i++)
-    {
-        m_boardMap[i] = PLAYER_NONE;
-    }
+    InitializeBoard();
 
     // Randomly decide who plays first
     if (rand() % 100 > 50)
@@ -42,28 +35,42 @@ Game::Game()
     }
 }
 
+Game::Game(Player_t firstPlayer)
+{
+    InitializeBoard();
+
+    m_currentTurn = firstPlayer;
+}
+
 //--------------------------------------------------------------------------------
-// @name                    : GetTurn
+// @name                    : InitializeBoard
 //
-// @description             : Determines whose turn is this
+// @description             : Resets game state and the board map
 //
-// @return                  : Player_t
+// @return                  : Nothing
 //--------------------------------------------------------------------------------
-Player_t Game::GetTurn()
+void Game::InitializeBoard()
 {
-    return m_currentTurn;
+    m_isGameOver = false;
+    m_lastMoveUs = 0;
+
+    // Initialize the board map
+    for (size_t i = 0; i < 9; i++)
+    {
+        m_boardMap[i] = PLAYER_NONE;
+    }
 }
 
 //--------------------------------------------------------------------------------
-// @name                    : GetScore
+// @name                    : GetTurn
 //
-// @description             : Fetches score of specified player
+// @description             : Determines whose turn is this
 //
-// @return                  : int
+// @return                  : Player_t
 //--------------------------------------------------------------------------------
-int Game::GetScore(Player_t player)
+Player_t Game::GetTurn() const
 {
-    return (player == PLAYER_USER) ? m_userScore : m_computerScore;
+    return m_currentTurn;
 }
 
 //--------------------------------------------------------------------------------
@@ -83,15 +90,9 @@ void Game::AddPlayerMarkToBoard(size_t position, Player_t player)
 
     m_boardMap[position] = player;
 
-    if (CheckWin() == PLAYER_USER)
+    if (CheckWin() != PLAYER_NONE)
     {
         m_isGameOver = true;
-        m_userScore++;
-    }
-    else if (CheckWin() == PLAYER_COMPUTER)
-    {
-        m_computerScore++;
-        m_isGameOver = true;
     }
     else
     {
@@ -116,7 +117,7 @@ void Game::AddPlayerMarkToBoard(size_t position, Player_t player)
 //
 // @return                  : true/false
 //--------------------------------------------------------------------------------
-bool Game::CheckWinPattern(Player_t player, const std::vector<size_t> & playerPattern)
+bool Game::CheckWinPattern(Player_t player, const std::vector<size_t> & playerPattern) const
 {
     // Match with winning patterns
     for (auto it = WIN_PATTERNS.begin(); it != WIN_PATTERNS.end(); it++)
@@ -148,7 +149,7 @@ bool Game::CheckWinPattern(Player_t player, const std::vector<size_t> & playerPa
 //
 // @return                  : vector of pattern
 //--------------------------------------------------------------------------------
-std::vector<size_t> Game::GetPlayerPattern(Player_t player)
+std::vector<size_t> Game::GetPlayerPattern(Player_t player) const
 {
     std::vector<size_t> userPattern;
     // Prepare pattern of this player
@@ -170,7 +171,7 @@ std::vector<size_t> Game::GetPlayerPattern(Player_t player)
 //
 // @return                  : Player_t who won the game
 //--------------------------------------------------------------------------------
-Player_t Game::CheckWin()
+Player_t Game::CheckWin() const
 {
     std::vector<size_t> userPattern = GetPlayerPattern(PLAYER_USER);
     bool userWon = CheckWinPattern(PLAYER_USER, userPattern);
@@ -196,7 +197,7 @@ Player_t Game::CheckWin()
 //
 // @return                  : true/false
 //--------------------------------------------------------------------------------
-bool Game::GameOver()
+bool Game::GameOver() const
 {
     return m_isGameOver;
 }
@@ -208,7 +209,7 @@ bool Game::GameOver()
 //
 // @return                  : size_t
 //--------------------------------------------------------------------------------
-size_t Game::GetPositionsAvailable()
+size_t Game::GetPositionsAvailable() const
 {
     size_t count = 0;
     for (auto it = m_boardMap.begin(); it != m_boardMap.end(); it++)
@@ -223,57 +224,142 @@ size_t Game::GetPositionsAvailable()
 }
 
 //--------------------------------------------------------------------------------
-// @name                    : GetComputerMove
+// @name                    : GetAvailableMoves
 //
-// @description             : This function houses the intelligence of computer's
-//                            move.
+// @description             : Move generator. Lists the vacant positions in
+//                            board order.
 //
-// @return                  : position of computer's move on the board.
+// @return                  : vector of positions
 //--------------------------------------------------------------------------------
-size_t Game::GetComputerMove()
+std::vector<size_t> Game::GetAvailableMoves() const
 {
-    size_t move = 0;
-    std::vector<size_t> moveCandidates;
-    bool bMoveFound = false;
+    std::vector<size_t> moves;
+    for (auto it = m_boardMap.begin(); it != m_boardMap.end(); it++)
+    {
+        if (it->second == PLAYER_NONE)
+        {
+            moves.push_back(it->first);
+        }
+    }
 
-    // Pause this thread to give a feel that computer is thinking
-    Sleep(1000);
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetSymmetryReducedMoves
+//
+// @description             : Move generator that skips moves equivalent by
+//                            rotation or reflection of the current position.
+//
+// @return                  : vector of positions
+//--------------------------------------------------------------------------------
+std::vector<size_t> Game::GetSymmetryReducedMoves() const
+{
+    return ::GetSymmetryReducedMoves(GetCells(), 3);
+}
 
-    // Check all available moves
+//--------------------------------------------------------------------------------
+// @name                    : GetCells
+//
+// @description             : Owner of every board position, in board order
+//
+// @return                  : vector of Player_t
+//--------------------------------------------------------------------------------
+std::vector<Player_t> Game::GetCells() const
+{
+    std::vector<Player_t> cells;
     for (auto it = m_boardMap.begin(); it != m_boardMap.end(); it++)
     {
-        if (it->second == PLAYER_NONE)
+        cells.push_back(it->second);
+    }
+
+    return cells;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetBestMove
+//
+// @description             : This function houses the intelligence of computer's
+//                            move: win if possible, otherwise block the
+//                            opponent, otherwise play a random move drawn from
+//                            'rng'. Works for either side so engines can play
+//                            each other. Give each thread its own 'rng'.
+//
+// @return                  : position of the move on the board.
+//--------------------------------------------------------------------------------
+size_t Game::GetBestMove(Player_t player, std::mt19937 & rng) const
+{
+    Player_t opponent = (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    std::vector<size_t> playerPattern = GetPlayerPattern(player);
+    std::vector<size_t> opponentPattern = GetPlayerPattern(opponent);
+
+    // Check one move out of every set of moves that are equivalent by symmetry
+    std::vector<size_t> moveCandidates = GetSymmetryReducedMoves();
+    for (auto it = moveCandidates.begin(); it != moveCandidates.end(); it++)
+    {
+        size_t move = *it;
+
+        // Check if player can win with this move
+        std::vector<size_t> winPattern = playerPattern;
+        winPattern.push_back(move);
+        if (CheckWinPattern(player, winPattern))
         {
-            move = it->first;
-            moveCandidates.push_back(move);
-
-            // Check if computer can win with this move
-            std::vector<size_t> computerPattern = GetPlayerPattern(PLAYER_COMPUTER);
-            computerPattern.push_back(move);
-            bool bCanComputerWin = CheckWinPattern(PLAYER_COMPUTER, computerPattern);
-            if (bCanComputerWin)
-            {
-                std::cout << "Win targetting move" << std::endl;
-                bMoveFound = true;
-                return move;
-            }
+            return move;
+        }
 
-            // Check if User can win. This logic will aim to stop human player
-            // from winning.
-            std::vector<size_t> userPattern = GetPlayerPattern(PLAYER_USER);
-            userPattern.push_back(move);
-            bool bCanComputerLoose = CheckWinPattern(PLAYER_USER, userPattern);
-            if (bCanComputerLoose)
-            {
-                std::cout << "Loss avoidance move" << std::endl;
-                bMoveFound = true;
-                return move;
-            }
+        // Check if opponent can win. This logic will aim to stop the
+        // opponent from winning.
+        std::vector<size_t> lossPattern = opponentPattern;
+        lossPattern.push_back(move);
+        if (CheckWinPattern(opponent, lossPattern))
+        {
+            return move;
         }
     }
 
     // Win not possible, select any random move
-    std::cout << "Random move" << std::endl;
-    return moveCandidates[rand() % moveCandidates.size()];
+    std::uniform_int_distribution<size_t> pickRepresentative(0, moveCandidates.size() - 1);
+    size_t representative = moveCandidates[pickRepresentative(rng)];
+    std::vector<size_t> equivalentMoves = GetEquivalentMoves(GetCells(), 3, representative);
+    std::uniform_int_distribution<size_t> pickEquivalent(0, equivalentMoves.size() - 1);
+    return equivalentMoves[pickEquivalent(rng)];
 }
 
+//--------------------------------------------------------------------------------
+// @name                    : GetComputerMove
+//
+// @description             : Computer's move for the GUI. Uses 'engine' if one
+//                            is given, the built-in heuristic otherwise.
+//                            'player' is the side to move, the user's side
+//                            only being played by the computer in demo mode.
+//                            A forced move is played without asking the
+//                            engine. The time taken to choose is kept for
+//                            GetLastMoveLatency.
+//
+// @return                  : position of computer's move on the board.
+//--------------------------------------------------------------------------------
+size_t Game::GetComputerMove(Engine * engine, Player_t player)
+{
+    TRACE_SCOPE("GetComputerMove");
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<size_t> moves = GetAvailableMoves();
+    size_t move;
+    if (moves.size() == 1)
+    {
+        move = moves[0];
+    }
+    else if (engine)
+    {
+        move = engine->SelectMove(*this, player);
+    }
+    else
+    {
+        static thread_local std::mt19937 rng{std::random_device()()};
+        move = GetBestMove(player, rng);
+    }
+    m_lastMoveUs = static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    return move;
+}
@@ -1,7 +1,13 @@
 #ifndef GAME_H
 #define GAME_H
+#include <cstddef>
 #include <map>
-#include <Qthread>
+#include <random>
+#include <vector>
+#include <QThread>
+#include "trace.h"
+
+class Engine;
 
 typedef enum Player_tag
 {
@@ -15,48 +21,28 @@ class Game
 private:
     std::map<size_t, Player_t> m_boardMap;
     Player_t m_currentTurn;
-    int m_userScore;
-    int m_computerScore;
     bool m_isGameOver;
+    unsigned long m_lastMoveUs;
+
+    void InitializeBoard();
 
 public:
     Game();
-    auto GetBoardMap(){return m_boardMap;}
-    int GetScore(Player_t player);
+    Game(Player_t firstPlayer);
+    std::map<size_t, Player_t> GetBoardMap() const {return m_boardMap;}
     void AddPlayerMarkToBoard(size_t position, Player_t player);
-    size_t GetPositionsAvailable();
-    Player_t CheckWin();
-    bool CheckWinPattern(Player_t player, const std::vector<size_t> & playerPattern);
-    std::vector<size_t> GetPlayerPattern(Player_t player);
-    bool GameOver();
-    Player_t GetTurn();
-    size_t GetComputerMove();
-};
-
-
-//------------------------------------------------------------------------
-// Worker thread that calculates Computer's move
-//------------------------------------------------------------------------
-class ComputerMoveWorker: public QThread
-{
-Q_OBJECT
-private:
-    Game* m_gameData;
-
-signals:
-    void ComputerMoveAvailable(int move);
-
-public:
-    ComputerMoveWorker(Game* gameData) : QThread()
-    {
-        m_gameData = gameData;
-    }
-
-    void run()
-    {
-        size_t move = m_gameData->GetComputerMove();
-        emit ComputerMoveAvailable(static_cast<int>(move));
-    }
+    size_t GetPositionsAvailable() const;
+    std::vector<size_t> GetAvailableMoves() const;
+    std::vector<size_t> GetSymmetryReducedMoves() const;
+    std::vector<Player_t> GetCells() const;
+    Player_t CheckWin() const;
+    bool CheckWinPattern(Player_t player, const std::vector<size_t> & playerPattern) const;
+    std::vector<size_t> GetPlayerPattern(Player_t player) const;
+    bool GameOver() const;
+    Player_t GetTurn() const;
+    size_t GetBestMove(Player_t player, std::mt19937 & rng) const;
+    size_t GetComputerMove(Engine * engine = nullptr, Player_t player = PLAYER_COMPUTER);
+    unsigned long GetLastMoveLatency() const { return m_lastMoveUs; }
 };
 
 #endif // GAME_H
@@ -0,0 +1,385 @@
+#include "gametreedialog.h"
+#include "mainwindow.h"
+#include <QFont>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <algorithm>
+
+// Largest value, a position that is already won
+const int GAME_TREE_WIN = 10;
+
+// Value of a position one ply above a position worth 'value' for the opponent
+static int BackUp(int value)
+{
+    value = -value;
+    if (value > 0)
+    {
+        value--;
+    }
+    else if (value < 0)
+    {
+        value++;
+    }
+    return value;
+}
+
+static QString GetMark(Player_t player)
+{
+    return (player == PLAYER_USER) ? USER_MARK : COMPUTER_MARK;
+}
+
+static Player_t GetOpponent(Player_t player)
+{
+    return (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+}
+
+GameTreeModel::GameTreeModel(BoardMask_t user, BoardMask_t computer, Player_t turn, QObject * parent)
+    : QAbstractItemModel(parent)
+{
+    for (int symmetry = 0; symmetry < SYMMETRY_COUNT; symmetry++)
+    {
+        for (size_t cell = 0; cell < 9; cell++)
+        {
+            m_transform[symmetry][cell] = TransformCell(cell, 3, symmetry);
+        }
+    }
+
+    Node root;
+    root.user = user;
+    root.computer = computer;
+    root.turn = turn;
+    root.move = -1;
+    root.bBest = false;
+    root.bFetched = false;
+    root.parent = 0;
+    root.row = 0;
+    root.value = SolveNode(root);
+    m_nodes.push_back(root);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetNode
+//
+// @description             : The node behind a model index, the root for the
+//                            invalid index
+//
+// @return                  : index into m_nodes
+//--------------------------------------------------------------------------------
+size_t GameTreeModel::GetNode(const QModelIndex & index) const
+{
+    return index.isValid() ? static_cast<size_t>(index.internalId()) : 0;
+}
+
+bool GameTreeModel::IsTerminal(const Node & node) const
+{
+    return IsWinMask(node.user) || IsWinMask(node.computer) || (node.user | node.computer) == FULL_BOARD_MASK;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetCanonicalKey
+//
+// @description             : Smallest key of the position over the eight board
+//                            symmetries, so equivalent positions share a cache
+//                            entry
+//
+// @return                  : key with own stones in the low 9 bits
+//--------------------------------------------------------------------------------
+uint32_t GameTreeModel::GetCanonicalKey(BoardMask_t own, BoardMask_t opponent) const
+{
+    uint32_t best = 0xFFFFFFFF;
+    for (int symmetry = 0; symmetry < SYMMETRY_COUNT; symmetry++)
+    {
+        uint32_t key = 0;
+        for (size_t cell = 0; cell < 9; cell++)
+        {
+            if (own & (1u << cell))
+            {
+                key |= 1u << m_transform[symmetry][cell];
+            }
+            else if (opponent & (1u << cell))
+            {
+                key |= 1u << (9 + m_transform[symmetry][cell]);
+            }
+        }
+        best = std::min(best, key);
+    }
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Solve
+//
+// @description             : Memoised minimax. 'own' is the side to move.
+//
+// @return                  : value for the side to move
+//--------------------------------------------------------------------------------
+int GameTreeModel::Solve(BoardMask_t own, BoardMask_t opponent)
+{
+    if (IsWinMask(opponent))
+    {
+        return -GAME_TREE_WIN;
+    }
+
+    BoardMask_t empty = static_cast<BoardMask_t>(~(own | opponent) & FULL_BOARD_MASK);
+    if (empty == 0)
+    {
+        return 0;
+    }
+
+    uint32_t key = GetCanonicalKey(own, opponent);
+    auto cached = m_values.find(key);
+    if (cached != m_values.end())
+    {
+        return cached->second;
+    }
+
+    int best = -GAME_TREE_WIN;
+    for (size_t cell = 0; cell < 9; cell++)
+    {
+        BoardMask_t bit = static_cast<BoardMask_t>(1u << cell);
+        if (empty & bit)
+        {
+            best = std::max(best, BackUp(Solve(opponent, static_cast<BoardMask_t>(own | bit))));
+        }
+    }
+
+    m_values[key] = best;
+    return best;
+}
+
+int GameTreeModel::SolveNode(const Node & node)
+{
+    if (node.turn == PLAYER_USER)
+    {
+        return Solve(node.user, node.computer);
+    }
+    return Solve(node.computer, node.user);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetValueText
+//
+// @description             : Value of a node in words, e.g. "X wins in 3"
+//
+// @return                  : QString
+//--------------------------------------------------------------------------------
+QString GameTreeModel::GetValueText(size_t index) const
+{
+    const Node & node = m_nodes[index];
+    if (node.value == 0)
+    {
+        return IsTerminal(node) ? "Draw" : "Draw with best play";
+    }
+
+    Player_t winner = (node.value > 0) ? node.turn : GetOpponent(node.turn);
+    int plies = GAME_TREE_WIN - std::abs(node.value);
+    if (plies == 0)
+    {
+        return QString("%1 won").arg(GetMark(winner));
+    }
+    return QString("%1 wins in %2").arg(GetMark(winner)).arg(plies);
+}
+
+QModelIndex GameTreeModel::index(int row, int column, const QModelIndex & parent) const
+{
+    const Node & node = m_nodes[GetNode(parent)];
+    if (row < 0 || static_cast<size_t>(row) >= node.children.size() || column < 0 || column >= 2)
+    {
+        return QModelIndex();
+    }
+    return createIndex(row, column, static_cast<quintptr>(node.children[row]));
+}
+
+QModelIndex GameTreeModel::parent(const QModelIndex & index) const
+{
+    size_t node = GetNode(index);
+    if (node == 0 || m_nodes[node].parent == 0)
+    {
+        return QModelIndex();
+    }
+
+    size_t parentNode = m_nodes[node].parent;
+    return createIndex(static_cast<int>(m_nodes[parentNode].row), 0, static_cast<quintptr>(parentNode));
+}
+
+int GameTreeModel::rowCount(const QModelIndex & parent) const
+{
+    if (parent.column() > 0)
+    {
+        return 0;
+    }
+    return static_cast<int>(m_nodes[GetNode(parent)].children.size());
+}
+
+int GameTreeModel::columnCount(const QModelIndex & /*parent*/) const
+{
+    return 2;
+}
+
+QVariant GameTreeModel::data(const QModelIndex & index, int role) const
+{
+    if (!index.isValid())
+    {
+        return QVariant();
+    }
+
+    const Node & node = m_nodes[GetNode(index)];
+    if (role == Qt::DisplayRole)
+    {
+        if (index.column() == 0)
+        {
+            return QString("%1 on %2").arg(GetMark(GetOpponent(node.turn))).arg(node.move + 1);
+        }
+        return GetValueText(GetNode(index));
+    }
+    else if (role == Qt::ToolTipRole)
+    {
+        // The board after the move
+        QString board;
+        for (size_t cell = 0; cell < 9; cell++)
+        {
+            if (node.user & (1u << cell))
+            {
+                board += USER_MARK;
+            }
+            else if (node.computer & (1u << cell))
+            {
+                board += COMPUTER_MARK;
+            }
+            else
+            {
+                board += ".";
+            }
+            board += (cell % 3 == 2) ? (cell == 8 ? "" : "\n") : " ";
+        }
+        return board;
+    }
+    else if (role == Qt::FontRole && node.bBest)
+    {
+        QFont font;
+        font.setBold(true);
+        return font;
+    }
+
+    return QVariant();
+}
+
+QVariant GameTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
+    {
+        return (section == 0) ? QString("Move") : QString("Value");
+    }
+    return QVariant();
+}
+
+bool GameTreeModel::hasChildren(const QModelIndex & parent) const
+{
+    if (parent.column() > 0)
+    {
+        return false;
+    }
+
+    // Before its children are fetched a node only promises to have some
+    const Node & node = m_nodes[GetNode(parent)];
+    return node.bFetched ? !node.children.empty() : !IsTerminal(node);
+}
+
+bool GameTreeModel::canFetchMore(const QModelIndex & parent) const
+{
+    if (parent.column() > 0)
+    {
+        return false;
+    }
+
+    const Node & node = m_nodes[GetNode(parent)];
+    return !node.bFetched && !IsTerminal(node);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : fetchMore
+//
+// @description             : Creates the children of a node when the view
+//                            first needs them. Only this level is solved, and
+//                            mostly from the cache.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameTreeModel::fetchMore(const QModelIndex & parent)
+{
+    size_t parentNode = GetNode(parent);
+    if (!canFetchMore(parent))
+    {
+        return;
+    }
+
+    // m_nodes grows below, so no references into it are kept
+    Node templateNode = m_nodes[parentNode];
+    BoardMask_t empty = static_cast<BoardMask_t>(~(templateNode.user | templateNode.computer) & FULL_BOARD_MASK);
+
+    std::vector<Node> children;
+    for (size_t cell = 0; cell < 9; cell++)
+    {
+        BoardMask_t bit = static_cast<BoardMask_t>(1u << cell);
+        if (!(empty & bit))
+        {
+            continue;
+        }
+
+        Node child;
+        child.user = static_cast<BoardMask_t>(templateNode.user | ((templateNode.turn == PLAYER_USER) ? bit : 0));
+        child.computer = static_cast<BoardMask_t>(templateNode.computer | ((templateNode.turn == PLAYER_COMPUTER) ? bit : 0));
+        child.turn = GetOpponent(templateNode.turn);
+        child.move = static_cast<int>(cell);
+        child.value = SolveNode(child);
+        child.bBest = (BackUp(child.value) == templateNode.value);
+        child.bFetched = false;
+        child.parent = parentNode;
+        child.row = children.size();
+        children.push_back(child);
+    }
+
+    beginInsertRows(parent, 0, static_cast<int>(children.size()) - 1);
+    m_nodes[parentNode].bFetched = true;
+    for (auto it = children.begin(); it != children.end(); it++)
+    {
+        m_nodes[parentNode].children.push_back(m_nodes.size());
+        m_nodes.push_back(*it);
+    }
+    endInsertRows();
+}
+
+GameTreeDialog::GameTreeDialog(BoardMask_t user, BoardMask_t computer, Player_t turn, QWidget *parent)
+    : QDialog(parent)
+    , m_model(user, computer, turn)
+{
+    setWindowTitle("Game Tree");
+    resize(420, 480);
+
+    QVBoxLayout * mainLayout = new QVBoxLayout(this);
+    m_status = new QLabel(this);
+    m_tree = new QTreeView(this);
+    m_tree->setModel(&m_model);
+    m_tree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    connect(m_tree, SIGNAL(expanded(QModelIndex)), this, SLOT(OnTreeExpanded()));
+    mainLayout->addWidget(m_status);
+    mainLayout->addWidget(m_tree, 1);
+
+    OnTreeExpanded();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : OnTreeExpanded
+//
+// @description             : Shows the position's value and how much of the
+//                            tree has been built so far
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameTreeDialog::OnTreeExpanded()
+{
+    m_status->setText(QString("%1 - %2 nodes shown, %3 positions cached. Best moves are in bold.")
+                      .arg(m_model.GetValueText(0))
+                      .arg(m_model.GetNodeCount() - 1)
+                      .arg(m_model.GetCacheSize()));
+}
@@ -0,0 +1,89 @@
+#ifndef GAMETREEDIALOG_H
+#define GAMETREEDIALOG_H
+
+#include "bitboard.h"
+#include "symmetry.h"
+#include <QAbstractItemModel>
+#include <QDialog>
+#include <QLabel>
+#include <QTreeView>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Game tree below a 3x3 position with the minimax value of every node.
+//
+// The full tree has over half a million nodes, so a node's children are
+// only created when the view expands it (canFetchMore / fetchMore). Values
+// are memoised in a transposition cache keyed by the canonical position
+// over the board symmetries, so a whole subtree is solved at most once.
+// Values are for the side to move: 10 - n for a win in n plies, n - 10
+// for a loss, 0 for a draw.
+//------------------------------------------------------------------------
+class GameTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+private:
+    struct Node
+    {
+        BoardMask_t user;
+        BoardMask_t computer;
+        Player_t turn;              // side to move
+        int move;                   // cell played to get here, -1 for the root
+        int value;
+        bool bBest;                 // a best move for the side that played it
+        bool bFetched;
+        size_t parent;
+        size_t row;
+        std::vector<size_t> children;
+    };
+
+    std::vector<Node> m_nodes;      // m_nodes[0] is the position explored
+    std::unordered_map<uint32_t, int> m_values;
+    size_t m_transform[SYMMETRY_COUNT][9];
+
+    size_t GetNode(const QModelIndex & index) const;
+    bool IsTerminal(const Node & node) const;
+    uint32_t GetCanonicalKey(BoardMask_t own, BoardMask_t opponent) const;
+    int Solve(BoardMask_t own, BoardMask_t opponent);
+    int SolveNode(const Node & node);
+
+public:
+    GameTreeModel(BoardMask_t user, BoardMask_t computer, Player_t turn, QObject * parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex & index) const;
+    int rowCount(const QModelIndex & parent = QModelIndex()) const;
+    int columnCount(const QModelIndex & parent = QModelIndex()) const;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    bool hasChildren(const QModelIndex & parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex & parent) const;
+    void fetchMore(const QModelIndex & parent);
+
+    QString GetValueText(size_t node) const;
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    size_t GetCacheSize() const { return m_values.size(); }
+};
+
+//------------------------------------------------------------------------
+// Shows the game tree from the main window's current position
+//------------------------------------------------------------------------
+class GameTreeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    GameTreeDialog(BoardMask_t user, BoardMask_t computer, Player_t turn, QWidget *parent = nullptr);
+
+private slots:
+    void OnTreeExpanded();
+
+private:
+    GameTreeModel m_model;
+    QTreeView * m_tree;
+    QLabel * m_status;
+};
+
+#endif // GAMETREEDIALOG_H
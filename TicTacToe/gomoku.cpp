@@ -0,0 +1,998 @@
+#include "gomoku.h"
+#include <algorithm>
+#include <cassert>
+
+// Cell values in the padded board and in pattern windows
+const int STONE_EMPTY = 0;
+const int STONE_BORDER = 3;
+const int GOMOKU_PADDING = 4;
+
+// Window codes of 8 neighbours with 4 states each
+const size_t WINDOW_CODES = 1 << 16;
+
+// 3^8 windows once colours are reduced to empty / own / blocked
+const size_t REDUCED_WINDOWS = 6561;
+
+// Longest threat sequence searched, in attacker plus defender moves
+const int THREAT_MAX_PLY = 24;
+
+// Open threes tried per attacker move in the threat-space search
+const size_t THREAT_MAX_THREES = 8;
+
+const int GOMOKU_WIN_SCORE = 1000000;
+const int GOMOKU_INFINITY = GOMOKU_WIN_SCORE + 1;
+
+// Candidates searched per node by the alpha-beta fallback
+const size_t SEARCH_WIDTH = 10;
+
+//------------------------------------------------------------------------
+// Classification of a line window once every cell is empty (0), own (1)
+// or blocked (2). Fives and fours are found directly; threes and twos are
+// lines that become fours or threes with one more stone.
+//------------------------------------------------------------------------
+class WindowClassifier
+{
+private:
+    int8_t m_memo[3][REDUCED_WINDOWS];
+
+    static bool HasFive(const int line[9])
+    {
+        int count = 1;
+        for (int i = 3; i >= 0 && line[i] == 1; i--)
+        {
+            count++;
+        }
+        for (int i = 5; i < 9 && line[i] == 1; i++)
+        {
+            count++;
+        }
+        return count >= static_cast<int>(GOMOKU_K);
+    }
+
+    static int CountWinningCells(int line[9])
+    {
+        int count = 0;
+        for (int i = 0; i < 9; i++)
+        {
+            if (line[i] == 0)
+            {
+                line[i] = 1;
+                if (HasFive(line))
+                {
+                    count++;
+                }
+                line[i] = 0;
+            }
+        }
+        return count;
+    }
+
+    static int Encode(const int line[9])
+    {
+        int key = 0;
+        for (int i = 8; i >= 0; i--)
+        {
+            if (i != 4)
+            {
+                key = key * 3 + line[i];
+            }
+        }
+        return key;
+    }
+
+    Pattern_t Classify(int line[9], int level)
+    {
+        int key = Encode(line);
+        if (m_memo[level][key] >= 0)
+        {
+            return static_cast<Pattern_t>(m_memo[level][key]);
+        }
+
+        Pattern_t pattern = PATTERN_NONE;
+        if (HasFive(line))
+        {
+            pattern = PATTERN_FIVE;
+        }
+        else
+        {
+            int winningCells = CountWinningCells(line);
+            if (winningCells >= 2)
+            {
+                pattern = PATTERN_OPEN_FOUR;
+            }
+            else if (winningCells == 1)
+            {
+                pattern = PATTERN_FOUR;
+            }
+            else if (level > 0)
+            {
+                for (int i = 0; i < 9; i++)
+                {
+                    if (line[i] != 0)
+                    {
+                        continue;
+                    }
+
+                    line[i] = 1;
+                    Pattern_t next = Classify(line, level - 1);
+                    line[i] = 0;
+
+                    Pattern_t promoted = PATTERN_NONE;
+                    if (next == PATTERN_OPEN_FOUR)
+                    {
+                        promoted = PATTERN_OPEN_THREE;
+                    }
+                    else if (next == PATTERN_FOUR)
+                    {
+                        promoted = PATTERN_THREE;
+                    }
+                    else if (next == PATTERN_OPEN_THREE)
+                    {
+                        promoted = PATTERN_OPEN_TWO;
+                    }
+                    else if (next == PATTERN_THREE)
+                    {
+                        promoted = PATTERN_TWO;
+                    }
+                    pattern = std::max(pattern, promoted);
+                }
+            }
+        }
+
+        m_memo[level][key] = static_cast<int8_t>(pattern);
+        return pattern;
+    }
+
+public:
+    WindowClassifier()
+    {
+        std::fill(&m_memo[0][0], &m_memo[0][0] + 3 * REDUCED_WINDOWS, -1);
+    }
+
+    // 'own' is the stone value seen as own colour, the other colour and
+    // off-board cells both block
+    Pattern_t Classify(uint16_t window, int own)
+    {
+        int line[9];
+        line[4] = 1;
+        for (int slot = 0; slot < 8; slot++)
+        {
+            int value = (window >> (2 * slot)) & 3;
+            int position = (slot < 4) ? slot : slot + 1;
+            line[position] = (value == STONE_EMPTY) ? 0 : ((value == own) ? 1 : 2);
+        }
+        return Classify(line, 2);
+    }
+};
+
+//------------------------------------------------------------------------
+// Pattern of every window code for both colours, built once
+//------------------------------------------------------------------------
+struct PatternTables
+{
+    uint8_t patterns[2][WINDOW_CODES];
+
+    PatternTables()
+    {
+        WindowClassifier classifier;
+        for (size_t code = 0; code < WINDOW_CODES; code++)
+        {
+            patterns[0][code] = static_cast<uint8_t>(classifier.Classify(static_cast<uint16_t>(code), 1));
+            patterns[1][code] = static_cast<uint8_t>(classifier.Classify(static_cast<uint16_t>(code), 2));
+        }
+    }
+};
+
+static const PatternTables & GetTables()
+{
+    static const PatternTables tables;
+    return tables;
+}
+
+// Window slot of the neighbour 'offset' cells away (-4..-1, 1..4)
+static int GetSlot(int offset)
+{
+    return (offset < 0) ? offset + 4 : offset + 3;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : ClassifyWindow
+//
+// @description             : Pattern made by an own stone in the middle of the
+//                            window, see gomoku.h for the window layout
+//
+// @return                  : Pattern_t
+//--------------------------------------------------------------------------------
+Pattern_t ClassifyWindow(uint16_t window)
+{
+    return static_cast<Pattern_t>(GetTables().patterns[0][window]);
+}
+
+GomokuBoard::GomokuBoard(int size)
+{
+    assert(size >= static_cast<int>(GOMOKU_K) && size <= static_cast<int>(GOMOKU_MAX_SIZE));
+
+    m_size = size;
+    m_stride = size + 2 * GOMOKU_PADDING;
+    m_steps[0] = 1;
+    m_steps[1] = m_stride;
+    m_steps[2] = m_stride + 1;
+    m_steps[3] = m_stride - 1;
+
+    size_t total = static_cast<size_t>(m_stride * m_stride);
+    m_stones.assign(total, STONE_BORDER);
+    m_nearby.assign(total, 0);
+    m_cellOfIndex.assign(total, 0);
+    m_network = nullptr;
+    for (int d = 0; d < 4; d++)
+    {
+        m_codes[d].assign(total, 0);
+    }
+
+    for (int row = 0; row < size; row++)
+    {
+        for (int column = 0; column < size; column++)
+        {
+            int index = (row + GOMOKU_PADDING) * m_stride + column + GOMOKU_PADDING;
+            m_stones[index] = STONE_EMPTY;
+            m_cellOfIndex[index] = static_cast<uint16_t>(row * size + column);
+            m_cells.push_back(index);
+        }
+    }
+
+    // Empty board: only the off-board neighbours show up in the codes
+    for (auto it = m_cells.begin(); it != m_cells.end(); it++)
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            uint16_t code = 0;
+            for (int offset = -4; offset <= 4; offset++)
+            {
+                if (offset != 0)
+                {
+                    code |= m_stones[*it + offset * m_steps[d]] << (2 * GetSlot(offset));
+                }
+            }
+            m_codes[d][*it] = code;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : ToIndex / ToCell
+//
+// @description             : Converts between row * size + column cells and
+//                            indices into the padded board
+//
+// @return                  : padded index / cell
+//--------------------------------------------------------------------------------
+int GomokuBoard::ToIndex(size_t cell) const
+{
+    int row = static_cast<int>(cell) / m_size;
+    int column = static_cast<int>(cell) % m_size;
+    return (row + GOMOKU_PADDING) * m_stride + column + GOMOKU_PADDING;
+}
+
+size_t GomokuBoard::ToCell(int index) const
+{
+    int row = index / m_stride - GOMOKU_PADDING;
+    int column = index % m_stride - GOMOKU_PADDING;
+    return static_cast<size_t>(row * m_size + column);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetCode
+//
+// @description             : Writes 'color' (or empty) into the window codes of
+//                            the 32 cells that see 'index' along some line
+//
+// @return                  : none
+//--------------------------------------------------------------------------------
+void GomokuBoard::SetCode(int index, int color)
+{
+    for (int d = 0; d < 4; d++)
+    {
+        int step = m_steps[d];
+        for (int distance = 1; distance <= 4; distance++)
+        {
+            // 'index' is 'distance' cells to the left of the cell after it
+            // and to the right of the cell before it
+            int shiftAfter = 2 * GetSlot(-distance);
+            int shiftBefore = 2 * GetSlot(distance);
+
+            uint16_t & after = m_codes[d][index + distance * step];
+            after = static_cast<uint16_t>((after & ~(3 << shiftAfter)) | (color << shiftAfter));
+
+            uint16_t & before = m_codes[d][index - distance * step];
+            before = static_cast<uint16_t>((before & ~(3 << shiftBefore)) | (color << shiftBefore));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Place / Remove
+//
+// @description             : Make and unmake a stone, keeping the window codes
+//                            and the stone-nearby counts up to date
+//
+// @return                  : none
+//--------------------------------------------------------------------------------
+void GomokuBoard::Place(int index, int color)
+{
+    assert(m_stones[index] == STONE_EMPTY);
+
+    m_stones[index] = static_cast<uint8_t>(color);
+    SetCode(index, color);
+    if (m_network)
+    {
+        m_network->AddStone(m_accumulator, m_cellOfIndex[index], color);
+    }
+    for (int dr = -2; dr <= 2; dr++)
+    {
+        for (int dc = -2; dc <= 2; dc++)
+        {
+            m_nearby[index + dr * m_stride + dc]++;
+        }
+    }
+}
+
+void GomokuBoard::Remove(int index)
+{
+    assert(m_stones[index] != STONE_EMPTY && m_stones[index] != STONE_BORDER);
+
+    if (m_network)
+    {
+        m_network->RemoveStone(m_accumulator, m_cellOfIndex[index], m_stones[index]);
+    }
+    m_stones[index] = STONE_EMPTY;
+    SetCode(index, STONE_EMPTY);
+    for (int dr = -2; dr <= 2; dr++)
+    {
+        for (int dc = -2; dc <= 2; dc++)
+        {
+            m_nearby[index + dr * m_stride + dc]--;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetPattern
+//
+// @description             : Pattern 'color' makes along 'direction' by playing
+//                            at 'index' (or has made, if the stone is there)
+//
+// @return                  : Pattern_t
+//--------------------------------------------------------------------------------
+Pattern_t GomokuBoard::GetPattern(int index, int direction, int color) const
+{
+    return static_cast<Pattern_t>(GetTables().patterns[color - 1][m_codes[direction][index]]);
+}
+
+bool GomokuBoard::HasStones() const
+{
+    for (auto it = m_cells.begin(); it != m_cells.end(); it++)
+    {
+        if (m_stones[*it] != STONE_EMPTY)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetNetwork
+//
+// @description             : Attaches an evaluation network, or detaches it with
+//                            nullptr. A network trained for another board size
+//                            is ignored.
+//
+// @return                  : none
+//--------------------------------------------------------------------------------
+void GomokuBoard::SetNetwork(const EvalNetwork * network)
+{
+    m_network = (network && network->GetSize() == m_size) ? network : nullptr;
+    if (!m_network)
+    {
+        return;
+    }
+
+    m_network->Reset(m_accumulator);
+    for (auto it = m_cells.begin(); it != m_cells.end(); it++)
+    {
+        if (m_stones[*it] != STONE_EMPTY)
+        {
+            m_network->AddStone(m_accumulator, m_cellOfIndex[*it], m_stones[*it]);
+        }
+    }
+}
+
+GomokuEngine::GomokuEngine() : m_board(15)
+{
+    m_network = nullptr;
+    m_stopped = false;
+    m_nodes = 0;
+    m_reason = "";
+}
+
+bool GomokuEngine::IsTimeUp()
+{
+    if ((m_nodes & 255) == 0 && std::chrono::steady_clock::now() >= m_deadline)
+    {
+        m_stopped = true;
+    }
+    return m_stopped;
+}
+
+void GomokuEngine::SetPhaseDeadline(std::chrono::steady_clock::time_point start, int budgetMs, int percent)
+{
+    m_deadline = start + std::chrono::microseconds(static_cast<long long>(budgetMs) * 10 * percent);
+    m_stopped = std::chrono::steady_clock::now() >= m_deadline;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetCellScore
+//
+// @description             : Value of playing 'color' at an empty cell, from the
+//                            patterns it makes in the four directions. Moves
+//                            that make two threats at once win outright.
+//
+// @return                  : score
+//--------------------------------------------------------------------------------
+int GomokuEngine::GetCellScore(int index, int color) const
+{
+    int counts[PATTERN_COUNT] = {0};
+    for (int d = 0; d < 4; d++)
+    {
+        counts[m_board.GetPattern(index, d, color)]++;
+    }
+
+    if (counts[PATTERN_FIVE] > 0)
+    {
+        return 100000;
+    }
+    if (counts[PATTERN_OPEN_FOUR] > 0 || counts[PATTERN_FOUR] >= 2 ||
+        (counts[PATTERN_FOUR] > 0 && counts[PATTERN_OPEN_THREE] > 0))
+    {
+        return 20000;
+    }
+    if (counts[PATTERN_OPEN_THREE] >= 2)
+    {
+        return 5000;
+    }
+
+    return counts[PATTERN_FOUR] * 600 + counts[PATTERN_OPEN_THREE] * 500 + counts[PATTERN_THREE] * 80 +
+           counts[PATTERN_OPEN_TWO] * 60 + counts[PATTERN_TWO] * 10 + 1;
+}
+
+bool GomokuEngine::HasPattern(int index, int color, Pattern_t minimum) const
+{
+    for (int d = 0; d < 4; d++)
+    {
+        if (m_board.GetPattern(index, d, color) >= minimum)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : FindFives
+//
+// @description             : Cells where 'color' would complete five, at most
+//                            two are collected
+//
+// @return                  : number of cells found (0, 1 or 2)
+//--------------------------------------------------------------------------------
+int GomokuEngine::FindFives(int color, int * fives) const
+{
+    int count = 0;
+    const std::vector<int> & cells = m_board.GetCells();
+    for (auto it = cells.begin(); it != cells.end() && count < 2; it++)
+    {
+        if (m_board.IsEmpty(*it) && m_board.IsNearStones(*it) && HasPattern(*it, color, PATTERN_FIVE))
+        {
+            fives[count++] = *it;
+        }
+    }
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetThreatMoves
+//
+// @description             : Moves making a four for 'color', optionally also
+//                            those making an open three, strongest first
+//
+// @return                  : vector of padded indices
+//--------------------------------------------------------------------------------
+std::vector<int> GomokuEngine::GetThreatMoves(int color, bool bIncludeThrees) const
+{
+    std::vector<std::pair<int, int>> scored;
+    Pattern_t minimum = bIncludeThrees ? PATTERN_OPEN_THREE : PATTERN_FOUR;
+
+    const std::vector<int> & cells = m_board.GetCells();
+    for (auto it = cells.begin(); it != cells.end(); it++)
+    {
+        if (m_board.IsEmpty(*it) && m_board.IsNearStones(*it) && HasPattern(*it, color, minimum))
+        {
+            scored.push_back(std::make_pair(-GetCellScore(*it, color), *it));
+        }
+    }
+    std::sort(scored.begin(), scored.end());
+
+    std::vector<int> moves;
+    size_t threes = 0;
+    for (auto it = scored.begin(); it != scored.end(); it++)
+    {
+        if (!HasPattern(it->second, color, PATTERN_FOUR) && ++threes > THREAT_MAX_THREES)
+        {
+            continue;
+        }
+        moves.push_back(it->second);
+    }
+
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AttackerNode
+//
+// @description             : Threat-space search, attacker to move. Only fours
+//                            and (while threeDepth > 0) open threes are tried,
+//                            so the defender's replies stay few and forced.
+//
+// @return                  : true if 'color' has a forced win
+//--------------------------------------------------------------------------------
+bool GomokuEngine::AttackerNode(int color, int threeDepth, int plyLeft, int * firstMove)
+{
+    m_nodes++;
+    if (IsTimeUp())
+    {
+        return false;
+    }
+
+    int fives[2];
+    if (FindFives(color, fives) > 0)
+    {
+        *firstMove = fives[0];
+        return true;
+    }
+    if (plyLeft <= 0)
+    {
+        return false;
+    }
+
+    std::vector<int> moves;
+    int defenderFives = FindFives(3 - color, fives);
+    if (defenderFives > 0)
+    {
+        // The block has to be a four as well to keep the initiative
+        if (defenderFives > 1 || !HasPattern(fives[0], color, PATTERN_FOUR))
+        {
+            return false;
+        }
+        moves.push_back(fives[0]);
+    }
+    else
+    {
+        moves = GetThreatMoves(color, threeDepth > 0);
+    }
+
+    for (auto it = moves.begin(); it != moves.end(); it++)
+    {
+        bool bFour = HasPattern(*it, color, PATTERN_FOUR);
+
+        m_board.Place(*it, color);
+        bool bWin = DefenderNode(color, *it, bFour ? threeDepth : threeDepth - 1, plyLeft - 1);
+        m_board.Remove(*it);
+
+        if (bWin)
+        {
+            *firstMove = *it;
+            return true;
+        }
+        if (m_stopped)
+        {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : DefenderNode
+//
+// @description             : Threat-space search, defender to move after the
+//                            attacker played 'lastMove'. A four must be blocked;
+//                            an open three can be answered on its line or by
+//                            a counter-four.
+//
+// @return                  : true if every defence still loses
+//--------------------------------------------------------------------------------
+bool GomokuEngine::DefenderNode(int color, int lastMove, int threeDepth, int plyLeft)
+{
+    m_nodes++;
+    if (IsTimeUp())
+    {
+        return false;
+    }
+
+    int defender = 3 - color;
+
+    int fives[2];
+    if (FindFives(defender, fives) > 0)
+    {
+        return false;
+    }
+
+    int attackerFives = FindFives(color, fives);
+    if (attackerFives >= 2)
+    {
+        return true;
+    }
+
+    std::vector<int> defences;
+    if (attackerFives == 1)
+    {
+        defences.push_back(fives[0]);
+    }
+    else
+    {
+        if (plyLeft <= 0)
+        {
+            return false;
+        }
+
+        for (int d = 0; d < 4; d++)
+        {
+            if (m_board.GetPattern(lastMove, d, color) < PATTERN_OPEN_THREE)
+            {
+                continue;
+            }
+
+            int step = m_board.GetDirectionStep(d);
+            for (int offset = -4; offset <= 4; offset++)
+            {
+                int index = lastMove + offset * step;
+                if (offset != 0 && m_board.IsEmpty(index) &&
+                    std::find(defences.begin(), defences.end(), index) == defences.end())
+                {
+                    defences.push_back(index);
+                }
+            }
+        }
+
+        std::vector<int> counterFours = GetThreatMoves(defender, false);
+        for (auto it = counterFours.begin(); it != counterFours.end(); it++)
+        {
+            if (std::find(defences.begin(), defences.end(), *it) == defences.end())
+            {
+                defences.push_back(*it);
+            }
+        }
+    }
+
+    for (auto it = defences.begin(); it != defences.end(); it++)
+    {
+        int move;
+        m_board.Place(*it, defender);
+        bool bWin = AttackerNode(color, threeDepth, plyLeft - 1, &move);
+        m_board.Remove(*it);
+
+        if (!bWin)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : FindForcedWin
+//
+// @description             : Victory by continuous fours (threeDepth 0) or by
+//                            threats including up to threeDepth open threes
+//
+// @return                  : true and the first move if a win was proven
+//--------------------------------------------------------------------------------
+bool GomokuEngine::FindForcedWin(int color, int threeDepth, int * move)
+{
+    return AttackerNode(color, threeDepth, THREAT_MAX_PLY, move) && !m_stopped;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetOrderedCandidates
+//
+// @description             : Empty cells near stones, ordered by attack value
+//                            plus most of the value they deny the opponent
+//
+// @return                  : at most 'limit' padded indices
+//--------------------------------------------------------------------------------
+std::vector<int> GomokuEngine::GetOrderedCandidates(int color, size_t limit) const
+{
+    std::vector<std::pair<int, int>> scored;
+    const std::vector<int> & cells = m_board.GetCells();
+    for (auto it = cells.begin(); it != cells.end(); it++)
+    {
+        if (m_board.IsEmpty(*it) && m_board.IsNearStones(*it))
+        {
+            int score = GetCellScore(*it, color) + GetCellScore(*it, 3 - color) * 4 / 5;
+            scored.push_back(std::make_pair(-score, *it));
+        }
+    }
+    std::sort(scored.begin(), scored.end());
+
+    std::vector<int> moves;
+    for (size_t i = 0; i < scored.size() && i < limit; i++)
+    {
+        moves.push_back(scored[i].second);
+    }
+
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Evaluate
+//
+// @description             : Static score for the side to move: the best cell
+//                            it can take now counts fully, the opponent's best
+//                            cell only partly, plus the overall potential. The
+//                            network, if any, adds its positional judgement.
+//
+// @return                  : score from the point of view of 'color'
+//--------------------------------------------------------------------------------
+int GomokuEngine::Evaluate(int color) const
+{
+    int own = 0;
+    int opponent = 0;
+    int bestOwn = 0;
+    int bestOpponent = 0;
+
+    const std::vector<int> & cells = m_board.GetCells();
+    for (auto it = cells.begin(); it != cells.end(); it++)
+    {
+        if (m_board.IsEmpty(*it) && m_board.IsNearStones(*it))
+        {
+            int ownScore = GetCellScore(*it, color);
+            int opponentScore = GetCellScore(*it, 3 - color);
+            own += ownScore;
+            opponent += opponentScore;
+            bestOwn = std::max(bestOwn, ownScore);
+            bestOpponent = std::max(bestOpponent, opponentScore);
+        }
+    }
+
+    int score = bestOwn - bestOpponent / 2 + (own - opponent) / 8;
+    if (m_board.HasNetwork())
+    {
+        score += m_board.EvaluateNetwork(color);
+    }
+    return score;
+}
+
+int GomokuEngine::AlphaBeta(int color, int depth, int alpha, int beta)
+{
+    m_nodes++;
+    if (IsTimeUp())
+    {
+        return 0;
+    }
+
+    int fives[2];
+    if (FindFives(color, fives) > 0)
+    {
+        return GOMOKU_WIN_SCORE;
+    }
+    if (depth == 0)
+    {
+        return Evaluate(color);
+    }
+
+    std::vector<int> moves;
+    int opponentFives = FindFives(3 - color, fives);
+    if (opponentFives >= 2)
+    {
+        return -GOMOKU_WIN_SCORE;
+    }
+    if (opponentFives == 1)
+    {
+        moves.push_back(fives[0]);
+    }
+    else
+    {
+        moves = GetOrderedCandidates(color, SEARCH_WIDTH);
+    }
+    if (moves.empty())
+    {
+        return 0;
+    }
+
+    for (auto it = moves.begin(); it != moves.end(); it++)
+    {
+        m_board.Place(*it, color);
+        int score = -AlphaBeta(3 - color, depth - 1, -beta, -alpha);
+        m_board.Remove(*it);
+
+        if (m_stopped)
+        {
+            return 0;
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+            if (alpha >= beta)
+            {
+                break;
+            }
+        }
+    }
+
+    return alpha;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Picks a move for the side to move, in order: make
+//                            five, block five, own forced win, defend against
+//                            the opponent's forced win, then alpha-beta over
+//                            the strongest candidates. Each phase gets a share
+//                            of the budget, the whole call stays within it.
+//
+// @return                  : cell (row * size + column)
+//--------------------------------------------------------------------------------
+size_t GomokuEngine::SelectMove(const MnkGame & game, int budgetMs)
+{
+    assert(game.GetWidth() == game.GetHeight() && game.GetK() == GOMOKU_K);
+    assert(!game.GameOver());
+
+    auto start = std::chrono::steady_clock::now();
+    m_nodes = 0;
+    m_stopped = false;
+
+    m_board = GomokuBoard(static_cast<int>(game.GetWidth()));
+    m_board.SetNetwork(m_network);
+    const std::vector<Player_t> & cells = game.GetCells();
+    for (size_t cell = 0; cell < cells.size(); cell++)
+    {
+        if (cells[cell] != PLAYER_NONE)
+        {
+            m_board.Place(m_board.ToIndex(cell), (cells[cell] == PLAYER_USER) ? 1 : 2);
+        }
+    }
+
+    int own = (game.GetTurn() == PLAYER_USER) ? 1 : 2;
+    int opponent = 3 - own;
+
+    if (!m_board.HasStones())
+    {
+        m_reason = "opening";
+        size_t center = game.GetWidth() / 2;
+        return center * game.GetWidth() + center;
+    }
+
+    int fives[2];
+    if (FindFives(own, fives) > 0)
+    {
+        m_reason = "five";
+        return m_board.ToCell(fives[0]);
+    }
+    if (FindFives(opponent, fives) > 0)
+    {
+        m_reason = "block";
+        return m_board.ToCell(fives[0]);
+    }
+
+    // Own victory by continuous fours, then with open threes
+    SetPhaseDeadline(start, budgetMs, 35);
+    for (int threeDepth = 0; threeDepth <= 3 && !m_stopped; threeDepth++)
+    {
+        int move;
+        if (FindForcedWin(own, threeDepth, &move))
+        {
+            m_reason = (threeDepth == 0) ? "vcf" : "vct";
+            return m_board.ToCell(move);
+        }
+    }
+
+    // Opponent threats: keep the first defence that refutes them
+    SetPhaseDeadline(start, budgetMs, 65);
+    int threatDepth = -1;
+    for (int threeDepth = 0; threeDepth <= 2 && !m_stopped; threeDepth++)
+    {
+        int move;
+        if (FindForcedWin(opponent, threeDepth, &move))
+        {
+            threatDepth = threeDepth;
+            break;
+        }
+    }
+
+    std::vector<int> candidates = GetOrderedCandidates(own, SEARCH_WIDTH + 2);
+
+    // Every cell near the stones is taken: any empty cell will do
+    const std::vector<int> & indices = m_board.GetCells();
+    for (auto it = indices.begin(); it != indices.end() && candidates.empty(); it++)
+    {
+        if (m_board.IsEmpty(*it))
+        {
+            candidates.push_back(*it);
+        }
+    }
+    assert(!candidates.empty());
+
+    if (threatDepth >= 0)
+    {
+        std::vector<int> fours = GetThreatMoves(own, false);
+        for (auto it = fours.begin(); it != fours.end(); it++)
+        {
+            if (std::find(candidates.begin(), candidates.end(), *it) == candidates.end())
+            {
+                candidates.push_back(*it);
+            }
+        }
+
+        m_reason = "defend";
+        for (auto it = candidates.begin(); it != candidates.end() && !m_stopped; it++)
+        {
+            int move;
+            m_board.Place(*it, own);
+            bool bRefuted = !AttackerNode(opponent, threatDepth, THREAT_MAX_PLY, &move) && !m_stopped;
+            m_board.Remove(*it);
+
+            if (bRefuted)
+            {
+                return m_board.ToCell(*it);
+            }
+        }
+        return m_board.ToCell(candidates.front());
+    }
+
+    // Quiet position: iterative deepening over the strongest candidates
+    m_reason = "search";
+    SetPhaseDeadline(start, budgetMs, 90);
+    int bestMove = candidates.front();
+    for (int depth = 1; depth <= 8 && !m_stopped; depth++)
+    {
+        int alpha = -GOMOKU_INFINITY;
+        int depthBest = -1;
+        for (auto it = candidates.begin(); it != candidates.end(); it++)
+        {
+            m_board.Place(*it, own);
+            int score = -AlphaBeta(opponent, depth - 1, -GOMOKU_INFINITY, -alpha);
+            m_board.Remove(*it);
+
+            if (m_stopped)
+            {
+                break;
+            }
+            if (score > alpha)
+            {
+                alpha = score;
+                depthBest = *it;
+            }
+        }
+
+        if (!m_stopped && depthBest >= 0)
+        {
+            bestMove = depthBest;
+            if (alpha >= GOMOKU_WIN_SCORE || alpha <= -GOMOKU_WIN_SCORE)
+            {
+                break;
+            }
+
+            // Best move first for the next iteration
+            candidates.erase(std::find(candidates.begin(), candidates.end(), bestMove));
+            candidates.insert(candidates.begin(), bestMove);
+        }
+    }
+
+    return m_board.ToCell(bestMove);
+}
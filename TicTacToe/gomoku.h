@@ -0,0 +1,112 @@
+#ifndef GOMOKU_H
+#define GOMOKU_H
+#include "mnkgame.h"
+#include "nnue.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Five-in-a-row engine for large boards (15x15 Gomoku and similar).
+//
+// Every empty cell keeps, per direction, a 16 bit code of the 4 cells on
+// either side. The codes are updated incrementally when a stone is placed
+// or removed and index precomputed pattern tables that classify the line
+// through the cell (open three, four, broken patterns, ...). On top of
+// that the engine runs a threat-space search for forced wins (continuous
+// fours and open threes) before falling back to a shallow alpha-beta.
+//------------------------------------------------------------------------
+typedef enum Pattern_tag
+{
+    PATTERN_NONE,
+    PATTERN_TWO,
+    PATTERN_OPEN_TWO,
+    PATTERN_THREE,
+    PATTERN_OPEN_THREE,
+    PATTERN_FOUR,
+    PATTERN_OPEN_FOUR,
+    PATTERN_FIVE,
+    PATTERN_COUNT
+}Pattern_t;
+
+const size_t GOMOKU_K = 5;
+const size_t GOMOKU_MAX_SIZE = 25;
+
+// Pattern made along one line by placing 'own' in the middle of a 9 cell
+// window. 'window' holds the other 8 cells, 2 bits each, nearest last on
+// the left side and nearest first on the right side: 0 empty, 1 own,
+// 2 opponent, 3 off the board.
+Pattern_t ClassifyWindow(uint16_t window);
+
+//------------------------------------------------------------------------
+// Board with incrementally maintained pattern codes. Stones are 1 and 2,
+// the board is padded by 4 off-board cells on every side. With a network
+// attached, its accumulators are updated along with the codes.
+//------------------------------------------------------------------------
+class GomokuBoard
+{
+private:
+    int m_size;
+    int m_stride;
+    int m_steps[4];
+    std::vector<uint8_t> m_stones;
+    std::vector<uint16_t> m_codes[4];
+    std::vector<uint8_t> m_nearby;
+    std::vector<int> m_cells;
+    std::vector<uint16_t> m_cellOfIndex;
+    const EvalNetwork * m_network;
+    EvalAccumulator m_accumulator;
+
+    void SetCode(int index, int color);
+
+public:
+    explicit GomokuBoard(int size);
+
+    int GetSize() const { return m_size; }
+    int ToIndex(size_t cell) const;
+    size_t ToCell(int index) const;
+    bool IsEmpty(int index) const { return m_stones[index] == 0; }
+    bool IsNearStones(int index) const { return m_nearby[index] != 0; }
+    void Place(int index, int color);
+    void Remove(int index);
+    Pattern_t GetPattern(int index, int direction, int color) const;
+    int GetDirectionStep(int direction) const { return m_steps[direction]; }
+    const std::vector<int> & GetCells() const { return m_cells; }
+    bool HasStones() const;
+    void SetNetwork(const EvalNetwork * network);
+    bool HasNetwork() const { return m_network != nullptr; }
+    int EvaluateNetwork(int color) const { return m_network->Evaluate(m_accumulator, color); }
+};
+
+class GomokuEngine
+{
+private:
+    GomokuBoard m_board;
+    const EvalNetwork * m_network;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_stopped;
+    unsigned long long m_nodes;
+    const char * m_reason;
+
+    int GetCellScore(int index, int color) const;
+    bool HasPattern(int index, int color, Pattern_t minimum) const;
+    int FindFives(int color, int * fives) const;
+    std::vector<int> GetThreatMoves(int color, bool bIncludeThrees) const;
+    bool IsTimeUp();
+    void SetPhaseDeadline(std::chrono::steady_clock::time_point start, int budgetMs, int percent);
+    bool AttackerNode(int color, int threeDepth, int plyLeft, int * firstMove);
+    bool DefenderNode(int color, int lastMove, int threeDepth, int plyLeft);
+    bool FindForcedWin(int color, int threeDepth, int * move);
+    std::vector<int> GetOrderedCandidates(int color, size_t limit) const;
+    int Evaluate(int color) const;
+    int AlphaBeta(int color, int depth, int alpha, int beta);
+
+public:
+    GomokuEngine();
+    void SetEvalNetwork(const EvalNetwork * network) { m_network = network; }
+    size_t SelectMove(const MnkGame & game, int budgetMs);
+    unsigned long long GetNodes() const { return m_nodes; }
+    const char * GetReason() const { return m_reason; }
+};
+
+#endif // GOMOKU_H
@@ -1,11 +1,31 @@
 #include "mainwindow.h"
+#include "trace.h"
 
 #include <QApplication>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+    TRACE_THREAD_NAME("UI");
+
+    // Data files such as the tablebase live next to the program
+    MainWindow w(nullptr, STATS_FILE_NAME, QCoreApplication::applicationDirPath().toStdString());
     w.show();
-    return a.exec();
+
+    // --demo [player]: 'player' (heuristic by default) plays X against the
+    // selected computer player and a new game starts as soon as one ends
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--demo") == 0)
+        {
+            bool hasValue = (i + 1 < argc) && (argv[i + 1][0] != '-');
+            w.StartDemo(hasValue ? argv[++i] : "heuristic");
+        }
+    }
+
+    int result = a.exec();
+
+    TRACE_FLUSH("tictactoe_trace.json");
+    return result;
 }
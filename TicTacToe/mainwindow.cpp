@@ -1,25 +1,80 @@
-#include <QmessageBox>
 #include "mainwindow.h"
+#include "gametreedialog.h"
+#include "qubicdialog.h"
+#include "ultimatedialog.h"
 #include "ui_mainwindow.h"
 
-MainWindow::MainWindow(QWidget *parent)
+// Time controls offered, the first one being the default
+static const struct
+{
+    const char * name;
+    TimeControl control;
+} TIME_CONTROLS[] =
+{
+    {"Untimed", {0, 0}},
+    {"10 s + 1 s", {10000, 1000}},
+    {"30 s + 2 s", {30000, 2000}},
+    {"1 min + 5 s", {60000, 5000}},
+};
+
+MainWindow::MainWindow(QWidget *parent, const std::string & statsPrefix, const std::string & dataDirectory)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , m_stats(statsPrefix)
+    , m_dataDirectory(dataDirectory)
 {
     m_gameData = nullptr;
-    m_userScore = 0;
-    m_computerScore = 0;
+    m_worker = nullptr;
 
     ui->setupUi(this);
 
     // Prepare button mapping
     CreateBoard();
 
+    // List the computer players, the original heuristic being the default.
+    // X is played by a person unless an engine is picked for it too.
+    ui->cmbUserPlayer->addItem(HUMAN_PLAYER);
+    std::vector<std::string> engineNames = GetEngineNames();
+    for (auto it = engineNames.begin(); it != engineNames.end(); it++)
+    {
+        ui->cmbEngine->addItem(QString::fromStdString(*it));
+        ui->cmbUserPlayer->addItem(QString::fromStdString(*it));
+    }
+    ui->cmbEngine->setCurrentText("heuristic");
+    ui->cmbUserPlayer->setCurrentText(HUMAN_PLAYER);
+
+    for (size_t i = 0; i < sizeof(TIME_CONTROLS) / sizeof(TIME_CONTROLS[0]); i++)
+    {
+        ui->cmbTimeControl->addItem(TIME_CONTROLS[i].name);
+    }
+
+    // The scores shown are those of the players selected
+    m_gameRecord.players[PLAYER_USER] = HUMAN_PLAYER.toStdString();
+    m_gameRecord.players[PLAYER_COMPUTER] = ui->cmbEngine->currentText().toStdString();
+    UpdateScores();
+
+    // Search progress is coalesced: the timer drains everything the engine
+    // posted since the last tick and only shows the latest update
+    m_progressTimer.setInterval(PROGRESS_REFRESH_MS);
+    connect(&m_progressTimer, SIGNAL(timeout()), this, SLOT(OnProgressTimer()));
+
+    m_clockTimer.setInterval(CLOCK_REFRESH_MS);
+    connect(&m_clockTimer, SIGNAL(timeout()), this, SLOT(OnClockTimer()));
+    UpdateClocks();
+
     ui->statusBar->showMessage("Click on 'New Game' to begin");
 }
 
 MainWindow::~MainWindow()
 {
+    // The search has been told to stop, so this wait is short
+    ComputerMoveWorker * worker = m_worker;
+    StopMoveWorker();
+    if (worker)
+    {
+        worker->wait();
+    }
+    delete m_gameData;
     delete ui;
 }
 
@@ -70,17 +125,59 @@ void MainWindow::EnableGame(bool bEnable)
     }
 }
 
+//--------------------------------------------------------------------------------
+// @name                    : FormatPlayerStats
+//
+// @description             : A player's lifetime record in words, for the score
+//                            tooltips
+//
+// @return                  : QString
+//--------------------------------------------------------------------------------
+static QString FormatPlayerStats(const std::string & name, const PlayerStats & stats)
+{
+    QString streak = "No streak";
+    if (stats.streak > 0)
+    {
+        streak = QString("Won the last %1").arg(stats.streak);
+    }
+    else if (stats.streak < 0)
+    {
+        streak = QString("Lost the last %1").arg(-stats.streak);
+    }
+
+    QString text = QString("%1: %2 won, %3 drawn, %4 lost\n%5, longest winning streak %6")
+                   .arg(QString::fromStdString(name))
+                   .arg(stats.wins)
+                   .arg(stats.draws)
+                   .arg(stats.losses)
+                   .arg(streak)
+                   .arg(stats.longestWinStreak);
+    if (stats.moves > 0)
+    {
+        text += QString("\nMove time: %1 us average, p99 under %2 us")
+                .arg(stats.totalLatencyUs / stats.moves)
+                .arg(stats.GetLatencyPercentile(99));
+    }
+    return text;
+}
+
 //--------------------------------------------------------------------------------
 // @name                    : UpdateScores
 //
-// @description             : Updates user and computer scores
+// @description             : Shows the lifetime wins of the two players, with
+//                            the rest of their record as a tooltip
 //
 // @return                  : Nothing
 //--------------------------------------------------------------------------------
 void MainWindow::UpdateScores()
 {
-    ui->scoreUser->setText(QString::number(m_userScore));
-    ui->scoreComputer->setText(QString::number(m_computerScore));
+    PlayerStats user = m_stats.GetPlayerStats(m_gameRecord.players[PLAYER_USER]);
+    PlayerStats computer = m_stats.GetPlayerStats(m_gameRecord.players[PLAYER_COMPUTER]);
+
+    ui->scoreUser->setText(QString::number(user.wins));
+    ui->scoreUser->setToolTip(FormatPlayerStats(m_gameRecord.players[PLAYER_USER], user));
+    ui->scoreComputer->setText(QString::number(computer.wins));
+    ui->scoreComputer->setToolTip(FormatPlayerStats(m_gameRecord.players[PLAYER_COMPUTER], computer));
 }
 
 //--------------------------------------------------------------------------------
@@ -104,12 +201,23 @@ void MainWindow::InitializeGameBoard()
 // @name                    : MarkBoardPosition
 //
 // @description             : Executed each time a board button is pressed. It
-//                            marks the player selection on the board.
+//                            marks the player selection on the board and hands
+//                            the clock over to the opponent. A move made after
+//                            the player's time ran out loses on time instead.
 //
 // @return                  : Nothing
 //--------------------------------------------------------------------------------
 void MainWindow::MarkBoardPosition(size_t position, Player_t player)
 {
+    TRACE_SCOPE("MarkBoardPosition");
+
+    if (m_clock.IsTimed() && m_clock.GetRemainingMs(player) == 0)
+    {
+        LoseOnTime(player);
+        return;
+    }
+    m_clock.Stop();
+
     // Update game data
     m_gameData->AddPlayerMarkToBoard(position, player);
 
@@ -122,47 +230,73 @@ void MainWindow::MarkBoardPosition(size_t position, Player_t player)
     Player_t playerWon = m_gameData->CheckWin();
     if (playerWon == PLAYER_USER)
     {
-        m_userScore++;
-        ui->statusBar->showMessage("Congratulations!!! You Won.");
-        QMessageBox msgBox;
-        msgBox.setWindowTitle("Congratulations");
-        msgBox.setText("You won the game");
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.exec();
+        RecordGame(PLAYER_USER);
+        ShowGameResult(m_userEngine ? "X won the game" : "Congratulations!!! You Won.");
     }
     else if (playerWon == PLAYER_COMPUTER)
     {
-        m_computerScore++;
-        ui->statusBar->showMessage("Computer won the game.");
-        QMessageBox msgBox;
-        msgBox.setWindowTitle("Game Over");
-        msgBox.setText("Computer won the game");
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.exec();
+        RecordGame(PLAYER_COMPUTER);
+        ShowGameResult("Computer won the game.");
     }
     else if (m_gameData->GameOver())
     {
-        ui->statusBar->showMessage("Game Tied");
-        QMessageBox msgBox;
-        msgBox.setWindowTitle("Game Over");
-        msgBox.setText("Game was tied");
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.exec();
-        EnableGame(false);
+        RecordGame(PLAYER_NONE);
+        ShowGameResult("Game Tied");
     }
     else if (player == PLAYER_USER)
     {
         // If this move was user's, the next one should be of computer.
+        m_clock.Start(PLAYER_COMPUTER);
         SimulateComputerMove();
     }
     else
     {
-        // DO NOTHING
+        m_clock.Start(PLAYER_USER);
     }
 
+    UpdateClocks();
     UpdateScores();
 }
 
+//--------------------------------------------------------------------------------
+// @name                    : RecordGame
+//
+// @description             : Adds the finished game to the statistics store.
+//                            The store writes it to disk on its own thread.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::RecordGame(Player_t winner)
+{
+    m_gameRecord.winner = winner;
+    m_stats.Record(m_gameRecord);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : ShowGameResult
+//
+// @description             : Shows the result of a finished game next to the
+//                            board without blocking the event loop, and starts
+//                            the next game right away in auto rematch mode.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::ShowGameResult(const QString & result)
+{
+    TRACE_SCOPE("ShowGameResult");
+
+    ui->lblResult->setText(result);
+    ui->statusBar->showMessage(result);
+    EnableGame(false);
+    m_clockTimer.stop();
+
+    if (ui->chkAutoRematch->isChecked())
+    {
+        // Queued so the move that ended the game is fully handled first
+        QTimer::singleShot(0, this, SLOT(on_btnNewGame_clicked()));
+    }
+}
+
 //--------------------------------------------------------------------------------
 // @name                    : UpdatePlayerTurn
 //
@@ -211,14 +345,237 @@ void MainWindow::UpdatePlayerTurn(Player_t player)
 //--------------------------------------------------------------------------------
 void MainWindow::SimulateComputerMove()
 {
+    TRACE_SCOPE("SimulateComputerMove");
+
     UpdatePlayerTurn(PLAYER_COMPUTER);
 
     // Disable user interaction
     EnableGame(false);
 
-    ComputerMoveWorker* worker = new ComputerMoveWorker(m_gameData);
-    connect(worker, SIGNAL(ComputerMoveAvailable(int)), this, SLOT(OnComputerMoveAvailable(int)));
-    worker->start();
+    StartMoveWorker(m_engine, PLAYER_COMPUTER, SLOT(OnComputerMoveAvailable(int)));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SimulateUserMove
+//
+// @description             : Plays the user's side with the X engine in demo
+//                            mode, in a separate thread like the computer.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::SimulateUserMove()
+{
+    TRACE_SCOPE("SimulateUserMove");
+
+    UpdatePlayerTurn(PLAYER_USER);
+    EnableGame(false);
+
+    StartMoveWorker(m_userEngine, PLAYER_USER, SLOT(OnUserMoveAvailable(int)));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : StartMoveWorker
+//
+// @description             : Starts a worker that selects 'player's move with
+//                            'engine' and delivers it to 'slot'. The worker
+//                            deletes itself once it has finished. Only one
+//                            worker runs at a time; one still searching is
+//                            stopped first so its result cannot be taken for
+//                            the new one's.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::StartMoveWorker(const std::shared_ptr<Engine> & engine, Player_t player, const char * slot)
+{
+    StopMoveWorker();
+
+    // The engine gets its share of the time left over the moves still to play
+    if (engine)
+    {
+        MoveTime moveTime = {0, 0};
+        if (m_clock.IsTimed())
+        {
+            int movesLeft = static_cast<int>(m_gameData->GetPositionsAvailable() + 1) / 2;
+            moveTime = AllocateMoveTime(m_clock.GetRemainingMs(player), m_clock.GetControl().incrementMs, movesLeft);
+        }
+        engine->SetMoveTime(moveTime);
+    }
+
+    m_worker = new ComputerMoveWorker(*m_gameData, engine, player);
+    connect(m_worker, SIGNAL(ComputerMoveAvailable(int)), this, slot);
+    connect(m_worker, SIGNAL(finished()), m_worker, SLOT(deleteLater()));
+    m_worker->start();
+
+    m_progressTimer.start();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : StopMoveWorker
+//
+// @description             : Called when a move arrives or before the game it
+//                            is searching goes away. Never waits: a worker
+//                            still searching is told to stop and left to finish
+//                            and delete itself, its progress unread. Its engine
+//                            may still be running, so a new instance of that
+//                            engine plays the next moves.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::StopMoveWorker(bool bMoveDelivered)
+{
+    m_progressTimer.stop();
+    if (!m_worker)
+    {
+        return;
+    }
+
+    disconnect(m_worker, SIGNAL(ComputerMoveAvailable(int)), this, nullptr);
+    std::shared_ptr<Engine> engine = m_worker->GetEngine();
+    m_worker = nullptr;
+
+    if (!bMoveDelivered && engine)
+    {
+        engine->RequestStop();
+        std::shared_ptr<Engine> replacement(CreateEngine(engine->GetName(), m_dataDirectory));
+        if (engine == m_engine)
+        {
+            m_engine = replacement;
+        }
+        else if (engine == m_userEngine)
+        {
+            m_userEngine = replacement;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : OnProgressTimer
+//
+// @description             : Drains the progress channel and shows the most
+//                            recent search update.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::OnProgressTimer()
+{
+    if (!m_worker)
+    {
+        return;
+    }
+
+    SearchProgress progress;
+    bool bUpdated = false;
+    while (m_worker->GetProgressChannel().TryPop(progress))
+    {
+        bUpdated = true;
+    }
+
+    if (bUpdated)
+    {
+        ShowSearchProgress(progress);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : FormatClock
+//
+// @description             : Time on a clock as minutes, seconds and tenths
+//
+// @return                  : QString
+//--------------------------------------------------------------------------------
+static QString FormatClock(int ms)
+{
+    return QString("%1:%2.%3")
+           .arg(ms / 60000)
+           .arg((ms / 1000) % 60, 2, 10, QChar('0'))
+           .arg((ms / 100) % 10);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : UpdateClocks
+//
+// @description             : Shows both clocks, or hides them in untimed games
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::UpdateClocks()
+{
+    ui->lblUserClock->setVisible(m_clock.IsTimed());
+    ui->lblComputerClock->setVisible(m_clock.IsTimed());
+    ui->lblUserClock->setText(USER_MARK + " " + FormatClock(m_clock.GetRemainingMs(PLAYER_USER)));
+    ui->lblComputerClock->setText(COMPUTER_MARK + " " + FormatClock(m_clock.GetRemainingMs(PLAYER_COMPUTER)));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : OnClockTimer
+//
+// @description             : Redraws the clocks and ends the game when the
+//                            running clock reaches zero
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::OnClockTimer()
+{
+    UpdateClocks();
+
+    Player_t running = m_clock.GetRunning();
+    if (running != PLAYER_NONE && m_clock.GetRemainingMs(running) == 0)
+    {
+        LoseOnTime(running);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : LoseOnTime
+//
+// @description             : Ends the game as a loss for 'player', whose time
+//                            has run out. A search still running for them is
+//                            abandoned.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::LoseOnTime(Player_t player)
+{
+    StopMoveWorker();
+    m_clock.Stop();
+    UpdateClocks();
+
+    if (player == PLAYER_USER)
+    {
+        RecordGame(PLAYER_COMPUTER);
+        ShowGameResult(m_userEngine ? "X lost on time" : "You lost on time.");
+    }
+    else
+    {
+        RecordGame(PLAYER_USER);
+        ShowGameResult("Computer lost on time.");
+    }
+
+    UpdateScores();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : ShowSearchProgress
+//
+// @description             : Shows depth, score and principal variation of the
+//                            computer's search on the status bar. Positions are
+//                            numbered 1 to 9 like the board buttons.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::ShowSearchProgress(const SearchProgress & progress)
+{
+    QString pv;
+    for (size_t i = 0; i < progress.pvLength; i++)
+    {
+        pv += QString(" %1").arg(progress.pv[i] + 1);
+    }
+
+    ui->statusBar->showMessage(QString("Computer's turn - depth %1, score %2, pv%3 (%4 nodes)")
+                               .arg(progress.depth)
+                               .arg(progress.score)
+                               .arg(pv)
+                               .arg(progress.nodes));
 }
 
 //--------------------------------------------------------------------------------
@@ -230,19 +587,72 @@ void MainWindow::SimulateComputerMove()
 //--------------------------------------------------------------------------------
 void MainWindow::OnComputerMoveAvailable(int move)
 {
+    // Ignore a result that was already queued when its game was abandoned
+    if (sender() != m_worker)
+    {
+        return;
+    }
+
+    // Search is over, discard any progress not shown yet
+    m_gameRecord.latenciesUs[PLAYER_COMPUTER].push_back(static_cast<uint32_t>(m_worker->GetLastMoveLatency()));
+    StopMoveWorker(true);
+
     // Mark computer's move on board
     MarkBoardPosition(static_cast<size_t>(move), PLAYER_COMPUTER);
 
-    // Prompt for user move only if game is not over
-    if (!m_gameData->GameOver())
+    // Prompt for user move only if game is not over, on the board or on time
+    if (m_clock.GetRunning() == PLAYER_USER)
     {
-        UpdatePlayerTurn(PLAYER_USER);
+        if (m_userEngine)
+        {
+            SimulateUserMove();
+        }
+        else
+        {
+            UpdatePlayerTurn(PLAYER_USER);
 
-        // Enable user interaction
-        EnableGame(true);
+            // Enable user interaction
+            EnableGame(true);
+        }
     }
 }
 
+//--------------------------------------------------------------------------------
+// @name                    : OnUserMoveAvailable
+//
+// @description             : Triggered when the X engine's move is available in
+//                            demo mode. Marking it hands the turn to the computer.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::OnUserMoveAvailable(int move)
+{
+    if (sender() != m_worker)
+    {
+        return;
+    }
+
+    m_gameRecord.latenciesUs[PLAYER_USER].push_back(static_cast<uint32_t>(m_worker->GetLastMoveLatency()));
+    StopMoveWorker(true);
+    MarkBoardPosition(static_cast<size_t>(move), PLAYER_USER);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : StartDemo
+//
+// @description             : Lets 'userPlayer' play X against the selected
+//                            computer player, game after game, with nobody at
+//                            the board.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MainWindow::StartDemo(const QString & userPlayer)
+{
+    ui->cmbUserPlayer->setCurrentText(userPlayer);
+    ui->chkAutoRematch->setChecked(true);
+    on_btnNewGame_clicked();
+}
+
 //--------------------------------------------------------------------------------
 // On Button Clicked: Quit
 //--------------------------------------------------------------------------------
@@ -256,19 +666,52 @@ void MainWindow::on_btnQuit_clicked()
 //--------------------------------------------------------------------------------
 void MainWindow::on_btnNewGame_clicked()
 {
+    // A search still running refers to the game about to be deleted
+    StopMoveWorker();
+
     if (m_gameData)
     {
         delete m_gameData;
     }
 
     m_gameData = new Game();
+    m_engine.reset(CreateEngine(ui->cmbEngine->currentText().toStdString(), m_dataDirectory));
+
+    QString userPlayer = ui->cmbUserPlayer->currentText();
+    m_userEngine.reset(userPlayer == HUMAN_PLAYER ? nullptr : CreateEngine(userPlayer.toStdString(), m_dataDirectory));
+
+    m_gameRecord = StatsGameRecord();
+    m_gameRecord.players[PLAYER_USER] = userPlayer.toStdString();
+    m_gameRecord.players[PLAYER_COMPUTER] = ui->cmbEngine->currentText().toStdString();
+
+    ui->lblResult->setText("");
     InitializeGameBoard();
-    EnableGame(true);
+    EnableGame(!m_userEngine);
     UpdateScores();
 
+    // The first player's clock starts right away
+    m_clock.Reset(TIME_CONTROLS[ui->cmbTimeControl->currentIndex()].control);
+    m_clock.Start(m_gameData->GetTurn());
+    UpdateClocks();
+    if (m_clock.IsTimed())
+    {
+        m_clockTimer.start();
+    }
+    else
+    {
+        m_clockTimer.stop();
+    }
+
     if (m_gameData->GetTurn() == PLAYER_USER)
     {
-        UpdatePlayerTurn(PLAYER_USER);
+        if (m_userEngine)
+        {
+            SimulateUserMove();
+        }
+        else
+        {
+            UpdatePlayerTurn(PLAYER_USER);
+        }
     }
     else
     {
@@ -276,6 +719,50 @@ void MainWindow::on_btnNewGame_clicked()
     }
 }
 
+//--------------------------------------------------------------------------------
+// On Button Clicked: 4x4x4 Game
+//--------------------------------------------------------------------------------
+void MainWindow::on_btnQubic_clicked()
+{
+    QubicDialog dialog(this);
+    dialog.exec();
+}
+
+//--------------------------------------------------------------------------------
+// On Button Clicked: Ultimate Game
+//--------------------------------------------------------------------------------
+void MainWindow::on_btnUltimate_clicked()
+{
+    UltimateDialog dialog(this);
+    dialog.exec();
+}
+
+//--------------------------------------------------------------------------------
+// On Button Clicked: Game Tree
+//--------------------------------------------------------------------------------
+void MainWindow::on_btnGameTree_clicked()
+{
+    // The empty board with the user to move before the first game
+    BoardMask_t user = 0;
+    BoardMask_t computer = 0;
+    Player_t turn = PLAYER_USER;
+    if (m_gameData)
+    {
+        user = GetPlayerMask(*m_gameData, PLAYER_USER);
+        computer = GetPlayerMask(*m_gameData, PLAYER_COMPUTER);
+
+        // Game keeps the first player as its turn, moves alternate from there
+        turn = m_gameData->GetTurn();
+        if (CountBits(user | computer) % 2 == 1)
+        {
+            turn = (turn == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+        }
+    }
+
+    GameTreeDialog dialog(user, computer, turn, this);
+    dialog.exec();
+}
+
 
 //--------------------------------------------------------------------------------
 // On Button Clicked: Button 1 through 9
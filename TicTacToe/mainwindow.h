@@ -2,8 +2,14 @@
 #define MAINWINDOW_H
 
 #include "game.h"
+#include "engine.h"
+#include "statsstore.h"
+#include "timecontrol.h"
 #include <QMainWindow>
+#include <QThread>
+#include <QTimer>
 #include <QtWidgets/QAbstractButton>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -12,14 +18,68 @@ QT_END_NAMESPACE
 const QString USER_MARK = "X";
 const QString COMPUTER_MARK = "O";
 
+// How often search progress is drained from the engine and shown
+const int PROGRESS_REFRESH_MS = 50;
+
+// How often the clocks are redrawn and checked for a flag
+const int CLOCK_REFRESH_MS = 100;
+
+// X player entry for a person clicking the board
+const QString HUMAN_PLAYER = "human";
+
 //Q_DECLARE_METATYPE(size_t);
 
+//------------------------------------------------------------------------
+// Worker thread that calculates Computer's move. In demo mode it also
+// plays the user's side, 'player' says which side it moves for. It works
+// on its own copy of the game and shares the engine, so a worker that is
+// abandoned can run to the end after its game has gone away.
+//------------------------------------------------------------------------
+class ComputerMoveWorker: public QThread
+{
+Q_OBJECT
+private:
+    Game m_game;
+    std::shared_ptr<Engine> m_engine;
+    Player_t m_player;
+    std::unique_ptr<ProgressChannel> m_progress;
+
+signals:
+    void ComputerMoveAvailable(int move);
+
+public:
+    ComputerMoveWorker(const Game & game, const std::shared_ptr<Engine> & engine, Player_t player) : QThread()
+    {
+        m_game = game;
+        m_engine = engine;
+        m_player = player;
+        m_progress.reset(new ProgressChannel());
+        if (m_engine)
+        {
+            m_engine->SetProgressChannel(m_progress.get());
+        }
+    }
+
+    const std::shared_ptr<Engine> & GetEngine() const { return m_engine; }
+    ProgressChannel & GetProgressChannel() { return *m_progress; }
+    unsigned long GetLastMoveLatency() const { return m_game.GetLastMoveLatency(); }
+
+    void run()
+    {
+        TRACE_THREAD_NAME("ComputerMoveWorker");
+        TRACE_SCOPE("ComputerMoveWorker::run");
+        size_t move = m_game.GetComputerMove(m_engine.get(), m_player);
+        emit ComputerMoveAvailable(static_cast<int>(move));
+    }
+};
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    MainWindow(QWidget *parent = nullptr, const std::string & statsPrefix = STATS_FILE_NAME,
+               const std::string & dataDirectory = ENGINE_DATA_DIRECTORY);
     ~MainWindow();
     void CreateBoard();
     void EnableGame(bool bEnable);
@@ -27,15 +87,36 @@ public:
     void UpdateScores();
     void MarkBoardPosition(size_t position, Player_t player);
     void SimulateComputerMove();
+    void SimulateUserMove();
+    void StartMoveWorker(const std::shared_ptr<Engine> & engine, Player_t player, const char * slot);
+    void StopMoveWorker(bool bMoveDelivered = false);
+    void RecordGame(Player_t winner);
+    void ShowGameResult(const QString & result);
     void UpdatePlayerTurn(Player_t player);
+    void ShowSearchProgress(const SearchProgress & progress);
+    void StartDemo(const QString & userPlayer);
+    void UpdateClocks();
+    void LoseOnTime(Player_t player);
 
 private slots:
     void OnComputerMoveAvailable(int move);
 
+    void OnUserMoveAvailable(int move);
+
+    void OnProgressTimer();
+
+    void OnClockTimer();
+
     void on_btnQuit_clicked();
 
     void on_btnNewGame_clicked();
 
+    void on_btnQubic_clicked();
+
+    void on_btnUltimate_clicked();
+
+    void on_btnGameTree_clicked();
+
     void on_btnPos1_clicked();
 
     void on_btnPos2_clicked();
@@ -58,7 +139,14 @@ private:
     Ui::MainWindow *ui;
     std::vector<QAbstractButton *> m_board;
     Game * m_gameData;
-    int m_userScore;
-    int m_computerScore;
+    std::shared_ptr<Engine> m_engine;
+    std::shared_ptr<Engine> m_userEngine;   // plays X in demo mode
+    ComputerMoveWorker * m_worker;
+    QTimer m_progressTimer;
+    StatsStore m_stats;
+    std::string m_dataDirectory;
+    StatsGameRecord m_gameRecord;           // players and move times of the current game
+    GameClock m_clock;
+    QTimer m_clockTimer;
 };
 #endif // MAINWINDOW_H
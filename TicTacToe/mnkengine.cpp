@@ -0,0 +1,489 @@
+#include "mnkengine.h"
+#include "bitboard.h"
+#include "openingbook.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+// The clock is read once per this many nodes
+const unsigned long long MNK_TIME_CHECK_NODES = 1024;
+
+// Marks an empty hash move or killer slot
+const uint8_t MNK_NO_MOVE = 0xFF;
+
+// Ordering scores: each class of move goes before all of the next ones.
+// History is halved whenever an entry reaches MNK_HISTORY_LIMIT.
+const int MNK_ORDER_HASH_SCORE = 1 << 30;
+const int MNK_ORDER_WIN_SCORE = 1 << 29;
+const int MNK_ORDER_BLOCK_SCORE = 1 << 28;
+const int MNK_ORDER_KILLER_SCORE = 1 << 26;
+const uint32_t MNK_HISTORY_LIMIT = 1 << 24;
+
+MnkEngine::MnkEngine()
+{
+    m_width = 0;
+    m_height = 0;
+    m_k = 0;
+    m_fullMask = 0;
+    m_book = nullptr;
+    m_ordering = MNK_ORDER_ALL;
+    memset(m_killers, MNK_NO_MOVE, sizeof(m_killers));
+    memset(m_history, 0, sizeof(m_history));
+    m_hashMoves.resize(MNK_HASH_MOVE_ENTRIES);
+    for (auto it = m_hashMoves.begin(); it != m_hashMoves.end(); it++)
+    {
+        it->move = MNK_NO_MOVE;
+    }
+    m_bTimed = false;
+    m_stopped = false;
+    m_reason = "";
+    ResetStats();
+}
+
+void MnkEngine::ResetStats()
+{
+    m_stats.moves = 0;
+    m_stats.bookProbes = 0;
+    m_stats.bookHits = 0;
+    m_stats.nodes = 0;
+    m_stats.depth = 0;
+    m_stats.score = 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetBoard
+//
+// @description             : Builds the line tables of a board. Nothing is
+//                            done when the board does not change.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkEngine::SetBoard(size_t width, size_t height, size_t k)
+{
+    assert(width * height <= 64 && k <= MNK_MAX_PLY);
+
+    if (width == m_width && height == m_height && k == m_k)
+    {
+        return;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_k = k;
+    size_t cells = width * height;
+    m_fullMask = (cells == 64) ? ~0ULL : ((1ULL << cells) - 1);
+    m_lines = GetMnkLineMasks(width, height, k);
+
+    m_cellLines.assign(cells, std::vector<uint64_t>());
+    for (auto it = m_lines.begin(); it != m_lines.end(); it++)
+    {
+        for (size_t cell = 0; cell < cells; cell++)
+        {
+            if (*it & (1ULL << cell))
+            {
+                m_cellLines[cell].push_back(*it);
+            }
+        }
+    }
+
+    // Central cells lie on the most lines
+    m_cellPriors.assign(cells, 0);
+    for (size_t cell = 0; cell < cells; cell++)
+    {
+        m_cellPriors[cell] = static_cast<int>(m_cellLines[cell].size());
+    }
+
+    // Moves remembered for another board would be meaningless
+    for (auto it = m_hashMoves.begin(); it != m_hashMoves.end(); it++)
+    {
+        it->move = MNK_NO_MOVE;
+    }
+
+    // Every extra stone in an open line is worth four times more
+    m_lineWeights.assign(k + 1, 0);
+    for (size_t count = 1; count < k; count++)
+    {
+        m_lineWeights[count] = 1 << std::min<size_t>(2 * count, 16);
+    }
+}
+
+// Does the stone just put on 'cell' complete a line of 'mask'?
+bool MnkEngine::IsWinningMove(uint64_t mask, size_t cell) const
+{
+    const std::vector<uint64_t> & lines = m_cellLines[cell];
+    for (auto it = lines.begin(); it != lines.end(); it++)
+    {
+        if ((mask & *it) == *it)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetHashMove
+//
+// @description             : Slot of the hash move table for a position. The
+//                            slot holds another position, or none, unless its
+//                            masks match.
+//
+// @return                  : HashMove
+//--------------------------------------------------------------------------------
+MnkEngine::HashMove & MnkEngine::GetHashMove(uint64_t own, uint64_t opponent)
+{
+    uint64_t key = (own * 0x9E3779B97F4A7C15ULL) ^ (opponent * 0xC2B2AE3D27D4EB4FULL);
+    return m_hashMoves[(key ^ (key >> 29)) & (MNK_HASH_MOVE_ENTRIES - 1)];
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : OrderMoves
+//
+// @description             : Lists the cells of 'moves' best first by the
+//                            enabled heuristics, ties in cell order
+//
+// @return                  : number of cells written to 'ordered'
+//--------------------------------------------------------------------------------
+size_t MnkEngine::OrderMoves(uint64_t own, uint64_t opponent, uint64_t moves, int ply, uint8_t * ordered)
+{
+    size_t count = 0;
+    if (m_ordering == MNK_ORDER_NONE)
+    {
+        for (; moves; moves &= moves - 1)
+        {
+            ordered[count++] = static_cast<uint8_t>(GetLowestBitIndex(moves));
+        }
+        return count;
+    }
+
+    uint8_t hashMove = MNK_NO_MOVE;
+    if (m_ordering & MNK_ORDER_HASH_MOVE)
+    {
+        const HashMove & entry = GetHashMove(own, opponent);
+        if (entry.own == own && entry.opponent == opponent)
+        {
+            hashMove = entry.move;
+        }
+    }
+
+    int scores[64];
+    for (; moves; moves &= moves - 1)
+    {
+        size_t cell = GetLowestBitIndex(moves);
+        int score = 0;
+        if (cell == hashMove)
+        {
+            score += MNK_ORDER_HASH_SCORE;
+        }
+        if (m_ordering & MNK_ORDER_PRIOR)
+        {
+            if (IsWinningMove(own | (1ULL << cell), cell))
+            {
+                score += MNK_ORDER_WIN_SCORE;
+            }
+            else if (IsWinningMove(opponent | (1ULL << cell), cell))
+            {
+                score += MNK_ORDER_BLOCK_SCORE;
+            }
+            score += m_cellPriors[cell];
+        }
+        if (m_ordering & MNK_ORDER_KILLERS)
+        {
+            if (cell == m_killers[ply][0])
+            {
+                score += 2 * MNK_ORDER_KILLER_SCORE;
+            }
+            else if (cell == m_killers[ply][1])
+            {
+                score += MNK_ORDER_KILLER_SCORE;
+            }
+        }
+        if (m_ordering & MNK_ORDER_HISTORY)
+        {
+            score += static_cast<int>(m_history[ply & 1][cell]);
+        }
+
+        // Insertion sort, few moves and mostly searched only in part
+        size_t i = count++;
+        for (; i > 0 && scores[i - 1] < score; i--)
+        {
+            scores[i] = scores[i - 1];
+            ordered[i] = ordered[i - 1];
+        }
+        scores[i] = score;
+        ordered[i] = static_cast<uint8_t>(cell);
+    }
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : RecordCutoff
+//
+// @description             : Remembers a move that refuted the position at
+//                            'ply' as a killer, and credits it in the history
+//                            table by the depth of the refuted subtree
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkEngine::RecordCutoff(int ply, int depth, size_t cell)
+{
+    if (m_killers[ply][0] != cell)
+    {
+        m_killers[ply][1] = m_killers[ply][0];
+        m_killers[ply][0] = static_cast<uint8_t>(cell);
+    }
+
+    uint32_t & history = m_history[ply & 1][cell];
+    history += static_cast<uint32_t>(depth * depth);
+    if (history >= MNK_HISTORY_LIMIT)
+    {
+        for (size_t side = 0; side < 2; side++)
+        {
+            for (size_t i = 0; i < 64; i++)
+            {
+                m_history[side][i] /= 2;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Negamax
+//
+// @description             : Alpha-beta search 'depth' plies deep. Moves are
+//                            tried in the order of OrderMoves; the best one is
+//                            kept as the position's hash move and one causing
+//                            a cutoff feeds the killer and history tables.
+//
+// @return                  : score for the side to move, 0 once time is up
+//--------------------------------------------------------------------------------
+int MnkEngine::Negamax(uint64_t own, uint64_t opponent, int depth, int ply, int alpha, int beta)
+{
+    m_stats.nodes++;
+    if (m_bTimed && (m_stats.nodes % MNK_TIME_CHECK_NODES) == 0 &&
+        std::chrono::steady_clock::now() >= m_deadline)
+    {
+        m_stopped = true;
+    }
+    if (m_stopped)
+    {
+        return 0;
+    }
+
+    uint64_t empty = ~(own | opponent) & m_fullMask;
+    if (empty == 0)
+    {
+        return 0;
+    }
+    // Colour of the side to move, the root side being 0
+    int color = ply & 1;
+    if (depth == 0)
+    {
+        return m_counts.Evaluate(color, m_lineWeights);
+    }
+
+    uint8_t moves[64];
+    size_t count = OrderMoves(own, opponent, empty, ply, moves);
+
+    int best = -MNK_WIN_SCORE;
+    size_t bestCell = moves[0];
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t cell = moves[i];
+
+        int score;
+        m_counts.Place(cell, color);
+        if (m_counts.HasWon(color))
+        {
+            score = MNK_WIN_SCORE - ply - 1;
+        }
+        else
+        {
+            score = -Negamax(opponent, own | (1ULL << cell), depth - 1, ply + 1, -beta, -alpha);
+        }
+        m_counts.Remove(cell, color);
+
+        if (score > best)
+        {
+            best = score;
+            bestCell = cell;
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+        {
+            RecordCutoff(ply, depth, cell);
+            break;
+        }
+    }
+
+    if (!m_stopped)
+    {
+        HashMove & entry = GetHashMove(own, opponent);
+        entry.own = own;
+        entry.opponent = opponent;
+        entry.move = static_cast<uint8_t>(bestCell);
+    }
+
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Search
+//
+// @description             : Iterative deepening from 'own' to move until the
+//                            budget runs out, 'maxDepth' is reached or the game
+//                            is solved. 0 means no limit for either.
+//
+// @return                  : best move; its score through 'score'
+//--------------------------------------------------------------------------------
+size_t MnkEngine::Search(uint64_t own, uint64_t opponent, int budgetMs, int maxDepth, int & score)
+{
+    assert(m_width > 0);
+
+    m_bTimed = (budgetMs > 0);
+    m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+    m_stopped = false;
+
+    uint64_t empty = ~(own | opponent) & m_fullMask;
+    int emptyCount = CountBits(empty);
+    if (maxDepth <= 0 || maxDepth > emptyCount)
+    {
+        maxDepth = emptyCount;
+    }
+
+    m_counts.Reset(GetMnkLineTable(m_width, m_height, m_k));
+    for (uint64_t stones = own; stones; stones &= stones - 1)
+    {
+        m_counts.Place(GetLowestBitIndex(stones), 0);
+    }
+    for (uint64_t stones = opponent; stones; stones &= stones - 1)
+    {
+        m_counts.Place(GetLowestBitIndex(stones), 1);
+    }
+
+    // Killers are only good for the position they were found in, history
+    // from the previous move still says something but counts for less
+    memset(m_killers, MNK_NO_MOVE, sizeof(m_killers));
+    for (size_t side = 0; side < 2; side++)
+    {
+        for (size_t i = 0; i < 64; i++)
+        {
+            m_history[side][i] /= 4;
+        }
+    }
+
+    uint8_t rootMoves[64];
+    OrderMoves(own, opponent, empty, 0, rootMoves);
+    size_t bestMove = rootMoves[0];
+    score = 0;
+    m_stats.depth = 0;
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        // The previous iteration's best move is searched first
+        std::vector<size_t> moves(1, bestMove);
+        size_t count = OrderMoves(own, opponent, empty & ~(1ULL << bestMove), 0, rootMoves);
+        moves.insert(moves.end(), rootMoves, rootMoves + count);
+
+        int alpha = -MNK_WIN_SCORE;
+        size_t iterationMove = bestMove;
+        for (auto it = moves.begin(); it != moves.end(); it++)
+        {
+            int moveScore;
+            m_counts.Place(*it, 0);
+            if (m_counts.HasWon(0))
+            {
+                moveScore = MNK_WIN_SCORE - 1;
+            }
+            else
+            {
+                moveScore = -Negamax(opponent, own | (1ULL << *it), depth - 1, 1, -MNK_WIN_SCORE, -alpha);
+            }
+            m_counts.Remove(*it, 0);
+
+            if (m_stopped)
+            {
+                break;
+            }
+            if (moveScore > alpha)
+            {
+                alpha = moveScore;
+                iterationMove = *it;
+            }
+        }
+
+        if (m_stopped)
+        {
+            break;
+        }
+
+        bestMove = iterationMove;
+        score = alpha;
+
+        HashMove & entry = GetHashMove(own, opponent);
+        entry.own = own;
+        entry.opponent = opponent;
+        entry.move = static_cast<uint8_t>(bestMove);
+
+        m_stats.depth = depth;
+        m_stats.score = score;
+
+        // A forced result does not change with more depth
+        if (std::abs(score) >= MNK_WIN_SCORE - MNK_MAX_PLY)
+        {
+            break;
+        }
+    }
+
+    return bestMove;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Move for the side to move in 'game': from the
+//                            opening book if it has the position, otherwise
+//                            searched within 'budgetMs'
+//
+// @return                  : cell of the move
+//--------------------------------------------------------------------------------
+size_t MnkEngine::SelectMove(const MnkGame & game, int budgetMs)
+{
+    assert(!game.GameOver());
+
+    SetBoard(game.GetWidth(), game.GetHeight(), game.GetK());
+    m_stats.moves++;
+
+    uint64_t own = 0;
+    uint64_t opponent = 0;
+    Player_t turn = game.GetTurn();
+    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+    {
+        if (game.GetCell(cell) == turn)
+        {
+            own |= 1ULL << cell;
+        }
+        else if (game.GetCell(cell) != PLAYER_NONE)
+        {
+            opponent |= 1ULL << cell;
+        }
+    }
+
+    if (m_book && m_book->Covers(m_width, m_height, m_k, static_cast<size_t>(CountBits(own | opponent))))
+    {
+        m_stats.bookProbes++;
+        size_t move;
+        if (m_book->Probe(own, opponent, move))
+        {
+            m_stats.bookHits++;
+            m_reason = "book";
+            return move;
+        }
+    }
+
+    m_reason = "search";
+    int score;
+    return Search(own, opponent, budgetMs, 0, score);
+}
@@ -0,0 +1,103 @@
+#ifndef MNKENGINE_H
+#define MNKENGINE_H
+#include "mnkgame.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class OpeningBook;
+
+// Scores at or above MNK_WIN_SCORE - MNK_MAX_PLY are forced wins
+const int MNK_WIN_SCORE = 1000000;
+const int MNK_MAX_PLY = 64;
+
+// Positions remembered with their best move, a power of two
+const size_t MNK_HASH_MOVE_ENTRIES = 1 << 16;
+
+//------------------------------------------------------------------------
+// Move ordering heuristics of MnkEngine, combined as flags. Without any
+// of them moves are searched in cell order.
+//------------------------------------------------------------------------
+typedef enum MnkOrdering_tag
+{
+    MNK_ORDER_NONE = 0,
+    MNK_ORDER_HASH_MOVE = 1,        // best move found for the position before
+    MNK_ORDER_KILLERS = 2,          // last two moves that cut off at the same ply
+    MNK_ORDER_HISTORY = 4,          // moves that cut off anywhere, weighted by depth
+    MNK_ORDER_PRIOR = 8,            // wins, then blocks, then cells on the most lines
+    MNK_ORDER_ALL = 15
+}MnkOrdering_t;
+
+//------------------------------------------------------------------------
+// Counters an engine keeps over its lifetime, for telemetry
+//------------------------------------------------------------------------
+struct MnkSearchStats
+{
+    unsigned long long moves;           // SelectMove calls
+    unsigned long long bookProbes;      // positions shallow enough for the book
+    unsigned long long bookHits;
+    unsigned long long nodes;
+    int depth;                          // of the last completed iteration
+    int score;
+};
+
+//------------------------------------------------------------------------
+// Alpha-beta engine for m,n,k boards of up to 64 cells (4x4, 5x5, ...).
+// Iterative deepening negamax over the two players' stone masks within a
+// time budget; leaves are scored by the lines each player can still
+// complete, read from line counts kept up to date on every make and
+// unmake. An attached opening book is consulted before any search.
+// Moves are ordered by the heuristics of MnkOrdering_t, all of them by
+// default.
+//------------------------------------------------------------------------
+class MnkEngine
+{
+private:
+    struct HashMove
+    {
+        uint64_t own;
+        uint64_t opponent;
+        uint8_t move;
+    };
+
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    uint64_t m_fullMask;
+    std::vector<uint64_t> m_lines;
+    std::vector<std::vector<uint64_t> > m_cellLines;    // lines through each cell
+    std::vector<int> m_lineWeights;                     // by stone count
+    MnkLineCounts m_counts;                             // side to move at the root is colour 0
+    std::vector<int> m_cellPriors;                      // lines through each cell
+    unsigned m_ordering;
+    std::vector<HashMove> m_hashMoves;
+    uint8_t m_killers[MNK_MAX_PLY + 1][2];
+    uint32_t m_history[2][64];                          // by side, relative to the root
+    const OpeningBook * m_book;
+    MnkSearchStats m_stats;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_bTimed;
+    bool m_stopped;
+    const char * m_reason;
+
+    bool IsWinningMove(uint64_t mask, size_t cell) const;
+    int Negamax(uint64_t own, uint64_t opponent, int depth, int ply, int alpha, int beta);
+    HashMove & GetHashMove(uint64_t own, uint64_t opponent);
+    size_t OrderMoves(uint64_t own, uint64_t opponent, uint64_t moves, int ply, uint8_t * ordered);
+    void RecordCutoff(int ply, int depth, size_t cell);
+
+public:
+    MnkEngine();
+
+    void SetBoard(size_t width, size_t height, size_t k);
+    void SetOpeningBook(const OpeningBook * book) { m_book = book; }
+    void SetMoveOrdering(unsigned ordering) { m_ordering = ordering; }
+    size_t SelectMove(const MnkGame & game, int budgetMs);
+    size_t Search(uint64_t own, uint64_t opponent, int budgetMs, int maxDepth, int & score);
+
+    const MnkSearchStats & GetStats() const { return m_stats; }
+    void ResetStats();
+    const char * GetReason() const { return m_reason; }
+};
+
+#endif // MNKENGINE_H
@@ -0,0 +1,377 @@
+#include "mnkgame.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <cassert>
+#include <map>
+#include <tuple>
+
+MnkGame::MnkGame(size_t width, size_t height, size_t k, Player_t firstPlayer)
+    : m_width(width), m_height(height), m_k(k), m_cells(width * height, PLAYER_NONE),
+      m_lineCounts(GetMnkLineTable(width, height, k))
+{
+    m_firstPlayer = firstPlayer;
+    m_winner = PLAYER_NONE;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : FromGame
+//
+// @description             : Converts a 3x3 Game with 'turn' to move. The move
+//                            history is rebuilt in board order, so only the
+//                            position (not the original move order) is kept.
+//
+// @return                  : MnkGame
+//--------------------------------------------------------------------------------
+MnkGame MnkGame::FromGame(const Game & game, Player_t turn)
+{
+    Player_t other = (turn == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    std::vector<size_t> turnCells = game.GetPlayerPattern(turn);
+    std::vector<size_t> otherCells = game.GetPlayerPattern(other);
+
+    // Whoever has more marks moved first
+    Player_t first = (otherCells.size() > turnCells.size()) ? other : turn;
+    const std::vector<size_t> & firstCells = (first == turn) ? turnCells : otherCells;
+    const std::vector<size_t> & secondCells = (first == turn) ? otherCells : turnCells;
+
+    MnkGame mnk(3, 3, 3, first);
+    for (size_t i = 0; i < firstCells.size(); i++)
+    {
+        mnk.AddPlayerMarkToBoard(firstCells[i]);
+        if (i < secondCells.size())
+        {
+            mnk.AddPlayerMarkToBoard(secondCells[i]);
+        }
+    }
+
+    return mnk;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetTurn
+//
+// @description             : Determines whose turn is this
+//
+// @return                  : Player_t
+//--------------------------------------------------------------------------------
+Player_t MnkGame::GetTurn() const
+{
+    Player_t second = (m_firstPlayer == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    return (m_moveHistory.size() % 2 == 0) ? m_firstPlayer : second;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetAvailableMoves
+//
+// @description             : Lists the vacant cells in cell order
+//
+// @return                  : vector of cells
+//--------------------------------------------------------------------------------
+std::vector<size_t> MnkGame::GetAvailableMoves() const
+{
+    std::vector<size_t> moves;
+    for (size_t cell = 0; cell < m_cells.size(); cell++)
+    {
+        if (m_cells[cell] == PLAYER_NONE)
+        {
+            moves.push_back(cell);
+        }
+    }
+
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : IsWinningMove
+//
+// @description             : Checks the four lines through 'cell' for K or more
+//                            marks of its owner in a row.
+//
+// @return                  : true/false
+//--------------------------------------------------------------------------------
+bool MnkGame::IsWinningMove(size_t cell) const
+{
+    const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    Player_t player = m_cells[cell];
+    int row = static_cast<int>(cell / m_width);
+    int col = static_cast<int>(cell % m_width);
+    int width = static_cast<int>(m_width);
+    int height = static_cast<int>(m_height);
+
+    for (int d = 0; d < 4; d++)
+    {
+        size_t count = 1;
+        for (int sign = -1; sign <= 1; sign += 2)
+        {
+            int r = row + sign * directions[d][0];
+            int c = col + sign * directions[d][1];
+            while (r >= 0 && r < height && c >= 0 && c < width && m_cells[r * width + c] == player)
+            {
+                count++;
+                r += sign * directions[d][0];
+                c += sign * directions[d][1];
+            }
+        }
+
+        if (count >= m_k)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AddPlayerMarkToBoard
+//
+// @description             : Marks the move of the player whose turn it is. It
+//                            also determines if the player has won.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkGame::AddPlayerMarkToBoard(size_t cell)
+{
+    assert(m_cells[cell] == PLAYER_NONE && m_winner == PLAYER_NONE);
+
+    m_cells[cell] = GetTurn();
+    m_moveHistory.push_back(cell);
+    m_lineCounts.Place(cell, m_cells[cell]);
+
+    if (IsWinningMove(cell))
+    {
+        m_winner = m_cells[cell];
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : UndoMove
+//
+// @description             : Takes back the last move, restoring the line
+//                            counts
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkGame::UndoMove()
+{
+    assert(!m_moveHistory.empty());
+
+    size_t cell = m_moveHistory.back();
+    m_lineCounts.Remove(cell, m_cells[cell]);
+    m_cells[cell] = PLAYER_NONE;
+    m_moveHistory.pop_back();
+    m_winner = PLAYER_NONE;
+}
+
+bool MnkGame::GameOver() const
+{
+    return m_winner != PLAYER_NONE || m_moveHistory.size() == m_cells.size();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetMnkLineMasks
+//
+// @description             : Lists the winning lines of a board, bit N being
+//                            cell N. Used by the mask based solvers.
+//
+// @return                  : vector of line masks
+//--------------------------------------------------------------------------------
+std::vector<uint64_t> GetMnkLineMasks(size_t width, size_t height, size_t k)
+{
+    assert(width * height <= 64);
+
+    const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    const int w = static_cast<int>(width);
+    const int h = static_cast<int>(height);
+    const int length = static_cast<int>(k);
+
+    std::vector<uint64_t> lines;
+    for (int d = 0; d < 4; d++)
+    {
+        for (int row = 0; row < h; row++)
+        {
+            for (int col = 0; col < w; col++)
+            {
+                int endRow = row + (length - 1) * directions[d][0];
+                int endCol = col + (length - 1) * directions[d][1];
+                if (endRow < 0 || endRow >= h || endCol < 0 || endCol >= w)
+                {
+                    continue;
+                }
+
+                uint64_t line = 0;
+                for (int i = 0; i < length; i++)
+                {
+                    line |= 1ULL << ((row + i * directions[d][0]) * w + (col + i * directions[d][1]));
+                }
+                lines.push_back(line);
+            }
+        }
+    }
+
+    return lines;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetMnkLineTable
+//
+// @description             : Builds the line table of a board on first use
+//                            and hands out the same one afterwards
+//
+// @return                  : MnkLineTable
+//--------------------------------------------------------------------------------
+std::shared_ptr<const MnkLineTable> GetMnkLineTable(size_t width, size_t height, size_t k)
+{
+    static QMutex mutex;
+    static std::map<std::tuple<size_t, size_t, size_t>, std::shared_ptr<const MnkLineTable> > tables;
+    QMutexLocker lock(&mutex);
+
+    std::shared_ptr<const MnkLineTable> & cached = tables[std::make_tuple(width, height, k)];
+    if (cached)
+    {
+        return cached;
+    }
+
+    const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    const int w = static_cast<int>(width);
+    const int h = static_cast<int>(height);
+    const int length = static_cast<int>(k);
+
+    std::vector<std::vector<uint16_t> > cellLines(width * height);
+    size_t lineCount = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        for (int row = 0; row < h; row++)
+        {
+            for (int col = 0; col < w; col++)
+            {
+                int endRow = row + (length - 1) * directions[d][0];
+                int endCol = col + (length - 1) * directions[d][1];
+                if (endRow < 0 || endRow >= h || endCol < 0 || endCol >= w)
+                {
+                    continue;
+                }
+
+                for (int i = 0; i < length; i++)
+                {
+                    size_t cell = static_cast<size_t>((row + i * directions[d][0]) * w + (col + i * directions[d][1]));
+                    cellLines[cell].push_back(static_cast<uint16_t>(lineCount));
+                }
+                lineCount++;
+            }
+        }
+    }
+    assert(lineCount <= 0x10000);
+
+    std::shared_ptr<MnkLineTable> table(new MnkLineTable());
+    table->k = k;
+    table->lineCount = lineCount;
+    for (auto it = cellLines.begin(); it != cellLines.end(); it++)
+    {
+        table->firstLine.push_back(static_cast<uint32_t>(table->lines.size()));
+        table->lines.insert(table->lines.end(), it->begin(), it->end());
+    }
+    table->firstLine.push_back(static_cast<uint32_t>(table->lines.size()));
+
+    cached = table;
+    return cached;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Reset
+//
+// @description             : Empty board: every line is open for both colours
+//                            with no stones in it
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkLineCounts::Reset(const std::shared_ptr<const MnkLineTable> & table)
+{
+    m_table = table;
+    for (int color = 0; color < 2; color++)
+    {
+        m_stones[color].assign(table->lineCount, 0);
+        m_open[color].assign(table->k + 1, 0);
+        m_open[color][0] = static_cast<int>(table->lineCount);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Place
+//
+// @description             : A stone of 'color' goes on 'cell'. Each line
+//                            through it moves up one in 'color's counts if it
+//                            was open for 'color', and stops being open for
+//                            the other colour if it was open for them.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkLineCounts::Place(size_t cell, int color)
+{
+    int other = 1 - color;
+    const uint16_t * line = m_table->lines.data() + m_table->firstLine[cell];
+    const uint16_t * end = m_table->lines.data() + m_table->firstLine[cell + 1];
+    for (; line != end; line++)
+    {
+        uint8_t & own = m_stones[color][*line];
+        uint8_t opponent = m_stones[other][*line];
+        if (opponent == 0)
+        {
+            m_open[color][own]--;
+            m_open[color][own + 1]++;
+        }
+        if (own == 0)
+        {
+            m_open[other][opponent]--;
+        }
+        own++;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Remove
+//
+// @description             : Takes a stone of 'color' off 'cell', the exact
+//                            reverse of Place
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkLineCounts::Remove(size_t cell, int color)
+{
+    int other = 1 - color;
+    const uint16_t * line = m_table->lines.data() + m_table->firstLine[cell];
+    const uint16_t * end = m_table->lines.data() + m_table->firstLine[cell + 1];
+    for (; line != end; line++)
+    {
+        uint8_t & own = m_stones[color][*line];
+        uint8_t opponent = m_stones[other][*line];
+        own--;
+        if (opponent == 0)
+        {
+            m_open[color][own + 1]--;
+            m_open[color][own]++;
+        }
+        if (own == 0)
+        {
+            m_open[other][opponent]++;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Evaluate
+//
+// @description             : Weighs the open lines of both colours. Costs one
+//                            multiply per line length, not per line.
+//
+// @return                  : score for 'color'
+//--------------------------------------------------------------------------------
+int MnkLineCounts::Evaluate(int color, const std::vector<int> & weights) const
+{
+    int other = 1 - color;
+    int score = 0;
+    for (size_t stones = 1; stones < weights.size(); stones++)
+    {
+        score += weights[stones] * (m_open[color][stones] - m_open[other][stones]);
+    }
+    return score;
+}
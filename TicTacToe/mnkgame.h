@@ -0,0 +1,95 @@
+#ifndef MNKGAME_H
+#define MNKGAME_H
+#include "game.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------
+// The lines of k cells of a board and the lines through every cell, for
+// boards of any size. Tables are shared by all games on the same board.
+//------------------------------------------------------------------------
+struct MnkLineTable
+{
+    size_t k;
+    size_t lineCount;
+    std::vector<uint32_t> firstLine;        // per cell, into 'lines'; one extra at the end
+    std::vector<uint16_t> lines;            // line numbers through each cell in turn
+};
+
+std::shared_ptr<const MnkLineTable> GetMnkLineTable(size_t width, size_t height, size_t k);
+
+//------------------------------------------------------------------------
+// Running count of open lines: lines holding stones of one player only,
+// by how many stones that player has in them (empty lines count as open
+// for both). Placing or removing a stone touches only the lines through
+// its cell, so the counts are kept up to date on every move and undo and
+// reading them never scans the board. Colours are 0 and 1.
+//------------------------------------------------------------------------
+class MnkLineCounts
+{
+private:
+    std::shared_ptr<const MnkLineTable> m_table;
+    std::vector<uint8_t> m_stones[2];       // per line
+    std::vector<int> m_open[2];             // by stone count, 0 to k
+
+public:
+    MnkLineCounts() {}
+    explicit MnkLineCounts(const std::shared_ptr<const MnkLineTable> & table) { Reset(table); }
+
+    void Reset(const std::shared_ptr<const MnkLineTable> & table);
+    void Place(size_t cell, int color);
+    void Remove(size_t cell, int color);
+
+    // Open lines of 'color' with 'stones' in them; k stones is a win
+    int GetOpenLines(int color, size_t stones) const { return m_open[color][stones]; }
+    bool HasWon(int color) const { return m_open[color][m_table->k] > 0; }
+
+    // Sum of 'weights' (by stone count) over the open lines of 'color',
+    // minus the same for the other colour
+    int Evaluate(int color, const std::vector<int> & weights) const;
+};
+
+//------------------------------------------------------------------------
+// K-in-a-row on a width x height board (the m,n,k-game). Cells are
+// numbered row by row, so cell = row * width + column. Moves alternate
+// between the players and can be taken back, which is what searches need.
+//------------------------------------------------------------------------
+class MnkGame
+{
+private:
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    std::vector<Player_t> m_cells;
+    std::vector<size_t> m_moveHistory;
+    Player_t m_firstPlayer;
+    Player_t m_winner;
+    MnkLineCounts m_lineCounts;             // colour is the Player_t
+
+    bool IsWinningMove(size_t cell) const;
+
+public:
+    MnkGame(size_t width, size_t height, size_t k, Player_t firstPlayer = PLAYER_USER);
+    static MnkGame FromGame(const Game & game, Player_t turn);
+
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetK() const { return m_k; }
+    size_t GetCellCount() const { return m_cells.size(); }
+    Player_t GetCell(size_t cell) const { return m_cells[cell]; }
+    const std::vector<Player_t> & GetCells() const { return m_cells; }
+    const std::vector<size_t> & GetMoveHistory() const { return m_moveHistory; }
+    Player_t GetTurn() const;
+    std::vector<size_t> GetAvailableMoves() const;
+    void AddPlayerMarkToBoard(size_t cell);
+    void UndoMove();
+    Player_t CheckWin() const { return m_winner; }
+    bool GameOver() const;
+    const MnkLineCounts & GetLineCounts() const { return m_lineCounts; }
+};
+
+// Every line of k cells as a mask, for boards of at most 64 cells
+std::vector<uint64_t> GetMnkLineMasks(size_t width, size_t height, size_t k);
+
+#endif // MNKGAME_H
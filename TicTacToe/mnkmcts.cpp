@@ -0,0 +1,347 @@
+#include "mnkmcts.h"
+#include "bitboard.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+// Iterations between two reads of the clock
+const unsigned long long MNK_MCTS_TIME_CHECK = 64;
+
+MnkMctsEngine::MnkMctsEngine() : m_rng(std::random_device()())
+{
+    m_width = 0;
+    m_height = 0;
+    m_k = 0;
+    m_fullMask = 0;
+    m_evalScale = 1.0;
+    m_rolloutPlies = MNK_MCTS_ROLLOUT_PLIES;
+    ResetStats();
+}
+
+void MnkMctsEngine::ResetStats()
+{
+    m_stats.iterations = 0;
+    m_stats.rolloutPlies = 0;
+    m_stats.threatCutoffs = 0;
+    m_stats.evalCutoffs = 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetBoard
+//
+// @description             : Picks up the line table of a board. Nothing is
+//                            done when the board does not change.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkMctsEngine::SetBoard(size_t width, size_t height, size_t k)
+{
+    assert(width * height <= 64 && k >= 2);
+
+    if (width == m_width && height == m_height && k == m_k)
+    {
+        return;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_k = k;
+    size_t cells = width * height;
+    m_fullMask = (cells == 64) ? ~0ULL : ((1ULL << cells) - 1);
+    m_table = GetMnkLineTable(width, height, k);
+
+    // The weights of MnkEngine: every extra stone in an open line is worth
+    // four times more
+    m_lineWeights.assign(k + 1, 0);
+    for (size_t count = 1; count < k; count++)
+    {
+        m_lineWeights[count] = 1 << std::min<size_t>(2 * count, 16);
+    }
+
+    // An open line two stones short sets the slope of the cutoff score. At
+    // one stone short, leads of a few such lines all score near a draw and
+    // the cutoff loses to full rollouts at equal iterations.
+    m_evalScale = m_lineWeights[std::max<size_t>(k - 2, 1)];
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectChild
+//
+// @description             : UCB1 over the children; unvisited children first
+//
+// @return                  : index of the child node
+//--------------------------------------------------------------------------------
+size_t MnkMctsEngine::SelectChild(const Node & node) const
+{
+    size_t best = node.firstChild;
+    double bestValue = -1.0;
+    double logVisits = std::log(node.visits);
+
+    for (size_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+    {
+        const Node & child = m_nodes[i];
+        if (child.visits == 0)
+        {
+            return i;
+        }
+
+        double value = child.score / child.visits + MNK_MCTS_EXPLORATION * std::sqrt(logVisits / child.visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Expand
+//
+// @description             : Adds one child per empty cell, next to each other
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void MnkMctsEngine::Expand(uint32_t index)
+{
+    Node node = m_nodes[index];
+    uint64_t empty = ~(node.own | node.opponent) & m_fullMask;
+
+    m_nodes[index].firstChild = static_cast<uint32_t>(m_nodes.size());
+    m_nodes[index].childCount = static_cast<uint16_t>(CountBits(empty));
+
+    for (; empty; empty &= empty - 1)
+    {
+        size_t move = GetLowestBitIndex(empty);
+        Node child = Node();
+        child.own = node.opponent;
+        child.opponent = node.own | (1ULL << move);
+        child.parent = index;
+        child.move = static_cast<uint8_t>(move);
+        m_nodes.push_back(child);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Rollout
+//
+// @description             : Plays random moves from a position with 'color'
+//                            to move until the line counts settle the game or
+//                            the ply limit is reached, then takes them back
+//
+// @return                  : score in [0, 1] for the side that moved into the
+//                            position
+//--------------------------------------------------------------------------------
+double MnkMctsEngine::Rollout(uint64_t own, uint64_t opponent, int color)
+{
+    const int startColor = color;
+    const size_t start = m_placed.size();
+    uint64_t empty = ~(own | opponent) & m_fullMask;
+    double result;                          // for 'color' to move
+
+    for (int ply = 0; ; ply++)
+    {
+        if (m_rolloutPlies > 0)
+        {
+            // Whoever is to move completes a line that lacks one stone
+            if (m_counts.GetOpenLines(color, m_k - 1) > 0)
+            {
+                m_stats.threatCutoffs++;
+                result = 1.0;
+                break;
+            }
+            if (ply >= m_rolloutPlies)
+            {
+                m_stats.evalCutoffs++;
+                double eval = m_counts.Evaluate(color, m_lineWeights);
+                result = 1.0 / (1.0 + std::exp(-eval / m_evalScale));
+                break;
+            }
+        }
+
+        if (empty == 0)
+        {
+            result = 0.5;
+            break;
+        }
+
+        uint64_t rest = empty;
+        for (uint32_t skip = m_rng() % CountBits(empty); skip > 0; skip--)
+        {
+            rest &= rest - 1;
+        }
+        size_t cell = GetLowestBitIndex(rest);
+        empty &= ~(1ULL << cell);
+        m_counts.Place(cell, color);
+        m_placed.push_back(static_cast<uint8_t>(cell));
+        m_stats.rolloutPlies++;
+
+        if (m_counts.HasWon(color))
+        {
+            // The mover won; seen from the side to move next that is a loss
+            color = 1 - color;
+            result = 0.0;
+            break;
+        }
+        color = 1 - color;
+    }
+
+    // Back to the score of the side to move at the start
+    if (color != startColor)
+    {
+        result = 1.0 - result;
+    }
+
+    for (size_t i = m_placed.size(); i > start; i--)
+    {
+        m_counts.Remove(m_placed[i - 1], startColor ^ static_cast<int>((i - 1 - start) & 1));
+    }
+    m_placed.resize(start);
+
+    return 1.0 - result;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Search
+//
+// @description             : Grows the tree from 'own' to move until the
+//                            budget or 'maxIterations' runs out (0 means no
+//                            limit for either) or the tree is full
+//
+// @return                  : most visited move
+//--------------------------------------------------------------------------------
+size_t MnkMctsEngine::Search(uint64_t own, uint64_t opponent, int budgetMs, unsigned long long maxIterations)
+{
+    assert(m_width > 0 && (~(own | opponent) & m_fullMask) != 0);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+
+    m_counts.Reset(m_table);
+    for (uint64_t stones = own; stones; stones &= stones - 1)
+    {
+        m_counts.Place(GetLowestBitIndex(stones), 0);
+    }
+    for (uint64_t stones = opponent; stones; stones &= stones - 1)
+    {
+        m_counts.Place(GetLowestBitIndex(stones), 1);
+    }
+
+    Node root = Node();
+    root.own = own;
+    root.opponent = opponent;
+    m_nodes.clear();
+    m_nodes.push_back(root);
+    Expand(0);
+
+    unsigned long long iteration = 0;
+    for (; maxIterations == 0 || iteration < maxIterations; iteration++)
+    {
+        if (m_nodes.size() + m_width * m_height > MNK_MCTS_MAX_NODES)
+        {
+            break;
+        }
+        if (budgetMs > 0 && iteration % MNK_MCTS_TIME_CHECK == 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+
+        // Down the tree, the line counts following every move. The root
+        // side to move is colour 0, so the n-th move placed is colour n % 2.
+        uint32_t index = 0;
+        int color = 0;
+        while (m_nodes[index].childCount > 0)
+        {
+            index = static_cast<uint32_t>(SelectChild(m_nodes[index]));
+            m_counts.Place(m_nodes[index].move, color);
+            m_placed.push_back(m_nodes[index].move);
+            color = 1 - color;
+        }
+
+        // Expand a leaf the second time it is reached, unless the game is over there
+        bool bOver = (index != 0 && m_counts.HasWon(1 - color)) ||
+                     (m_nodes[index].own | m_nodes[index].opponent) == m_fullMask;
+        if (!bOver && m_nodes[index].visits > 0)
+        {
+            Expand(index);
+            index = m_nodes[index].firstChild;
+            m_counts.Place(m_nodes[index].move, color);
+            m_placed.push_back(m_nodes[index].move);
+            color = 1 - color;
+            bOver = m_counts.HasWon(1 - color) || (m_nodes[index].own | m_nodes[index].opponent) == m_fullMask;
+        }
+
+        double score;
+        if (bOver)
+        {
+            score = m_counts.HasWon(1 - color) ? 1.0 : 0.5;
+        }
+        else
+        {
+            score = Rollout(m_nodes[index].own, m_nodes[index].opponent, color);
+        }
+
+        for (;; index = m_nodes[index].parent)
+        {
+            m_nodes[index].visits += 1;
+            m_nodes[index].score += static_cast<float>(score);
+            score = 1.0 - score;
+            if (index == 0)
+            {
+                break;
+            }
+        }
+
+        for (size_t i = m_placed.size(); i > 0; i--)
+        {
+            m_counts.Remove(m_placed[i - 1], static_cast<int>((i - 1) & 1));
+        }
+        m_placed.clear();
+    }
+    m_stats.iterations += iteration;
+
+    const Node & rootNode = m_nodes[0];
+    size_t best = rootNode.firstChild;
+    for (size_t i = rootNode.firstChild; i < rootNode.firstChild + rootNode.childCount; i++)
+    {
+        if (m_nodes[i].visits > m_nodes[best].visits)
+        {
+            best = i;
+        }
+    }
+
+    return m_nodes[best].move;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Move for the side to move in 'game', searched
+//                            within 'budgetMs'
+//
+// @return                  : cell of the move
+//--------------------------------------------------------------------------------
+size_t MnkMctsEngine::SelectMove(const MnkGame & game, int budgetMs)
+{
+    assert(!game.GameOver());
+
+    SetBoard(game.GetWidth(), game.GetHeight(), game.GetK());
+
+    uint64_t own = 0;
+    uint64_t opponent = 0;
+    Player_t turn = game.GetTurn();
+    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+    {
+        if (game.GetCell(cell) == turn)
+        {
+            own |= 1ULL << cell;
+        }
+        else if (game.GetCell(cell) != PLAYER_NONE)
+        {
+            opponent |= 1ULL << cell;
+        }
+    }
+
+    return Search(own, opponent, budgetMs, 0);
+}
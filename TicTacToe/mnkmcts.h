@@ -0,0 +1,79 @@
+#ifndef MNKMCTS_H
+#define MNKMCTS_H
+#include "mnkgame.h"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Random moves a rollout plays before it is scored from the line counts
+const int MNK_MCTS_ROLLOUT_PLIES = 6;
+
+const double MNK_MCTS_EXPLORATION = 1.0;
+
+// Iterations stop once the tree holds this many nodes
+const size_t MNK_MCTS_MAX_NODES = 1 << 20;
+
+struct MnkMctsStats
+{
+    unsigned long long iterations;
+    unsigned long long rolloutPlies;    // random moves played in rollouts
+    unsigned long long threatCutoffs;   // rollouts ended by an open line one stone short
+    unsigned long long evalCutoffs;     // rollouts ended by the ply limit and scored
+};
+
+//------------------------------------------------------------------------
+// Monte Carlo tree search (UCT) for m,n,k boards of up to 64 cells.
+//
+// Line counts (MnkLineCounts) follow every move down the tree and through
+// the rollout and are taken back on the way out. They end rollouts early:
+// a side to move with an open line one stone short has won, and after
+// the ply limit the rollout is scored by the line evaluation instead of
+// being played out. A limit of 0 plays plain random rollouts to the end.
+//------------------------------------------------------------------------
+class MnkMctsEngine
+{
+private:
+    struct Node
+    {
+        uint64_t own;           // side to move at this node
+        uint64_t opponent;
+        uint32_t parent;
+        uint32_t firstChild;
+        uint16_t childCount;
+        uint8_t move;
+        float visits;
+        float score;            // for the side that moved into this node
+    };
+
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    uint64_t m_fullMask;
+    std::shared_ptr<const MnkLineTable> m_table;
+    MnkLineCounts m_counts;                 // side to move at the root is colour 0
+    std::vector<int> m_lineWeights;
+    double m_evalScale;                     // evaluation units per unit of cutoff logit
+    std::vector<Node> m_nodes;
+    std::vector<uint8_t> m_placed;          // cells to take back after an iteration
+    std::mt19937 m_rng;
+    int m_rolloutPlies;
+    MnkMctsStats m_stats;
+
+    size_t SelectChild(const Node & node) const;
+    void Expand(uint32_t index);
+    double Rollout(uint64_t own, uint64_t opponent, int color);
+
+public:
+    MnkMctsEngine();
+
+    void SetBoard(size_t width, size_t height, size_t k);
+    void SetRolloutPlies(int plies) { m_rolloutPlies = plies; }
+    size_t SelectMove(const MnkGame & game, int budgetMs);
+    size_t Search(uint64_t own, uint64_t opponent, int budgetMs, unsigned long long maxIterations);
+
+    const MnkMctsStats & GetStats() const { return m_stats; }
+    void ResetStats();
+};
+
+#endif // MNKMCTS_H
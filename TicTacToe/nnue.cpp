@@ -0,0 +1,345 @@
+#include "nnue.h"
+#include "atomicfile.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const char NNUE_MAGIC[8] = {'T', 'T', 'T', 'N', 'N', 'U', 'E', '1'};
+
+// Followed by the feature rows, bias, output weights and output bias
+struct NnueHeader
+{
+    char magic[8];
+    uint32_t size;
+    uint32_t hidden;
+};
+
+static void AddRowScalar(int16_t * accumulator, const int16_t * row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i++)
+    {
+        accumulator[i] = static_cast<int16_t>(accumulator[i] + row[i]);
+    }
+}
+
+static void SubRowScalar(int16_t * accumulator, const int16_t * row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i++)
+    {
+        accumulator[i] = static_cast<int16_t>(accumulator[i] - row[i]);
+    }
+}
+
+static int32_t DotScalar(const int16_t * own, const int16_t * opponent, const int16_t * weights)
+{
+    int32_t sum = 0;
+    for (size_t i = 0; i < NNUE_HIDDEN; i++)
+    {
+        sum += std::min(std::max<int32_t>(own[i], 0), NNUE_QA) * weights[i];
+        sum += std::min(std::max<int32_t>(opponent[i], 0), NNUE_QA) * weights[NNUE_HIDDEN + i];
+    }
+    return sum;
+}
+
+#ifdef SIMD_X86
+static void AddRowSse2(int16_t * accumulator, const int16_t * row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i * target = reinterpret_cast<__m128i *>(accumulator + i);
+        __m128i weights = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        _mm_storeu_si128(target, _mm_add_epi16(_mm_loadu_si128(target), weights));
+    }
+}
+
+static void SubRowSse2(int16_t * accumulator, const int16_t * row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i * target = reinterpret_cast<__m128i *>(accumulator + i);
+        __m128i weights = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        _mm_storeu_si128(target, _mm_sub_epi16(_mm_loadu_si128(target), weights));
+    }
+}
+
+// Clipped ReLU then multiply-add of adjacent pairs into int32 lanes
+static int32_t DotSse2(const int16_t * own, const int16_t * opponent, const int16_t * weights)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(NNUE_QA);
+    __m128i sum = _mm_setzero_si128();
+
+    for (size_t i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i a = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(own + i)), zero), one);
+        __m128i b = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(opponent + i)), zero),
+                                  one);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i))));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(b, _mm_loadu_si128(
+                                                       reinterpret_cast<const __m128i *>(weights + NNUE_HIDDEN + i))));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+TARGET_AVX2 static void AddRowAvx2(int16_t * accumulator, const int16_t * row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i * target = reinterpret_cast<__m256i *>(accumulator + i);
+        __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        _mm256_storeu_si256(target, _mm256_add_epi16(_mm256_loadu_si256(target), weights));
+    }
+}
+
+TARGET_AVX2 static void SubRowAvx2(int16_t * accumulator, const int16_t * row)
+{
+    for (size_t i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i * target = reinterpret_cast<__m256i *>(accumulator + i);
+        __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        _mm256_storeu_si256(target, _mm256_sub_epi16(_mm256_loadu_si256(target), weights));
+    }
+}
+
+TARGET_AVX2 static int32_t DotAvx2(const int16_t * own, const int16_t * opponent, const int16_t * weights)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(NNUE_QA);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_min_epi16(
+            _mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(own + i)), zero), one);
+        __m256i b = _mm256_min_epi16(
+            _mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(opponent + i)), zero), one);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+                                        a, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i))));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+                                        b, _mm256_loadu_si256(
+                                               reinterpret_cast<const __m256i *>(weights + NNUE_HIDDEN + i))));
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+static void AddRow(BatchIsa_t isa, int16_t * accumulator, const int16_t * row)
+{
+#ifdef SIMD_X86
+    if (isa == BATCH_ISA_AVX2)
+    {
+        AddRowAvx2(accumulator, row);
+        return;
+    }
+    if (isa == BATCH_ISA_SSE2)
+    {
+        AddRowSse2(accumulator, row);
+        return;
+    }
+#else
+    (void)isa;
+#endif
+    AddRowScalar(accumulator, row);
+}
+
+static void SubRow(BatchIsa_t isa, int16_t * accumulator, const int16_t * row)
+{
+#ifdef SIMD_X86
+    if (isa == BATCH_ISA_AVX2)
+    {
+        SubRowAvx2(accumulator, row);
+        return;
+    }
+    if (isa == BATCH_ISA_SSE2)
+    {
+        SubRowSse2(accumulator, row);
+        return;
+    }
+#else
+    (void)isa;
+#endif
+    SubRowScalar(accumulator, row);
+}
+
+EvalNetwork::EvalNetwork()
+{
+    static const BatchIsa_t bestIsa = GetBestBatchIsa();
+
+    m_size = 0;
+    m_cells = 0;
+    m_isa = bestIsa;
+    m_outputBias = 0;
+    memset(m_bias, 0, sizeof(m_bias));
+    memset(m_outputWeights, 0, sizeof(m_outputWeights));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetFloatWeights
+//
+// @description             : Quantises trained weights: first layer and bias by
+//                            NNUE_QA, output weights by NNUE_QB, output bias by
+//                            both
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void EvalNetwork::SetFloatWeights(int size, const std::vector<float> & featureWeights, const std::vector<float> & bias,
+                                  const std::vector<float> & outputWeights, float outputBias)
+{
+    auto quantise = [](float value, float scale)
+    {
+        float scaled = std::round(value * scale);
+        return static_cast<int16_t>(std::min(32767.0f, std::max(-32767.0f, scaled)));
+    };
+
+    m_size = size;
+    m_cells = static_cast<size_t>(size * size);
+    m_featureWeights.resize(2 * m_cells * NNUE_HIDDEN);
+    for (size_t i = 0; i < m_featureWeights.size(); i++)
+    {
+        m_featureWeights[i] = quantise(featureWeights[i], NNUE_QA);
+    }
+    for (size_t i = 0; i < NNUE_HIDDEN; i++)
+    {
+        m_bias[i] = quantise(bias[i], NNUE_QA);
+    }
+    for (size_t i = 0; i < 2 * NNUE_HIDDEN; i++)
+    {
+        m_outputWeights[i] = quantise(outputWeights[i], NNUE_QB);
+    }
+    m_outputBias = static_cast<int32_t>(std::round(outputBias * NNUE_QA * NNUE_QB));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Load / Save
+//
+// @description             : Reads or writes the quantised network. Save goes
+//                            through a temporary file so a reader never sees a
+//                            half written network.
+//
+// @return                  : true on success
+//--------------------------------------------------------------------------------
+bool EvalNetwork::Load(const std::string & path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    NnueHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, NNUE_MAGIC, sizeof(header.magic)) != 0 || header.hidden != NNUE_HIDDEN ||
+        header.size == 0 || header.size > 64)
+    {
+        return false;
+    }
+
+    size_t cells = static_cast<size_t>(header.size) * header.size;
+    std::vector<int16_t> featureWeights(2 * cells * NNUE_HIDDEN);
+    int16_t bias[NNUE_HIDDEN];
+    int16_t outputWeights[2 * NNUE_HIDDEN];
+    int32_t outputBias;
+    file.read(reinterpret_cast<char *>(featureWeights.data()), featureWeights.size() * sizeof(int16_t));
+    file.read(reinterpret_cast<char *>(bias), sizeof(bias));
+    file.read(reinterpret_cast<char *>(outputWeights), sizeof(outputWeights));
+    file.read(reinterpret_cast<char *>(&outputBias), sizeof(outputBias));
+    if (!file)
+    {
+        return false;
+    }
+
+    m_size = static_cast<int>(header.size);
+    m_cells = cells;
+    m_featureWeights.swap(featureWeights);
+    memcpy(m_bias, bias, sizeof(m_bias));
+    memcpy(m_outputWeights, outputWeights, sizeof(m_outputWeights));
+    m_outputBias = outputBias;
+    return true;
+}
+
+bool EvalNetwork::Save(const std::string & path) const
+{
+    NnueHeader header;
+    memcpy(header.magic, NNUE_MAGIC, sizeof(header.magic));
+    header.size = static_cast<uint32_t>(m_size);
+    header.hidden = static_cast<uint32_t>(NNUE_HIDDEN);
+
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(m_featureWeights.data()), m_featureWeights.size() * sizeof(int16_t));
+    file.write(reinterpret_cast<const char *>(m_bias), sizeof(m_bias));
+    file.write(reinterpret_cast<const char *>(m_outputWeights), sizeof(m_outputWeights));
+    file.write(reinterpret_cast<const char *>(&m_outputBias), sizeof(m_outputBias));
+    file.close();
+    if (!file)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return CommitFile(temporary, path);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Reset / AddStone / RemoveStone
+//
+// @description             : Accumulators of the empty board, and the update
+//                            for one stone: one weight row per perspective
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void EvalNetwork::Reset(EvalAccumulator & accumulator) const
+{
+    memcpy(accumulator.values[0], m_bias, sizeof(m_bias));
+    memcpy(accumulator.values[1], m_bias, sizeof(m_bias));
+}
+
+void EvalNetwork::AddStone(EvalAccumulator & accumulator, size_t cell, int color) const
+{
+    AddRow(m_isa, accumulator.values[0], GetRow(cell, color == 1));
+    AddRow(m_isa, accumulator.values[1], GetRow(cell, color == 2));
+}
+
+void EvalNetwork::RemoveStone(EvalAccumulator & accumulator, size_t cell, int color) const
+{
+    SubRow(m_isa, accumulator.values[0], GetRow(cell, color == 1));
+    SubRow(m_isa, accumulator.values[1], GetRow(cell, color == 2));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Evaluate
+//
+// @description             : Output layer over both accumulators, side to move
+//                            first
+//
+// @return                  : score from the point of view of 'color'
+//--------------------------------------------------------------------------------
+int EvalNetwork::Evaluate(const EvalAccumulator & accumulator, int color) const
+{
+    const int16_t * own = accumulator.values[color - 1];
+    const int16_t * opponent = accumulator.values[2 - color];
+
+    int32_t sum;
+#ifdef SIMD_X86
+    if (m_isa == BATCH_ISA_AVX2)
+    {
+        sum = DotAvx2(own, opponent, m_outputWeights);
+    }
+    else if (m_isa == BATCH_ISA_SSE2)
+    {
+        sum = DotSse2(own, opponent, m_outputWeights);
+    }
+    else
+#endif
+    {
+        sum = DotScalar(own, opponent, m_outputWeights);
+    }
+
+    return static_cast<int>((static_cast<int64_t>(sum + m_outputBias) * NNUE_SCORE_SCALE) / (NNUE_QA * NNUE_QB));
+}
@@ -0,0 +1,66 @@
+#ifndef NNUE_H
+#define NNUE_H
+#include "batcheval.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Small efficiently updatable evaluation network for large boards.
+//
+// Inputs are one feature per (cell, stone colour) seen from each side's
+// perspective ("own" or "opponent" stone). The first layer is kept as one
+// int16 accumulator per perspective and updated by adding or subtracting
+// a single weight row when a stone is placed or removed, so the cost of
+// a move does not depend on the board size. Evaluation clips both
+// accumulators to [0, 1] and takes a dot product with the output weights,
+// side to move first. Weights are trained in floating point (see
+// Tools/EvalTrain) and quantised to int16.
+//------------------------------------------------------------------------
+const size_t NNUE_HIDDEN = 32;
+const int NNUE_QA = 127;            // accumulator value of an activation of 1.0
+const int NNUE_QB = 64;             // output weight value of 1.0
+const int NNUE_SCORE_SCALE = 200;   // score units per unit of network output
+
+// Loads and stores are unaligned: C++11 new ignores over-alignment
+struct EvalAccumulator
+{
+    alignas(32) int16_t values[2][NNUE_HIDDEN];     // perspective of colour 1, colour 2
+};
+
+class EvalNetwork
+{
+private:
+    int m_size;
+    size_t m_cells;
+    BatchIsa_t m_isa;
+    std::vector<int16_t> m_featureWeights;      // [2 * cells][NNUE_HIDDEN], own stones first
+    alignas(32) int16_t m_bias[NNUE_HIDDEN];
+    alignas(32) int16_t m_outputWeights[2 * NNUE_HIDDEN];
+    int32_t m_outputBias;
+
+    const int16_t * GetRow(size_t cell, bool bOwn) const
+    {
+        return &m_featureWeights[((bOwn ? 0 : m_cells) + cell) * NNUE_HIDDEN];
+    }
+
+public:
+    EvalNetwork();
+
+    bool Load(const std::string & path);
+    bool Save(const std::string & path) const;
+    void SetFloatWeights(int size, const std::vector<float> & featureWeights, const std::vector<float> & bias,
+                         const std::vector<float> & outputWeights, float outputBias);
+    bool IsLoaded() const { return m_size > 0; }
+    int GetSize() const { return m_size; }
+
+    // The CPU must support 'isa'; the best one is chosen by default
+    void SetIsa(BatchIsa_t isa) { m_isa = isa; }
+
+    void Reset(EvalAccumulator & accumulator) const;
+    void AddStone(EvalAccumulator & accumulator, size_t cell, int color) const;
+    void RemoveStone(EvalAccumulator & accumulator, size_t cell, int color) const;
+    int Evaluate(const EvalAccumulator & accumulator, int color) const;
+};
+
+#endif // NNUE_H
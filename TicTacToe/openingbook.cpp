@@ -0,0 +1,328 @@
+#include "openingbook.h"
+#include "atomicfile.h"
+#include "bitboard.h"
+#include "mnkengine.h"
+#include "symmetry.h"
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+const char OPENING_BOOK_MAGIC[8] = {'T', 'T', 'T', 'B', 'O', 'O', 'K', '1'};
+
+struct OpeningBookHeader
+{
+    char magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint32_t k;
+    uint32_t plies;
+    uint64_t entries;
+    uint64_t dataOffset;
+};
+
+OpeningBook::OpeningBook()
+{
+    m_mapping = nullptr;
+    m_entries = nullptr;
+    m_count = 0;
+    m_width = 0;
+    m_height = 0;
+    m_k = 0;
+    m_plies = 0;
+}
+
+OpeningBook::~OpeningBook()
+{
+    Close();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Open
+//
+// @description             : Maps a book file into memory. Only the header is
+//                            checked; entries are read straight from the
+//                            mapping.
+//
+// @return                  : true if the file is a valid opening book
+//--------------------------------------------------------------------------------
+bool OpeningBook::Open(const std::string & path)
+{
+    Close();
+
+    m_file.setFileName(QString::fromStdString(path));
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < static_cast<qint64>(sizeof(OpeningBookHeader)))
+    {
+        Close();
+        return false;
+    }
+
+    m_mapping = m_file.map(0, m_file.size());
+    if (!m_mapping)
+    {
+        Close();
+        return false;
+    }
+
+    OpeningBookHeader header;
+    memcpy(&header, m_mapping, sizeof(header));
+    uint64_t cells = static_cast<uint64_t>(header.width) * header.height;
+    if (memcmp(header.magic, OPENING_BOOK_MAGIC, sizeof(header.magic)) != 0 || cells == 0 || cells > 64 ||
+        header.dataOffset % alignof(OpeningBookEntry) != 0 ||
+        static_cast<uint64_t>(m_file.size()) < header.dataOffset + header.entries * sizeof(OpeningBookEntry))
+    {
+        Close();
+        return false;
+    }
+
+    m_width = header.width;
+    m_height = header.height;
+    m_k = header.k;
+    m_plies = header.plies;
+    m_count = header.entries;
+    m_hasher = CanonicalHasher(m_width, m_height);
+    m_entries = reinterpret_cast<const OpeningBookEntry *>(m_mapping + header.dataOffset);
+    return true;
+}
+
+void OpeningBook::Close()
+{
+    if (m_mapping)
+    {
+        m_file.unmap(m_mapping);
+    }
+    m_file.close();
+    m_mapping = nullptr;
+    m_entries = nullptr;
+    m_count = 0;
+}
+
+bool OpeningBook::Covers(size_t width, size_t height, size_t k, size_t stones) const
+{
+    return IsOpen() && width == m_width && height == m_height && k == m_k && stones < m_plies;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Probe
+//
+// @description             : Looks up the position with 'own' to move
+//
+// @return                  : true and the move through 'move' if it is in the book
+//--------------------------------------------------------------------------------
+bool OpeningBook::Probe(uint64_t own, uint64_t opponent, size_t & move) const
+{
+    if (!IsOpen())
+    {
+        return false;
+    }
+
+    int symmetry;
+    uint64_t key = m_hasher.GetKey(own, opponent, symmetry);
+    const OpeningBookEntry * end = m_entries + m_count;
+    const OpeningBookEntry * entry = std::lower_bound(m_entries, end, key,
+        [](const OpeningBookEntry & candidate, uint64_t wanted) { return candidate.key < wanted; });
+    if (entry == end || entry->key != key)
+    {
+        return false;
+    }
+
+    move = m_hasher.FromCanonical(entry->move, symmetry);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetOpeningBookFileName
+//
+// @description             : Default file name of a board's opening book
+//
+// @return                  : e.g. "tictactoe_4x4x4.book"
+//--------------------------------------------------------------------------------
+std::string GetOpeningBookFileName(size_t width, size_t height, size_t k)
+{
+    std::ostringstream name;
+    name << "tictactoe_" << width << "x" << height << "x" << k << ".book";
+    return name.str();
+}
+
+struct BookPosition
+{
+    uint64_t own;
+    uint64_t opponent;
+    uint64_t key;
+    int symmetry;
+};
+
+//------------------------------------------------------------------------
+// Searches book positions until none are left. Positions are taken one at
+// a time, so threads stay busy however long each search takes.
+//------------------------------------------------------------------------
+class OpeningBookWorker: public QThread
+{
+private:
+    const std::vector<BookPosition> & m_positions;
+    std::vector<OpeningBookEntry> & m_entries;
+    std::atomic<size_t> & m_next;
+    const CanonicalHasher & m_hasher;
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    int m_budgetMs;
+
+public:
+    unsigned long long nodes;
+
+    OpeningBookWorker(const std::vector<BookPosition> & positions, std::vector<OpeningBookEntry> & entries,
+                      std::atomic<size_t> & next, const CanonicalHasher & hasher, size_t width, size_t height,
+                      size_t k, int budgetMs)
+        : QThread(), m_positions(positions), m_entries(entries), m_next(next), m_hasher(hasher), m_width(width),
+          m_height(height), m_k(k), m_budgetMs(budgetMs), nodes(0)
+    {
+    }
+
+    void run()
+    {
+        MnkEngine engine;
+        engine.SetBoard(m_width, m_height, m_k);
+
+        size_t index;
+        while ((index = m_next++) < m_positions.size())
+        {
+            const BookPosition & position = m_positions[index];
+            int score;
+            size_t move = engine.Search(position.own, position.opponent, m_budgetMs, 0, score);
+
+            OpeningBookEntry & entry = m_entries[index];
+            entry.key = position.key;
+            entry.move = static_cast<uint16_t>(m_hasher.ToCanonical(move, position.symmetry));
+            entry.depth = static_cast<uint16_t>(engine.GetStats().depth);
+            entry.score = score;
+        }
+
+        nodes = engine.GetStats().nodes;
+    }
+};
+
+static bool HasLine(uint64_t mask, const std::vector<uint64_t> & lines)
+{
+    for (auto it = lines.begin(); it != lines.end(); it++)
+    {
+        if ((mask & *it) == *it)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GenerateOpeningBook
+//
+// @description             : Lists every unfinished position with fewer than
+//                            'plies' stones, one per symmetry class, searches
+//                            each for 'budgetMs' on 'threads' threads and
+//                            writes the book sorted by key. The file is written
+//                            under a temporary name and renamed once complete.
+//
+// @return                  : true if the file was written
+//--------------------------------------------------------------------------------
+bool GenerateOpeningBook(size_t width, size_t height, size_t k, size_t plies, int budgetMs, size_t threads,
+                         const std::string & path, OpeningBookStats & stats)
+{
+    size_t cells = width * height;
+    assert(cells <= 64 && threads > 0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    CanonicalHasher hasher(width, height);
+    std::vector<uint64_t> lines = GetMnkLineMasks(width, height, k);
+    uint64_t fullMask = (cells == 64) ? ~0ULL : ((1ULL << cells) - 1);
+
+    // Breadth first, so each position is listed at its own ply
+    std::vector<BookPosition> positions;
+    std::unordered_set<uint64_t> seen;
+    std::vector<BookPosition> layer(1, BookPosition());
+    for (size_t ply = 0; ply < plies && !layer.empty(); ply++)
+    {
+        std::vector<BookPosition> nextLayer;
+        for (auto it = layer.begin(); it != layer.end(); it++)
+        {
+            BookPosition position = *it;
+            position.key = hasher.GetKey(position.own, position.opponent, position.symmetry);
+            uint64_t empty = ~(position.own | position.opponent) & fullMask;
+            if (empty == 0 || !seen.insert(position.key).second)
+            {
+                continue;
+            }
+            positions.push_back(position);
+
+            for (; empty; empty &= empty - 1)
+            {
+                BookPosition child = BookPosition();
+                child.own = position.opponent;
+                child.opponent = position.own | (empty & (0 - empty));
+                if (!HasLine(child.opponent, lines))
+                {
+                    nextLayer.push_back(child);
+                }
+            }
+        }
+        layer.swap(nextLayer);
+    }
+
+    std::vector<OpeningBookEntry> entries(positions.size());
+    std::atomic<size_t> next(0);
+    std::vector<OpeningBookWorker *> workers;
+    for (size_t i = 0; i < std::min(threads, positions.size()); i++)
+    {
+        workers.push_back(new OpeningBookWorker(positions, entries, next, hasher, width, height, k, budgetMs));
+        workers.back()->start();
+    }
+
+    stats.nodes = 0;
+    for (auto it = workers.begin(); it != workers.end(); it++)
+    {
+        (*it)->wait();
+        stats.nodes += (*it)->nodes;
+        delete *it;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const OpeningBookEntry & a, const OpeningBookEntry & b) { return a.key < b.key; });
+
+    OpeningBookHeader header;
+    memcpy(header.magic, OPENING_BOOK_MAGIC, sizeof(header.magic));
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.k = static_cast<uint32_t>(k);
+    header.plies = static_cast<uint32_t>(plies);
+    header.entries = entries.size();
+    header.dataOffset = sizeof(OpeningBookHeader);
+
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(OpeningBookEntry));
+    file.close();
+    if (!file)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    if (!CommitFile(temporary, path))
+    {
+        return false;
+    }
+
+    stats.positions = entries.size();
+    stats.fileBytes = sizeof(header) + entries.size() * sizeof(OpeningBookEntry);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+#include "symmetry.h"
+#include <QFile>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct OpeningBookEntry
+{
+    uint64_t key;           // canonical key, side to move's stones as 'own'
+    uint16_t move;          // in the canonical orientation
+    uint16_t depth;         // of the search that chose it
+    int32_t score;
+};
+
+struct OpeningBookStats
+{
+    uint64_t positions;
+    unsigned long long nodes;
+    uint64_t fileBytes;
+    double seconds;
+};
+
+//------------------------------------------------------------------------
+// Best moves for every position of the first few plies of an m,n,k board,
+// found offline by deep search. The file is a header and the entries
+// sorted by key; it is used through a memory mapping, so opening costs no
+// parsing and a probe is a binary search over the mapped entries.
+//------------------------------------------------------------------------
+class OpeningBook
+{
+private:
+    QFile m_file;
+    uchar * m_mapping;
+    const OpeningBookEntry * m_entries;
+    uint64_t m_count;
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    size_t m_plies;
+    CanonicalHasher m_hasher;
+
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    bool Open(const std::string & path);
+    void Close();
+    bool IsOpen() const { return m_entries != nullptr; }
+    uint64_t GetEntryCount() const { return m_count; }
+    size_t GetPlies() const { return m_plies; }
+
+    // Whether positions with 'stones' stones on this board can be in the book
+    bool Covers(size_t width, size_t height, size_t k, size_t stones) const;
+    bool Probe(uint64_t own, uint64_t opponent, size_t & move) const;
+};
+
+std::string GetOpeningBookFileName(size_t width, size_t height, size_t k);
+bool GenerateOpeningBook(size_t width, size_t height, size_t k, size_t plies, int budgetMs, size_t threads,
+                         const std::string & path, OpeningBookStats & stats);
+
+#endif // OPENINGBOOK_H
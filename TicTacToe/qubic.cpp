@@ -0,0 +1,544 @@
+#include "qubic.h"
+#include <algorithm>
+#include <cassert>
+
+const int QUBIC_WIN_SCORE = 10000;
+const int QUBIC_INFINITY = QUBIC_WIN_SCORE + 1;
+
+// Scores above this are wins found by search rather than evaluations
+const int QUBIC_PROVEN_SCORE = QUBIC_WIN_SCORE - 100;
+
+// Value of an open line holding 0, 1, 2 or 3 marks of one player
+const int QUBIC_LINE_WEIGHTS[4] = {0, 1, 12, 150};
+
+const size_t QUBIC_TABLE_SIZE = 1 << 18;
+
+// Part of the budget kept back for unwinding the search, in percent plus
+// a fixed millisecond
+const int QUBIC_TIME_MARGIN_PERCENT = 5;
+const int QUBIC_TIME_MARGIN_MS = 1;
+
+// Expected growth of the search time from one depth to the next
+const int QUBIC_DEPTH_TIME_GROWTH = 3;
+
+typedef enum TableFlag_tag
+{
+    TABLE_EXACT,
+    TABLE_LOWER_BOUND,
+    TABLE_UPPER_BOUND
+}TableFlag_t;
+
+//------------------------------------------------------------------------
+// Winning lines, the lines through every cell and a move order that
+// tries the strongest cells (7 lines through them) first
+//------------------------------------------------------------------------
+struct QubicTables
+{
+    uint64_t lines[QUBIC_LINE_COUNT];
+    std::vector<uint64_t> cellLines[QUBIC_CELLS];
+    size_t moveOrder[QUBIC_CELLS];
+
+    QubicTables()
+    {
+        size_t count = 0;
+        for (int dz = -1; dz <= 1; dz++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    // Take one direction out of each opposite pair
+                    bool bForward = (dz > 0) || (dz == 0 && dy > 0) || (dz == 0 && dy == 0 && dx > 0);
+                    if (!bForward)
+                    {
+                        continue;
+                    }
+
+                    for (int z = 0; z < 4; z++)
+                    {
+                        for (int y = 0; y < 4; y++)
+                        {
+                            for (int x = 0; x < 4; x++)
+                            {
+                                int ex = x + 3 * dx;
+                                int ey = y + 3 * dy;
+                                int ez = z + 3 * dz;
+                                if (ex < 0 || ex > 3 || ey < 0 || ey > 3 || ez < 0 || ez > 3)
+                                {
+                                    continue;
+                                }
+
+                                uint64_t line = 0;
+                                for (int i = 0; i < 4; i++)
+                                {
+                                    line |= 1ULL << ((x + i * dx) + 4 * (y + i * dy) + 16 * (z + i * dz));
+                                }
+                                lines[count++] = line;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        assert(count == QUBIC_LINE_COUNT);
+
+        for (size_t cell = 0; cell < QUBIC_CELLS; cell++)
+        {
+            for (size_t i = 0; i < QUBIC_LINE_COUNT; i++)
+            {
+                if (lines[i] & (1ULL << cell))
+                {
+                    cellLines[cell].push_back(lines[i]);
+                }
+            }
+            moveOrder[cell] = cell;
+        }
+
+        const std::vector<uint64_t> * byCell = cellLines;
+        std::stable_sort(moveOrder, moveOrder + QUBIC_CELLS, [byCell](size_t a, size_t b) {
+            return byCell[a].size() > byCell[b].size();
+        });
+    }
+};
+
+static const QubicTables & GetTables()
+{
+    static const QubicTables tables;
+    return tables;
+}
+
+static uint64_t HashPosition(uint64_t own, uint64_t opponent)
+{
+    // splitmix64 finaliser over both masks
+    uint64_t key = own * 0x9E3779B97F4A7C15ULL ^ (opponent + 0x632BE59BD9B4E019ULL);
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetQubicLines
+//
+// @description             : The 76 winning lines as cell masks
+//
+// @return                  : array of QUBIC_LINE_COUNT masks
+//--------------------------------------------------------------------------------
+const uint64_t* GetQubicLines()
+{
+    return GetTables().lines;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetQubicLinesThroughCell
+//
+// @description             : The 4 or 7 winning lines passing through a cell
+//
+// @return                  : vector of line masks
+//--------------------------------------------------------------------------------
+const std::vector<uint64_t> & GetQubicLinesThroughCell(size_t cell)
+{
+    return GetTables().cellLines[cell];
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : IsQubicWinAfterMove
+//
+// @description             : Checks only the lines through the cell just played
+//
+// @return                  : true/false
+//--------------------------------------------------------------------------------
+bool IsQubicWinAfterMove(uint64_t mask, size_t cell)
+{
+    const std::vector<uint64_t> & lines = GetTables().cellLines[cell];
+    for (auto it = lines.begin(); it != lines.end(); it++)
+    {
+        if ((mask & *it) == *it)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetQubicThreats
+//
+// @description             : Cells where 'own' would complete a line: lines
+//                            holding three own marks and no opponent mark.
+//
+// @return                  : mask of threat cells
+//--------------------------------------------------------------------------------
+uint64_t GetQubicThreats(uint64_t own, uint64_t opponent)
+{
+    const uint64_t * lines = GetTables().lines;
+    uint64_t threats = 0;
+    for (size_t i = 0; i < QUBIC_LINE_COUNT; i++)
+    {
+        uint64_t line = lines[i];
+        if ((line & opponent) == 0 && CountBits(line & own) == 3)
+        {
+            threats |= line & ~own;
+        }
+    }
+
+    return threats;
+}
+
+QubicGame::QubicGame()
+{
+    m_userMask = 0;
+    m_computerMask = 0;
+    m_winner = PLAYER_NONE;
+}
+
+uint64_t QubicGame::GetPlayerMask(Player_t player) const
+{
+    return (player == PLAYER_USER) ? m_userMask : m_computerMask;
+}
+
+bool QubicGame::IsCellEmpty(size_t cell) const
+{
+    return ((m_userMask | m_computerMask) & (1ULL << cell)) == 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetAvailableMoves
+//
+// @description             : Lists the vacant cells in cell order
+//
+// @return                  : vector of cells
+//--------------------------------------------------------------------------------
+std::vector<size_t> QubicGame::GetAvailableMoves() const
+{
+    std::vector<size_t> moves;
+    uint64_t empty = ~(m_userMask | m_computerMask);
+    while (empty)
+    {
+        moves.push_back(GetLowestBitIndex(empty));
+        empty &= empty - 1;
+    }
+
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AddPlayerMarkToBoard
+//
+// @description             : Mark the player's move on the board. It also
+//                            determines if the player has won.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void QubicGame::AddPlayerMarkToBoard(size_t cell, Player_t player)
+{
+    assert(IsCellEmpty(cell));
+
+    uint64_t & mask = (player == PLAYER_USER) ? m_userMask : m_computerMask;
+    mask |= 1ULL << cell;
+
+    if (IsQubicWinAfterMove(mask, cell))
+    {
+        m_winner = player;
+    }
+}
+
+Player_t QubicGame::CheckWin() const
+{
+    return m_winner;
+}
+
+bool QubicGame::GameOver() const
+{
+    return m_winner != PLAYER_NONE || (m_userMask | m_computerMask) == ~0ULL;
+}
+
+QubicEngine::QubicEngine() : m_table(QUBIC_TABLE_SIZE)
+{
+    m_generation = 0;
+    m_stopped = false;
+    m_nodes = 0;
+    m_completedDepth = 0;
+}
+
+bool QubicEngine::IsTimeUp()
+{
+    return std::chrono::steady_clock::now() >= m_deadline;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Evaluate
+//
+// @description             : Static score of a quiet position: open lines of the
+//                            side to move minus open lines of the opponent,
+//                            weighted by how many marks they hold.
+//
+// @return                  : score from the point of view of 'own'
+//--------------------------------------------------------------------------------
+int QubicEngine::Evaluate(uint64_t own, uint64_t opponent) const
+{
+    const uint64_t * lines = GetTables().lines;
+    int score = 0;
+    for (size_t i = 0; i < QUBIC_LINE_COUNT; i++)
+    {
+        uint64_t ownPart = lines[i] & own;
+        uint64_t opponentPart = lines[i] & opponent;
+        if (opponentPart == 0)
+        {
+            score += QUBIC_LINE_WEIGHTS[CountBits(ownPart)];
+        }
+        else if (ownPart == 0)
+        {
+            score -= QUBIC_LINE_WEIGHTS[CountBits(opponentPart)];
+        }
+    }
+
+    return score;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Search
+//
+// @description             : Alpha-beta negamax with a transposition table.
+//                            'own' is the side to move. Immediate wins and
+//                            double threats are scored without searching, and
+//                            a forced block does not use up depth.
+//
+// @return                  : score from the point of view of 'own'
+//--------------------------------------------------------------------------------
+int QubicEngine::Search(uint64_t own, uint64_t opponent, int depth, int ply, int alpha, int beta)
+{
+    m_nodes++;
+    if ((m_nodes & 1023) == 0 && IsTimeUp())
+    {
+        m_stopped = true;
+    }
+    if (m_stopped)
+    {
+        return 0;
+    }
+
+    uint64_t empty = ~(own | opponent);
+    if (empty == 0)
+    {
+        return 0;
+    }
+
+    if (GetQubicThreats(own, opponent) & empty)
+    {
+        return QUBIC_WIN_SCORE - (ply + 1);
+    }
+
+    uint64_t opponentThreats = GetQubicThreats(opponent, own) & empty;
+    if (CountBits(opponentThreats) >= 2)
+    {
+        return -(QUBIC_WIN_SCORE - (ply + 2));
+    }
+    if (opponentThreats)
+    {
+        return -Search(opponent, own | opponentThreats, depth, ply + 1, -beta, -alpha);
+    }
+
+    if (depth <= 0)
+    {
+        return Evaluate(own, opponent);
+    }
+
+    uint64_t key = HashPosition(own, opponent);
+    TableEntry & entry = m_table[key & (QUBIC_TABLE_SIZE - 1)];
+    size_t tableMove = QUBIC_CELLS;
+    if (entry.key == key)
+    {
+        // Entries of earlier searches still order the moves, but their
+        // scores are not trusted for cutoffs
+        tableMove = entry.move;
+        if (entry.generation == m_generation && entry.depth >= depth)
+        {
+            // Proven scores are stored relative to the node, not the root
+            int score = entry.score;
+            if (score > QUBIC_PROVEN_SCORE)
+            {
+                score -= ply;
+            }
+            else if (score < -QUBIC_PROVEN_SCORE)
+            {
+                score += ply;
+            }
+
+            if (entry.flag == TABLE_EXACT ||
+                (entry.flag == TABLE_LOWER_BOUND && score >= beta) ||
+                (entry.flag == TABLE_UPPER_BOUND && score <= alpha))
+            {
+                return score;
+            }
+        }
+    }
+
+    const size_t * moveOrder = GetTables().moveOrder;
+    int originalAlpha = alpha;
+    int bestScore = -QUBIC_INFINITY;
+    size_t bestMove = QUBIC_CELLS;
+
+    for (size_t i = 0; i <= QUBIC_CELLS; i++)
+    {
+        // Table move first, then the static order
+        size_t cell = (i == 0) ? tableMove : moveOrder[i - 1];
+        if (cell >= QUBIC_CELLS || (i > 0 && cell == tableMove) || !(empty & (1ULL << cell)))
+        {
+            continue;
+        }
+
+        int score = -Search(opponent, own | (1ULL << cell), depth - 1, ply + 1, -beta, -alpha);
+        if (m_stopped)
+        {
+            return 0;
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = cell;
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    int storedScore = bestScore;
+    if (storedScore > QUBIC_PROVEN_SCORE)
+    {
+        storedScore += ply;
+    }
+    else if (storedScore < -QUBIC_PROVEN_SCORE)
+    {
+        storedScore -= ply;
+    }
+
+    entry.key = key;
+    entry.score = static_cast<int16_t>(storedScore);
+    entry.depth = static_cast<int8_t>(depth);
+    entry.move = static_cast<uint8_t>(bestMove);
+    entry.generation = m_generation;
+    if (bestScore <= originalAlpha)
+    {
+        entry.flag = TABLE_UPPER_BOUND;
+    }
+    else if (bestScore >= beta)
+    {
+        entry.flag = TABLE_LOWER_BOUND;
+    }
+    else
+    {
+        entry.flag = TABLE_EXACT;
+    }
+
+    return bestScore;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Deepens the search until the time budget runs out,
+//                            the result is proven or 'maxDepth' is reached.
+//
+// @return                  : cell of the move on the board, QUBIC_CELLS if the
+//                            board is full
+//--------------------------------------------------------------------------------
+size_t QubicEngine::SelectMove(const QubicGame & game, Player_t player, int budgetMs, int maxDepth)
+{
+    assert(!game.GameOver());
+
+    Player_t opponent = (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    uint64_t own = game.GetPlayerMask(player);
+    uint64_t opp = game.GetPlayerMask(opponent);
+    uint64_t empty = ~(own | opp);
+
+    m_nodes = 0;
+    m_completedDepth = 0;
+    if (empty == 0)
+    {
+        return QUBIC_CELLS;
+    }
+
+    // Win now, or block the opponent's threat
+    uint64_t ownThreats = GetQubicThreats(own, opp) & empty;
+    if (ownThreats)
+    {
+        return GetLowestBitIndex(ownThreats);
+    }
+    uint64_t opponentThreats = GetQubicThreats(opp, own) & empty;
+    if (opponentThreats)
+    {
+        return GetLowestBitIndex(opponentThreats);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int marginMs = budgetMs * QUBIC_TIME_MARGIN_PERCENT / 100 + QUBIC_TIME_MARGIN_MS;
+    m_deadline = start + std::chrono::milliseconds(std::max(budgetMs - marginMs, 0));
+    m_stopped = false;
+
+    // A new generation instead of clearing the table
+    m_generation++;
+
+    std::vector<size_t> rootMoves;
+    const size_t * moveOrder = GetTables().moveOrder;
+    for (size_t i = 0; i < QUBIC_CELLS; i++)
+    {
+        if (empty & (1ULL << moveOrder[i]))
+        {
+            rootMoves.push_back(moveOrder[i]);
+        }
+    }
+
+    size_t bestMove = rootMoves.front();
+    int emptyCount = CountBits(empty);
+    auto lastIterationStart = start;
+    for (int depth = 1; depth <= maxDepth && depth <= emptyCount; depth++)
+    {
+        // Skip a depth that would most likely be cut off unfinished
+        auto iterationStart = std::chrono::steady_clock::now();
+        if (depth > 1 && iterationStart + (iterationStart - lastIterationStart) * QUBIC_DEPTH_TIME_GROWTH > m_deadline)
+        {
+            break;
+        }
+        lastIterationStart = iterationStart;
+
+        int iterationScore = -QUBIC_INFINITY;
+        size_t iterationMove = bestMove;
+        for (auto it = rootMoves.begin(); it != rootMoves.end(); it++)
+        {
+            int score = -Search(opp, own | (1ULL << *it), depth - 1, 1, -QUBIC_INFINITY, -iterationScore);
+            if (m_stopped)
+            {
+                break;
+            }
+            if (score > iterationScore)
+            {
+                iterationScore = score;
+                iterationMove = *it;
+            }
+        }
+
+        if (m_stopped)
+        {
+            break;
+        }
+
+        // Search the best move first in the next iteration
+        bestMove = iterationMove;
+        m_completedDepth = depth;
+        std::iter_swap(rootMoves.begin(), std::find(rootMoves.begin(), rootMoves.end(), bestMove));
+
+        if (iterationScore > QUBIC_PROVEN_SCORE || iterationScore < -QUBIC_PROVEN_SCORE)
+        {
+            break;
+        }
+    }
+
+    return bestMove;
+}
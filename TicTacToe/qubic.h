@@ -0,0 +1,77 @@
+#ifndef QUBIC_H
+#define QUBIC_H
+#include "game.h"
+#include "bitboard.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Qubic: tic-tac-toe on a 4x4x4 cube, four in a row wins.
+// One 64 bit mask per player, bit N is cell N = x + 4 * y + 16 * z.
+//------------------------------------------------------------------------
+const size_t QUBIC_SIZE = 4;
+const size_t QUBIC_CELLS = 64;
+const size_t QUBIC_LINE_COUNT = 76;
+
+const uint64_t* GetQubicLines();
+const std::vector<uint64_t> & GetQubicLinesThroughCell(size_t cell);
+bool IsQubicWinAfterMove(uint64_t mask, size_t cell);
+uint64_t GetQubicThreats(uint64_t own, uint64_t opponent);
+
+class QubicGame
+{
+private:
+    uint64_t m_userMask;
+    uint64_t m_computerMask;
+    Player_t m_winner;
+
+public:
+    QubicGame();
+    uint64_t GetPlayerMask(Player_t player) const;
+    bool IsCellEmpty(size_t cell) const;
+    std::vector<size_t> GetAvailableMoves() const;
+    void AddPlayerMarkToBoard(size_t cell, Player_t player);
+    Player_t CheckWin() const;
+    bool GameOver() const;
+};
+
+//------------------------------------------------------------------------
+// Iterative deepening alpha-beta engine for Qubic. Forced replies to a
+// single threat do not use up depth, a double threat is scored as lost.
+// Every search finishes within the given time budget: the clock stops
+// the search a margin before it, and a depth that cannot finish in the
+// time left is not started.
+//------------------------------------------------------------------------
+class QubicEngine
+{
+private:
+    struct TableEntry
+    {
+        uint64_t key;
+        int16_t score;
+        int8_t depth;
+        uint8_t flag;
+        uint8_t move;
+        uint8_t generation;     // search that stored the entry
+    };
+
+    std::vector<TableEntry> m_table;
+    uint8_t m_generation;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_stopped;
+    unsigned long long m_nodes;
+    int m_completedDepth;
+
+    int Search(uint64_t own, uint64_t opponent, int depth, int ply, int alpha, int beta);
+    int Evaluate(uint64_t own, uint64_t opponent) const;
+    bool IsTimeUp();
+
+public:
+    QubicEngine();
+    size_t SelectMove(const QubicGame & game, Player_t player, int budgetMs, int maxDepth = 64);
+    unsigned long long GetNodes() const { return m_nodes; }
+    int GetCompletedDepth() const { return m_completedDepth; }
+};
+
+#endif // QUBIC_H
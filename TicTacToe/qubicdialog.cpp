@@ -0,0 +1,177 @@
+#include "qubicdialog.h"
+#include "mainwindow.h"
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+QubicDialog::QubicDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    m_bComputerFirst = false;
+    m_worker = nullptr;
+    setWindowTitle("Tic Tac Toe 4x4x4");
+
+    QVBoxLayout * mainLayout = new QVBoxLayout(this);
+    QHBoxLayout * layersLayout = new QHBoxLayout();
+    mainLayout->addLayout(layersLayout);
+
+    // One grid per layer, cell = x + 4 * y + 16 * z
+    m_board.resize(QUBIC_CELLS);
+    for (size_t z = 0; z < QUBIC_SIZE; z++)
+    {
+        QGridLayout * layer = new QGridLayout();
+        layer->setSpacing(2);
+        for (size_t y = 0; y < QUBIC_SIZE; y++)
+        {
+            for (size_t x = 0; x < QUBIC_SIZE; x++)
+            {
+                size_t cell = x + QUBIC_SIZE * y + QUBIC_SIZE * QUBIC_SIZE * z;
+                QPushButton * btn = new QPushButton(".", this);
+                btn->setFixedSize(28, 28);
+                btn->setProperty("cell", static_cast<int>(cell));
+                connect(btn, SIGNAL(clicked()), this, SLOT(OnCellClicked()));
+                layer->addWidget(btn, static_cast<int>(y), static_cast<int>(x));
+                m_board[cell] = btn;
+            }
+        }
+        layersLayout->addLayout(layer);
+    }
+
+    QHBoxLayout * bottomLayout = new QHBoxLayout();
+    m_status = new QLabel(this);
+    m_btnNewGame = new QPushButton("New Game", this);
+    connect(m_btnNewGame, SIGNAL(clicked()), this, SLOT(OnNewGame()));
+    bottomLayout->addWidget(m_status, 1);
+    bottomLayout->addWidget(m_btnNewGame);
+    mainLayout->addLayout(bottomLayout);
+
+    OnNewGame();
+}
+
+QubicDialog::~QubicDialog()
+{
+    // The worker uses our engine, let it finish its search first
+    if (m_worker)
+    {
+        m_worker->wait();
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : EnableGame
+//
+// @description             : Enable/Disable the vacant cells
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void QubicDialog::EnableGame(bool bEnable)
+{
+    for (size_t cell = 0; cell < QUBIC_CELLS; cell++)
+    {
+        m_board[cell]->setEnabled(bEnable && m_game.IsCellEmpty(cell));
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : MarkBoardPosition
+//
+// @description             : Marks a move on the board and reports the result
+//                            once the game is over.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void QubicDialog::MarkBoardPosition(size_t cell, Player_t player)
+{
+    m_game.AddPlayerMarkToBoard(cell, player);
+    m_board[cell]->setText((player == PLAYER_USER) ? USER_MARK : COMPUTER_MARK);
+    m_board[cell]->setEnabled(false);
+
+    if (m_game.CheckWin() == PLAYER_USER)
+    {
+        m_status->setText("You won the game");
+        EnableGame(false);
+    }
+    else if (m_game.CheckWin() == PLAYER_COMPUTER)
+    {
+        m_status->setText("Computer won the game");
+        EnableGame(false);
+    }
+    else if (m_game.GameOver())
+    {
+        m_status->setText("Game was tied");
+        EnableGame(false);
+    }
+    else if (player == PLAYER_USER)
+    {
+        SimulateComputerMove();
+    }
+    else
+    {
+        m_status->setText("Your turn");
+        EnableGame(true);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SimulateComputerMove
+//
+// @description             : Searches the computer's move in a separate thread.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void QubicDialog::SimulateComputerMove()
+{
+    m_status->setText("Computer's turn");
+    EnableGame(false);
+    m_btnNewGame->setEnabled(false);
+
+    m_worker = new QubicMoveWorker(m_game, &m_engine);
+    connect(m_worker, SIGNAL(QubicMoveAvailable(int)), this, SLOT(OnQubicMoveAvailable(int)));
+    connect(m_worker, SIGNAL(finished()), m_worker, SLOT(deleteLater()));
+    m_worker->start();
+}
+
+void QubicDialog::OnQubicMoveAvailable(int move)
+{
+    m_worker = nullptr;
+    m_btnNewGame->setEnabled(true);
+    MarkBoardPosition(static_cast<size_t>(move), PLAYER_COMPUTER);
+}
+
+void QubicDialog::OnCellClicked()
+{
+    QAbstractButton * btn = qobject_cast<QAbstractButton *>(sender());
+    if (btn)
+    {
+        MarkBoardPosition(static_cast<size_t>(btn->property("cell").toInt()), PLAYER_USER);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : OnNewGame
+//
+// @description             : Clears the board. Who moves first alternates from
+//                            game to game.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void QubicDialog::OnNewGame()
+{
+    m_game = QubicGame();
+    for (auto it = m_board.begin(); it != m_board.end(); it++)
+    {
+        (*it)->setText(".");
+    }
+
+    if (m_bComputerFirst)
+    {
+        SimulateComputerMove();
+    }
+    else
+    {
+        m_status->setText("Your turn");
+        EnableGame(true);
+    }
+    m_bComputerFirst = !m_bComputerFirst;
+}
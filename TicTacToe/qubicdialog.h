@@ -0,0 +1,71 @@
+#ifndef QUBICDIALOG_H
+#define QUBICDIALOG_H
+
+#include "qubic.h"
+#include <QDialog>
+#include <QLabel>
+#include <QtWidgets/QAbstractButton>
+#include <vector>
+
+// Time the computer may think per Qubic move
+const int QUBIC_MOVE_BUDGET_MS = 200;
+
+//------------------------------------------------------------------------
+// Worker thread that calculates Computer's Qubic move
+//------------------------------------------------------------------------
+class QubicMoveWorker: public QThread
+{
+Q_OBJECT
+private:
+    QubicGame m_game;
+    QubicEngine* m_engine;
+
+signals:
+    void QubicMoveAvailable(int move);
+
+public:
+    QubicMoveWorker(const QubicGame & game, QubicEngine* engine) : QThread()
+    {
+        m_game = game;
+        m_engine = engine;
+    }
+
+    void run()
+    {
+        size_t move = m_engine->SelectMove(m_game, PLAYER_COMPUTER, QUBIC_MOVE_BUDGET_MS);
+        emit QubicMoveAvailable(static_cast<int>(move));
+    }
+};
+
+//------------------------------------------------------------------------
+// 4x4x4 board shown as four 4x4 layers side by side
+//------------------------------------------------------------------------
+class QubicDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    QubicDialog(QWidget *parent = nullptr);
+    ~QubicDialog();
+    void EnableGame(bool bEnable);
+    void MarkBoardPosition(size_t cell, Player_t player);
+    void SimulateComputerMove();
+
+private slots:
+    void OnCellClicked();
+
+    void OnQubicMoveAvailable(int move);
+
+    void OnNewGame();
+
+private:
+    std::vector<QAbstractButton *> m_board;
+    QLabel * m_status;
+    QAbstractButton * m_btnNewGame;
+    QubicMoveWorker * m_worker;
+    QubicGame m_game;
+    QubicEngine m_engine;
+    bool m_bComputerFirst;
+};
+
+#endif // QUBICDIALOG_H
@@ -0,0 +1,230 @@
+#ifndef RULES_H
+#define RULES_H
+#include "bitboard.h"
+#include <cstdint>
+
+//------------------------------------------------------------------------
+// Game rules as compile-time policies. A rule set combines:
+//
+//   Geometry      board width and height (at most 64 cells)
+//   WinCondition  which lines count, e.g. KInARow<3>
+//   Play          NormalPlay (completing a line wins) or MiserePlay
+//                 (completing a line loses)
+//   Symbols       OwnSymbol (each player places their own mark) or
+//                 WildSymbols (either player may place X or O)
+//
+// The board is one mask per symbol; bit N is cell N = row * width + col.
+// Everything resolves at compile time, so a search instantiated for a
+// rule set has no runtime rule branching in its hot loop.
+//------------------------------------------------------------------------
+typedef uint64_t RuleMask_t;
+
+template <size_t W, size_t H>
+struct BoardGeometry
+{
+    static_assert(W > 0 && H > 0 && W * H <= 64, "Board must have 1 to 64 cells");
+
+    static const size_t WIDTH = W;
+    static const size_t HEIGHT = H;
+    static const size_t CELLS = W * H;
+    static const RuleMask_t FULL_MASK = (CELLS == 64) ? ~0ULL : ((1ULL << (CELLS % 64)) - 1);
+};
+
+//------------------------------------------------------------------------
+// Lines of K cells through every cell of the board, built once
+//------------------------------------------------------------------------
+template <class Geometry, size_t K>
+struct LineTable
+{
+    static const size_t MAX_LINES_PER_CELL = 4 * K;
+
+    RuleMask_t cellLines[Geometry::CELLS][MAX_LINES_PER_CELL];
+    size_t cellLineCount[Geometry::CELLS];
+
+    LineTable()
+    {
+        const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        const int width = static_cast<int>(Geometry::WIDTH);
+        const int height = static_cast<int>(Geometry::HEIGHT);
+        const int k = static_cast<int>(K);
+
+        for (size_t cell = 0; cell < Geometry::CELLS; cell++)
+        {
+            cellLineCount[cell] = 0;
+        }
+
+        for (int d = 0; d < 4; d++)
+        {
+            int dr = directions[d][0];
+            int dc = directions[d][1];
+            for (int row = 0; row < height; row++)
+            {
+                for (int col = 0; col < width; col++)
+                {
+                    int endRow = row + (k - 1) * dr;
+                    int endCol = col + (k - 1) * dc;
+                    if (endRow < 0 || endRow >= height || endCol < 0 || endCol >= width)
+                    {
+                        continue;
+                    }
+
+                    RuleMask_t line = 0;
+                    for (int i = 0; i < k; i++)
+                    {
+                        line |= 1ULL << ((row + i * dr) * width + (col + i * dc));
+                    }
+                    for (int i = 0; i < k; i++)
+                    {
+                        size_t cell = static_cast<size_t>((row + i * dr) * width + (col + i * dc));
+                        cellLines[cell][cellLineCount[cell]++] = line;
+                    }
+                }
+            }
+        }
+    }
+
+    static const LineTable instance;
+};
+
+template <class Geometry, size_t K>
+const LineTable<Geometry, K> LineTable<Geometry, K>::instance;
+
+template <size_t K>
+struct KInARow
+{
+    // Does 'mask' hold a complete line through 'cell'?
+    template <class Geometry>
+    static bool CompletesLine(RuleMask_t mask, size_t cell)
+    {
+        const LineTable<Geometry, K> & table = LineTable<Geometry, K>::instance;
+        for (size_t i = 0; i < table.cellLineCount[cell]; i++)
+        {
+            RuleMask_t line = table.cellLines[cell][i];
+            if ((mask & line) == line)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+struct NormalPlay
+{
+    // Score for the player who just completed a line
+    static int LineCompletedScore(int winScore) { return winScore; }
+};
+
+struct MiserePlay
+{
+    static int LineCompletedScore(int winScore) { return -winScore; }
+};
+
+struct OwnSymbol
+{
+    static const int CHOICES = 1;
+    static int GetSymbol(int side, int choice) { (void)choice; return side; }
+};
+
+struct WildSymbols
+{
+    static const int CHOICES = 2;
+    static int GetSymbol(int side, int choice) { (void)side; return choice; }
+};
+
+template <class GeometryPolicy, class WinPolicy, class PlayPolicy, class SymbolPolicy>
+struct GameRules
+{
+    typedef GeometryPolicy Geometry;
+    typedef PlayPolicy Play;
+    typedef SymbolPolicy Symbols;
+
+    static bool CompletesLine(RuleMask_t mask, size_t cell)
+    {
+        return WinPolicy::template CompletesLine<Geometry>(mask, cell);
+    }
+};
+
+typedef GameRules<BoardGeometry<3, 3>, KInARow<3>, NormalPlay, OwnSymbol> StandardRules;
+typedef GameRules<BoardGeometry<3, 3>, KInARow<3>, MiserePlay, OwnSymbol> MisereRules;
+typedef GameRules<BoardGeometry<3, 3>, KInARow<3>, NormalPlay, WildSymbols> WildRules;
+
+//------------------------------------------------------------------------
+// Alpha-beta negamax specialised for one rule set. 'symbols' holds one
+// mask per symbol, 'side' is the player to move (0 moves first).
+//------------------------------------------------------------------------
+template <class Rules>
+class PolicySearch
+{
+private:
+    typedef typename Rules::Geometry Geometry;
+    typedef typename Rules::Play Play;
+    typedef typename Rules::Symbols Symbols;
+
+    unsigned long long m_nodes;
+
+    int Negamax(RuleMask_t symbols[2], int side, int ply, int alpha, int beta)
+    {
+        m_nodes++;
+
+        RuleMask_t empty = ~(symbols[0] | symbols[1]) & Geometry::FULL_MASK;
+        if (empty == 0)
+        {
+            return 0;
+        }
+
+        for (RuleMask_t remaining = empty; remaining; remaining &= remaining - 1)
+        {
+            size_t cell = GetLowestBitIndex(remaining);
+            RuleMask_t bit = 1ULL << cell;
+
+            for (int choice = 0; choice < Symbols::CHOICES; choice++)
+            {
+                int symbol = Symbols::GetSymbol(side, choice);
+                RuleMask_t placed = symbols[symbol] | bit;
+
+                int score;
+                if (Rules::CompletesLine(placed, cell))
+                {
+                    score = Play::LineCompletedScore(WIN_SCORE - ply);
+                }
+                else
+                {
+                    symbols[symbol] = placed;
+                    score = -Negamax(symbols, side ^ 1, ply + 1, -beta, -alpha);
+                    symbols[symbol] ^= bit;
+                }
+
+                if (score > alpha)
+                {
+                    alpha = score;
+                    if (alpha >= beta)
+                    {
+                        return alpha;
+                    }
+                }
+            }
+        }
+
+        return alpha;
+    }
+
+public:
+    // Larger than any ply count so quicker wins score higher
+    static const int WIN_SCORE = 100;
+
+    PolicySearch() : m_nodes(0) {}
+
+    unsigned long long GetNodes() const { return m_nodes; }
+
+    // Exact value of the position for the side to move
+    int Solve(RuleMask_t firstSymbol, RuleMask_t secondSymbol, int side)
+    {
+        RuleMask_t symbols[2] = {firstSymbol, secondSymbol};
+        m_nodes = 0;
+        return Negamax(symbols, side, 0, -WIN_SCORE - 1, WIN_SCORE + 1);
+    }
+};
+
+#endif // RULES_H
@@ -0,0 +1,21 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+//------------------------------------------------------------------------
+// x86 intrinsics for the hand-vectorised paths. SIMD_X86 is defined where
+// SSE2 and AVX2 code can be compiled. TARGET_AVX2 marks a function built
+// for AVX2 while the rest of the file keeps the baseline instruction set,
+// so it may only be called once GetBestBatchIsa() has reported AVX2.
+//------------------------------------------------------------------------
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#endif // SIMD_H
@@ -0,0 +1,78 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+//------------------------------------------------------------------------
+// Lock-free single producer / single consumer ring buffer.
+//
+// Storage is a fixed array, so neither side ever allocates or blocks:
+// TryPush fails when the buffer is full and TryPop fails when it is
+// empty. Exactly one thread may push and one thread may pop at a time.
+//------------------------------------------------------------------------
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    // Head and tail live on separate cache lines so the producer and
+    // consumer do not invalidate each other's line on every operation.
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) T m_items[Capacity];
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+
+    // C++11 new ignores the cache line alignment, so a queue on the heap
+    // aligns itself, keeping the start of the block just in front of it
+    static void * operator new(size_t size)
+    {
+        void * block = ::operator new(size + alignof(SpscQueue) + sizeof(void *));
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + sizeof(void *) + alignof(SpscQueue) - 1)
+                            & ~static_cast<uintptr_t>(alignof(SpscQueue) - 1);
+        reinterpret_cast<void **>(aligned)[-1] = block;
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    static void operator delete(void * queue)
+    {
+        if (queue)
+        {
+            ::operator delete(static_cast<void **>(queue)[-1]);
+        }
+    }
+
+    // Producer side
+    bool TryPush(const T & item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool TryPop(T & item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // SPSCQUEUE_H
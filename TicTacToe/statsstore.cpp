@@ -0,0 +1,567 @@
+#include "statsstore.h"
+#include "atomicfile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+const char STATS_SNAPSHOT_MAGIC[8] = {'T', 'T', 'T', 'S', 'T', 'A', 'T', '1'};
+
+// Larger records can only be garbage
+const uint32_t STATS_MAX_RECORD_BYTES = 1 << 20;
+
+// Log records are framed by their payload size and checksum
+const size_t STATS_RECORD_HEADER_BYTES = 2 * sizeof(uint32_t);
+
+//------------------------------------------------------------------------
+// Writes queued games to the log off the UI thread
+//------------------------------------------------------------------------
+class StatsWriter: public QThread
+{
+private:
+    StatsStore & m_store;
+
+public:
+    explicit StatsWriter(StatsStore & store) : QThread(), m_store(store) {}
+
+    void run()
+    {
+        TRACE_THREAD_NAME("StatsWriter");
+        m_store.WriteBatches();
+    }
+};
+
+//------------------------------------------------------------------------
+// Reads fixed size values and strings from a buffer, failing instead of
+// reading past its end
+//------------------------------------------------------------------------
+class StatsReader
+{
+private:
+    const char * m_data;
+    size_t m_size;
+    size_t m_offset;
+
+public:
+    StatsReader(const char * data, size_t size) : m_data(data), m_size(size), m_offset(0) {}
+
+    size_t GetOffset() const { return m_offset; }
+
+    template <typename T> bool Read(T & value)
+    {
+        if (m_size - m_offset < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(&value, m_data + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(std::string & text, size_t length)
+    {
+        if (m_size - m_offset < length)
+        {
+            return false;
+        }
+        text.assign(m_data + m_offset, length);
+        m_offset += length;
+        return true;
+    }
+};
+
+template <typename T> static void Append(std::string & out, const T & value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// FNV-1a, enough to tell a torn or overwritten record from a good one
+static uint32_t Checksum(const char * data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+static bool ReadFile(const std::string & path, std::string & contents)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// Writes under a temporary name and commits, so the file is never seen half written
+static bool ReplaceFile(const std::string & path, const std::string & contents)
+{
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+    file.close();
+    if (!file)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return CommitFile(temporary, path);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : EncodeRecord
+//
+// @description             : Log record of a game: payload size, checksum and
+//                            the payload
+//
+// @return                  : encoded record
+//--------------------------------------------------------------------------------
+static std::string EncodeRecord(const StatsGameRecord & game, uint64_t sequence)
+{
+    std::string payload;
+    Append(payload, sequence);
+    Append(payload, static_cast<uint8_t>(game.winner));
+    for (int side = PLAYER_USER; side <= PLAYER_COMPUTER; side++)
+    {
+        Append(payload, static_cast<uint8_t>(game.players[side].size()));
+        payload += game.players[side];
+        Append(payload, static_cast<uint16_t>(game.latenciesUs[side].size()));
+        for (auto it = game.latenciesUs[side].begin(); it != game.latenciesUs[side].end(); it++)
+        {
+            Append(payload, *it);
+        }
+    }
+
+    std::string record;
+    Append(record, static_cast<uint32_t>(payload.size()));
+    Append(record, Checksum(payload.data(), payload.size()));
+    return record + payload;
+}
+
+static bool DecodeRecord(const char * payload, size_t size, StatsGameRecord & game, uint64_t & sequence)
+{
+    StatsReader reader(payload, size);
+    uint8_t winner;
+    if (!reader.Read(sequence) || !reader.Read(winner) || winner > PLAYER_NONE)
+    {
+        return false;
+    }
+    game.winner = static_cast<Player_t>(winner);
+
+    for (int side = PLAYER_USER; side <= PLAYER_COMPUTER; side++)
+    {
+        uint8_t nameLength;
+        uint16_t moves;
+        if (!reader.Read(nameLength) || !reader.ReadString(game.players[side], nameLength) || !reader.Read(moves))
+        {
+            return false;
+        }
+
+        game.latenciesUs[side].resize(moves);
+        for (size_t i = 0; i < moves; i++)
+        {
+            if (!reader.Read(game.latenciesUs[side][i]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return reader.GetOffset() == size;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetLatencyPercentile
+//
+// @description             : Latency that 'percentile' percent of the timed
+//                            moves stayed below, rounded up to a bucket bound
+//
+// @return                  : microseconds
+//--------------------------------------------------------------------------------
+uint64_t PlayerStats::GetLatencyPercentile(double percentile) const
+{
+    uint64_t wanted = static_cast<uint64_t>(percentile / 100.0 * moves + 0.5);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < STATS_LATENCY_BUCKETS; bucket++)
+    {
+        seen += latencyBuckets[bucket];
+        if (seen >= wanted && seen > 0)
+        {
+            return (bucket == 0) ? 0 : std::min<uint64_t>(1ULL << bucket, maxLatencyUs);
+        }
+    }
+    return maxLatencyUs;
+}
+
+StatsStore::StatsStore(const std::string & prefix)
+{
+    m_snapshotPath = prefix + ".snapshot";
+    m_logPath = prefix + ".log";
+    m_games = 0;
+    m_sequence = 0;
+    m_writtenSequence = 0;
+    m_logRecords = 0;
+    m_bFlushRequested = false;
+    m_bWriteFailed = false;
+    m_bStopping = false;
+
+    Load();
+
+    m_writer = new StatsWriter(*this);
+    m_writer->start();
+}
+
+StatsStore::~StatsStore()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_bStopping = true;
+        m_queued.wakeAll();
+    }
+
+    // Queued games are written before the writer stops
+    m_writer->wait();
+    delete m_writer;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Load
+//
+// @description             : Reads the snapshot and replays the log after it.
+//                            A torn or corrupt record ends the log; it and
+//                            anything after it are cut off so later records
+//                            are appended after the last good one.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void StatsStore::Load()
+{
+    auto start = std::chrono::steady_clock::now();
+    m_loadInfo = StatsLoadInfo();
+
+    std::string snapshot;
+    if (ReadFile(m_snapshotPath, snapshot) && snapshot.size() >= sizeof(uint32_t))
+    {
+        size_t size = snapshot.size() - sizeof(uint32_t);
+        uint32_t checksum;
+        memcpy(&checksum, snapshot.data() + size, sizeof(checksum));
+
+        StatsReader reader(snapshot.data(), size);
+        std::string magic;
+        uint64_t sequence;
+        uint64_t games;
+        uint32_t playerCount;
+        if (checksum == Checksum(snapshot.data(), size) && reader.ReadString(magic, sizeof(STATS_SNAPSHOT_MAGIC)) &&
+            memcmp(magic.data(), STATS_SNAPSHOT_MAGIC, sizeof(STATS_SNAPSHOT_MAGIC)) == 0 &&
+            reader.Read(sequence) && reader.Read(games) && reader.Read(playerCount))
+        {
+            std::map<std::string, PlayerStats> players;
+            bool bValid = true;
+            for (uint32_t i = 0; i < playerCount && bValid; i++)
+            {
+                uint8_t nameLength;
+                std::string name;
+                PlayerStats stats;
+                bValid = reader.Read(nameLength) && reader.ReadString(name, nameLength) && reader.Read(stats);
+                players[name] = stats;
+            }
+
+            if (bValid)
+            {
+                m_players.swap(players);
+                m_games = games;
+                m_sequence = sequence;
+            }
+        }
+    }
+    m_loadInfo.snapshotGames = m_games;
+
+    std::string log;
+    if (ReadFile(m_logPath, log))
+    {
+        size_t offset = 0;
+        while (log.size() - offset >= STATS_RECORD_HEADER_BYTES)
+        {
+            uint32_t size;
+            uint32_t checksum;
+            memcpy(&size, log.data() + offset, sizeof(size));
+            memcpy(&checksum, log.data() + offset + sizeof(size), sizeof(checksum));
+            const char * payload = log.data() + offset + STATS_RECORD_HEADER_BYTES;
+            if (size > STATS_MAX_RECORD_BYTES || log.size() - offset - STATS_RECORD_HEADER_BYTES < size ||
+                Checksum(payload, size) != checksum)
+            {
+                break;
+            }
+
+            StatsGameRecord game;
+            uint64_t sequence;
+            if (!DecodeRecord(payload, size, game, sequence))
+            {
+                break;
+            }
+
+            // Games already folded into the snapshot are in the log too if
+            // the last compaction stopped before emptying it
+            if (sequence > m_sequence)
+            {
+                Apply(game);
+                m_sequence = sequence;
+                m_loadInfo.replayedGames++;
+            }
+            m_logRecords++;
+            offset += STATS_RECORD_HEADER_BYTES + size;
+        }
+
+        if (offset < log.size())
+        {
+            m_loadInfo.droppedBytes = log.size() - offset;
+            ReplaceFile(m_logPath, log.substr(0, offset));
+        }
+    }
+
+    m_writtenSequence = m_sequence;
+    m_loadInfo.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Apply
+//
+// @description             : Adds a game to the totals of both its players
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void StatsStore::Apply(const StatsGameRecord & game)
+{
+    m_games++;
+    for (int side = PLAYER_USER; side <= PLAYER_COMPUTER; side++)
+    {
+        PlayerStats & stats = m_players[game.players[side]];
+        if (game.winner == PLAYER_NONE)
+        {
+            stats.draws++;
+            stats.streak = 0;
+        }
+        else if (game.winner == side)
+        {
+            stats.wins++;
+            stats.streak = (stats.streak > 0) ? stats.streak + 1 : 1;
+            stats.longestWinStreak = std::max<uint64_t>(stats.longestWinStreak, stats.streak);
+        }
+        else
+        {
+            stats.losses++;
+            stats.streak = (stats.streak < 0) ? stats.streak - 1 : -1;
+            stats.longestLossStreak = std::max<uint64_t>(stats.longestLossStreak, -stats.streak);
+        }
+
+        const std::vector<uint32_t> & latencies = game.latenciesUs[side];
+        for (auto it = latencies.begin(); it != latencies.end(); it++)
+        {
+            size_t bucket = 0;
+            for (uint32_t latency = *it; latency > 0 && bucket + 1 < STATS_LATENCY_BUCKETS; latency >>= 1)
+            {
+                bucket++;
+            }
+
+            stats.moves++;
+            stats.totalLatencyUs += *it;
+            stats.maxLatencyUs = std::max<uint64_t>(stats.maxLatencyUs, *it);
+            stats.latencyBuckets[bucket]++;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Record
+//
+// @description             : Adds a finished game. The totals are updated right
+//                            away; the game reaches the log with the writer's
+//                            next batch.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void StatsStore::Record(const StatsGameRecord & game)
+{
+    // Names are stored with a one byte length; replay must see the same name
+    StatsGameRecord stored = game;
+    for (int side = PLAYER_USER; side <= PLAYER_COMPUTER; side++)
+    {
+        stored.players[side] = stored.players[side].substr(0, 255);
+        if (stored.latenciesUs[side].size() > 0xFFFF)
+        {
+            stored.latenciesUs[side].resize(0xFFFF);
+        }
+    }
+
+    QMutexLocker lock(&m_mutex);
+    Apply(stored);
+    m_sequence++;
+    m_pending.push_back(EncodeRecord(stored, m_sequence));
+    m_queued.wakeOne();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Flush
+//
+// @description             : Waits until every game recorded so far is in the
+//                            log on disk, or until an append fails
+//
+// @return                  : true if all of them were written
+//--------------------------------------------------------------------------------
+bool StatsStore::Flush()
+{
+    QMutexLocker lock(&m_mutex);
+    uint64_t target = m_sequence;
+    m_bFlushRequested = true;
+    m_bWriteFailed = false;
+    m_queued.wakeOne();
+    while (m_writtenSequence < target && !m_bWriteFailed)
+    {
+        m_written.wait(&m_mutex);
+    }
+    m_bFlushRequested = false;
+    return m_writtenSequence >= target;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : WriteBatches
+//
+// @description             : Writer thread loop. Waits for games, lets a batch
+//                            build up for a short while, then appends it with
+//                            one write. Once the log is long enough the totals
+//                            that include the batch become the new snapshot
+//                            and the log is emptied.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void StatsStore::WriteBatches()
+{
+    for (;;)
+    {
+        std::vector<std::string> batch;
+        std::map<std::string, PlayerStats> players;
+        uint64_t games = 0;
+        uint64_t sequence;
+        bool bCompact = false;
+        bool bStop;
+        {
+            QMutexLocker lock(&m_mutex);
+            while (m_pending.empty() && !m_bStopping && !m_bFlushRequested)
+            {
+                m_queued.wait(&m_mutex);
+            }
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(STATS_BATCH_MS);
+            while (!m_bStopping && !m_bFlushRequested && m_pending.size() < STATS_BATCH_RECORDS)
+            {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline)
+                {
+                    break;
+                }
+                m_queued.wait(&m_mutex, static_cast<unsigned long>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1);
+            }
+
+            batch.swap(m_pending);
+            sequence = m_sequence;
+            bStop = m_bStopping;
+            if (m_logRecords + batch.size() >= STATS_COMPACT_RECORDS)
+            {
+                // Matches the log once the batch is written
+                bCompact = true;
+                players = m_players;
+                games = m_games;
+            }
+        }
+
+        std::string data;
+        for (auto it = batch.begin(); it != batch.end(); it++)
+        {
+            data += *it;
+        }
+        if (!data.empty() && !AppendFile(m_logPath, data))
+        {
+            // Keep the batch ahead of newer games and try again with them
+            QMutexLocker lock(&m_mutex);
+            m_pending.insert(m_pending.begin(), batch.begin(), batch.end());
+            m_bWriteFailed = true;
+            m_written.wakeAll();
+            if (bStop)
+            {
+                return;
+            }
+            continue;
+        }
+
+        // The snapshot is in place before the log is emptied; a crash in
+        // between leaves records the next load skips by sequence number
+        if (bCompact && WriteSnapshot(players, games, sequence))
+        {
+            std::ofstream log(m_logPath.c_str(), std::ios::binary | std::ios::trunc);
+        }
+        else
+        {
+            bCompact = false;
+        }
+
+        QMutexLocker lock(&m_mutex);
+        m_logRecords = bCompact ? 0 : m_logRecords + batch.size();
+        m_writtenSequence = sequence;
+        m_bWriteFailed = false;
+        m_written.wakeAll();
+        if (bStop && m_pending.empty())
+        {
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : WriteSnapshot
+//
+// @description             : Writes the totals of all games up to 'sequence',
+//                            followed by a checksum of everything before it
+//
+// @return                  : true if the snapshot was replaced
+//--------------------------------------------------------------------------------
+bool StatsStore::WriteSnapshot(const std::map<std::string, PlayerStats> & players, uint64_t games,
+                               uint64_t sequence) const
+{
+    std::string data(STATS_SNAPSHOT_MAGIC, sizeof(STATS_SNAPSHOT_MAGIC));
+    Append(data, sequence);
+    Append(data, games);
+    Append(data, static_cast<uint32_t>(players.size()));
+    for (auto it = players.begin(); it != players.end(); it++)
+    {
+        Append(data, static_cast<uint8_t>(it->first.size()));
+        data += it->first;
+        Append(data, it->second);
+    }
+    Append(data, Checksum(data.data(), data.size()));
+
+    return ReplaceFile(m_snapshotPath, data);
+}
+
+PlayerStats StatsStore::GetPlayerStats(const std::string & name) const
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_players.find(name);
+    return (it != m_players.end()) ? it->second : PlayerStats();
+}
+
+uint64_t StatsStore::GetGameCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_games;
+}
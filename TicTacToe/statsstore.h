@@ -0,0 +1,123 @@
+#ifndef STATSSTORE_H
+#define STATSSTORE_H
+#include "game.h"
+#include <QMutex>
+#include <QWaitCondition>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Default file name prefix, the store uses <prefix>.snapshot and <prefix>.log
+const char STATS_FILE_NAME[] = "tictactoe_stats";
+
+// Move latencies are counted in power of two buckets of microseconds
+const size_t STATS_LATENCY_BUCKETS = 32;
+
+// The log is folded into the snapshot once it holds this many games, which
+// bounds what has to be replayed at startup
+const uint64_t STATS_COMPACT_RECORDS = 4096;
+
+// Games are written at most this long after they are recorded, or as soon
+// as this many are waiting
+const int STATS_BATCH_MS = 250;
+const size_t STATS_BATCH_RECORDS = 256;
+
+//------------------------------------------------------------------------
+// Lifetime results of one player, a person or an engine, over all the
+// games it played on either side
+//------------------------------------------------------------------------
+struct PlayerStats
+{
+    uint64_t wins;
+    uint64_t draws;
+    uint64_t losses;
+    int64_t streak;                     // wins in a row if positive, losses if negative
+    uint64_t longestWinStreak;
+    uint64_t longestLossStreak;
+    uint64_t moves;                     // timed moves
+    uint64_t totalLatencyUs;
+    uint64_t maxLatencyUs;
+    uint64_t latencyBuckets[STATS_LATENCY_BUCKETS];
+
+    uint64_t GetLatencyPercentile(double percentile) const;
+};
+
+//------------------------------------------------------------------------
+// One finished game. Latencies are listed per side, in move order, for
+// the moves the computer chose.
+//------------------------------------------------------------------------
+struct StatsGameRecord
+{
+    std::string players[2];             // by Player_t
+    Player_t winner;                    // PLAYER_NONE for a draw
+    std::vector<uint32_t> latenciesUs[2];
+};
+
+struct StatsLoadInfo
+{
+    uint64_t snapshotGames;             // games folded into the snapshot
+    uint64_t replayedGames;             // games replayed from the log
+    uint64_t droppedBytes;              // torn tail cut off the log
+    double seconds;
+};
+
+class StatsWriter;
+
+//------------------------------------------------------------------------
+// Statistics kept across sessions.
+//
+// Every game is appended to a log as a checksummed record carrying a
+// sequence number. The log is periodically folded into a snapshot of the
+// per-player totals, written under a temporary name and renamed, after
+// which the log is emptied. Opening the store reads the snapshot and
+// replays the short log, so it takes the same time however many games
+// have been played. Records already in the snapshot are skipped, and a
+// record cut short by a crash ends the replay and is cut off the log.
+//
+// Record() only updates the totals in memory and queues the game; a
+// writer thread appends the queued games in batches and syncs the log
+// before they count as written. A batch that fails to append stays
+// queued for the next one.
+//------------------------------------------------------------------------
+class StatsStore
+{
+    friend class StatsWriter;
+
+private:
+    std::string m_snapshotPath;
+    std::string m_logPath;
+    mutable QMutex m_mutex;
+    QWaitCondition m_queued;
+    QWaitCondition m_written;
+    std::map<std::string, PlayerStats> m_players;
+    uint64_t m_games;
+    uint64_t m_sequence;                // of the last game recorded
+    uint64_t m_writtenSequence;         // of the last game in the log
+    uint64_t m_logRecords;
+    std::vector<std::string> m_pending; // encoded records not written yet
+    bool m_bFlushRequested;
+    bool m_bWriteFailed;                // last append did not reach the disk
+    bool m_bStopping;
+    StatsWriter * m_writer;
+    StatsLoadInfo m_loadInfo;
+
+    void Load();
+    void Apply(const StatsGameRecord & game);
+    void WriteBatches();
+    bool WriteSnapshot(const std::map<std::string, PlayerStats> & players, uint64_t games,
+                       uint64_t sequence) const;
+
+public:
+    explicit StatsStore(const std::string & prefix = STATS_FILE_NAME);
+    ~StatsStore();
+
+    void Record(const StatsGameRecord & game);
+    bool Flush();
+
+    PlayerStats GetPlayerStats(const std::string & name) const;
+    uint64_t GetGameCount() const;
+    const StatsLoadInfo & GetLoadInfo() const { return m_loadInfo; }
+};
+
+#endif // STATSSTORE_H
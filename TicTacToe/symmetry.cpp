@@ -0,0 +1,218 @@
+#include "symmetry.h"
+#include "bitboard.h"
+#include <algorithm>
+#include <cassert>
+
+//--------------------------------------------------------------------------------
+// @name                    : TransformCell
+//
+// @description             : Maps a cell through one of the eight symmetries:
+//                            0 identity, 1-3 rotations by 90/180/270 degrees,
+//                            4 horizontal mirror, 5 vertical mirror,
+//                            6 main diagonal, 7 anti-diagonal.
+//
+// @return                  : transformed cell
+//--------------------------------------------------------------------------------
+size_t TransformCell(size_t cell, size_t size, int symmetry)
+{
+    size_t row = cell / size;
+    size_t col = cell % size;
+    size_t last = size - 1;
+
+    switch (symmetry)
+    {
+    case 1:
+        return col * size + (last - row);
+    case 2:
+        return (last - row) * size + (last - col);
+    case 3:
+        return (last - col) * size + row;
+    case 4:
+        return row * size + (last - col);
+    case 5:
+        return (last - row) * size + col;
+    case 6:
+        return col * size + row;
+    case 7:
+        return (last - col) * size + (last - row);
+    default:
+        return cell;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetBoardSymmetries
+//
+// @description             : Finds the symmetries that leave the position
+//                            unchanged. The identity is always among them.
+//
+// @return                  : vector of symmetries
+//--------------------------------------------------------------------------------
+std::vector<int> GetBoardSymmetries(const std::vector<Player_t> & cells, size_t size)
+{
+    std::vector<int> symmetries;
+    for (int symmetry = 0; symmetry < SYMMETRY_COUNT; symmetry++)
+    {
+        bool bPreserved = true;
+        for (size_t cell = 0; cell < cells.size() && bPreserved; cell++)
+        {
+            bPreserved = (cells[TransformCell(cell, size, symmetry)] == cells[cell]);
+        }
+
+        if (bPreserved)
+        {
+            symmetries.push_back(symmetry);
+        }
+    }
+
+    return symmetries;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetSymmetryReducedMoves
+//
+// @description             : Move generator yielding one move per class of moves
+//                            that are equivalent under the position's remaining
+//                            symmetries: the lowest numbered cell of each class.
+//
+// @return                  : vector of positions
+//--------------------------------------------------------------------------------
+std::vector<size_t> GetSymmetryReducedMoves(const std::vector<Player_t> & cells, size_t size)
+{
+    std::vector<int> symmetries = GetBoardSymmetries(cells, size);
+    std::vector<size_t> moves;
+    for (size_t cell = 0; cell < cells.size(); cell++)
+    {
+        if (cells[cell] != PLAYER_NONE)
+        {
+            continue;
+        }
+
+        bool bRepresentative = true;
+        for (auto it = symmetries.begin(); it != symmetries.end() && bRepresentative; it++)
+        {
+            bRepresentative = (TransformCell(cell, size, *it) >= cell);
+        }
+
+        if (bRepresentative)
+        {
+            moves.push_back(cell);
+        }
+    }
+
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetEquivalentMoves
+//
+// @description             : Lists the moves equivalent to 'move' under the
+//                            position's symmetries, 'move' included.
+//
+// @return                  : vector of positions
+//--------------------------------------------------------------------------------
+std::vector<size_t> GetEquivalentMoves(const std::vector<Player_t> & cells, size_t size, size_t move)
+{
+    std::vector<int> symmetries = GetBoardSymmetries(cells, size);
+    std::vector<size_t> moves;
+    for (auto it = symmetries.begin(); it != symmetries.end(); it++)
+    {
+        size_t equivalent = TransformCell(move, size, *it);
+        if (std::find(moves.begin(), moves.end(), equivalent) == moves.end())
+        {
+            moves.push_back(equivalent);
+        }
+    }
+
+    return moves;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SplitMix64
+//
+// @description             : Next value of the SplitMix64 generator, used to
+//                            fill Zobrist tables from a fixed seed
+//
+// @return                  : 64 random bits
+//--------------------------------------------------------------------------------
+uint64_t SplitMix64(uint64_t & state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+CanonicalHasher::CanonicalHasher(size_t width, size_t height, uint64_t seed)
+{
+    m_cells = width * height;
+    m_symmetryCount = (width == height) ? SYMMETRY_COUNT : 1;
+
+    for (size_t i = 0; i < m_cells * 2; i++)
+    {
+        m_zobrist.push_back(SplitMix64(seed));
+    }
+
+    m_transforms.assign(m_cells * SYMMETRY_COUNT, 0);
+    for (size_t cell = 0; cell < m_cells; cell++)
+    {
+        for (int symmetry = 0; symmetry < m_symmetryCount; symmetry++)
+        {
+            m_transforms[cell * SYMMETRY_COUNT + symmetry] = TransformCell(cell, width, symmetry);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetKey
+//
+// @description             : Canonical key of a position, 'own' being the side
+//                            to move. 'symmetry' receives the symmetry that maps
+//                            the position onto its canonical orientation.
+//
+// @return                  : key
+//--------------------------------------------------------------------------------
+uint64_t CanonicalHasher::GetKey(uint64_t own, uint64_t opponent, int & symmetry) const
+{
+    uint64_t best = 0;
+    symmetry = 0;
+    for (int s = 0; s < m_symmetryCount; s++)
+    {
+        uint64_t key = 0;
+        for (uint64_t stones = own; stones; stones &= stones - 1)
+        {
+            key ^= m_zobrist[m_transforms[GetLowestBitIndex(stones) * SYMMETRY_COUNT + s] * 2];
+        }
+        for (uint64_t stones = opponent; stones; stones &= stones - 1)
+        {
+            key ^= m_zobrist[m_transforms[GetLowestBitIndex(stones) * SYMMETRY_COUNT + s] * 2 + 1];
+        }
+
+        if (s == 0 || key < best)
+        {
+            best = key;
+            symmetry = s;
+        }
+    }
+
+    return best;
+}
+
+size_t CanonicalHasher::ToCanonical(size_t cell, int symmetry) const
+{
+    return m_transforms[cell * SYMMETRY_COUNT + symmetry];
+}
+
+size_t CanonicalHasher::FromCanonical(size_t cell, int symmetry) const
+{
+    for (size_t original = 0; original < m_cells; original++)
+    {
+        if (m_transforms[original * SYMMETRY_COUNT + symmetry] == cell)
+        {
+            return original;
+        }
+    }
+
+    assert(0);
+    return cell;
+}
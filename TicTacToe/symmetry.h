@@ -0,0 +1,55 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+#include "game.h"
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------
+// The eight rotations and reflections of a square board. Cells are
+// numbered row by row, so cell = row * size + column.
+//------------------------------------------------------------------------
+const int SYMMETRY_COUNT = 8;
+
+size_t TransformCell(size_t cell, size_t size, int symmetry);
+std::vector<int> GetBoardSymmetries(const std::vector<Player_t> & cells, size_t size);
+std::vector<size_t> GetSymmetryReducedMoves(const std::vector<Player_t> & cells, size_t size);
+std::vector<size_t> GetEquivalentMoves(const std::vector<Player_t> & cells, size_t size, size_t move);
+
+// Seed of the opening book keys, kept fixed so book files stay valid
+const uint64_t BOOK_HASH_SEED = 0xBB67AE8584CAA73BULL;
+
+uint64_t SplitMix64(uint64_t & state);
+
+//------------------------------------------------------------------------
+// Position keys that are equal for all symmetric images of a position.
+// A key is the smallest Zobrist hash over the board's symmetries (eight
+// on square boards, the identity otherwise); the symmetry that gave it
+// maps moves to and from the canonical orientation. The stone keys come
+// from 'seed', so keys written to a file stay valid between runs. Stones
+// are of kind 0 or 1, e.g. own and opponent or first and second player.
+//------------------------------------------------------------------------
+class CanonicalHasher
+{
+private:
+    size_t m_cells;
+    int m_symmetryCount;
+    std::vector<uint64_t> m_zobrist;        // [cell][stone kind]
+    std::vector<size_t> m_transforms;       // [cell][symmetry]
+
+public:
+    CanonicalHasher(size_t width = 0, size_t height = 0, uint64_t seed = BOOK_HASH_SEED);
+
+    int GetSymmetryCount() const { return m_symmetryCount; }
+
+    // Key of a stone of 'kind' on 'cell' in the image under 'symmetry'
+    uint64_t GetStoneKey(size_t cell, int kind, int symmetry) const
+    {
+        return m_zobrist[m_transforms[cell * SYMMETRY_COUNT + symmetry] * 2 + kind];
+    }
+
+    uint64_t GetKey(uint64_t own, uint64_t opponent, int & symmetry) const;
+    size_t ToCanonical(size_t cell, int symmetry) const;
+    size_t FromCanonical(size_t cell, int symmetry) const;
+};
+
+#endif // SYMMETRY_H
@@ -0,0 +1,556 @@
+#include "tablebase.h"
+#include "atomicfile.h"
+#include "bitboard.h"
+#include "mnkgame.h"
+#include "symmetry.h"
+#include <QThread>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+const char TABLEBASE_MAGIC[8] = {'T', 'T', 'T', 'B', 'A', 'S', 'E', '2'};
+
+struct TablebaseHeader
+{
+    char magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint32_t k;
+    uint32_t reserved;
+    uint64_t positions;
+    uint64_t dataOffset;
+    uint64_t movesOffset;
+};
+
+//------------------------------------------------------------------------
+// Binomial coefficients C(n, k) for n, k <= TABLEBASE_MAX_CELLS
+//------------------------------------------------------------------------
+struct BinomialTable
+{
+    uint64_t values[TABLEBASE_MAX_CELLS + 1][TABLEBASE_MAX_CELLS + 1];
+
+    BinomialTable()
+    {
+        for (size_t n = 0; n <= TABLEBASE_MAX_CELLS; n++)
+        {
+            values[n][0] = 1;
+            for (size_t k = 1; k <= TABLEBASE_MAX_CELLS; k++)
+            {
+                values[n][k] = (n == 0) ? 0 : values[n - 1][k - 1] + values[n - 1][k];
+            }
+        }
+    }
+};
+
+static uint64_t Binomial(size_t n, size_t k)
+{
+    static const BinomialTable table;
+    return table.values[n][k];
+}
+
+// Colex rank of the set bits of 'mask' among all k-subsets
+static uint64_t RankCombination(uint32_t mask)
+{
+    uint64_t rank = 0;
+    size_t i = 0;
+    for (; mask; mask &= mask - 1)
+    {
+        rank += Binomial(GetLowestBitIndex(mask), ++i);
+    }
+    return rank;
+}
+
+static uint32_t UnrankCombination(uint64_t rank, size_t k)
+{
+    uint32_t mask = 0;
+    for (size_t i = k; i > 0; i--)
+    {
+        // Largest position p with C(p, i) <= rank
+        size_t p = i - 1;
+        while (Binomial(p + 1, i) <= rank)
+        {
+            p++;
+        }
+        mask |= 1u << p;
+        rank -= Binomial(p, i);
+    }
+    return mask;
+}
+
+static bool HasLine(uint32_t mask, const std::vector<uint64_t> & lines)
+{
+    for (auto it = lines.begin(); it != lines.end(); it++)
+    {
+        if ((mask & *it) == *it)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+TablebaseIndexer::TablebaseIndexer(size_t cells) : m_cells(cells)
+{
+    assert(cells <= TABLEBASE_MAX_CELLS);
+
+    m_layerOffsets.push_back(0);
+    for (size_t stones = 0; stones <= cells; stones++)
+    {
+        size_t first = (stones + 1) / 2;
+        size_t second = stones / 2;
+        m_layerOffsets.push_back(m_layerOffsets.back() + Binomial(cells, first) * Binomial(cells - first, second));
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Rank
+//
+// @description             : Dense index of a position: the layer offset for
+//                            its stone count, then the first player's cells as
+//                            a combination of all cells, then the second
+//                            player's cells as a combination of the rest
+//
+// @return                  : index in [0, GetPositionCount())
+//--------------------------------------------------------------------------------
+uint64_t TablebaseIndexer::Rank(uint32_t first, uint32_t second) const
+{
+    size_t firstCount = CountBits(first);
+    size_t secondCount = CountBits(second);
+    assert(firstCount == secondCount || firstCount == secondCount + 1);
+
+    // The second player's cells renumbered over the cells left free
+    uint32_t compressed = 0;
+    size_t free = 0;
+    for (size_t cell = 0; cell < m_cells; cell++)
+    {
+        if (first & (1u << cell))
+        {
+            continue;
+        }
+        if (second & (1u << cell))
+        {
+            compressed |= 1u << free;
+        }
+        free++;
+    }
+
+    return m_layerOffsets[firstCount + secondCount] +
+           RankCombination(first) * Binomial(m_cells - firstCount, secondCount) + RankCombination(compressed);
+}
+
+void TablebaseIndexer::Unrank(uint64_t index, size_t stones, uint32_t & first, uint32_t & second) const
+{
+    size_t firstCount = (stones + 1) / 2;
+    size_t secondCount = stones / 2;
+    uint64_t local = index - m_layerOffsets[stones];
+    uint64_t secondCombinations = Binomial(m_cells - firstCount, secondCount);
+
+    first = UnrankCombination(local / secondCombinations, firstCount);
+    uint32_t compressed = UnrankCombination(local % secondCombinations, secondCount);
+
+    second = 0;
+    size_t free = 0;
+    for (size_t cell = 0; cell < m_cells; cell++)
+    {
+        if (first & (1u << cell))
+        {
+            continue;
+        }
+        if (compressed & (1u << free))
+        {
+            second |= 1u << cell;
+        }
+        free++;
+    }
+}
+
+//------------------------------------------------------------------------
+// Solves one slice of a layer. All positions with one more stone are
+// already solved, so the slices of a layer run in parallel.
+//------------------------------------------------------------------------
+class TablebaseWorker: public QThread
+{
+private:
+    const TablebaseIndexer & m_indexer;
+    const std::vector<uint64_t> & m_lines;
+    std::vector<uint8_t> & m_values;
+    std::vector<uint8_t> & m_moves;
+    size_t m_cells;
+    size_t m_stones;
+    uint64_t m_begin;
+    uint64_t m_end;
+
+    // 'move' is left at 0 for positions without a move
+    uint8_t Solve(uint64_t index, uint8_t & move) const
+    {
+        uint32_t first;
+        uint32_t second;
+        m_indexer.Unrank(index, m_stones, first, second);
+
+        bool bFirstToMove = (m_stones % 2 == 0);
+        uint32_t mover = bFirstToMove ? first : second;
+        uint32_t previous = bFirstToMove ? second : first;
+
+        if (HasLine(mover, m_lines))
+        {
+            return TABLEBASE_ILLEGAL;
+        }
+        if (HasLine(previous, m_lines))
+        {
+            return TABLEBASE_LOSS;
+        }
+        if (m_stones == m_cells)
+        {
+            return TABLEBASE_DRAW;
+        }
+
+        // An immediate win is kept over a longer one, so games end early
+        uint8_t best = TABLEBASE_LOSS;
+        uint32_t empty = ~(first | second) & ((1u << m_cells) - 1);
+        move = static_cast<uint8_t>(GetLowestBitIndex(empty));
+        for (; empty; empty &= empty - 1)
+        {
+            uint32_t bit = empty & (0u - empty);
+            uint8_t cell = static_cast<uint8_t>(GetLowestBitIndex(bit));
+            if (HasLine(mover | bit, m_lines))
+            {
+                move = cell;
+                return TABLEBASE_WIN;
+            }
+
+            uint64_t child = bFirstToMove ? m_indexer.Rank(first | bit, second) : m_indexer.Rank(first, second | bit);
+            uint8_t value = m_values[child];
+            if (value == TABLEBASE_LOSS && best != TABLEBASE_WIN)
+            {
+                best = TABLEBASE_WIN;
+                move = cell;
+            }
+            else if (value == TABLEBASE_DRAW && best == TABLEBASE_LOSS)
+            {
+                best = TABLEBASE_DRAW;
+                move = cell;
+            }
+        }
+
+        return best;
+    }
+
+public:
+    TablebaseWorker(const TablebaseIndexer & indexer, const std::vector<uint64_t> & lines,
+                    std::vector<uint8_t> & values, std::vector<uint8_t> & moves, size_t cells, size_t stones,
+                    uint64_t begin, uint64_t end)
+        : QThread(), m_indexer(indexer), m_lines(lines), m_values(values), m_moves(moves), m_cells(cells),
+          m_stones(stones), m_begin(begin), m_end(end)
+    {
+    }
+
+    void run()
+    {
+        for (uint64_t index = m_begin; index < m_end; index++)
+        {
+            uint8_t move = 0;
+            m_values[index] = Solve(index, move);
+            m_moves[index] = move;
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : GetTablebaseFileName
+//
+// @description             : Default file name of a board's tablebase
+//
+// @return                  : e.g. "tictactoe_3x3x3.tb"
+//--------------------------------------------------------------------------------
+std::string GetTablebaseFileName(size_t width, size_t height, size_t k)
+{
+    std::ostringstream name;
+    name << "tictactoe_" << width << "x" << height << "x" << k << ".tb";
+    return name.str();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GenerateTablebase
+//
+// @description             : Solves every position of the board by retrograde
+//                            analysis, from the full board back to the empty
+//                            one, with each layer split over 'threads' threads.
+//                            A best move is kept for every position beside its
+//                            value. The file is written under a temporary name and
+//                            renamed once complete.
+//
+// @return                  : true if the file was written
+//--------------------------------------------------------------------------------
+bool GenerateTablebase(size_t width, size_t height, size_t k, const std::string & path,
+                       size_t threads, TablebaseStats & stats)
+{
+    size_t cells = width * height;
+    assert(cells <= TABLEBASE_MAX_CELLS && threads > 0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    TablebaseIndexer indexer(cells);
+    std::vector<uint64_t> lines = GetMnkLineMasks(width, height, k);
+    std::vector<uint8_t> values(indexer.GetPositionCount());
+    std::vector<uint8_t> moves(indexer.GetPositionCount());
+
+    for (size_t stones = cells + 1; stones-- > 0; )
+    {
+        uint64_t begin = indexer.GetLayerOffset(stones);
+        uint64_t size = indexer.GetLayerSize(stones);
+        size_t workerCount = static_cast<size_t>(std::min<uint64_t>(threads, size));
+
+        std::vector<TablebaseWorker *> workers;
+        for (size_t i = 0; i < workerCount; i++)
+        {
+            uint64_t sliceBegin = begin + size * i / workerCount;
+            uint64_t sliceEnd = begin + size * (i + 1) / workerCount;
+            workers.push_back(new TablebaseWorker(indexer, lines, values, moves, cells, stones,
+                                                   sliceBegin, sliceEnd));
+            workers.back()->start();
+        }
+        for (auto it = workers.begin(); it != workers.end(); it++)
+        {
+            (*it)->wait();
+            delete *it;
+        }
+    }
+
+    // Four values per byte, lowest bits first
+    std::vector<uint8_t> packed((values.size() + 3) / 4, 0);
+    memset(stats.counts, 0, sizeof(stats.counts));
+    for (uint64_t index = 0; index < values.size(); index++)
+    {
+        packed[index >> 2] |= static_cast<uint8_t>(values[index] << ((index & 3) * 2));
+        stats.counts[values[index]]++;
+    }
+
+    // Two moves per byte, lowest bits first
+    std::vector<uint8_t> packedMoves((moves.size() + 1) / 2, 0);
+    for (uint64_t index = 0; index < moves.size(); index++)
+    {
+        packedMoves[index >> 1] |= static_cast<uint8_t>(moves[index] << ((index & 1) * 4));
+    }
+
+    TablebaseHeader header;
+    memcpy(header.magic, TABLEBASE_MAGIC, sizeof(header.magic));
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.k = static_cast<uint32_t>(k);
+    header.reserved = 0;
+    header.positions = values.size();
+    header.dataOffset = sizeof(TablebaseHeader);
+    header.movesOffset = header.dataOffset + packed.size();
+
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(packed.data()), packed.size());
+    file.write(reinterpret_cast<const char *>(packedMoves.data()), packedMoves.size());
+    file.close();
+    if (!file)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    if (!CommitFile(temporary, path))
+    {
+        return false;
+    }
+
+    stats.positions = values.size();
+    stats.fileBytes = sizeof(header) + packed.size() + packedMoves.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+Tablebase::Tablebase()
+{
+    m_mapping = nullptr;
+    m_values = nullptr;
+    m_moves = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_k = 0;
+}
+
+Tablebase::~Tablebase()
+{
+    Close();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Open
+//
+// @description             : Maps a tablebase file into memory. Only the header
+//                            is checked; the values are read straight from the
+//                            mapping, so pages load on first probe.
+//
+// @return                  : true if the file is a valid tablebase
+//--------------------------------------------------------------------------------
+bool Tablebase::Open(const std::string & path)
+{
+    Close();
+
+    m_file.setFileName(QString::fromStdString(path));
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < static_cast<qint64>(sizeof(TablebaseHeader)))
+    {
+        Close();
+        return false;
+    }
+
+    m_mapping = m_file.map(0, m_file.size());
+    if (!m_mapping)
+    {
+        Close();
+        return false;
+    }
+
+    TablebaseHeader header;
+    memcpy(&header, m_mapping, sizeof(header));
+    size_t cells = static_cast<size_t>(header.width) * header.height;
+    if (memcmp(header.magic, TABLEBASE_MAGIC, sizeof(header.magic)) != 0 || cells == 0 ||
+        cells > TABLEBASE_MAX_CELLS)
+    {
+        Close();
+        return false;
+    }
+
+    m_indexer = TablebaseIndexer(cells);
+    uint64_t dataBytes = (m_indexer.GetPositionCount() + 3) / 4;
+    uint64_t movesBytes = (m_indexer.GetPositionCount() + 1) / 2;
+    if (header.positions != m_indexer.GetPositionCount() ||
+        static_cast<uint64_t>(m_file.size()) < header.dataOffset + dataBytes ||
+        static_cast<uint64_t>(m_file.size()) < header.movesOffset + movesBytes)
+    {
+        Close();
+        return false;
+    }
+
+    m_width = header.width;
+    m_height = header.height;
+    m_k = header.k;
+    m_lines = GetMnkLineMasks(m_width, m_height, m_k);
+    m_values = m_mapping + header.dataOffset;
+    m_moves = m_mapping + header.movesOffset;
+    return true;
+}
+
+void Tablebase::Close()
+{
+    if (m_mapping)
+    {
+        m_file.unmap(m_mapping);
+    }
+    m_file.close();
+    m_mapping = nullptr;
+    m_values = nullptr;
+    m_moves = nullptr;
+}
+
+bool Tablebase::HasLine(uint32_t mask) const
+{
+    return ::HasLine(mask, m_lines);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Probe
+//
+// @description             : Value of a position for the side to move, given
+//                            as the first and second player's stones
+//
+// @return                  : TablebaseValue_t
+//--------------------------------------------------------------------------------
+TablebaseValue_t Tablebase::Probe(uint32_t first, uint32_t second) const
+{
+    assert(IsOpen());
+
+    uint64_t index = m_indexer.Rank(first, second);
+    return static_cast<TablebaseValue_t>((m_values[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+TablebaseValue_t Tablebase::Probe(const std::vector<Player_t> & cells, Player_t turn) const
+{
+    uint64_t index;
+    if (!GetIndex(cells, turn, index))
+    {
+        return TABLEBASE_ILLEGAL;
+    }
+    return static_cast<TablebaseValue_t>((m_values[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetIndex
+//
+// @description             : Index of a position given as cells, with 'turn'
+//                            to move
+//
+// @return                  : false if the stone counts do not fit 'turn'
+//--------------------------------------------------------------------------------
+bool Tablebase::GetIndex(const std::vector<Player_t> & cells, Player_t turn, uint64_t & index) const
+{
+    assert(IsOpen() && cells.size() == m_width * m_height);
+
+    uint32_t own = 0;
+    uint32_t other = 0;
+    for (size_t cell = 0; cell < cells.size(); cell++)
+    {
+        if (cells[cell] == turn)
+        {
+            own |= 1u << cell;
+        }
+        else if (cells[cell] != PLAYER_NONE)
+        {
+            other |= 1u << cell;
+        }
+    }
+
+    // The side to move moved first exactly when both have as many stones
+    size_t ownCount = CountBits(own);
+    size_t otherCount = CountBits(other);
+    if (ownCount == otherCount)
+    {
+        index = m_indexer.Rank(own, other);
+        return true;
+    }
+    if (otherCount == ownCount + 1)
+    {
+        index = m_indexer.Rank(other, own);
+        return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Perfect move for 'turn', read with a single probe
+//                            of the stored best moves. On a square board one of
+//                            the moves equivalent to it by symmetry is chosen
+//                            at random, so play still varies.
+//
+// @return                  : cell of the move
+//--------------------------------------------------------------------------------
+size_t Tablebase::SelectMove(const std::vector<Player_t> & cells, Player_t turn, std::mt19937 & rng) const
+{
+    uint64_t index;
+    bool bIndexed = GetIndex(cells, turn, index);
+    assert(bIndexed);
+    (void)bIndexed;
+
+    size_t move = (m_moves[index >> 1] >> ((index & 1) * 4)) & 15;
+    assert(cells[move] == PLAYER_NONE);
+    if (m_width != m_height)
+    {
+        return move;
+    }
+
+    std::vector<size_t> equivalentMoves = GetEquivalentMoves(cells, m_width, move);
+    std::uniform_int_distribution<size_t> pick(0, equivalentMoves.size() - 1);
+    return equivalentMoves[pick(rng)];
+}
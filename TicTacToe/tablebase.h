@@ -0,0 +1,96 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+#include "game.h"
+#include <QFile>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Tablebases for boards small enough to enumerate (up to 4x4).
+//
+// Every position is given a dense index by a perfect ranking: positions
+// are grouped by stone count, and inside a group the first player's cells
+// and then the second player's cells are ranked as combinations. Values
+// are computed backwards from the full board, one stone count at a time,
+// and stored at 2 bits per position, followed by a best move per
+// position at 4 bits. The file is used through a memory mapping, so
+// opening it costs no parsing and a probe is one byte read.
+//------------------------------------------------------------------------
+typedef enum TablebaseValue_tag
+{
+    TABLEBASE_DRAW,
+    TABLEBASE_WIN,      // for the side to move
+    TABLEBASE_LOSS,
+    TABLEBASE_ILLEGAL   // cannot arise in play
+}TablebaseValue_t;
+
+const size_t TABLEBASE_MAX_CELLS = 16;
+
+//------------------------------------------------------------------------
+// Perfect ranking of positions on a board of 'cells' cells. Positions are
+// given as two masks: the stones of the player who moved first and the
+// stones of the player who moved second.
+//------------------------------------------------------------------------
+class TablebaseIndexer
+{
+private:
+    size_t m_cells;
+    std::vector<uint64_t> m_layerOffsets;
+
+public:
+    explicit TablebaseIndexer(size_t cells = 0);
+
+    uint64_t GetPositionCount() const { return m_layerOffsets.back(); }
+    uint64_t GetLayerOffset(size_t stones) const { return m_layerOffsets[stones]; }
+    uint64_t GetLayerSize(size_t stones) const { return m_layerOffsets[stones + 1] - m_layerOffsets[stones]; }
+    uint64_t Rank(uint32_t first, uint32_t second) const;
+    void Unrank(uint64_t index, size_t stones, uint32_t & first, uint32_t & second) const;
+};
+
+struct TablebaseStats
+{
+    uint64_t positions;
+    uint64_t counts[4];
+    uint64_t fileBytes;
+    double seconds;
+};
+
+class Tablebase
+{
+private:
+    QFile m_file;
+    uchar * m_mapping;
+    const uchar * m_values;
+    const uchar * m_moves;
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    TablebaseIndexer m_indexer;
+    std::vector<uint64_t> m_lines;
+
+    bool HasLine(uint32_t mask) const;
+    bool GetIndex(const std::vector<Player_t> & cells, Player_t turn, uint64_t & index) const;
+
+public:
+    Tablebase();
+    ~Tablebase();
+
+    bool Open(const std::string & path);
+    void Close();
+    bool IsOpen() const { return m_values != nullptr; }
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetK() const { return m_k; }
+
+    TablebaseValue_t Probe(uint32_t first, uint32_t second) const;
+    TablebaseValue_t Probe(const std::vector<Player_t> & cells, Player_t turn) const;
+    size_t SelectMove(const std::vector<Player_t> & cells, Player_t turn, std::mt19937 & rng) const;
+};
+
+std::string GetTablebaseFileName(size_t width, size_t height, size_t k);
+bool GenerateTablebase(size_t width, size_t height, size_t k, const std::string & path,
+                       size_t threads, TablebaseStats & stats);
+
+#endif // TABLEBASE_H
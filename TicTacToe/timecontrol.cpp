@@ -0,0 +1,101 @@
+#include "timecontrol.h"
+#include <algorithm>
+
+//--------------------------------------------------------------------------------
+// @name                    : AllocateMoveTime
+//
+// @description             : Splits the time left evenly over the moves still
+//                            to play and adds most of the increment. With few
+//                            moves left each one gets a larger share. The hard
+//                            limit leaves CLOCK_MARGIN_MS on the clock, so an
+//                            engine that honours it never runs out of time.
+//
+// @return                  : MoveTime
+//--------------------------------------------------------------------------------
+MoveTime AllocateMoveTime(int remainingMs, int incrementMs, int movesLeft)
+{
+    int usableMs = std::max(remainingMs - CLOCK_MARGIN_MS, 1);
+    movesLeft = std::max(movesLeft, 1);
+
+    MoveTime moveTime;
+    moveTime.softMs = std::min(usableMs / movesLeft + incrementMs * 3 / 4, usableMs);
+    moveTime.softMs = std::max(moveTime.softMs, 1);
+    moveTime.hardMs = std::min(moveTime.softMs * HARD_LIMIT_FACTOR, usableMs);
+    return moveTime;
+}
+
+GameClock::GameClock()
+{
+    TimeControl untimed = {0, 0};
+    Reset(untimed);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Reset
+//
+// @description             : Stops both clocks and sets them to the base time
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameClock::Reset(const TimeControl & control)
+{
+    m_control = control;
+    m_remainingMs[PLAYER_USER] = control.baseMs;
+    m_remainingMs[PLAYER_COMPUTER] = control.baseMs;
+    m_running = PLAYER_NONE;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Start
+//
+// @description             : Starts 'player's clock, stopping the other one
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameClock::Start(Player_t player)
+{
+    Stop();
+    m_running = player;
+    m_started = std::chrono::steady_clock::now();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Stop
+//
+// @description             : Charges the running player for the time since
+//                            Start and gives them the increment, unless they
+//                            have flagged. Nothing happens if no clock is
+//                            running.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameClock::Stop()
+{
+    if (m_running == PLAYER_NONE)
+    {
+        return;
+    }
+
+    int remainingMs = GetRemainingMs(m_running);
+    m_remainingMs[m_running] = (remainingMs > 0) ? remainingMs + m_control.incrementMs : 0;
+    m_running = PLAYER_NONE;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetRemainingMs
+//
+// @description             : Time left on 'player's clock, counting the move in
+//                            progress if their clock is running
+//
+// @return                  : milliseconds, 0 once the player has flagged
+//--------------------------------------------------------------------------------
+int GameClock::GetRemainingMs(Player_t player) const
+{
+    int remainingMs = m_remainingMs[player];
+    if (player == m_running)
+    {
+        remainingMs -= static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_started).count());
+    }
+    return std::max(remainingMs, 0);
+}
@@ -0,0 +1,60 @@
+#ifndef TIMECONTROL_H
+#define TIMECONTROL_H
+#include "game.h"
+#include <chrono>
+
+// Kept in hand on every move for the latency between the engine returning
+// and the clock being stopped
+const int CLOCK_MARGIN_MS = 50;
+
+// The hard limit of a move is at most this many times its soft limit
+const int HARD_LIMIT_FACTOR = 4;
+
+//------------------------------------------------------------------------
+// Chess style time control: every player starts with 'baseMs' and gets
+// 'incrementMs' back after each move. A base of 0 means untimed.
+//------------------------------------------------------------------------
+struct TimeControl
+{
+    int baseMs;
+    int incrementMs;
+};
+
+//------------------------------------------------------------------------
+// Time given to an engine for one move. The engine aims for 'softMs',
+// stretching or shortening it depending on how the search goes, and
+// never runs past 'hardMs'. 0 for both means no limit.
+//------------------------------------------------------------------------
+struct MoveTime
+{
+    int softMs;
+    int hardMs;
+};
+
+MoveTime AllocateMoveTime(int remainingMs, int incrementMs, int movesLeft);
+
+//------------------------------------------------------------------------
+// The two clocks of a game. At most one of them runs at a time. Stopping
+// a clock charges the time used and adds the increment.
+//------------------------------------------------------------------------
+class GameClock
+{
+private:
+    TimeControl m_control;
+    int m_remainingMs[2];
+    Player_t m_running;
+    std::chrono::steady_clock::time_point m_started;
+
+public:
+    GameClock();
+
+    void Reset(const TimeControl & control);
+    bool IsTimed() const { return m_control.baseMs > 0; }
+    const TimeControl & GetControl() const { return m_control; }
+    void Start(Player_t player);
+    void Stop();
+    Player_t GetRunning() const { return m_running; }
+    int GetRemainingMs(Player_t player) const;
+};
+
+#endif // TIMECONTROL_H
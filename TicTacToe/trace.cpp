@@ -0,0 +1,167 @@
+#include "trace.h"
+
+#ifdef TICTACTOE_TRACE
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct TraceEvent
+{
+    const char * name;
+    long long startUs;
+    long long durationUs;
+};
+
+//------------------------------------------------------------------------
+// Events of one thread. Buffers are owned by the registry so they outlive
+// the threads that filled them. A buffer is handed back when its thread
+// exits and the next new thread appends to it, so a new thread per move
+// keeps reusing one track instead of adding a buffer every time.
+//------------------------------------------------------------------------
+struct TraceBuffer
+{
+    size_t threadId;
+    const char * threadName;
+    bool bInUse;
+    std::vector<TraceEvent> events;
+};
+
+static std::mutex s_registryMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> s_buffers;
+static thread_local TraceBuffer * t_buffer = nullptr;
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+//------------------------------------------------------------------------
+// Hands the calling thread's buffer back to the registry at thread exit
+//------------------------------------------------------------------------
+struct TraceBufferRelease
+{
+    ~TraceBufferRelease()
+    {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        t_buffer->bInUse = false;
+        t_buffer = nullptr;
+    }
+};
+
+static long long NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetThreadBuffer
+//
+// @description             : Fetches the calling thread's buffer on first use,
+//                            taking over the buffer of a thread that has exited
+//                            or registering a new one. Only this first call
+//                            takes the lock.
+//
+// @return                  : TraceBuffer
+//--------------------------------------------------------------------------------
+static TraceBuffer * GetThreadBuffer()
+{
+    if (!t_buffer)
+    {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (auto it = s_buffers.begin(); it != s_buffers.end(); it++)
+        {
+            if (!(*it)->bInUse)
+            {
+                // The events stay on the track, the old thread's name does not
+                t_buffer = it->get();
+                t_buffer->threadName = nullptr;
+                break;
+            }
+        }
+
+        if (!t_buffer)
+        {
+            std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+            buffer->threadId = s_buffers.size() + 1;
+            buffer->threadName = nullptr;
+            t_buffer = buffer.get();
+            s_buffers.push_back(std::move(buffer));
+        }
+        t_buffer->bInUse = true;
+
+        // Constructed here, so destroyed when this thread exits
+        static thread_local TraceBufferRelease release;
+        (void)release;
+    }
+
+    return t_buffer;
+}
+
+ScopedTrace::ScopedTrace(const char * name)
+{
+    m_name = name;
+    m_startUs = NowUs();
+}
+
+ScopedTrace::~ScopedTrace()
+{
+    TraceEvent event;
+    event.name = m_name;
+    event.startUs = m_startUs;
+    event.durationUs = NowUs() - m_startUs;
+    GetThreadBuffer()->events.push_back(event);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SetTraceThreadName
+//
+// @description             : Labels the calling thread in the trace viewer. The
+//                            name must outlive the trace (e.g. a literal).
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void SetTraceThreadName(const char * name)
+{
+    GetThreadBuffer()->threadName = name;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : WriteTrace
+//
+// @description             : Writes every recorded event as Chrome trace JSON
+//                            ("X" complete events, one track per thread).
+//
+// @return                  : true if the file was written
+//--------------------------------------------------------------------------------
+bool WriteTrace(const char * path)
+{
+    FILE * file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    const char * separator = "";
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (auto it = s_buffers.begin(); it != s_buffers.end(); it++)
+    {
+        const TraceBuffer & buffer = **it;
+        if (buffer.threadName)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                    separator, buffer.threadId, buffer.threadName);
+            separator = ",\n";
+        }
+
+        for (auto event = buffer.events.begin(); event != buffer.events.end(); event++)
+        {
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%lld,\"dur\":%lld}",
+                    separator, event->name, buffer.threadId, event->startUs, event->durationUs);
+            separator = ",\n";
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    return fclose(file) == 0;
+}
+
+#endif // TICTACTOE_TRACE
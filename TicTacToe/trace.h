@@ -0,0 +1,46 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+//------------------------------------------------------------------------
+// Scoped profiling events written as Chrome trace JSON (chrome://tracing,
+// Perfetto). Build with "qmake CONFIG+=trace" to enable; otherwise the
+// macros expand to nothing and cost nothing.
+//
+//   TRACE_SCOPE("name")          time the enclosing scope
+//   TRACE_THREAD_NAME("name")    label the calling thread in the viewer
+//   TRACE_FLUSH("file.json")     write all events recorded so far
+//
+// Each thread appends to its own buffer, so recording takes no locks.
+// Flush once the traced threads are idle, e.g. at exit.
+//------------------------------------------------------------------------
+#ifdef TICTACTOE_TRACE
+
+class ScopedTrace
+{
+private:
+    const char * m_name;
+    long long m_startUs;
+
+public:
+    explicit ScopedTrace(const char * name);
+    ~ScopedTrace();
+};
+
+void SetTraceThreadName(const char * name);
+bool WriteTrace(const char * path);
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) ScopedTrace TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) SetTraceThreadName(name)
+#define TRACE_FLUSH(path) WriteTrace(path)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#define TRACE_FLUSH(path) do {} while (0)
+
+#endif // TICTACTOE_TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,640 @@
+#include "ultimate.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+// Iterations between two reads of the clock
+const unsigned long long ULTIMATE_TIME_CHECK = 256;
+
+const int ULTIMATE_WIN_SCORE = 10000;
+const int ULTIMATE_INFINITY = ULTIMATE_WIN_SCORE + 1;
+
+// Scores above this are wins found by search rather than evaluations
+const int ULTIMATE_PROVEN_SCORE = ULTIMATE_WIN_SCORE - 100;
+
+// Value of a sub-board won, and of an open line of the big board or of an
+// open sub-board holding 0, 1 or 2 marks of one player
+const int ULTIMATE_BOARD_SCORE = 60;
+const int ULTIMATE_BIG_LINE_WEIGHTS[3] = {0, 20, 120};
+const int ULTIMATE_LINE_WEIGHTS[3] = {0, 1, 6};
+
+//------------------------------------------------------------------------
+// The squares of every 3x3 mask as a list, so that a playout turns the
+// index of a random empty square into the square with one lookup
+//------------------------------------------------------------------------
+struct SquareTable
+{
+    uint8_t squares[FULL_BOARD_MASK + 1][ULTIMATE_BOARDS];
+
+    SquareTable()
+    {
+        for (size_t mask = 0; mask <= FULL_BOARD_MASK; mask++)
+        {
+            size_t count = 0;
+            for (size_t square = 0; square < ULTIMATE_BOARDS; square++)
+            {
+                if (mask & (1u << square))
+                {
+                    squares[mask][count++] = static_cast<uint8_t>(square);
+                }
+            }
+        }
+    }
+};
+
+static const SquareTable SQUARE_TABLE;
+
+UltimateGame::UltimateGame(Player_t firstPlayer)
+{
+    for (size_t board = 0; board < ULTIMATE_BOARDS; board++)
+    {
+        m_boards[PLAYER_USER][board] = 0;
+        m_boards[PLAYER_COMPUTER][board] = 0;
+        m_empty[board] = FULL_BOARD_MASK;
+        m_emptyCount[board] = 9;
+    }
+    m_openCells = static_cast<uint8_t>(ULTIMATE_CELLS);
+    m_won[PLAYER_USER] = 0;
+    m_won[PLAYER_COMPUTER] = 0;
+    m_closed = 0;
+    m_nextBoard = ULTIMATE_ANY_BOARD;
+    m_turn = static_cast<uint8_t>(firstPlayer);
+    m_winner = PLAYER_NONE;
+    m_moveCount = 0;
+}
+
+Player_t UltimateGame::GetCell(size_t cell) const
+{
+    BoardMask_t bit = static_cast<BoardMask_t>(1u << (cell % 9));
+    if (m_boards[PLAYER_USER][cell / 9] & bit)
+    {
+        return PLAYER_USER;
+    }
+    if (m_boards[PLAYER_COMPUTER][cell / 9] & bit)
+    {
+        return PLAYER_COMPUTER;
+    }
+    return PLAYER_NONE;
+}
+
+Player_t UltimateGame::GetBoardWinner(size_t board) const
+{
+    if (m_won[PLAYER_USER] & (1u << board))
+    {
+        return PLAYER_USER;
+    }
+    if (m_won[PLAYER_COMPUTER] & (1u << board))
+    {
+        return PLAYER_COMPUTER;
+    }
+    return PLAYER_NONE;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : IsLegalMove
+//
+// @description             : Empty cell on an open sub-board the side to move
+//                            may play on
+//
+// @return                  : true/false
+//--------------------------------------------------------------------------------
+bool UltimateGame::IsLegalMove(size_t cell) const
+{
+    size_t board = cell / 9;
+    if (cell >= ULTIMATE_CELLS || GameOver() || (m_closed & (1u << board)))
+    {
+        return false;
+    }
+    if (m_nextBoard != ULTIMATE_ANY_BOARD && m_nextBoard != board)
+    {
+        return false;
+    }
+    return (m_empty[board] & (1u << (cell % 9))) != 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetMoves
+//
+// @description             : Writes the legal cells to 'moves', which must
+//                            hold ULTIMATE_CELLS entries
+//
+// @return                  : number of moves
+//--------------------------------------------------------------------------------
+size_t UltimateGame::GetMoves(uint8_t * moves) const
+{
+    if (GameOver())
+    {
+        return 0;
+    }
+
+    size_t first = (m_nextBoard == ULTIMATE_ANY_BOARD) ? 0 : m_nextBoard;
+    size_t last = (m_nextBoard == ULTIMATE_ANY_BOARD) ? ULTIMATE_BOARDS - 1 : m_nextBoard;
+    size_t count = 0;
+    for (size_t board = first; board <= last; board++)
+    {
+        BoardMask_t empty = m_empty[board];
+        for (size_t i = 0; i < m_emptyCount[board]; i++)
+        {
+            moves[count++] = static_cast<uint8_t>(board * 9 + SQUARE_TABLE.squares[empty][i]);
+        }
+    }
+
+    return count;
+}
+
+std::vector<size_t> UltimateGame::GetAvailableMoves() const
+{
+    uint8_t moves[ULTIMATE_CELLS];
+    size_t count = GetMoves(moves);
+    return std::vector<size_t>(moves, moves + count);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Play
+//
+// @description             : Marks 'square' of 'board' for the side to move,
+//                            resolves the sub-board and the big board through
+//                            the 3x3 win lookup and picks the next sub-board.
+//                            A won sub-board gives up its empty squares.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateGame::Play(size_t board, size_t square)
+{
+    size_t side = m_turn;
+    BoardMask_t boardBit = static_cast<BoardMask_t>(1u << board);
+    BoardMask_t mask = m_boards[side][board] |= static_cast<BoardMask_t>(1u << square);
+    m_empty[board] &= static_cast<BoardMask_t>(~(1u << square));
+    m_emptyCount[board]--;
+    m_openCells--;
+
+    if (IsWinMask(mask))
+    {
+        m_won[side] |= boardBit;
+        m_closed |= boardBit;
+        m_openCells = static_cast<uint8_t>(m_openCells - m_emptyCount[board]);
+        m_empty[board] = 0;
+        m_emptyCount[board] = 0;
+        if (IsWinMask(m_won[side]))
+        {
+            m_winner = static_cast<uint8_t>(side);
+        }
+    }
+    else if (m_emptyCount[board] == 0)
+    {
+        m_closed |= boardBit;
+    }
+
+    m_nextBoard = (m_closed & (1u << square)) ? ULTIMATE_ANY_BOARD : static_cast<uint8_t>(square);
+    m_turn = static_cast<uint8_t>(1 - side);
+    m_moveCount++;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AddPlayerMarkToBoard
+//
+// @description             : Mark the move of the side to move on the board. It
+//                            also determines if the player has won.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateGame::AddPlayerMarkToBoard(size_t cell)
+{
+    assert(IsLegalMove(cell));
+    Play(cell / 9, cell % 9);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayRandom
+//
+// @description             : Plays uniformly random legal moves until the game
+//                            is over. When every open sub-board is allowed a
+//                            number below the count of open cells is walked
+//                            through the per sub-board counts, so each legal
+//                            move is as likely as any other. The moves are
+//                            those of Play with the side to move, the next
+//                            sub-board and the counters kept in registers and
+//                            written back at the end.
+//
+// @return                  : winner, PLAYER_NONE for a draw
+//--------------------------------------------------------------------------------
+Player_t UltimateGame::PlayRandom(UltimateRng & rng)
+{
+    UltimateRng random = rng;
+    size_t side = m_turn;
+    size_t board = m_nextBoard;
+    size_t winner = m_winner;
+    size_t openCells = m_openCells;
+    size_t moveCount = m_moveCount;
+    BoardMask_t closed = m_closed;
+
+    while (winner == PLAYER_NONE && closed != FULL_BOARD_MASK)
+    {
+        size_t index;
+        if (board == ULTIMATE_ANY_BOARD)
+        {
+            index = random.Below(static_cast<uint32_t>(openCells));
+            for (board = 0; index >= m_emptyCount[board]; board++)
+            {
+                index -= m_emptyCount[board];
+            }
+        }
+        else
+        {
+            index = random.Below(m_emptyCount[board]);
+        }
+
+        size_t square = SQUARE_TABLE.squares[m_empty[board]][index];
+        BoardMask_t boardBit = static_cast<BoardMask_t>(1u << board);
+        BoardMask_t mask = m_boards[side][board] |= static_cast<BoardMask_t>(1u << square);
+        m_empty[board] &= static_cast<BoardMask_t>(~(1u << square));
+        m_emptyCount[board]--;
+        openCells--;
+        moveCount++;
+
+        if (IsWinMask(mask))
+        {
+            m_won[side] |= boardBit;
+            closed |= boardBit;
+            openCells -= m_emptyCount[board];
+            m_empty[board] = 0;
+            m_emptyCount[board] = 0;
+            if (IsWinMask(m_won[side]))
+            {
+                winner = side;
+            }
+        }
+        else if (m_emptyCount[board] == 0)
+        {
+            closed |= boardBit;
+        }
+
+        board = (closed & (1u << square)) ? ULTIMATE_ANY_BOARD : square;
+        side = 1 - side;
+    }
+
+    rng = random;
+    m_turn = static_cast<uint8_t>(side);
+    m_nextBoard = static_cast<uint8_t>(board);
+    m_winner = static_cast<uint8_t>(winner);
+    m_openCells = static_cast<uint8_t>(openCells);
+    m_moveCount = static_cast<uint8_t>(moveCount);
+    m_closed = closed;
+    return CheckWin();
+}
+
+UltimateEngine::UltimateEngine() : m_rng(static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()))
+{
+    ResetStats();
+}
+
+void UltimateEngine::ResetStats()
+{
+    m_stats.iterations = 0;
+    m_stats.playoutMoves = 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectChild
+//
+// @description             : UCB1 over the children; unvisited children first
+//
+// @return                  : index of the child node
+//--------------------------------------------------------------------------------
+size_t UltimateEngine::SelectChild(const Node & node) const
+{
+    // UCB1 as score / visits + c * sqrt(log(parent visits)) / sqrt(visits),
+    // in float with the logarithm taken once
+    size_t best = node.firstChild;
+    float bestValue = -1.0f;
+    float exploration = static_cast<float>(ULTIMATE_EXPLORATION) * std::sqrt(std::log(node.visits));
+
+    for (size_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+    {
+        const Node & child = m_nodes[i];
+        if (child.visits == 0)
+        {
+            return i;
+        }
+
+        float value = (child.score + exploration * std::sqrt(child.visits)) / child.visits;
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Expand
+//
+// @description             : Adds one child per legal move of 'position', next
+//                            to each other
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateEngine::Expand(uint32_t index, const UltimateGame & position)
+{
+    uint8_t moves[ULTIMATE_CELLS];
+    size_t count = position.GetMoves(moves);
+
+    m_nodes[index].firstChild = static_cast<uint32_t>(m_nodes.size());
+    m_nodes[index].childCount = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Node child = Node();
+        child.parent = index;
+        child.move = moves[i];
+        m_nodes.push_back(child);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Grows the tree until 'budgetMs' or 'maxIterations'
+//                            runs out (0 means no limit; one of them must be
+//                            set)
+//
+// @return                  : most visited move
+//--------------------------------------------------------------------------------
+size_t UltimateEngine::SelectMove(const UltimateGame & game, int budgetMs, unsigned long long maxIterations)
+{
+    assert(!game.GameOver() && (budgetMs > 0 || maxIterations > 0));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+
+    m_nodes.clear();
+    m_nodes.push_back(Node());
+    Expand(0, game);
+    if (m_nodes[0].childCount == 1)
+    {
+        return m_nodes[1].move;
+    }
+
+    unsigned long long iteration = 0;
+    for (; maxIterations == 0 || iteration < maxIterations; iteration++)
+    {
+        if (budgetMs > 0 && iteration % ULTIMATE_TIME_CHECK == 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+
+        UltimateGame position = game;
+        uint32_t index = 0;
+        while (m_nodes[index].childCount > 0)
+        {
+            index = static_cast<uint32_t>(SelectChild(m_nodes[index]));
+            position.AddPlayerMarkToBoard(m_nodes[index].move);
+        }
+
+        if (!position.GameOver() && m_nodes[index].visits > 0 && m_nodes.size() + ULTIMATE_CELLS <= ULTIMATE_MAX_NODES)
+        {
+            Expand(index, position);
+            index = m_nodes[index].firstChild;
+            position.AddPlayerMarkToBoard(m_nodes[index].move);
+        }
+
+        // The side that moved into the leaf is the one not to move there
+        Player_t mover = (position.GetTurn() == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+        Player_t winner = position.CheckWin();
+        if (!position.GameOver())
+        {
+            size_t moveCount = position.GetMoveCount();
+            winner = position.PlayRandom(m_rng);
+            m_stats.playoutMoves += position.GetMoveCount() - moveCount;
+        }
+
+        double score = (winner == PLAYER_NONE) ? 0.5 : ((winner == mover) ? 1.0 : 0.0);
+        for (;; index = m_nodes[index].parent)
+        {
+            m_nodes[index].visits += 1;
+            m_nodes[index].score += static_cast<float>(score);
+            score = 1.0 - score;
+            if (index == 0)
+            {
+                break;
+            }
+        }
+    }
+    m_stats.iterations += iteration;
+
+    const Node & root = m_nodes[0];
+    size_t best = root.firstChild;
+    for (size_t i = root.firstChild; i < root.firstChild + root.childCount; i++)
+    {
+        if (m_nodes[i].visits > m_nodes[best].visits)
+        {
+            best = i;
+        }
+    }
+
+    return m_nodes[best].move;
+}
+
+UltimateAlphaBeta::UltimateAlphaBeta()
+{
+    m_stopped = false;
+    m_nodes = 0;
+    m_completedDepth = 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Evaluate
+//
+// @description             : Static score of a position: sub-boards won, open
+//                            lines of the big board and open lines inside the
+//                            open sub-boards, weighted by how many marks they
+//                            hold. A drawn sub-board blocks its big board
+//                            lines for both sides.
+//
+// @return                  : score from the point of view of the side to move
+//--------------------------------------------------------------------------------
+int UltimateAlphaBeta::Evaluate(const UltimateGame & position) const
+{
+    Player_t own = position.GetTurn();
+    Player_t opponent = (own == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    BoardMask_t ownWon = position.GetWonBoards(own);
+    BoardMask_t opponentWon = position.GetWonBoards(opponent);
+    BoardMask_t closed = position.GetClosedBoards();
+    BoardMask_t drawn = closed & ~(ownWon | opponentWon);
+
+    int score = ULTIMATE_BOARD_SCORE * (CountBits(ownWon) - CountBits(opponentWon));
+    for (size_t i = 0; i < 8; i++)
+    {
+        BoardMask_t ownPart = WIN_MASKS[i] & ownWon;
+        BoardMask_t opponentPart = WIN_MASKS[i] & opponentWon;
+        if (WIN_MASKS[i] & drawn)
+        {
+            continue;
+        }
+        if (opponentPart == 0)
+        {
+            score += ULTIMATE_BIG_LINE_WEIGHTS[CountBits(ownPart)];
+        }
+        else if (ownPart == 0)
+        {
+            score -= ULTIMATE_BIG_LINE_WEIGHTS[CountBits(opponentPart)];
+        }
+    }
+
+    for (size_t board = 0; board < ULTIMATE_BOARDS; board++)
+    {
+        if (closed & (1u << board))
+        {
+            continue;
+        }
+
+        BoardMask_t ownMask = position.GetBoardMask(own, board);
+        BoardMask_t opponentMask = position.GetBoardMask(opponent, board);
+        for (size_t i = 0; i < 8; i++)
+        {
+            BoardMask_t ownPart = WIN_MASKS[i] & ownMask;
+            BoardMask_t opponentPart = WIN_MASKS[i] & opponentMask;
+            if (opponentPart == 0)
+            {
+                score += ULTIMATE_LINE_WEIGHTS[CountBits(ownPart)];
+            }
+            else if (ownPart == 0)
+            {
+                score -= ULTIMATE_LINE_WEIGHTS[CountBits(opponentPart)];
+            }
+        }
+    }
+
+    return score;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Search
+//
+// @description             : Alpha-beta negamax on copies of the position. A
+//                            won game is scored by how soon it was won.
+//
+// @return                  : score from the point of view of the side to move
+//--------------------------------------------------------------------------------
+int UltimateAlphaBeta::Search(const UltimateGame & position, int depth, int ply, int alpha, int beta)
+{
+    m_nodes++;
+    if ((m_nodes & 1023) == 0 && std::chrono::steady_clock::now() >= m_deadline)
+    {
+        m_stopped = true;
+    }
+    if (m_stopped)
+    {
+        return 0;
+    }
+
+    // Only the side that just moved can have won
+    if (position.CheckWin() != PLAYER_NONE)
+    {
+        return -(ULTIMATE_WIN_SCORE - ply);
+    }
+    if (position.GameOver())
+    {
+        return 0;
+    }
+    if (depth <= 0)
+    {
+        return Evaluate(position);
+    }
+
+    uint8_t moves[ULTIMATE_CELLS];
+    size_t count = position.GetMoves(moves);
+    int bestScore = -ULTIMATE_INFINITY;
+    for (size_t i = 0; i < count; i++)
+    {
+        UltimateGame child = position;
+        child.AddPlayerMarkToBoard(moves[i]);
+        int score = -Search(child, depth - 1, ply + 1, -beta, -alpha);
+        if (m_stopped)
+        {
+            return 0;
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return bestScore;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SelectMove
+//
+// @description             : Deepens the search until the time budget runs out,
+//                            the result is proven or 'maxDepth' is reached.
+//
+// @return                  : cell of the move
+//--------------------------------------------------------------------------------
+size_t UltimateAlphaBeta::SelectMove(const UltimateGame & game, int budgetMs, int maxDepth)
+{
+    assert(!game.GameOver());
+
+    m_nodes = 0;
+    m_completedDepth = 0;
+    m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+    m_stopped = false;
+
+    uint8_t moves[ULTIMATE_CELLS];
+    size_t count = game.GetMoves(moves);
+    std::vector<size_t> rootMoves(moves, moves + count);
+    size_t bestMove = rootMoves.front();
+    if (count == 1)
+    {
+        return bestMove;
+    }
+
+    int emptyCount = static_cast<int>(ULTIMATE_CELLS - game.GetMoveCount());
+    for (int depth = 1; depth <= maxDepth && depth <= emptyCount; depth++)
+    {
+        int iterationScore = -ULTIMATE_INFINITY;
+        size_t iterationMove = bestMove;
+        for (auto it = rootMoves.begin(); it != rootMoves.end(); it++)
+        {
+            UltimateGame child = game;
+            child.AddPlayerMarkToBoard(*it);
+            int score = -Search(child, depth - 1, 1, -ULTIMATE_INFINITY, -iterationScore);
+            if (m_stopped)
+            {
+                break;
+            }
+            if (score > iterationScore)
+            {
+                iterationScore = score;
+                iterationMove = *it;
+            }
+        }
+
+        if (m_stopped)
+        {
+            break;
+        }
+
+        // Search the best move first in the next iteration
+        bestMove = iterationMove;
+        m_completedDepth = depth;
+        std::iter_swap(rootMoves.begin(), std::find(rootMoves.begin(), rootMoves.end(), bestMove));
+
+        if (iterationScore > ULTIMATE_PROVEN_SCORE || iterationScore < -ULTIMATE_PROVEN_SCORE)
+        {
+            break;
+        }
+    }
+
+    return bestMove;
+}
@@ -0,0 +1,165 @@
+#ifndef ULTIMATE_H
+#define ULTIMATE_H
+#include "game.h"
+#include "bitboard.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Ultimate tic-tac-toe: nine 3x3 sub-boards laid out as a 3x3 board.
+// Cell N is square N % 9 of sub-board N / 9, both numbered like the 3x3
+// board. A move on square S sends the opponent to sub-board S, or
+// anywhere if that sub-board is already won or full. Winning a sub-board
+// claims its square on the big board; three claimed in a row win.
+//------------------------------------------------------------------------
+const size_t ULTIMATE_BOARDS = 9;
+const size_t ULTIMATE_CELLS = 81;
+
+// Next sub-board when the side to move may play on any open sub-board
+const uint8_t ULTIMATE_ANY_BOARD = 9;
+
+//------------------------------------------------------------------------
+// xorshift64* generator for the playouts, which draw one number per move
+// and cannot afford std::mt19937
+//------------------------------------------------------------------------
+class UltimateRng
+{
+private:
+    uint64_t m_state;
+
+public:
+    explicit UltimateRng(uint64_t seed) : m_state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+    uint32_t Next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return static_cast<uint32_t>((m_state * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    // Uniform in [0, bound) without a division
+    uint32_t Below(uint32_t bound)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(Next()) * bound) >> 32);
+    }
+};
+
+//------------------------------------------------------------------------
+// Nested bitboard: one 3x3 mask per player and sub-board, and the big
+// board as the sub-boards each player has won. Sub-board and big board
+// wins are both read from the 3x3 win lookup (IsWinMask). Masks are
+// indexed by Player_t. The empty squares of each open sub-board are kept
+// as a mask and a count next to them, so a playout draws a move with
+// loads that do not wait on each other; the whole state is 74 bytes and
+// copied freely.
+//------------------------------------------------------------------------
+class UltimateGame
+{
+private:
+    BoardMask_t m_boards[2][ULTIMATE_BOARDS];
+    BoardMask_t m_won[2];           // sub-boards won, the big board
+    BoardMask_t m_closed;           // sub-boards won or full
+    BoardMask_t m_empty[ULTIMATE_BOARDS];       // empty squares, 0 once closed
+    uint8_t m_emptyCount[ULTIMATE_BOARDS];      // bits set in m_empty
+    uint8_t m_openCells;            // sum of m_emptyCount
+    uint8_t m_nextBoard;            // sub-board to play on, or ULTIMATE_ANY_BOARD
+    uint8_t m_turn;
+    uint8_t m_winner;
+    uint8_t m_moveCount;
+
+    void Play(size_t board, size_t square);
+
+public:
+    UltimateGame(Player_t firstPlayer = PLAYER_USER);
+
+    Player_t GetTurn() const { return static_cast<Player_t>(m_turn); }
+    Player_t GetCell(size_t cell) const;
+    Player_t GetBoardWinner(size_t board) const;
+    BoardMask_t GetWonBoards(Player_t player) const { return m_won[player]; }
+    BoardMask_t GetClosedBoards() const { return m_closed; }
+    BoardMask_t GetBoardMask(Player_t player, size_t board) const { return m_boards[player][board]; }
+    size_t GetNextBoard() const { return m_nextBoard; }
+    size_t GetMoveCount() const { return m_moveCount; }
+    bool IsLegalMove(size_t cell) const;
+    size_t GetMoves(uint8_t * moves) const;
+    std::vector<size_t> GetAvailableMoves() const;
+    void AddPlayerMarkToBoard(size_t cell);
+    Player_t PlayRandom(UltimateRng & rng);
+    Player_t CheckWin() const { return static_cast<Player_t>(m_winner); }
+    bool GameOver() const { return m_winner != PLAYER_NONE || m_closed == FULL_BOARD_MASK; }
+};
+
+// Nodes the search tree may hold; beyond it leaves are no longer expanded
+const size_t ULTIMATE_MAX_NODES = 1 << 21;
+
+const double ULTIMATE_EXPLORATION = 1.0;
+
+struct UltimateStats
+{
+    unsigned long long iterations;      // one random playout each
+    unsigned long long playoutMoves;
+};
+
+//------------------------------------------------------------------------
+// Monte Carlo tree search (UCT) for Ultimate tic-tac-toe. Nodes keep only
+// their move; every iteration replays the moves from the root on a copy
+// of the position, expands a leaf the second time it is reached and
+// plays the game out at random with PlayRandom.
+//------------------------------------------------------------------------
+class UltimateEngine
+{
+private:
+    struct Node
+    {
+        uint32_t parent;
+        uint32_t firstChild;
+        uint8_t childCount;
+        uint8_t move;
+        float visits;
+        float score;            // for the side that moved into this node
+    };
+
+    std::vector<Node> m_nodes;
+    UltimateRng m_rng;
+    UltimateStats m_stats;
+
+    size_t SelectChild(const Node & node) const;
+    void Expand(uint32_t index, const UltimateGame & position);
+
+public:
+    UltimateEngine();
+
+    size_t SelectMove(const UltimateGame & game, int budgetMs, unsigned long long maxIterations = 0);
+
+    const UltimateStats & GetStats() const { return m_stats; }
+    void ResetStats();
+};
+
+//------------------------------------------------------------------------
+// Iterative deepening alpha-beta (negamax) for Ultimate tic-tac-toe, the
+// deterministic counterpart of UltimateEngine. Positions are copied down
+// the tree and scored at the horizon by the sub-boards won and the lines
+// still open on the big board and inside the open sub-boards. Every
+// search finishes within the given time budget.
+//------------------------------------------------------------------------
+class UltimateAlphaBeta
+{
+private:
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_stopped;
+    unsigned long long m_nodes;
+    int m_completedDepth;
+
+    int Search(const UltimateGame & position, int depth, int ply, int alpha, int beta);
+    int Evaluate(const UltimateGame & position) const;
+
+public:
+    UltimateAlphaBeta();
+    size_t SelectMove(const UltimateGame & game, int budgetMs, int maxDepth = 64);
+    unsigned long long GetNodes() const { return m_nodes; }
+    int GetCompletedDepth() const { return m_completedDepth; }
+};
+
+#endif // ULTIMATE_H
@@ -0,0 +1,188 @@
+#include "ultimatedialog.h"
+#include "mainwindow.h"
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+UltimateDialog::UltimateDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    m_bComputerFirst = false;
+    m_worker = nullptr;
+    setWindowTitle("Ultimate Tic Tac Toe");
+
+    QVBoxLayout * mainLayout = new QVBoxLayout(this);
+    QGridLayout * boardsLayout = new QGridLayout();
+    boardsLayout->setSpacing(10);
+    mainLayout->addLayout(boardsLayout);
+
+    // One grid per sub-board, cell = 9 * board + square
+    m_board.resize(ULTIMATE_CELLS);
+    for (size_t board = 0; board < ULTIMATE_BOARDS; board++)
+    {
+        QGridLayout * subBoard = new QGridLayout();
+        subBoard->setSpacing(2);
+        for (size_t square = 0; square < 9; square++)
+        {
+            size_t cell = board * 9 + square;
+            QPushButton * btn = new QPushButton(".", this);
+            btn->setFixedSize(28, 28);
+            btn->setProperty("cell", static_cast<int>(cell));
+            connect(btn, SIGNAL(clicked()), this, SLOT(OnCellClicked()));
+            subBoard->addWidget(btn, static_cast<int>(square / 3), static_cast<int>(square % 3));
+            m_board[cell] = btn;
+        }
+        boardsLayout->addLayout(subBoard, static_cast<int>(board / 3), static_cast<int>(board % 3));
+    }
+
+    QHBoxLayout * bottomLayout = new QHBoxLayout();
+    m_status = new QLabel(this);
+    m_btnNewGame = new QPushButton("New Game", this);
+    connect(m_btnNewGame, SIGNAL(clicked()), this, SLOT(OnNewGame()));
+    bottomLayout->addWidget(m_status, 1);
+    bottomLayout->addWidget(m_btnNewGame);
+    mainLayout->addLayout(bottomLayout);
+
+    OnNewGame();
+}
+
+UltimateDialog::~UltimateDialog()
+{
+    // The worker uses our engine, let it finish its search first
+    if (m_worker)
+    {
+        m_worker->wait();
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : EnableGame
+//
+// @description             : Enable the cells the side to move may play on,
+//                            disable all the others
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateDialog::EnableGame(bool bEnable)
+{
+    for (size_t cell = 0; cell < ULTIMATE_CELLS; cell++)
+    {
+        m_board[cell]->setEnabled(bEnable && m_game.IsLegalMove(cell));
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : MarkBoardPosition
+//
+// @description             : Marks a move on the board, claims the sub-board
+//                            if the move won it and reports the result once
+//                            the game is over.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateDialog::MarkBoardPosition(size_t cell, Player_t player)
+{
+    size_t board = cell / 9;
+    bool bOpenBefore = (m_game.GetBoardWinner(board) == PLAYER_NONE);
+    m_game.AddPlayerMarkToBoard(cell);
+
+    const QString & mark = (player == PLAYER_USER) ? USER_MARK : COMPUTER_MARK;
+    m_board[cell]->setText(mark);
+    if (bOpenBefore && m_game.GetBoardWinner(board) == player)
+    {
+        for (size_t square = 0; square < 9; square++)
+        {
+            m_board[board * 9 + square]->setText(mark);
+        }
+    }
+
+    if (m_game.CheckWin() == PLAYER_USER)
+    {
+        m_status->setText("You won the game");
+        EnableGame(false);
+    }
+    else if (m_game.CheckWin() == PLAYER_COMPUTER)
+    {
+        m_status->setText("Computer won the game");
+        EnableGame(false);
+    }
+    else if (m_game.GameOver())
+    {
+        m_status->setText("Game was tied");
+        EnableGame(false);
+    }
+    else if (player == PLAYER_USER)
+    {
+        SimulateComputerMove();
+    }
+    else
+    {
+        m_status->setText((m_game.GetNextBoard() == ULTIMATE_ANY_BOARD) ? "Your turn, play on any open board"
+                                                                        : "Your turn");
+        EnableGame(true);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : SimulateComputerMove
+//
+// @description             : Searches the computer's move in a separate thread.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateDialog::SimulateComputerMove()
+{
+    m_status->setText("Computer's turn");
+    EnableGame(false);
+    m_btnNewGame->setEnabled(false);
+
+    m_worker = new UltimateMoveWorker(m_game, &m_engine);
+    connect(m_worker, SIGNAL(UltimateMoveAvailable(int)), this, SLOT(OnUltimateMoveAvailable(int)));
+    connect(m_worker, SIGNAL(finished()), m_worker, SLOT(deleteLater()));
+    m_worker->start();
+}
+
+void UltimateDialog::OnUltimateMoveAvailable(int move)
+{
+    m_worker = nullptr;
+    m_btnNewGame->setEnabled(true);
+    MarkBoardPosition(static_cast<size_t>(move), PLAYER_COMPUTER);
+}
+
+void UltimateDialog::OnCellClicked()
+{
+    QAbstractButton * btn = qobject_cast<QAbstractButton *>(sender());
+    if (btn)
+    {
+        MarkBoardPosition(static_cast<size_t>(btn->property("cell").toInt()), PLAYER_USER);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : OnNewGame
+//
+// @description             : Clears the board. Who moves first alternates from
+//                            game to game.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void UltimateDialog::OnNewGame()
+{
+    m_game = UltimateGame(m_bComputerFirst ? PLAYER_COMPUTER : PLAYER_USER);
+    for (auto it = m_board.begin(); it != m_board.end(); it++)
+    {
+        (*it)->setText(".");
+    }
+
+    if (m_bComputerFirst)
+    {
+        SimulateComputerMove();
+    }
+    else
+    {
+        m_status->setText("Your turn");
+        EnableGame(true);
+    }
+    m_bComputerFirst = !m_bComputerFirst;
+}
@@ -0,0 +1,73 @@
+#ifndef ULTIMATEDIALOG_H
+#define ULTIMATEDIALOG_H
+
+#include "ultimate.h"
+#include <QDialog>
+#include <QLabel>
+#include <QtWidgets/QAbstractButton>
+#include <vector>
+
+// Time the computer may think per Ultimate move
+const int ULTIMATE_MOVE_BUDGET_MS = 1000;
+
+//------------------------------------------------------------------------
+// Worker thread that calculates Computer's Ultimate move
+//------------------------------------------------------------------------
+class UltimateMoveWorker: public QThread
+{
+Q_OBJECT
+private:
+    UltimateGame m_game;
+    UltimateEngine* m_engine;
+
+signals:
+    void UltimateMoveAvailable(int move);
+
+public:
+    UltimateMoveWorker(const UltimateGame & game, UltimateEngine* engine) : QThread()
+    {
+        m_game = game;
+        m_engine = engine;
+    }
+
+    void run()
+    {
+        size_t move = m_engine->SelectMove(m_game, ULTIMATE_MOVE_BUDGET_MS);
+        emit UltimateMoveAvailable(static_cast<int>(move));
+    }
+};
+
+//------------------------------------------------------------------------
+// Nine 3x3 sub-boards in a 3x3 grid. Only the cells the side to move may
+// play on are enabled, which shows the sub-board the last move sent it
+// to; a won sub-board shows its winner's mark on every cell.
+//------------------------------------------------------------------------
+class UltimateDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    UltimateDialog(QWidget *parent = nullptr);
+    ~UltimateDialog();
+    void EnableGame(bool bEnable);
+    void MarkBoardPosition(size_t cell, Player_t player);
+    void SimulateComputerMove();
+
+private slots:
+    void OnCellClicked();
+
+    void OnUltimateMoveAvailable(int move);
+
+    void OnNewGame();
+
+private:
+    std::vector<QAbstractButton *> m_board;
+    QLabel * m_status;
+    QAbstractButton * m_btnNewGame;
+    UltimateMoveWorker * m_worker;
+    UltimateGame m_game;
+    UltimateEngine m_engine;
+    bool m_bComputerFirst;
+};
+
+#endif // ULTIMATEDIALOG_H
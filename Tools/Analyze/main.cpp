@@ -0,0 +1,684 @@
+//--------------------------------------------------------------------------------
+// Analyze: batch evaluation of 3x3 positions, file in, evaluations out.
+//
+// Three stages run as a pipeline:
+// 1. Reader: streams positions from the input file in batches.
+// 2. Solvers: one thread per core. Each one solves the positions of a batch
+//    exactly and asks an engine for its move through a Game.
+// 3. Writer: writes the results in input order.
+// Batches are dealt to the solvers round robin, each solver has a bounded
+// queue in and out, and the writer drains the solvers' output queues in the
+// same round robin order, so results come out in order without a reorder
+// buffer. Full queues stall the stage feeding them, so memory use does not
+// depend on the file size.
+//
+// Text format: one position per line, 9 characters of 'X', 'O' and '.'.
+// X moves first. The output line is "<position> <value> <move>", where
+// value is win, draw or loss for the side to move, or illegal, and move is
+// 1 to 9 like the board buttons, or '-' once the game is over.
+// Binary format: 4 bytes per position, the little endian 9 bit masks of X
+// and of O. The output is 2 bytes per position: the TablebaseValue_t and
+// the move 0 to 8, or 255.
+//
+// Usage: Analyze --input PATH [--output PATH] [--format text|binary]
+//                [--threads N] [--engine NAME] [--generate N]
+//--------------------------------------------------------------------------------
+#include "atomicfile.h"
+#include "engine.h"
+#include "spscqueue.h"
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t BATCH_POSITIONS = 4096;
+const size_t QUEUE_BATCHES = 4;                 // per solver, in each direction
+const unsigned long STALL_SLEEP_US = 100;
+const uint8_t NO_MOVE = 0xFF;
+const size_t BINARY_POSITION_BYTES = 4;
+const size_t BINARY_RESULT_BYTES = 2;
+
+typedef enum InputFormat_tag
+{
+    FORMAT_TEXT,
+    FORMAT_BINARY
+}InputFormat_t;
+
+struct Position
+{
+    BoardMask_t first;      // X
+    BoardMask_t second;     // O
+    bool bValid;            // false for a malformed line
+};
+
+struct Analysis
+{
+    uint8_t value;          // TablebaseValue_t for the side to move
+    uint8_t move;
+};
+
+struct Batch
+{
+    std::vector<Position> positions;
+    std::vector<Analysis> results;
+};
+
+// nullptr marks the end of the input
+typedef SpscQueue<Batch *, QUEUE_BATCHES> BatchQueue;
+
+// Static so the queues keep their cache line alignment, C++11 new ignores it
+const size_t MAX_SOLVERS = 64;
+static BatchQueue s_solverInputs[MAX_SOLVERS];
+static BatchQueue s_solverOutputs[MAX_SOLVERS];
+
+struct StageStats
+{
+    unsigned long long positions;
+    double seconds;
+    double stallSeconds;    // blocked on a full or empty queue
+};
+
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PushBatch / PopBatch
+//
+// @description             : Blocking queue operations. The time spent waiting
+//                            is added to 'stallSeconds'.
+//
+// @return                  : PopBatch: the batch, nullptr at the end of input
+//--------------------------------------------------------------------------------
+static void PushBatch(BatchQueue & queue, Batch * batch, double & stallSeconds)
+{
+    if (queue.TryPush(batch))
+    {
+        return;
+    }
+
+    Clock::time_point start = Clock::now();
+    while (!queue.TryPush(batch))
+    {
+        QThread::usleep(STALL_SLEEP_US);
+    }
+    stallSeconds += SecondsSince(start);
+}
+
+static Batch * PopBatch(BatchQueue & queue, double & stallSeconds)
+{
+    Batch * batch;
+    if (queue.TryPop(batch))
+    {
+        return batch;
+    }
+
+    Clock::time_point start = Clock::now();
+    while (!queue.TryPop(batch))
+    {
+        QThread::usleep(STALL_SLEEP_US);
+    }
+    stallSeconds += SecondsSince(start);
+    return batch;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : IsLegalPosition
+//
+// @description             : Whether the position can arise with X moving first
+//
+// @return                  : true if legal
+//--------------------------------------------------------------------------------
+static bool IsLegalPosition(BoardMask_t first, BoardMask_t second)
+{
+    if ((first & second) || ((first | second) & ~FULL_BOARD_MASK))
+    {
+        return false;
+    }
+
+    int firstCount = CountBits(first);
+    int secondCount = CountBits(second);
+    if (firstCount != secondCount && firstCount != secondCount + 1)
+    {
+        return false;
+    }
+
+    // The winner made the last move
+    bool bFirstWon = IsWinMask(first);
+    bool bSecondWon = IsWinMask(second);
+    if (bFirstWon && (bSecondWon || firstCount != secondCount + 1))
+    {
+        return false;
+    }
+    if (bSecondWon && firstCount != secondCount)
+    {
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Solve
+//
+// @description             : Alpha-beta negamax to the end of the game
+//
+// @return                  : 1 win, 0 draw, -1 loss for the side to move
+//--------------------------------------------------------------------------------
+static int Solve(BoardMask_t own, BoardMask_t opponent, int alpha, int beta)
+{
+    if (IsWinMask(opponent))
+    {
+        return -1;
+    }
+
+    BoardMask_t empty = static_cast<BoardMask_t>(~(own | opponent) & FULL_BOARD_MASK);
+    if (empty == 0)
+    {
+        return 0;
+    }
+
+    int best = -1;
+    while (empty)
+    {
+        BoardMask_t bit = static_cast<BoardMask_t>(empty & (0 - empty));
+        empty = static_cast<BoardMask_t>(empty & ~bit);
+
+        int score = -Solve(opponent, static_cast<BoardMask_t>(own | bit), -beta, -alpha);
+        best = std::max(best, score);
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : AnalyzePosition
+//
+// @description             : Exact value of the position and the engine's move
+//
+// @return                  : Analysis
+//--------------------------------------------------------------------------------
+static Analysis AnalyzePosition(const Position & position, Engine & engine)
+{
+    Analysis analysis;
+    analysis.move = NO_MOVE;
+
+    if (!position.bValid || !IsLegalPosition(position.first, position.second))
+    {
+        analysis.value = TABLEBASE_ILLEGAL;
+        return analysis;
+    }
+
+    // X is the user's side of a Game and always moves first
+    bool bFirstToMove = (CountBits(position.first) == CountBits(position.second));
+    Player_t turn = bFirstToMove ? PLAYER_USER : PLAYER_COMPUTER;
+    BoardMask_t own = bFirstToMove ? position.first : position.second;
+    BoardMask_t opponent = bFirstToMove ? position.second : position.first;
+
+    int score = Solve(own, opponent, -1, 1);
+    analysis.value = static_cast<uint8_t>(score > 0 ? TABLEBASE_WIN : (score < 0 ? TABLEBASE_LOSS : TABLEBASE_DRAW));
+    if (IsWinMask(opponent) || (own | opponent) == FULL_BOARD_MASK)
+    {
+        return analysis;
+    }
+
+    Game game(PLAYER_USER);
+    for (size_t i = 0; i < 9; i++)
+    {
+        if (position.first & (1u << i))
+        {
+            game.AddPlayerMarkToBoard(i, PLAYER_USER);
+        }
+        else if (position.second & (1u << i))
+        {
+            game.AddPlayerMarkToBoard(i, PLAYER_COMPUTER);
+        }
+    }
+    analysis.move = static_cast<uint8_t>(engine.SelectMove(game, turn));
+    return analysis;
+}
+
+//------------------------------------------------------------------------
+// Stage 1: parses the input into batches and deals them to the solvers
+//------------------------------------------------------------------------
+class ReaderStage : public QThread
+{
+private:
+    std::ifstream & m_input;
+    InputFormat_t m_format;
+    size_t m_solvers;
+
+    bool ReadBatch(Batch & batch)
+    {
+        if (m_format == FORMAT_TEXT)
+        {
+            std::string line;
+            while (batch.positions.size() < BATCH_POSITIONS && std::getline(m_input, line))
+            {
+                Position position = { 0, 0, true };
+                size_t length = line.size();
+                if (length > 0 && line[length - 1] == '\r')
+                {
+                    length--;
+                }
+                position.bValid = (length == 9);
+                for (size_t i = 0; i < 9 && position.bValid; i++)
+                {
+                    char mark = line[i];
+                    if (mark == 'X' || mark == 'x')
+                    {
+                        position.first |= static_cast<BoardMask_t>(1u << i);
+                    }
+                    else if (mark == 'O' || mark == 'o')
+                    {
+                        position.second |= static_cast<BoardMask_t>(1u << i);
+                    }
+                    else if (mark != '.')
+                    {
+                        position.bValid = false;
+                    }
+                }
+                batch.positions.push_back(position);
+            }
+            return true;
+        }
+
+        std::vector<unsigned char> bytes(BATCH_POSITIONS * BINARY_POSITION_BYTES);
+        m_input.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        size_t count = static_cast<size_t>(m_input.gcount());
+        for (size_t offset = 0; offset + BINARY_POSITION_BYTES <= count; offset += BINARY_POSITION_BYTES)
+        {
+            Position position;
+            position.first = static_cast<BoardMask_t>(bytes[offset] | (bytes[offset + 1] << 8));
+            position.second = static_cast<BoardMask_t>(bytes[offset + 2] | (bytes[offset + 3] << 8));
+            position.bValid = true;
+            batch.positions.push_back(position);
+        }
+        return (count % BINARY_POSITION_BYTES) == 0;
+    }
+
+protected:
+    void run()
+    {
+        Clock::time_point start = Clock::now();
+        size_t sequence = 0;
+        while (true)
+        {
+            std::unique_ptr<Batch> batch(new Batch());
+            if (!ReadBatch(*batch))
+            {
+                bTruncated = true;
+            }
+            if (batch->positions.empty())
+            {
+                break;
+            }
+
+            stats.positions += batch->positions.size();
+            PushBatch(s_solverInputs[sequence % m_solvers], batch.release(), stats.stallSeconds);
+            sequence++;
+        }
+
+        for (size_t i = 0; i < m_solvers; i++)
+        {
+            PushBatch(s_solverInputs[i], nullptr, stats.stallSeconds);
+        }
+        stats.seconds = SecondsSince(start);
+    }
+
+public:
+    StageStats stats;
+    bool bTruncated;
+
+    ReaderStage(std::ifstream & input, InputFormat_t format, size_t solvers)
+        : m_input(input), m_format(format), m_solvers(solvers), bTruncated(false)
+    {
+        stats = StageStats();
+    }
+};
+
+//------------------------------------------------------------------------
+// Stage 2: analyses every position of a batch, one engine per thread
+//------------------------------------------------------------------------
+class SolverStage : public QThread
+{
+private:
+    BatchQueue & m_input;
+    BatchQueue & m_output;
+    std::string m_engineName;
+
+protected:
+    void run()
+    {
+        Clock::time_point start = Clock::now();
+        std::unique_ptr<Engine> engine(CreateEngine(m_engineName));
+
+        Batch * batch;
+        while ((batch = PopBatch(m_input, stats.stallSeconds)) != nullptr)
+        {
+            batch->results.resize(batch->positions.size());
+            for (size_t i = 0; i < batch->positions.size(); i++)
+            {
+                batch->results[i] = AnalyzePosition(batch->positions[i], *engine);
+            }
+            stats.positions += batch->positions.size();
+            PushBatch(m_output, batch, stats.stallSeconds);
+        }
+
+        PushBatch(m_output, nullptr, stats.stallSeconds);
+        stats.seconds = SecondsSince(start);
+    }
+
+public:
+    StageStats stats;
+
+    SolverStage(BatchQueue & input, BatchQueue & output, const std::string & engineName)
+        : m_input(input), m_output(output), m_engineName(engineName)
+    {
+        stats = StageStats();
+    }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : WriteBatch
+//
+// @description             : Stage 3: appends the results of one batch
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static const char * VALUE_NAMES[4] = { "draw", "win", "loss", "illegal" };
+
+static void WriteBatch(std::ofstream & output, InputFormat_t format, const Batch & batch,
+                       unsigned long long counts[4])
+{
+    if (format == FORMAT_BINARY)
+    {
+        std::vector<unsigned char> bytes;
+        bytes.reserve(batch.results.size() * BINARY_RESULT_BYTES);
+        for (auto it = batch.results.begin(); it != batch.results.end(); it++)
+        {
+            bytes.push_back(it->value);
+            bytes.push_back(it->move);
+            counts[it->value]++;
+        }
+        output.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return;
+    }
+
+    std::string text;
+    for (size_t i = 0; i < batch.results.size(); i++)
+    {
+        const Position & position = batch.positions[i];
+        const Analysis & analysis = batch.results[i];
+        counts[analysis.value]++;
+
+        if (!position.bValid)
+        {
+            text += "?????????";
+        }
+        else
+        {
+            for (size_t cell = 0; cell < 9; cell++)
+            {
+                text += (position.first & (1u << cell)) ? 'X' : ((position.second & (1u << cell)) ? 'O' : '.');
+            }
+        }
+        text += ' ';
+        text += VALUE_NAMES[analysis.value];
+        text += ' ';
+        text += (analysis.move == NO_MOVE) ? std::string("-") : std::to_string(analysis.move + 1);
+        text += '\n';
+    }
+    output << text;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GeneratePositions
+//
+// @description             : Writes 'count' positions reached by random play,
+//                            for trying the pipeline out
+//
+// @return                  : true if the file was written
+//--------------------------------------------------------------------------------
+static bool GeneratePositions(const std::string & path, InputFormat_t format, unsigned long long count)
+{
+    std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::mt19937 rng(20200117);
+    std::string text;
+    std::vector<unsigned char> bytes;
+    for (unsigned long long i = 0; i < count; i++)
+    {
+        BoardMask_t masks[2] = { 0, 0 };
+        size_t plies = rng() % 10;
+        for (size_t ply = 0; ply < plies && !IsWinMask(masks[0]) && !IsWinMask(masks[1]); ply++)
+        {
+            BoardMask_t bit;
+            do
+            {
+                bit = static_cast<BoardMask_t>(1u << (rng() % 9));
+            } while ((masks[0] | masks[1]) & bit);
+            masks[ply % 2] |= bit;
+        }
+
+        if (format == FORMAT_BINARY)
+        {
+            bytes.push_back(static_cast<unsigned char>(masks[0] & 0xFF));
+            bytes.push_back(static_cast<unsigned char>(masks[0] >> 8));
+            bytes.push_back(static_cast<unsigned char>(masks[1] & 0xFF));
+            bytes.push_back(static_cast<unsigned char>(masks[1] >> 8));
+        }
+        else
+        {
+            for (size_t cell = 0; cell < 9; cell++)
+            {
+                text += (masks[0] & (1u << cell)) ? 'X' : ((masks[1] & (1u << cell)) ? 'O' : '.');
+            }
+            text += '\n';
+        }
+
+        // Flush in chunks so huge files need little memory
+        if ((i + 1) % BATCH_POSITIONS == 0 || i + 1 == count)
+        {
+            file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            file << text;
+            bytes.clear();
+            text.clear();
+        }
+    }
+
+    file.close();
+    if (!file)
+    {
+        return false;
+    }
+
+    return CommitFile(tmpPath, path);
+}
+
+static void PrintStage(const char * name, const StageStats & stats)
+{
+    double busySeconds = std::max(stats.seconds - stats.stallSeconds, 1e-9);
+    std::cout << "  " << std::left << std::setw(8) << name << std::right << std::setw(12) << stats.positions
+              << " positions, " << std::setw(12) << std::setprecision(0) << stats.positions / busySeconds
+              << " positions/sec busy, " << std::setprecision(2) << stats.stallSeconds << " s stalled" << std::endl;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " --input PATH [--output PATH] [--format text|binary]"
+              << " [--threads N] [--engine NAME] [--generate N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string inputPath;
+    std::string outputPath;
+    InputFormat_t format = FORMAT_TEXT;
+    size_t threads = std::min(MAX_SOLVERS, static_cast<size_t>(std::max(1, QThread::idealThreadCount())));
+    std::string engineName = "minimax";
+    unsigned long long generate = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--input") == 0 && hasValue)
+        {
+            inputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--format") == 0 && hasValue)
+        {
+            i++;
+            if (strcmp(argv[i], "text") == 0)
+            {
+                format = FORMAT_TEXT;
+            }
+            else if (strcmp(argv[i], "binary") == 0)
+            {
+                format = FORMAT_BINARY;
+            }
+            else
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--engine") == 0 && hasValue)
+        {
+            engineName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--generate") == 0 && hasValue)
+        {
+            generate = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> names = GetEngineNames();
+    if (inputPath.empty() || threads < 1 || threads > MAX_SOLVERS || std::find(names.begin(), names.end(), engineName) == names.end())
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::cout << std::fixed;
+    if (generate > 0)
+    {
+        bool bGenerated = GeneratePositions(inputPath, format, generate);
+        std::cout << "Generated " << generate << " positions in " << inputPath << std::endl;
+        std::cout << (bGenerated ? "OK" : "FAILED") << std::endl;
+        return bGenerated ? 0 : 1;
+    }
+
+    if (outputPath.empty())
+    {
+        outputPath = inputPath + ".out";
+    }
+
+    std::ifstream input(inputPath, std::ios::binary);
+    std::string tmpPath = outputPath + ".tmp";
+    std::ofstream output(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!input || !output)
+    {
+        std::cout << "Cannot open " << (input ? tmpPath : inputPath) << std::endl;
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<SolverStage> > solvers;
+    for (size_t i = 0; i < threads; i++)
+    {
+        solvers.emplace_back(new SolverStage(s_solverInputs[i], s_solverOutputs[i], engineName));
+    }
+
+    Clock::time_point start = Clock::now();
+    ReaderStage reader(input, format, threads);
+    reader.start();
+    for (auto it = solvers.begin(); it != solvers.end(); it++)
+    {
+        (*it)->start();
+    }
+
+    // Stage 3 runs here, taking batches back in the order they were dealt
+    StageStats writerStats = StageStats();
+    unsigned long long counts[4] = { 0, 0, 0, 0 };
+    size_t sequence = 0;
+    Batch * batch;
+    while ((batch = PopBatch(s_solverOutputs[sequence % threads], writerStats.stallSeconds)) != nullptr)
+    {
+        WriteBatch(output, format, *batch, counts);
+        writerStats.positions += batch->positions.size();
+        delete batch;
+        sequence++;
+    }
+
+    output.close();
+    writerStats.seconds = SecondsSince(start);
+
+    // Solver times are averaged so the rate is that of the whole stage
+    reader.wait();
+    StageStats solverStats = StageStats();
+    for (auto it = solvers.begin(); it != solvers.end(); it++)
+    {
+        (*it)->wait();
+        solverStats.positions += (*it)->stats.positions;
+        solverStats.seconds += (*it)->stats.seconds / threads;
+        solverStats.stallSeconds += (*it)->stats.stallSeconds / threads;
+    }
+    double elapsed = SecondsSince(start);
+
+    bool bOk = !reader.bTruncated && !input.bad() && static_cast<bool>(output) &&
+               writerStats.positions == reader.stats.positions;
+    if (bOk)
+    {
+        bOk = CommitFile(tmpPath, outputPath);
+    }
+
+    std::cout << "Analyzed " << writerStats.positions << " positions with '" << engineName << "' on " << threads
+              << " solver threads in " << std::setprecision(2) << elapsed << " s, " << std::setprecision(0)
+              << writerStats.positions / std::max(elapsed, 1e-9) << " positions/sec" << std::endl;
+    PrintStage("reader", reader.stats);
+    PrintStage("solvers", solverStats);
+    PrintStage("writer", writerStats);
+    std::cout << "  " << counts[TABLEBASE_WIN] << " wins, " << counts[TABLEBASE_DRAW] << " draws, "
+              << counts[TABLEBASE_LOSS] << " losses for the side to move, " << counts[TABLEBASE_ILLEGAL]
+              << " illegal" << std::endl;
+    if (reader.bTruncated)
+    {
+        std::cout << "  input ends in a partial record" << std::endl;
+    }
+    std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk ? 0 : 1;
+}
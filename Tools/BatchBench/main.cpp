@@ -0,0 +1,298 @@
+//--------------------------------------------------------------------------------
+// BatchBench: throughput of the batched board evaluator.
+//
+// Checks random boards with the scalar path and every vector path the CPU
+// supports, verifies they agree and reports boards/sec for each. Random
+// self-play is then timed one game at a time and in lockstep batches, and
+// the MCTS engine, which scores its leaves with batched playouts, plays a
+// few games against the random engine.
+//
+// Usage: BatchBench [--boards N] [--games N] [--batch N] [--mcts-games N]
+//--------------------------------------------------------------------------------
+#include "batcheval.h"
+#include "engine.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+const size_t EVALUATE_REPEATS = 20;
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : MakeBoards
+//
+// @description             : Positions reached by random play, some of them
+//                            finished, in structure-of-arrays layout
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void MakeBoards(size_t count, std::mt19937 & rng, std::vector<BoardMask_t> & first,
+                       std::vector<BoardMask_t> & second)
+{
+    first.assign(count, 0);
+    second.assign(count, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t plies = rng() % 10;
+        for (size_t ply = 0; ply < plies && !IsWinMask(first[i]) && !IsWinMask(second[i]); ply++)
+        {
+            BoardMask_t bit;
+            do
+            {
+                bit = static_cast<BoardMask_t>(1u << (rng() % 9));
+            } while ((first[i] | second[i]) & bit);
+            (ply % 2 == 0 ? first[i] : second[i]) |= bit;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchEvaluate
+//
+// @description             : Times every available path on the same boards and
+//                            compares the results with the scalar path
+//
+// @return                  : true if all paths agree
+//--------------------------------------------------------------------------------
+static bool BenchEvaluate(size_t count, std::mt19937 & rng)
+{
+    std::vector<BoardMask_t> first;
+    std::vector<BoardMask_t> second;
+    MakeBoards(count, rng, first, second);
+
+    std::vector<uint8_t> expected(count);
+    std::vector<uint8_t> status(count);
+    EvaluateBoards(BATCH_ISA_SCALAR, first.data(), second.data(), expected.data(), count);
+
+    bool bOk = true;
+    BatchIsa_t best = GetBestBatchIsa();
+    std::cout << "Evaluating " << count << " boards, best path on this CPU: " << GetBatchIsaName(best) << std::endl;
+
+    for (int isa = BATCH_ISA_SCALAR; isa <= best; isa++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t repeat = 0; repeat < EVALUATE_REPEATS; repeat++)
+        {
+            EvaluateBoards(static_cast<BatchIsa_t>(isa), first.data(), second.data(), status.data(), count);
+        }
+        double seconds = SecondsSince(start);
+
+        bool bMatch = (status == expected);
+        bOk = bOk && bMatch;
+        std::cout << "  " << std::left << std::setw(7) << GetBatchIsaName(static_cast<BatchIsa_t>(isa)) << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(8)
+                  << count * EVALUATE_REPEATS / seconds / 1e6 << " M boards/sec"
+                  << (bMatch ? "" : "  MISMATCH") << std::endl;
+    }
+
+    return bOk;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayScalar
+//
+// @description             : Random games one at a time with per-move win checks
+//
+// @return                  : tally for the first player
+//--------------------------------------------------------------------------------
+static PlayoutTally PlayScalar(size_t games, std::mt19937 & rng)
+{
+    PlayoutTally tally = {0, 0, 0};
+    for (size_t game = 0; game < games; game++)
+    {
+        BoardMask_t masks[2] = {0, 0};
+        for (size_t ply = 0; ; ply++)
+        {
+            if (IsWinMask(masks[0]))
+            {
+                tally.wins++;
+                break;
+            }
+            if (IsWinMask(masks[1]))
+            {
+                tally.losses++;
+                break;
+            }
+            uint32_t empty = ~(masks[0] | masks[1]) & FULL_BOARD_MASK;
+            if (!empty)
+            {
+                tally.draws++;
+                break;
+            }
+            for (int skip = static_cast<int>(rng() % static_cast<uint32_t>(CountBits(empty))); skip > 0; skip--)
+            {
+                empty &= empty - 1;
+            }
+            masks[ply % 2] |= static_cast<BoardMask_t>(empty & (0u - empty));
+        }
+    }
+    return tally;
+}
+
+static void PrintSelfPlay(const char * label, size_t games, const PlayoutTally & tally, double seconds)
+{
+    std::cout << "  " << std::left << std::setw(9) << label << std::right << std::fixed << std::setprecision(2)
+              << std::setw(7) << games / seconds / 1e6 << " M games/sec, first player "
+              << std::setprecision(1) << 100.0 * tally.wins / games << "% / draw "
+              << 100.0 * tally.draws / games << "% / second player " << 100.0 * tally.losses / games << "%"
+              << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchSelfPlay
+//
+// @description             : Random self-play with and without batching. Both
+//                            must land near the known random-play outcome of
+//                            58.5% / 12.7% / 28.8%.
+//
+// @return                  : true if the batched results are plausible
+//--------------------------------------------------------------------------------
+static bool BenchSelfPlay(size_t games, size_t batch, std::mt19937 & rng)
+{
+    std::cout << "Random self-play, " << games << " games" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    PlayoutTally scalar = PlayScalar(games, rng);
+    PrintSelfPlay("scalar", games, scalar, SecondsSince(start));
+
+    BatchPlayouts playouts;
+    PlayoutTally batched = {0, 0, 0};
+    start = std::chrono::steady_clock::now();
+    for (size_t played = 0; played < games; played += batch)
+    {
+        size_t count = std::min(batch, games - played);
+        PlayoutTally tally = playouts.Run(0, 0, count, rng);
+        batched.wins += tally.wins;
+        batched.draws += tally.draws;
+        batched.losses += tally.losses;
+    }
+    PrintSelfPlay("batched", games, batched, SecondsSince(start));
+
+    double firstWinRate = static_cast<double>(batched.wins) / games;
+    return firstWinRate > 0.57 && firstWinRate < 0.60;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayMcts
+//
+// @description             : MCTS against the random engine, alternating who
+//                            moves first
+//
+// @return                  : true if MCTS lost no game
+//--------------------------------------------------------------------------------
+static bool PlayMcts(size_t games)
+{
+    std::unique_ptr<Engine> mcts(CreateEngine("mcts"));
+    std::unique_ptr<Engine> random(CreateEngine("random"));
+    size_t wins = 0;
+    size_t draws = 0;
+    size_t losses = 0;
+    size_t moves = 0;
+    double mctsSeconds = 0;
+
+    for (size_t i = 0; i < games; i++)
+    {
+        Player_t mctsPlayer = (i % 2 == 0) ? PLAYER_USER : PLAYER_COMPUTER;
+        Game game(PLAYER_USER);
+        Player_t turn = PLAYER_USER;
+        while (!game.GameOver())
+        {
+            size_t move;
+            if (turn == mctsPlayer)
+            {
+                auto start = std::chrono::steady_clock::now();
+                move = mcts->SelectMove(game, turn);
+                mctsSeconds += SecondsSince(start);
+                moves++;
+            }
+            else
+            {
+                move = random->SelectMove(game, turn);
+            }
+            game.AddPlayerMarkToBoard(move, turn);
+            turn = (turn == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+        }
+
+        Player_t winner = game.CheckWin();
+        if (winner == mctsPlayer)
+        {
+            wins++;
+        }
+        else if (winner == PLAYER_NONE)
+        {
+            draws++;
+        }
+        else
+        {
+            losses++;
+        }
+    }
+
+    std::cout << "MCTS vs random, " << games << " games: " << wins << " won, " << draws << " drawn, " << losses
+              << " lost, " << std::setprecision(2) << 1000 * mctsSeconds / moves << " ms per move" << std::endl;
+    return losses == 0;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--boards N] [--games N] [--batch N] [--mcts-games N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t boards = 1 << 20;
+    size_t games = 2000000;
+    size_t batch = 256;
+    size_t mctsGames = 20;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--boards") == 0 && hasValue)
+        {
+            boards = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && hasValue)
+        {
+            batch = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--mcts-games") == 0 && hasValue)
+        {
+            mctsGames = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (boards < 1 || games < 1 || batch < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    // Fixed seed so runs are comparable
+    std::mt19937 rng(20200117);
+    bool bOk = BenchEvaluate(boards, rng);
+    bOk = BenchSelfPlay(games, batch, rng) && bOk;
+    if (mctsGames > 0)
+    {
+        bOk = PlayMcts(mctsGames) && bOk;
+    }
+
+    std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+//--------------------------------------------------------------------------------
+// BookGen: builds the opening book of an m,n,k board and measures what it
+// saves in play.
+//
+// Every unfinished position of the first --plies plies (one per symmetry
+// class on square boards) is searched for --budget ms on --threads threads
+// and the best moves are written to --book. An existing book is reused
+// unless --force is given. The book is then memory mapped and --games
+// self-play games, each opened with a random move, are played with and
+// without it; the latency of the moves the book covers and the book hit
+// rate are reported.
+//
+// Usage: BookGen [--board WxHxK] [--plies N] [--budget MS] [--threads N]
+//                [--book PATH] [--games N] [--move-budget MS] [--force]
+//--------------------------------------------------------------------------------
+#include "mnkengine.h"
+#include "openingbook.h"
+#include <QThread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+struct PlayResult
+{
+    size_t games;
+    size_t wins[PLAYER_NONE + 1];           // by winner, PLAYER_NONE for draws
+    size_t earlyMoves;                      // moves the book covers
+    double earlySeconds;
+    double maxEarlySeconds;
+    double lateSeconds;
+    size_t lateMoves;
+    MnkSearchStats stats;
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayGames
+//
+// @description             : Self-play with one engine for both sides. Game i
+//                            opens on a random cell drawn from a generator
+//                            seeded the same for every call, so runs with and
+//                            without the book play the same openings.
+//
+// @return                  : PlayResult
+//--------------------------------------------------------------------------------
+static PlayResult PlayGames(size_t width, size_t height, size_t k, size_t games, int moveBudgetMs,
+                            size_t bookPlies, const OpeningBook * book)
+{
+    PlayResult result = PlayResult();
+    MnkEngine engine;
+    engine.SetBoard(width, height, k);
+    engine.SetOpeningBook(book);
+
+    std::mt19937 rng(20200117);
+    std::uniform_int_distribution<size_t> firstMove(0, width * height - 1);
+    for (size_t i = 0; i < games; i++)
+    {
+        MnkGame game(width, height, k);
+        game.AddPlayerMarkToBoard(firstMove(rng));
+
+        while (!game.GameOver())
+        {
+            auto start = std::chrono::steady_clock::now();
+            size_t move = engine.SelectMove(game, moveBudgetMs);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (game.GetMoveHistory().size() < bookPlies)
+            {
+                result.earlyMoves++;
+                result.earlySeconds += seconds;
+                result.maxEarlySeconds = std::max(result.maxEarlySeconds, seconds);
+            }
+            else
+            {
+                result.lateMoves++;
+                result.lateSeconds += seconds;
+            }
+            game.AddPlayerMarkToBoard(move);
+        }
+
+        result.wins[game.CheckWin()]++;
+        result.games++;
+    }
+
+    result.stats = engine.GetStats();
+    return result;
+}
+
+static void PrintResult(const char * name, const PlayResult & result)
+{
+    double hitRate = result.stats.bookProbes ? 100.0 * result.stats.bookHits / result.stats.bookProbes : 0.0;
+    std::cout << std::left << std::setw(14) << name << std::right << std::fixed
+              << std::setw(8) << result.earlyMoves
+              << std::setw(14) << std::setprecision(1)
+              << (result.earlyMoves ? 1e6 * result.earlySeconds / result.earlyMoves : 0.0)
+              << std::setw(14) << 1e6 * result.maxEarlySeconds
+              << std::setw(14) << (result.lateMoves ? 1e6 * result.lateSeconds / result.lateMoves : 0.0)
+              << std::setw(10) << result.stats.bookHits << "/" << std::left << std::setw(8)
+              << result.stats.bookProbes << std::right << std::setw(8) << hitRate << "%"
+              << std::setw(6) << result.wins[PLAYER_USER] << "/" << result.wins[PLAYER_NONE] << "/"
+              << result.wins[PLAYER_COMPUTER] << std::endl;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--board WxHxK] [--plies N] [--budget MS] [--threads N]"
+              << " [--book PATH] [--games N] [--move-budget MS] [--force]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t width = 4;
+    size_t height = 4;
+    size_t k = 4;
+    size_t plies = 4;
+    int budgetMs = 200;
+    size_t threads = static_cast<size_t>(QThread::idealThreadCount());
+    std::string path;
+    size_t games = 20;
+    int moveBudgetMs = 50;
+    bool bForce = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--board") == 0 && hasValue)
+        {
+            if (sscanf(argv[++i], "%zux%zux%zu", &width, &height, &k) != 3)
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--plies") == 0 && hasValue)
+        {
+            plies = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && hasValue)
+        {
+            budgetMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--book") == 0 && hasValue)
+        {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--move-budget") == 0 && hasValue)
+        {
+            moveBudgetMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--force") == 0)
+        {
+            bForce = true;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (width < 1 || height < 1 || k < 1 || width * height > 64 || plies < 1 || budgetMs < 1 ||
+        threads < 1 || moveBudgetMs < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (path.empty())
+    {
+        path = GetOpeningBookFileName(width, height, k);
+    }
+
+    std::cout << width << "x" << height << " k=" << k << ", book of the first " << plies << " plies: "
+              << path << std::endl;
+
+    if (bForce || !std::ifstream(path.c_str()).good())
+    {
+        OpeningBookStats stats;
+        if (!GenerateOpeningBook(width, height, k, plies, budgetMs, threads, path, stats))
+        {
+            std::cout << "Could not write " << path << std::endl;
+            return 1;
+        }
+        std::cout << "Generated " << stats.positions << " positions at " << budgetMs << " ms each on "
+                  << threads << " threads in " << std::fixed << std::setprecision(2) << stats.seconds
+                  << " s, " << stats.nodes << " nodes, " << stats.fileBytes << " bytes" << std::endl;
+    }
+
+    auto openStart = std::chrono::steady_clock::now();
+    OpeningBook book;
+    if (!book.Open(path))
+    {
+        std::cout << path << " is not an opening book" << std::endl;
+        return 1;
+    }
+    double openSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStart).count();
+    if (!book.Covers(width, height, k, 0))
+    {
+        std::cout << path << " is for another board" << std::endl;
+        return 1;
+    }
+    std::cout << "Opened " << book.GetEntryCount() << " entries covering " << book.GetPlies() << " plies in "
+              << std::fixed << std::setprecision(1) << 1e6 * openSeconds << " us" << std::endl << std::endl;
+
+    std::cout << games << " self-play games, " << moveBudgetMs << " ms per searched move" << std::endl;
+    std::cout << std::left << std::setw(14) << "engine" << std::right << std::setw(8) << "early"
+              << std::setw(14) << "early us" << std::setw(14) << "max us" << std::setw(14) << "later us"
+              << std::setw(19) << "book hits" << std::setw(9) << "rate"
+              << std::setw(12) << "X/draw/O" << std::endl;
+
+    PlayResult withBook = PlayGames(width, height, k, games, moveBudgetMs, book.GetPlies(), &book);
+    PrintResult("book", withBook);
+    PlayResult withoutBook = PlayGames(width, height, k, games, moveBudgetMs, book.GetPlies(), nullptr);
+    PrintResult("search only", withoutBook);
+
+    double bookLatency = withBook.earlyMoves ? withBook.earlySeconds / withBook.earlyMoves : 0.0;
+    double searchLatency = withoutBook.earlyMoves ? withoutBook.earlySeconds / withoutBook.earlyMoves : 0.0;
+    std::cout << std::endl << "Early moves: " << std::setprecision(1) << 1e6 * bookLatency << " us with the book, "
+              << 1e6 * searchLatency << " us searched";
+    if (bookLatency > 0.0)
+    {
+        std::cout << " (" << std::setprecision(0) << searchLatency / bookLatency << "x)";
+    }
+    std::cout << std::endl;
+
+    // Every covered position is in the book, so every probe should hit
+    bool bPassed = (withBook.stats.bookHits == withBook.stats.bookProbes);
+    std::cout << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,347 @@
+//--------------------------------------------------------------------------------
+// DfpnSolve: proves m,n,k positions won, drawn or lost with df-pn.
+//
+// The root positions are every position reachable in --plies moves from the
+// empty board, one per symmetry class on square boards. They are solved in
+// parallel, each worker with its own bounded transposition table. With
+// --checkpoint every root saves its proof to DIR at regular intervals and a
+// rerun picks up where the previous one stopped.
+//
+// Usage: DfpnSolve [--board WxHxK] [--plies N] [--threads N] [--memory MB]
+//                  [--nodes N] [--checkpoint DIR]
+//--------------------------------------------------------------------------------
+#include "dfpn.h"
+#include "symmetry.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+const unsigned long long CHECKPOINT_NODES = 2000000;
+
+struct RootResult
+{
+    ProofResult_t result;
+    ProofNumbers winProof;
+    ProofNumbers lossProof;
+    unsigned long long nodes;
+    double seconds;
+};
+
+//------------------------------------------------------------------------
+// Root positions handed out to the workers one at a time
+//------------------------------------------------------------------------
+class RootQueue
+{
+private:
+    QMutex m_mutex;
+    size_t m_next;
+    size_t m_count;
+
+public:
+    explicit RootQueue(size_t count) : m_next(0), m_count(count) {}
+
+    bool Claim(size_t & index)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_next >= m_count)
+        {
+            return false;
+        }
+
+        index = m_next++;
+        return true;
+    }
+};
+
+class SolveWorker: public QThread
+{
+private:
+    RootQueue & m_queue;
+    const std::vector<MnkGame> & m_roots;
+    std::vector<RootResult> & m_results;
+    DfpnSolver m_solver;
+    unsigned long long m_maxNodes;
+    std::string m_checkpointDir;
+
+public:
+    SolveWorker(RootQueue & queue, const std::vector<MnkGame> & roots, std::vector<RootResult> & results,
+                size_t memoryMb, unsigned long long maxNodes, const std::string & checkpointDir)
+        : QThread(), m_queue(queue), m_roots(roots), m_results(results), m_solver(memoryMb),
+          m_maxNodes(maxNodes), m_checkpointDir(checkpointDir)
+    {
+    }
+
+    size_t GetTableBytes() const { return m_solver.GetTableBytes(); }
+    size_t GetTableEntriesUsed() const { return m_solver.GetTableEntriesUsed(); }
+
+    void run()
+    {
+        size_t index;
+        while (m_queue.Claim(index))
+        {
+            const MnkGame & root = m_roots[index];
+            std::string checkpoint;
+            if (!m_checkpointDir.empty())
+            {
+                std::ostringstream path;
+                path << m_checkpointDir << "/" << root.GetWidth() << "x" << root.GetHeight() << "k" << root.GetK()
+                     << "_" << root.GetMoveHistory().size() << "_" << index << ".dfpn";
+                checkpoint = path.str();
+            }
+
+            // Each root owns its slot, no locking needed
+            RootResult & result = m_results[index];
+            result.result = m_solver.Solve(root, m_maxNodes, checkpoint, CHECKPOINT_NODES);
+            result.winProof = m_solver.GetWinProof();
+            result.lossProof = m_solver.GetLossProof();
+            result.nodes = m_solver.GetNodes();
+            result.seconds = m_solver.GetSeconds();
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : GetCanonicalCells
+//
+// @description             : Smallest of the symmetric images of the board, so
+//                            equivalent positions compare equal
+//
+// @return                  : cells of the canonical image
+//--------------------------------------------------------------------------------
+static std::vector<Player_t> GetCanonicalCells(const MnkGame & game)
+{
+    const std::vector<Player_t> & cells = game.GetCells();
+    if (game.GetWidth() != game.GetHeight())
+    {
+        return cells;
+    }
+
+    std::vector<Player_t> best = cells;
+    for (int symmetry = 1; symmetry < SYMMETRY_COUNT; symmetry++)
+    {
+        std::vector<Player_t> image(cells.size());
+        for (size_t cell = 0; cell < cells.size(); cell++)
+        {
+            image[TransformCell(cell, game.GetWidth(), symmetry)] = cells[cell];
+        }
+        best = std::min(best, image);
+    }
+
+    return best;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CollectRoots
+//
+// @description             : Unfinished positions 'plies' moves deep, one per
+//                            symmetry class
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void CollectRoots(MnkGame & game, size_t plies, std::set<std::vector<Player_t>> & seen,
+                         std::vector<MnkGame> & roots)
+{
+    if (game.GameOver())
+    {
+        return;
+    }
+    if (plies == 0)
+    {
+        if (seen.insert(GetCanonicalCells(game)).second)
+        {
+            roots.push_back(game);
+        }
+        return;
+    }
+
+    std::vector<size_t> moves = game.GetAvailableMoves();
+    for (auto it = moves.begin(); it != moves.end(); it++)
+    {
+        game.AddPlayerMarkToBoard(*it);
+        CollectRoots(game, plies - 1, seen, roots);
+        game.UndoMove();
+    }
+}
+
+static const char * ResultName(ProofResult_t result)
+{
+    switch (result)
+    {
+    case PROOF_WIN:
+        return "win";
+    case PROOF_DRAW:
+        return "draw";
+    case PROOF_LOSS:
+        return "loss";
+    default:
+        return "unknown";
+    }
+}
+
+static std::string FormatProofNumber(uint32_t number)
+{
+    return (number >= PROOF_INFINITY) ? std::string("inf") : std::to_string(number);
+}
+
+static std::string FormatMoves(const MnkGame & game)
+{
+    std::ostringstream text;
+    const std::vector<size_t> & history = game.GetMoveHistory();
+    for (size_t i = 0; i < history.size(); i++)
+    {
+        // Cells shown 1-based, like the GUI
+        text << (i ? " " : "") << history[i] + 1;
+    }
+    return history.empty() ? std::string("(empty)") : text.str();
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--board WxHxK] [--plies N] [--threads N] [--memory MB]"
+              << " [--nodes N] [--checkpoint DIR]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t width = 4;
+    size_t height = 4;
+    size_t k = 4;
+    size_t plies = 1;
+    size_t threads = static_cast<size_t>(QThread::idealThreadCount());
+    size_t memoryMb = 64;
+    unsigned long long maxNodes = 0;
+    std::string checkpointDir;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--board") == 0 && hasValue)
+        {
+            if (sscanf(argv[++i], "%zux%zux%zu", &width, &height, &k) != 3)
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--plies") == 0 && hasValue)
+        {
+            plies = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--memory") == 0 && hasValue)
+        {
+            memoryMb = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--nodes") == 0 && hasValue)
+        {
+            maxNodes = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && hasValue)
+        {
+            checkpointDir = argv[++i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (width < 1 || height < 1 || k < 1 || threads < 1 || memoryMb < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    MnkGame empty(width, height, k);
+    std::set<std::vector<Player_t>> seen;
+    std::vector<MnkGame> roots;
+    CollectRoots(empty, plies, seen, roots);
+    if (roots.empty())
+    {
+        std::cout << "No unfinished positions " << plies << " plies deep" << std::endl;
+        return 1;
+    }
+    threads = std::min(threads, roots.size());
+
+    RootQueue queue(roots.size());
+    std::vector<RootResult> results(roots.size());
+    std::vector<SolveWorker *> workers;
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers.push_back(new SolveWorker(queue, roots, results, memoryMb, maxNodes, checkpointDir));
+    }
+
+    // The table is rounded down to a power of two, report what was allocated
+    std::cout << width << "x" << height << " k=" << k << ": " << roots.size() << " root positions at ply "
+              << plies << " on " << threads << " threads, " << std::fixed << std::setprecision(1)
+              << workers.front()->GetTableBytes() / (1024.0 * 1024.0) << " MB table each" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto it = workers.begin(); it != workers.end(); it++)
+    {
+        (*it)->start();
+    }
+
+    size_t tableBytes = 0;
+    size_t tableEntriesUsed = 0;
+    for (auto it = workers.begin(); it != workers.end(); it++)
+    {
+        (*it)->wait();
+        tableBytes += (*it)->GetTableBytes();
+        tableEntriesUsed += (*it)->GetTableEntriesUsed();
+        delete *it;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::left << std::setw(20) << "moves" << std::right << std::setw(9) << "result"
+              << std::setw(22) << "win pn/dn" << std::setw(22) << "loss pn/dn"
+              << std::setw(14) << "nodes" << std::setw(14) << "nodes/sec" << std::endl;
+
+    unsigned long long totalNodes = 0;
+    double proofSeconds = 0.0;
+    size_t counts[PROOF_LOSS + 1] = {0};
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        const RootResult & result = results[i];
+        totalNodes += result.nodes;
+        proofSeconds += result.seconds;
+        counts[result.result]++;
+
+        std::string winProof = FormatProofNumber(result.winProof.pn) + "/" + FormatProofNumber(result.winProof.dn);
+        std::string lossProof = FormatProofNumber(result.lossProof.pn) + "/" + FormatProofNumber(result.lossProof.dn);
+        if (result.result == PROOF_WIN)
+        {
+            lossProof = "-";
+        }
+
+        std::cout << std::left << std::setw(20) << FormatMoves(roots[i]) << std::right
+                  << std::setw(9) << ResultName(result.result) << std::setw(22) << winProof
+                  << std::setw(22) << lossProof << std::setw(14) << result.nodes
+                  << std::setw(14) << std::fixed << std::setprecision(0)
+                  << (result.seconds > 0.0 ? result.nodes / result.seconds : 0.0) << std::endl;
+    }
+
+    std::cout << std::endl << "Results: " << counts[PROOF_WIN] << " win, " << counts[PROOF_DRAW] << " draw, "
+              << counts[PROOF_LOSS] << " loss, " << counts[PROOF_UNKNOWN] << " unknown (side to move)" << std::endl;
+    // Node counts and proof times include work resumed from checkpoints
+    std::cout << "Nodes  : " << totalNodes << ", " << std::setprecision(0)
+              << (proofSeconds > 0.0 ? totalNodes / proofSeconds : 0.0) << " nodes/sec per thread, "
+              << std::setprecision(2) << seconds << " s wall time" << std::endl;
+    std::cout << "Memory : " << std::setprecision(1) << tableBytes / (1024.0 * 1024.0) << " MB of tables, "
+              << tableEntriesUsed << " entries used" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,419 @@
+//--------------------------------------------------------------------------------
+// EvalBench: incremental open-line counts of the m,n,k engines.
+//
+// 1. Checks: random make/unmake walks on several boards, up to 19x19, with
+//    the counts compared after every step against a rescan of the board.
+// 2. Cost: one evaluation from the counts against one rescan of the board.
+// 3. Alpha-beta: nodes per second of MnkEngine at a fixed depth.
+// 4. MCTS: iterations per second and random moves per rollout of
+//    MnkMctsEngine with rollouts cut off by the counts after a few plies
+//    and played out to the end, then a match between the two settings.
+//
+// Usage: EvalBench [--steps N] [--games N] [--iterations N]
+//--------------------------------------------------------------------------------
+#include "mnkengine.h"
+#include "mnkmcts.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+struct BenchBoard
+{
+    size_t width;
+    size_t height;
+    size_t k;
+};
+
+static const BenchBoard CHECK_BOARDS[] =
+{
+    {3, 3, 3},
+    {4, 4, 4},
+    {7, 6, 4},
+    {8, 8, 5},
+    {15, 15, 5},
+    {19, 19, 5},
+};
+
+static const BenchBoard COST_BOARDS[] =
+{
+    {8, 8, 5},
+    {15, 15, 5},
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : ScanOpenLines
+//
+// @description             : Open lines per stone count for both colours,
+//                            walking every line of the board cell by cell.
+//                            'cells' holds the colour of each stone, -1 when
+//                            empty.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void ScanOpenLines(const BenchBoard & board, const std::vector<int> & cells, std::vector<int> open[2])
+{
+    static const int DIRECTIONS[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+    const int width = static_cast<int>(board.width);
+    const int height = static_cast<int>(board.height);
+    const int k = static_cast<int>(board.k);
+
+    open[0].assign(board.k + 1, 0);
+    open[1].assign(board.k + 1, 0);
+    for (int d = 0; d < 4; d++)
+    {
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int endX = x + DIRECTIONS[d][0] * (k - 1);
+                int endY = y + DIRECTIONS[d][1] * (k - 1);
+                if (endX >= width || endY < 0 || endY >= height)
+                {
+                    continue;
+                }
+
+                int stones[2] = {0, 0};
+                for (int i = 0; i < k; i++)
+                {
+                    int cell = cells[(y + DIRECTIONS[d][1] * i) * width + x + DIRECTIONS[d][0] * i];
+                    if (cell >= 0)
+                    {
+                        stones[cell]++;
+                    }
+                }
+                for (int color = 0; color < 2; color++)
+                {
+                    if (stones[1 - color] == 0)
+                    {
+                        open[color][stones[color]]++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static bool SameCounts(const MnkLineCounts & counts, const std::vector<int> open[2], size_t k)
+{
+    for (int color = 0; color < 2; color++)
+    {
+        for (size_t stones = 0; stones <= k; stones++)
+        {
+            if (counts.GetOpenLines(color, stones) != open[color][stones])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CheckBoard
+//
+// @description             : Random walk of 'steps' stones placed and taken
+//                            off, mostly placed until the board fills, with
+//                            the counts checked after every step
+//
+// @return                  : true if the counts always matched the rescan
+//--------------------------------------------------------------------------------
+static bool CheckBoard(const BenchBoard & board, size_t steps, std::mt19937 & rng)
+{
+    size_t cellCount = board.width * board.height;
+    MnkLineCounts counts;
+    counts.Reset(GetMnkLineTable(board.width, board.height, board.k));
+    std::vector<int> cells(cellCount, -1);
+    std::vector<size_t> placed;
+    std::vector<int> open[2];
+    std::uniform_int_distribution<size_t> pickCell(0, cellCount - 1);
+
+    for (size_t step = 0; step < steps; step++)
+    {
+        bool bRemove = !placed.empty() && (placed.size() == cellCount || rng() % 3 == 0);
+        if (bRemove)
+        {
+            size_t cell = placed.back();
+            counts.Remove(cell, cells[cell]);
+            cells[cell] = -1;
+            placed.pop_back();
+        }
+        else
+        {
+            size_t cell = pickCell(rng);
+            while (cells[cell] >= 0)
+            {
+                cell = (cell + 1) % cellCount;
+            }
+            cells[cell] = static_cast<int>(placed.size() & 1);
+            counts.Place(cell, cells[cell]);
+            placed.push_back(cell);
+        }
+
+        ScanOpenLines(board, cells, open);
+        if (!SameCounts(counts, open, board.k))
+        {
+            std::cout << "  mismatch after step " << step << std::endl;
+            return false;
+        }
+    }
+
+    // Everything taken back must leave the empty board
+    while (!placed.empty())
+    {
+        counts.Remove(placed.back(), cells[placed.back()]);
+        cells[placed.back()] = -1;
+        placed.pop_back();
+    }
+    ScanOpenLines(board, cells, open);
+    return SameCounts(counts, open, board.k);
+}
+
+static std::vector<int> MakeWeights(size_t k)
+{
+    std::vector<int> weights(k + 1, 0);
+    for (size_t count = 1; count < k; count++)
+    {
+        weights[count] = 1 << std::min<size_t>(2 * count, 16);
+    }
+    return weights;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : MeasureCost
+//
+// @description             : Times evaluations from the counts against
+//                            rescans of a half full board
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void MeasureCost(const BenchBoard & board, std::mt19937 & rng)
+{
+    size_t cellCount = board.width * board.height;
+    MnkLineCounts counts;
+    counts.Reset(GetMnkLineTable(board.width, board.height, board.k));
+    std::vector<int> cells(cellCount, -1);
+    std::vector<int> weights = MakeWeights(board.k);
+    std::uniform_int_distribution<size_t> pickCell(0, cellCount - 1);
+    for (size_t stone = 0; stone < cellCount / 2; stone++)
+    {
+        size_t cell = pickCell(rng);
+        while (cells[cell] >= 0)
+        {
+            cell = (cell + 1) % cellCount;
+        }
+        cells[cell] = static_cast<int>(stone & 1);
+        counts.Place(cell, cells[cell]);
+    }
+
+    const int rescans = 20000;
+    volatile int sink = 0;
+    std::vector<int> open[2];
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rescans; i++)
+    {
+        ScanOpenLines(board, cells, open);
+        int score = 0;
+        for (size_t stones = 1; stones < weights.size(); stones++)
+        {
+            score += weights[stones] * (open[0][stones] - open[1][stones]);
+        }
+        sink = sink + score;
+    }
+    double scanNs = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rescans;
+
+    // A make, an evaluation and an unmake, as a search leaf pays for them
+    const int updates = 2000000;
+    size_t empty = 0;
+    while (cells[empty] >= 0)
+    {
+        empty++;
+    }
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < updates; i++)
+    {
+        counts.Place(empty, 0);
+        sink = sink + counts.Evaluate(1, weights);
+        counts.Remove(empty, 0);
+    }
+    double updateNs = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / updates;
+
+    std::cout << "  " << board.width << "x" << board.height << " k=" << board.k << ": rescan "
+              << std::fixed << std::setprecision(1) << scanNs << " ns, make + evaluate + unmake "
+              << updateNs << " ns (" << scanNs / updateNs << "x)" << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayMatch
+//
+// @description             : MCTS with rollout cutoffs against MCTS with full
+//                            random rollouts, each side first in half the games
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void PlayMatch(const BenchBoard & board, int games, unsigned long long iterations, std::mt19937 & rng)
+{
+    MnkMctsEngine engines[2];
+    engines[0].SetRolloutPlies(MNK_MCTS_ROLLOUT_PLIES);
+    engines[1].SetRolloutPlies(0);
+    int wins[2] = {0, 0};
+    int draws = 0;
+
+    for (int g = 0; g < games; g++)
+    {
+        MnkGame game(board.width, board.height, board.k);
+
+        // Two random stones so that the games differ
+        for (int i = 0; i < 2; i++)
+        {
+            std::vector<size_t> moves = game.GetAvailableMoves();
+            game.AddPlayerMarkToBoard(moves[rng() % moves.size()]);
+        }
+
+        int first = g % 2;
+        while (!game.GameOver())
+        {
+            int side = (game.GetMoveHistory().size() % 2 == 0) ? first : 1 - first;
+            MnkMctsEngine & engine = engines[side];
+            engine.SetBoard(board.width, board.height, board.k);
+
+            uint64_t own = 0;
+            uint64_t opponent = 0;
+            for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+            {
+                if (game.GetCell(cell) == game.GetTurn())
+                {
+                    own |= 1ULL << cell;
+                }
+                else if (game.GetCell(cell) != PLAYER_NONE)
+                {
+                    opponent |= 1ULL << cell;
+                }
+            }
+            game.AddPlayerMarkToBoard(engine.Search(own, opponent, 0, iterations));
+        }
+
+        Player_t winner = game.CheckWin();
+        if (winner == PLAYER_NONE)
+        {
+            draws++;
+        }
+        else
+        {
+            // The first player of MnkGame is PLAYER_USER
+            bool bFirstWon = (winner == PLAYER_USER);
+            wins[bFirstWon ? first : 1 - first]++;
+        }
+    }
+
+    std::cout << "  cutoff after " << MNK_MCTS_ROLLOUT_PLIES << " plies vs full rollouts, " << games << " games of "
+              << iterations << " iterations a move: " << wins[0] << " won, " << draws << " drawn, " << wins[1]
+              << " lost, " << std::fixed << std::setprecision(1) << 100.0 * (wins[0] + 0.5 * draws) / games
+              << "% for the cutoff" << std::endl;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--steps N] [--games N] [--iterations N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t steps = 2000;
+    int games = 40;
+    unsigned long long iterations = 20000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--steps") == 0 && hasValue)
+        {
+            steps = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+        {
+            iterations = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (steps < 1 || games < 0 || iterations < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(20200117);
+    bool bPassed = true;
+
+    std::cout << "Line counts against a rescan, " << steps << " random steps a board" << std::endl;
+    for (size_t i = 0; i < sizeof(CHECK_BOARDS) / sizeof(CHECK_BOARDS[0]); i++)
+    {
+        bool bSame = CheckBoard(CHECK_BOARDS[i], steps, rng);
+        bPassed = bPassed && bSame;
+        std::cout << "  " << CHECK_BOARDS[i].width << "x" << CHECK_BOARDS[i].height << " k=" << CHECK_BOARDS[i].k
+                  << ": " << (bSame ? "same" : "DIFFERENT") << std::endl;
+    }
+
+    std::cout << std::endl << "Leaf evaluation cost" << std::endl;
+    for (size_t i = 0; i < sizeof(COST_BOARDS) / sizeof(COST_BOARDS[0]); i++)
+    {
+        MeasureCost(COST_BOARDS[i], rng);
+    }
+
+    const BenchBoard searchBoard = {7, 7, 5};
+    std::cout << std::endl << "Alpha-beta on " << searchBoard.width << "x" << searchBoard.height << " k="
+              << searchBoard.k << ", empty board to depth 6" << std::endl;
+    {
+        MnkEngine engine;
+        engine.SetBoard(searchBoard.width, searchBoard.height, searchBoard.k);
+        int score;
+        auto start = std::chrono::steady_clock::now();
+        engine.Search(0, 0, 0, 6, score);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << engine.GetStats().nodes << " nodes in " << std::fixed << std::setprecision(3)
+                  << seconds << " s, " << std::setprecision(0) << engine.GetStats().nodes / seconds
+                  << " nodes/s" << std::endl;
+    }
+
+    std::cout << std::endl << "MCTS on " << searchBoard.width << "x" << searchBoard.height << " k="
+              << searchBoard.k << ", empty board, 200000 iterations" << std::endl;
+    const int rolloutPlies[] = {MNK_MCTS_ROLLOUT_PLIES, 0};
+    for (size_t i = 0; i < sizeof(rolloutPlies) / sizeof(rolloutPlies[0]); i++)
+    {
+        MnkMctsEngine engine;
+        engine.SetBoard(searchBoard.width, searchBoard.height, searchBoard.k);
+        engine.SetRolloutPlies(rolloutPlies[i]);
+        auto start = std::chrono::steady_clock::now();
+        engine.Search(0, 0, 0, 200000);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const MnkMctsStats & stats = engine.GetStats();
+        std::cout << "  " << (rolloutPlies[i] > 0 ? "cutoff after " + std::to_string(rolloutPlies[i]) + " plies"
+                                                  : std::string("full rollouts"))
+                  << ": " << std::fixed << std::setprecision(0) << stats.iterations / seconds << " iterations/s, "
+                  << std::setprecision(1) << static_cast<double>(stats.rolloutPlies) / stats.iterations
+                  << " random moves a rollout, " << stats.threatCutoffs << " threat and " << stats.evalCutoffs
+                  << " evaluation cutoffs" << std::endl;
+    }
+
+    if (games > 0)
+    {
+        PlayMatch(searchBoard, games, iterations, rng);
+    }
+
+    std::cout << std::endl << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,665 @@
+//--------------------------------------------------------------------------------
+// EvalTrain: trains the Gomoku evaluation network from self-play records.
+//
+// 1. Self-play: the Gomoku engine plays itself from random openings and the
+//    games are appended to a record file, one game per line:
+//    "<size> <result> <moves...>", result 0 draw, 1 first player, 2 second.
+// 2. Training: every position of the recorded games, in all 8 symmetries,
+//    is a sample labelled with the final result for the side to move. The
+//    network is trained in floating point with SGD, quantised and saved.
+// 3. Checks: validation loss before and after quantisation, agreement of
+//    the scalar and SIMD paths, and the cost of an incremental update and
+//    of an evaluation. Optionally plays the engine with the network against
+//    the engine without it.
+//
+// Usage: EvalTrain [--games N] [--records PATH] [--out PATH] [--epochs N]
+//                  [--budget MS] [--match N]
+//--------------------------------------------------------------------------------
+#include "gomoku.h"
+#include "nnue.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+const int BOARD_SIZE = 15;
+const size_t BOARD_CELLS = BOARD_SIZE * BOARD_SIZE;
+const size_t RANDOM_OPENING_PLIES = 6;
+const size_t VALIDATION_PERCENT = 10;
+const float LEARNING_RATE = 0.01f;
+const float MAX_FEATURE_WEIGHT = 1.0f;     // keeps 225 stones inside int16 after quantisation
+const size_t BENCH_UPDATES = 10000000;
+
+struct GameRecord
+{
+    int result;
+    std::vector<uint16_t> moves;
+};
+
+struct Sample
+{
+    std::vector<uint16_t> own;      // stones of the side to move
+    std::vector<uint16_t> opponent;
+    float target;                   // 1 win, 0.5 draw, 0 loss for the side to move
+};
+
+//------------------------------------------------------------------------
+// Floating point copy of the network used for training
+//------------------------------------------------------------------------
+struct FloatNetwork
+{
+    std::vector<float> featureWeights;
+    std::vector<float> bias;
+    std::vector<float> outputWeights;
+    float outputBias;
+
+    explicit FloatNetwork(std::mt19937 & rng)
+    {
+        std::uniform_real_distribution<float> small(-0.05f, 0.05f);
+        std::uniform_real_distribution<float> output(-0.3f, 0.3f);
+        featureWeights.resize(2 * BOARD_CELLS * NNUE_HIDDEN);
+        for (auto it = featureWeights.begin(); it != featureWeights.end(); it++)
+        {
+            *it = small(rng);
+        }
+        bias.assign(NNUE_HIDDEN, 0.25f);
+        outputWeights.resize(2 * NNUE_HIDDEN);
+        for (auto it = outputWeights.begin(); it != outputWeights.end(); it++)
+        {
+            *it = output(rng);
+        }
+        outputBias = 0;
+    }
+
+    float * Row(size_t cell, bool bOwn) { return &featureWeights[((bOwn ? 0 : BOARD_CELLS) + cell) * NNUE_HIDDEN]; }
+
+    // Hidden layer of both perspectives, side to move first
+    void Accumulate(const Sample & sample, float * accumulators)
+    {
+        for (size_t h = 0; h < NNUE_HIDDEN; h++)
+        {
+            accumulators[h] = bias[h];
+            accumulators[NNUE_HIDDEN + h] = bias[h];
+        }
+        for (auto it = sample.own.begin(); it != sample.own.end(); it++)
+        {
+            const float * own = Row(*it, true);
+            const float * other = Row(*it, false);
+            for (size_t h = 0; h < NNUE_HIDDEN; h++)
+            {
+                accumulators[h] += own[h];
+                accumulators[NNUE_HIDDEN + h] += other[h];
+            }
+        }
+        for (auto it = sample.opponent.begin(); it != sample.opponent.end(); it++)
+        {
+            const float * own = Row(*it, true);
+            const float * other = Row(*it, false);
+            for (size_t h = 0; h < NNUE_HIDDEN; h++)
+            {
+                accumulators[h] += other[h];
+                accumulators[NNUE_HIDDEN + h] += own[h];
+            }
+        }
+    }
+
+    float Output(const float * accumulators) const
+    {
+        float output = outputBias;
+        for (size_t h = 0; h < 2 * NNUE_HIDDEN; h++)
+        {
+            output += outputWeights[h] * std::min(1.0f, std::max(0.0f, accumulators[h]));
+        }
+        return output;
+    }
+
+    void UpdateRow(size_t cell, bool bOwn, const float * gradient)
+    {
+        float * row = Row(cell, bOwn);
+        for (size_t h = 0; h < NNUE_HIDDEN; h++)
+        {
+            row[h] = std::min(MAX_FEATURE_WEIGHT, std::max(-MAX_FEATURE_WEIGHT, row[h] - LEARNING_RATE * gradient[h]));
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    // One SGD step on the squared error of sigmoid(output)
+    //----------------------------------------------------------------------------
+    float Train(const Sample & sample)
+    {
+        float accumulators[2 * NNUE_HIDDEN];
+        Accumulate(sample, accumulators);
+        float prediction = 1.0f / (1.0f + std::exp(-Output(accumulators)));
+        float error = prediction - sample.target;
+        float outputGradient = error * prediction * (1.0f - prediction);
+
+        float hiddenGradient[2 * NNUE_HIDDEN];
+        for (size_t h = 0; h < 2 * NNUE_HIDDEN; h++)
+        {
+            float activation = std::min(1.0f, std::max(0.0f, accumulators[h]));
+            bool bLinear = accumulators[h] > 0.0f && accumulators[h] < 1.0f;
+            hiddenGradient[h] = bLinear ? outputGradient * outputWeights[h] : 0.0f;
+            outputWeights[h] -= LEARNING_RATE * outputGradient * activation;
+        }
+        outputBias -= LEARNING_RATE * outputGradient;
+
+        const float * ownGradient = hiddenGradient;
+        const float * otherGradient = hiddenGradient + NNUE_HIDDEN;
+        for (size_t h = 0; h < NNUE_HIDDEN; h++)
+        {
+            bias[h] -= LEARNING_RATE * (ownGradient[h] + otherGradient[h]);
+        }
+        for (auto it = sample.own.begin(); it != sample.own.end(); it++)
+        {
+            UpdateRow(*it, true, ownGradient);
+            UpdateRow(*it, false, otherGradient);
+        }
+        for (auto it = sample.opponent.begin(); it != sample.opponent.end(); it++)
+        {
+            UpdateRow(*it, false, ownGradient);
+            UpdateRow(*it, true, otherGradient);
+        }
+
+        return error * error;
+    }
+
+    float Predict(const Sample & sample)
+    {
+        float accumulators[2 * NNUE_HIDDEN];
+        Accumulate(sample, accumulators);
+        return 1.0f / (1.0f + std::exp(-Output(accumulators)));
+    }
+};
+
+static double GetLoss(FloatNetwork & network, const std::vector<Sample> & samples)
+{
+    double loss = 0;
+    for (auto it = samples.begin(); it != samples.end(); it++)
+    {
+        double prediction = network.Predict(*it);
+        loss += (prediction - it->target) * (prediction - it->target);
+    }
+    return loss / samples.size();
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlaySelfPlayGame
+//
+// @description             : Random stones near the centre, then the engine
+//                            plays both sides until the game ends
+//
+// @return                  : the game
+//--------------------------------------------------------------------------------
+static GameRecord PlaySelfPlayGame(GomokuEngine & engine, int budgetMs, std::mt19937 & rng)
+{
+    MnkGame game(BOARD_SIZE, BOARD_SIZE, GOMOKU_K);
+    GameRecord record;
+
+    while (!game.GameOver())
+    {
+        size_t move;
+        if (record.moves.size() < RANDOM_OPENING_PLIES)
+        {
+            do
+            {
+                move = (BOARD_SIZE / 2 - 3 + rng() % 7) * BOARD_SIZE + BOARD_SIZE / 2 - 3 + rng() % 7;
+            } while (game.GetCell(move) != PLAYER_NONE);
+        }
+        else
+        {
+            move = engine.SelectMove(game, budgetMs);
+        }
+        game.AddPlayerMarkToBoard(move);
+        record.moves.push_back(static_cast<uint16_t>(move));
+    }
+
+    Player_t winner = game.CheckWin();
+    record.result = (winner == PLAYER_USER) ? 1 : (winner == PLAYER_COMPUTER) ? 2 : 0;
+    return record;
+}
+
+static bool AppendRecords(const std::string & path, const std::vector<GameRecord> & records)
+{
+    std::ofstream file(path.c_str(), std::ios::app);
+    for (auto it = records.begin(); it != records.end(); it++)
+    {
+        file << BOARD_SIZE << " " << it->result;
+        for (auto move = it->moves.begin(); move != it->moves.end(); move++)
+        {
+            file << " " << *move;
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+static std::vector<GameRecord> ReadRecords(const std::string & path)
+{
+    std::vector<GameRecord> records;
+    std::ifstream file(path.c_str());
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        int size;
+        GameRecord record;
+        if (!(fields >> size >> record.result) || size != BOARD_SIZE)
+        {
+            continue;
+        }
+        unsigned move;
+        while (fields >> move)
+        {
+            if (move < BOARD_CELLS)
+            {
+                record.moves.push_back(static_cast<uint16_t>(move));
+            }
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+static uint16_t Transform(uint16_t cell, int symmetry)
+{
+    int row = cell / BOARD_SIZE;
+    int column = cell % BOARD_SIZE;
+    if (symmetry & 1)
+    {
+        column = BOARD_SIZE - 1 - column;
+    }
+    if (symmetry & 2)
+    {
+        row = BOARD_SIZE - 1 - row;
+    }
+    if (symmetry & 4)
+    {
+        std::swap(row, column);
+    }
+    return static_cast<uint16_t>(row * BOARD_SIZE + column);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : MakeSamples
+//
+// @description             : Every position after the random opening, in all
+//                            8 symmetries of the board
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void MakeSamples(const std::vector<GameRecord> & records, size_t first, size_t last,
+                        std::vector<Sample> & samples)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        const GameRecord & record = records[i];
+        for (size_t ply = RANDOM_OPENING_PLIES; ply < record.moves.size(); ply++)
+        {
+            // Player 1 moves on even plies
+            int toMove = (ply % 2 == 0) ? 1 : 2;
+            float target = (record.result == 0) ? 0.5f : (record.result == toMove) ? 1.0f : 0.0f;
+
+            for (int symmetry = 0; symmetry < 8; symmetry++)
+            {
+                Sample sample;
+                sample.target = target;
+                for (size_t played = 0; played < ply; played++)
+                {
+                    bool bOwn = (played % 2) == (ply % 2);
+                    (bOwn ? sample.own : sample.opponent).push_back(Transform(record.moves[played], symmetry));
+                }
+                samples.push_back(sample);
+            }
+        }
+    }
+}
+
+// Quantised score of a sample through the incremental accumulator
+static int EvaluateQuantised(const EvalNetwork & network, const Sample & sample)
+{
+    EvalAccumulator accumulator;
+    network.Reset(accumulator);
+    for (auto it = sample.own.begin(); it != sample.own.end(); it++)
+    {
+        network.AddStone(accumulator, *it, 1);
+    }
+    for (auto it = sample.opponent.begin(); it != sample.opponent.end(); it++)
+    {
+        network.AddStone(accumulator, *it, 2);
+    }
+    return network.Evaluate(accumulator, 1);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Validate
+//
+// @description             : Mean squared error of the float and the quantised
+//                            network on held out samples, and how far their
+//                            scores differ
+//
+// @return                  : true if quantising cost less than 2% of the loss
+//--------------------------------------------------------------------------------
+static bool Validate(FloatNetwork & floatNetwork, const EvalNetwork & network, const std::vector<Sample> & samples)
+{
+    double floatLoss = 0;
+    double quantisedLoss = 0;
+    double difference = 0;
+    double worst = 0;
+    for (auto it = samples.begin(); it != samples.end(); it++)
+    {
+        float accumulators[2 * NNUE_HIDDEN];
+        floatNetwork.Accumulate(*it, accumulators);
+        double floatScore = floatNetwork.Output(accumulators) * NNUE_SCORE_SCALE;
+        int quantisedScore = EvaluateQuantised(network, *it);
+
+        double floatPrediction = floatNetwork.Predict(*it);
+        double quantisedPrediction = 1.0 / (1.0 + std::exp(-static_cast<double>(quantisedScore) / NNUE_SCORE_SCALE));
+        floatLoss += (floatPrediction - it->target) * (floatPrediction - it->target);
+        quantisedLoss += (quantisedPrediction - it->target) * (quantisedPrediction - it->target);
+        difference += std::fabs(floatScore - quantisedScore);
+        worst = std::max(worst, std::fabs(floatScore - quantisedScore));
+    }
+
+    floatLoss /= samples.size();
+    quantisedLoss /= samples.size();
+    std::cout << "  validation loss " << std::setprecision(4) << floatLoss << " float, " << quantisedLoss
+              << " quantised; score difference mean " << std::setprecision(1) << difference / samples.size()
+              << ", largest " << worst << std::endl;
+    return quantisedLoss <= floatLoss * 1.02;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchNetwork
+//
+// @description             : Checks that every available path gives the same
+//                            scores and times an incremental update and an
+//                            evaluation on each
+//
+// @return                  : true if all paths agree
+//--------------------------------------------------------------------------------
+static bool BenchNetwork(EvalNetwork & network, const std::vector<Sample> & samples)
+{
+    bool bOk = true;
+    BatchIsa_t best = GetBestBatchIsa();
+    std::vector<int> expected;
+
+    std::cout << "Inference" << std::endl;
+    for (int isa = BATCH_ISA_SCALAR; isa <= best; isa++)
+    {
+        network.SetIsa(static_cast<BatchIsa_t>(isa));
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < samples.size() && i < 4096; i++)
+        {
+            int score = EvaluateQuantised(network, samples[i]);
+            if (isa == BATCH_ISA_SCALAR)
+            {
+                expected.push_back(score);
+            }
+            else if (score != expected[i])
+            {
+                mismatches++;
+            }
+        }
+        bOk = bOk && mismatches == 0;
+
+        EvalAccumulator accumulator;
+        network.Reset(accumulator);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < BENCH_UPDATES; i += 2)
+        {
+            size_t cell = i % BOARD_CELLS;
+            network.AddStone(accumulator, cell, 1);
+            network.RemoveStone(accumulator, cell, 1);
+        }
+        double updateNs = SecondsSince(start) * 1e9 / BENCH_UPDATES;
+
+        int checksum = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < BENCH_UPDATES; i++)
+        {
+            checksum += network.Evaluate(accumulator, 1 + static_cast<int>(i & 1));
+        }
+        double evaluateNs = SecondsSince(start) * 1e9 / BENCH_UPDATES;
+
+        std::cout << "  " << std::left << std::setw(7) << GetBatchIsaName(static_cast<BatchIsa_t>(isa)) << std::right
+                  << std::setprecision(2) << updateNs << " ns per stone update, " << evaluateNs
+                  << " ns per evaluation" << (mismatches ? "  MISMATCH" : "") << std::endl;
+
+        // Keeps the loop from being optimised away
+        if (checksum == 1)
+        {
+            std::cout << checksum;
+        }
+    }
+    network.SetIsa(best);
+
+    // Cost the network adds to a make / unmake on the Gomoku board
+    GomokuBoard board(BOARD_SIZE);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        board.SetNetwork(pass == 0 ? nullptr : &network);
+        const std::vector<int> & cells = board.GetCells();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < BENCH_UPDATES / 10; i++)
+        {
+            int index = cells[i % cells.size()];
+            board.Place(index, 1);
+            board.Remove(index);
+        }
+        double pairNs = SecondsSince(start) * 1e9 / (BENCH_UPDATES / 10);
+        std::cout << "  board place + remove " << (pass == 0 ? "without" : "with") << " network: "
+                  << std::setprecision(1) << pairNs << " ns" << std::endl;
+    }
+
+    return bOk;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayMatch
+//
+// @description             : Engine with the network against the engine
+//                            without, alternating who moves first
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void PlayMatch(const EvalNetwork & network, size_t games, int budgetMs, std::mt19937 & rng)
+{
+    GomokuEngine withNetwork;
+    GomokuEngine without;
+    withNetwork.SetEvalNetwork(&network);
+    size_t wins = 0;
+    size_t draws = 0;
+    size_t losses = 0;
+
+    for (size_t i = 0; i < games; i++)
+    {
+        MnkGame game(BOARD_SIZE, BOARD_SIZE, GOMOKU_K);
+        Player_t networkPlayer = (i % 2 == 0) ? PLAYER_USER : PLAYER_COMPUTER;
+        for (size_t ply = 0; !game.GameOver(); ply++)
+        {
+            size_t move;
+            if (ply < RANDOM_OPENING_PLIES)
+            {
+                do
+                {
+                    move = (BOARD_SIZE / 2 - 3 + rng() % 7) * BOARD_SIZE + BOARD_SIZE / 2 - 3 + rng() % 7;
+                } while (game.GetCell(move) != PLAYER_NONE);
+            }
+            else
+            {
+                GomokuEngine & engine = (game.GetTurn() == networkPlayer) ? withNetwork : without;
+                move = engine.SelectMove(game, budgetMs);
+            }
+            game.AddPlayerMarkToBoard(move);
+        }
+
+        Player_t winner = game.CheckWin();
+        if (winner == networkPlayer)
+        {
+            wins++;
+        }
+        else if (winner == PLAYER_NONE)
+        {
+            draws++;
+        }
+        else
+        {
+            losses++;
+        }
+    }
+
+    std::cout << "Match, network vs patterns only, " << games << " games at " << budgetMs << " ms: " << wins
+              << " won, " << draws << " drawn, " << losses << " lost" << std::endl;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--games N] [--records PATH] [--out PATH] [--epochs N]"
+              << " [--budget MS] [--match N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t games = 100;
+    std::string recordsPath = "gomoku_selfplay.txt";
+    std::string outPath = "gomoku_15x15.nnue";
+    size_t epochs = 6;
+    int budgetMs = 5;
+    size_t matchGames = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--records") == 0 && hasValue)
+        {
+            recordsPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+        {
+            outPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--epochs") == 0 && hasValue)
+        {
+            epochs = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && hasValue)
+        {
+            budgetMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--match") == 0 && hasValue)
+        {
+            matchGames = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (budgetMs < 1 || epochs < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    // Fixed seed so runs are comparable
+    std::mt19937 rng(20200117);
+    std::cout << std::fixed;
+
+    if (games > 0)
+    {
+        GomokuEngine engine;
+        std::vector<GameRecord> played;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < games; i++)
+        {
+            played.push_back(PlaySelfPlayGame(engine, budgetMs, rng));
+        }
+        if (!AppendRecords(recordsPath, played))
+        {
+            std::cout << "could not write " << recordsPath << std::endl;
+            return 1;
+        }
+        std::cout << "Self-play: " << games << " games in " << std::setprecision(1)
+                  << SecondsSince(start) << " s appended to " << recordsPath << std::endl;
+    }
+
+    std::vector<GameRecord> records = ReadRecords(recordsPath);
+    size_t validationGames = std::max<size_t>(1, records.size() * VALIDATION_PERCENT / 100);
+    if (records.size() <= validationGames)
+    {
+        std::cout << "not enough games in " << recordsPath << std::endl;
+        return 1;
+    }
+
+    std::vector<Sample> training;
+    std::vector<Sample> validation;
+    MakeSamples(records, 0, records.size() - validationGames, training);
+    MakeSamples(records, records.size() - validationGames, records.size(), validation);
+    std::cout << "Training on " << training.size() << " samples from " << records.size() - validationGames
+              << " games, validating on " << validation.size() << std::endl;
+
+    // Self-play games are few and alike, so keep the epoch that validates best
+    FloatNetwork floatNetwork(rng);
+    FloatNetwork bestNetwork = floatNetwork;
+    double bestLoss = GetLoss(floatNetwork, validation);
+    std::cout << "  untrained validation loss " << std::setprecision(4) << bestLoss << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t epoch = 1; epoch <= epochs; epoch++)
+    {
+        std::shuffle(training.begin(), training.end(), rng);
+        double loss = 0;
+        for (auto it = training.begin(); it != training.end(); it++)
+        {
+            loss += floatNetwork.Train(*it);
+        }
+
+        double validationLoss = GetLoss(floatNetwork, validation);
+        std::cout << "  epoch " << epoch << " training loss " << std::setprecision(4) << loss / training.size()
+                  << ", validation loss " << validationLoss << std::endl;
+        if (validationLoss < bestLoss)
+        {
+            bestLoss = validationLoss;
+            bestNetwork = floatNetwork;
+        }
+    }
+    floatNetwork = bestNetwork;
+    std::cout << "  trained in " << std::setprecision(1) << SecondsSince(start) << " s" << std::endl;
+
+    EvalNetwork network;
+    network.SetFloatWeights(BOARD_SIZE, floatNetwork.featureWeights, floatNetwork.bias, floatNetwork.outputWeights,
+                            floatNetwork.outputBias);
+    bool bQuantised = Validate(floatNetwork, network, validation);
+
+    EvalNetwork loaded;
+    bool bSaved = network.Save(outPath) && loaded.Load(outPath) &&
+                  EvaluateQuantised(loaded, validation.front()) == EvaluateQuantised(network, validation.front());
+    std::cout << "  " << (bSaved ? "saved to " : "could not save ") << outPath << std::endl;
+
+    bool bOk = BenchNetwork(network, validation) && bSaved && bQuantised;
+    if (matchGames > 0)
+    {
+        PlayMatch(network, matchGames, budgetMs * 4, rng);
+    }
+
+    std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------
+// GameServer: hosts many concurrent 3x3 games without a window.
+//
+// Clients connect to a Unix domain socket and speak the fixed frame protocol
+// in protocol.h. Runs until interrupted, then prints what it served.
+//
+// Usage: GameServer [--socket PATH] [--workers N] [--max-sessions N]
+//--------------------------------------------------------------------------------
+#include "server.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--socket PATH] [--workers N] [--max-sessions N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string path = "tictactoe.sock";
+    size_t workers = static_cast<size_t>(QThread::idealThreadCount());
+    size_t maxSessions = 1000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--socket") == 0 && hasValue)
+        {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--workers") == 0 && hasValue)
+        {
+            workers = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--max-sessions") == 0 && hasValue)
+        {
+            maxSessions = static_cast<size_t>(atol(argv[++i]));
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (workers < 1 || maxSessions < 1 || maxSessions > (1u << 24))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    GameServer server(path, workers, maxSessions);
+    if (!server.Start())
+    {
+        return 1;
+    }
+
+    std::cout << "Listening on " << path << " with " << workers << " engine workers" << std::endl;
+    server.Run();
+
+    const ServerStats & stats = server.GetStats();
+    std::cout << stats.connections << " connections, " << stats.requests << " requests, " << stats.engineMoves
+              << " engine moves, peak " << stats.peakSessions << " sessions at " << sizeof(Session)
+              << " bytes each" << std::endl;
+    return 0;
+}
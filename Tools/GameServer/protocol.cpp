@@ -0,0 +1,54 @@
+#include "protocol.h"
+
+static void PutU32(uint8_t * out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static uint32_t GetU32(const uint8_t * in)
+{
+    return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+           (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+void EncodeRequest(const Request & request, uint8_t * frame)
+{
+    PutU32(frame, request.tag);
+    PutU32(frame + 4, request.session);
+    frame[8] = request.type;
+    frame[9] = request.arg;
+    frame[10] = 0;
+    frame[11] = 0;
+}
+
+void DecodeRequest(const uint8_t * frame, Request & request)
+{
+    request.tag = GetU32(frame);
+    request.session = GetU32(frame + 4);
+    request.type = frame[8];
+    request.arg = frame[9];
+}
+
+void EncodeResponse(const Response & response, uint8_t * frame)
+{
+    PutU32(frame, response.tag);
+    PutU32(frame + 4, response.session);
+    frame[8] = response.status;
+    frame[9] = response.move;
+    frame[10] = response.result;
+    frame[11] = 0;
+    PutU32(frame + 12, response.value);
+}
+
+void DecodeResponse(const uint8_t * frame, Response & response)
+{
+    response.tag = GetU32(frame);
+    response.session = GetU32(frame + 4);
+    response.status = frame[8];
+    response.move = frame[9];
+    response.result = frame[10];
+    response.value = GetU32(frame + 12);
+}
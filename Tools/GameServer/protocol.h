@@ -0,0 +1,70 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+#include <cstddef>
+#include <cstdint>
+
+//------------------------------------------------------------------------
+// Wire format of the game server. Every message is a fixed size frame of
+// little endian fields, so a stream is cut into frames by length alone.
+//
+//   request  (12 bytes): tag u32 | session u32 | type u8 | arg u8 | 0 u16
+//   response (16 bytes): tag u32 | session u32 | status u8 | move u8 |
+//                        result u8 | 0 u8 | value u32
+//
+// The tag is chosen by the client and echoed back; responses to requests
+// on different sessions may arrive out of order.
+//------------------------------------------------------------------------
+typedef enum RequestType_tag
+{
+    REQUEST_NEW_GAME,   // arg: engine index in GetEngineNames(); client moves first
+    REQUEST_MOVE,       // arg: cell 0-8; the response carries the engine's reply
+    REQUEST_CLOSE,
+    REQUEST_STATS       // value: sessions open on the server
+}RequestType_t;
+
+typedef enum ResponseStatus_tag
+{
+    STATUS_OK,
+    STATUS_BAD_REQUEST,
+    STATUS_BAD_SESSION,
+    STATUS_ILLEGAL_MOVE,
+    STATUS_BUSY,        // an engine move for the session is still pending
+    STATUS_SERVER_FULL
+}ResponseStatus_t;
+
+typedef enum SessionResult_tag
+{
+    SESSION_ONGOING,
+    SESSION_CLIENT_WINS,
+    SESSION_ENGINE_WINS,
+    SESSION_DRAW
+}SessionResult_t;
+
+const size_t REQUEST_SIZE = 12;
+const size_t RESPONSE_SIZE = 16;
+const uint8_t NO_MOVE = 0xFF;
+
+struct Request
+{
+    uint32_t tag;
+    uint32_t session;
+    uint8_t type;
+    uint8_t arg;
+};
+
+struct Response
+{
+    uint32_t tag;
+    uint32_t session;
+    uint8_t status;
+    uint8_t move;
+    uint8_t result;
+    uint32_t value;
+};
+
+void EncodeRequest(const Request & request, uint8_t * frame);
+void DecodeRequest(const uint8_t * frame, Request & request);
+void EncodeResponse(const Response & response, uint8_t * frame);
+void DecodeResponse(const uint8_t * frame, Response & response);
+
+#endif // PROTOCOL_H
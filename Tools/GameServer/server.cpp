@@ -0,0 +1,701 @@
+#include "server.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const uint8_t SESSION_OPEN = 0x01;
+const uint8_t SESSION_BUSY = 0x02;      // engine move pending
+const uint8_t SESSION_FINISHED = 0x04;
+
+const uint32_t SESSION_INDEX_BITS = 24;
+const uint32_t SESSION_INDEX_MASK = (1u << SESSION_INDEX_BITS) - 1;
+const int MAX_EVENTS = 256;
+const size_t READ_CHUNK = 65536;
+
+static SessionResult_t GetSessionResult(BoardMask_t client, BoardMask_t engine)
+{
+    if (IsWinMask(client))
+    {
+        return SESSION_CLIENT_WINS;
+    }
+    if (IsWinMask(engine))
+    {
+        return SESSION_ENGINE_WINS;
+    }
+    if ((client | engine) == FULL_BOARD_MASK)
+    {
+        return SESSION_DRAW;
+    }
+    return SESSION_ONGOING;
+}
+
+void JobQueue::Push(const MoveJob & job)
+{
+    QMutexLocker lock(&m_mutex);
+    m_jobs.push_back(job);
+    m_available.wakeOne();
+}
+
+// Blocks until a job is available; false once the queue is stopped
+bool JobQueue::Pop(MoveJob & job)
+{
+    QMutexLocker lock(&m_mutex);
+    while (m_jobs.empty() && !m_stopped)
+    {
+        m_available.wait(&m_mutex);
+    }
+    if (m_stopped)
+    {
+        return false;
+    }
+
+    job = m_jobs.front();
+    m_jobs.pop_front();
+    return true;
+}
+
+void JobQueue::Stop()
+{
+    QMutexLocker lock(&m_mutex);
+    m_stopped = true;
+    m_available.wakeAll();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : run
+//
+// @description             : Rebuilds each job's position as a Game and asks the
+//                            session's engine for the computer's move
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void EngineWorker::run()
+{
+    std::vector<std::string> names = GetEngineNames();
+    m_engines.resize(names.size());
+
+    MoveJob job;
+    while (m_jobs.Pop(job))
+    {
+        std::unique_ptr<Engine> & engine = m_engines[job.engineIndex];
+        if (!engine)
+        {
+            engine.reset(CreateEngine(names[job.engineIndex]));
+        }
+
+        Game game(PLAYER_USER);
+        for (size_t cell = 0; cell < 9; cell++)
+        {
+            if (job.client & (1u << cell))
+            {
+                game.AddPlayerMarkToBoard(cell, PLAYER_USER);
+            }
+            else if (job.engine & (1u << cell))
+            {
+                game.AddPlayerMarkToBoard(cell, PLAYER_COMPUTER);
+            }
+        }
+
+        job.move = static_cast<uint8_t>(engine->SelectMove(game, PLAYER_COMPUTER));
+        m_server.Complete(job);
+    }
+}
+
+GameServer::GameServer(const std::string & path, size_t workers, size_t maxSessions)
+    : m_path(path), m_maxSessions(maxSessions)
+{
+    m_listenFd = -1;
+    m_epollFd = -1;
+    m_wakeFd = -1;
+    m_signalFd = -1;
+    m_nextConnectionId = 1;
+    m_engineCount = GetEngineNames().size();
+    m_openSessions = 0;
+    m_stats = ServerStats();
+
+    for (size_t i = 0; i < workers; i++)
+    {
+        m_workers.emplace_back(new EngineWorker(*this, m_jobs));
+    }
+}
+
+GameServer::~GameServer()
+{
+    m_jobs.Stop();
+    for (auto it = m_workers.begin(); it != m_workers.end(); it++)
+    {
+        (*it)->wait();
+    }
+
+    for (auto it = m_connections.begin(); it != m_connections.end(); it++)
+    {
+        close(it->first);
+    }
+    int fds[] = {m_listenFd, m_epollFd, m_wakeFd, m_signalFd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+    if (m_listenFd >= 0)
+    {
+        unlink(m_path.c_str());
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Start
+//
+// @description             : Binds the socket and starts the worker pool.
+//                            SIGINT and SIGTERM are blocked before the workers
+//                            start and read through a signalfd by the loop.
+//
+// @return                  : true on success
+//--------------------------------------------------------------------------------
+bool GameServer::Start()
+{
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    m_signalFd = signalfd(-1, &stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (m_path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "socket path too long: " << m_path << std::endl;
+        return false;
+    }
+    strncpy(address.sun_path, m_path.c_str(), sizeof(address.sun_path) - 1);
+
+    unlink(m_path.c_str());
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0 ||
+        bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(m_listenFd, SOMAXCONN) != 0)
+    {
+        std::cerr << "cannot listen on " << m_path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0 || m_signalFd < 0)
+    {
+        std::cerr << "cannot set up the event loop: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int fds[] = {m_listenFd, m_wakeFd, m_signalFd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fds[i];
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fds[i], &event);
+    }
+
+    for (auto it = m_workers.begin(); it != m_workers.end(); it++)
+    {
+        (*it)->start();
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Run
+//
+// @description             : Event loop, returns on SIGINT or SIGTERM
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::Run()
+{
+    epoll_event events[MAX_EVENTS];
+    bool bRunning = true;
+
+    while (bRunning)
+    {
+        int count = epoll_wait(m_epollFd, events, MAX_EVENTS, -1);
+        if (count < 0 && errno != EINTR)
+        {
+            std::cerr << "epoll_wait: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == m_listenFd)
+            {
+                Accept();
+            }
+            else if (fd == m_wakeFd)
+            {
+                DrainCompletions();
+            }
+            else if (fd == m_signalFd)
+            {
+                bRunning = false;
+            }
+            else
+            {
+                // A completion earlier in this batch may have closed it
+                if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && m_connections.count(fd))
+                {
+                    HandleRead(fd);
+                }
+                if ((events[i].events & EPOLLOUT) && m_connections.count(fd))
+                {
+                    Flush(fd);
+                }
+            }
+        }
+    }
+}
+
+void GameServer::Accept()
+{
+    for (;;)
+    {
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        Connection & connection = m_connections[fd];
+        connection.id = m_nextConnectionId++;
+        connection.sessions.clear();
+        connection.bWantWrite = false;
+        connection.input.clear();
+        connection.output.clear();
+        connection.outputOffset = 0;
+        m_stats.connections++;
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CloseConnection
+//
+// @description             : Drops the connection and every session it opened.
+//                            Engine moves still in flight for it are discarded
+//                            when they come back.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::CloseConnection(int fd)
+{
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end())
+    {
+        return;
+    }
+
+    std::vector<uint32_t> sessions;
+    sessions.swap(it->second.sessions);
+    for (auto id = sessions.begin(); id != sessions.end(); id++)
+    {
+        FreeSession(*id);
+    }
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    m_connections.erase(it);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : HandleRead
+//
+// @description             : Reads everything available and handles the complete
+//                            frames; a partial frame waits for the next read
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::HandleRead(int fd)
+{
+    Connection & connection = m_connections[fd];
+    uint8_t chunk[READ_CHUNK];
+    bool bClosed = false;
+
+    for (;;)
+    {
+        ssize_t bytes = read(fd, chunk, sizeof(chunk));
+        if (bytes > 0)
+        {
+            connection.input.insert(connection.input.end(), chunk, chunk + bytes);
+            continue;
+        }
+        if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            bClosed = true;
+        }
+        if (bytes == 0 || errno != EINTR)
+        {
+            break;
+        }
+    }
+
+    size_t offset = 0;
+    for (; offset + REQUEST_SIZE <= connection.input.size(); offset += REQUEST_SIZE)
+    {
+        Request request;
+        DecodeRequest(&connection.input[offset], request);
+        HandleRequest(fd, connection, request);
+    }
+    connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+
+    if (bClosed)
+    {
+        CloseConnection(fd);
+        return;
+    }
+    Flush(fd);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Flush
+//
+// @description             : Writes queued responses. Whatever the socket does
+//                            not take is kept, and EPOLLOUT is watched until
+//                            it is gone.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::Flush(int fd)
+{
+    Connection & connection = m_connections[fd];
+    while (connection.outputOffset < connection.output.size())
+    {
+        ssize_t bytes = send(fd, &connection.output[connection.outputOffset],
+                             connection.output.size() - connection.outputOffset, MSG_NOSIGNAL);
+        if (bytes > 0)
+        {
+            connection.outputOffset += static_cast<size_t>(bytes);
+        }
+        else if (bytes < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            CloseConnection(fd);
+            return;
+        }
+    }
+
+    bool bPending = connection.outputOffset < connection.output.size();
+    if (!bPending)
+    {
+        connection.output.clear();
+        connection.outputOffset = 0;
+    }
+    if (bPending != connection.bWantWrite)
+    {
+        connection.bWantWrite = bPending;
+        epoll_event event;
+        event.events = EPOLLIN;
+        if (bPending)
+        {
+            event.events |= EPOLLOUT;
+        }
+        event.data.fd = fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+}
+
+void GameServer::Reply(Connection & connection, const Response & response)
+{
+    size_t size = connection.output.size();
+    connection.output.resize(size + RESPONSE_SIZE);
+    EncodeResponse(response, &connection.output[size]);
+}
+
+Session * GameServer::FindSession(uint32_t id, uint32_t owner)
+{
+    uint32_t index = id & SESSION_INDEX_MASK;
+    if (index >= m_sessions.size())
+    {
+        return nullptr;
+    }
+
+    Session & session = m_sessions[index];
+    if (!(session.flags & SESSION_OPEN) || session.generation != (id >> SESSION_INDEX_BITS) || session.owner != owner)
+    {
+        return nullptr;
+    }
+    return &session;
+}
+
+void GameServer::FreeSession(uint32_t id)
+{
+    uint32_t index = id & SESSION_INDEX_MASK;
+    Session & session = m_sessions[index];
+    session.flags = 0;
+    session.generation++;
+    m_freeSessions.push_back(index);
+    m_openSessions--;
+
+    auto it = m_connections.find(session.ownerFd);
+    if (it != m_connections.end() && it->second.id == session.owner)
+    {
+        std::vector<uint32_t> & sessions = it->second.sessions;
+        auto position = std::find(sessions.begin(), sessions.end(), id);
+        if (position != sessions.end())
+        {
+            *position = sessions.back();
+            sessions.pop_back();
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : HandleRequest
+//
+// @description             : Answers a request, except engine moves, which are
+//                            answered when the worker pool is done with them
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::HandleRequest(int fd, Connection & connection, const Request & request)
+{
+    m_stats.requests++;
+
+    Response response;
+    response.tag = request.tag;
+    response.session = request.session;
+    response.status = STATUS_OK;
+    response.move = NO_MOVE;
+    response.result = SESSION_ONGOING;
+    response.value = 0;
+
+    switch (request.type)
+    {
+    case REQUEST_NEW_GAME:
+        if (request.arg >= m_engineCount)
+        {
+            response.status = STATUS_BAD_REQUEST;
+        }
+        else if (m_freeSessions.empty() && m_sessions.size() >= m_maxSessions)
+        {
+            response.status = STATUS_SERVER_FULL;
+        }
+        else
+        {
+            uint32_t index;
+            if (m_freeSessions.empty())
+            {
+                index = static_cast<uint32_t>(m_sessions.size());
+                m_sessions.push_back(Session());
+            }
+            else
+            {
+                index = m_freeSessions.back();
+                m_freeSessions.pop_back();
+            }
+
+            Session & session = m_sessions[index];
+            session.client = 0;
+            session.engine = 0;
+            session.engineIndex = request.arg;
+            session.flags = SESSION_OPEN;
+            session.owner = connection.id;
+            session.ownerFd = fd;
+            response.session = index | (static_cast<uint32_t>(session.generation) << SESSION_INDEX_BITS);
+
+            connection.sessions.push_back(response.session);
+            m_openSessions++;
+            if (m_openSessions > m_stats.peakSessions)
+            {
+                m_stats.peakSessions = m_openSessions;
+            }
+        }
+        break;
+
+    case REQUEST_MOVE:
+        HandleMove(fd, connection, request, response);
+        if (response.status == STATUS_OK && response.result == SESSION_ONGOING)
+        {
+            // Answered from DrainCompletions
+            return;
+        }
+        break;
+
+    case REQUEST_CLOSE:
+        if (FindSession(request.session, connection.id))
+        {
+            FreeSession(request.session);
+        }
+        else
+        {
+            response.status = STATUS_BAD_SESSION;
+        }
+        break;
+
+    case REQUEST_STATS:
+        response.value = static_cast<uint32_t>(m_openSessions);
+        break;
+
+    default:
+        response.status = STATUS_BAD_REQUEST;
+        break;
+    }
+
+    Reply(connection, response);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : HandleMove
+//
+// @description             : Plays the client's move. If the game goes on, the
+//                            engine's reply is queued for the worker pool and
+//                            the session stays busy until it comes back.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::HandleMove(int fd, Connection & connection, const Request & request, Response & response)
+{
+    Session * session = FindSession(request.session, connection.id);
+    if (!session)
+    {
+        response.status = STATUS_BAD_SESSION;
+        return;
+    }
+    if (session->flags & SESSION_BUSY)
+    {
+        response.status = STATUS_BUSY;
+        return;
+    }
+
+    if ((session->flags & SESSION_FINISHED) || request.arg >= 9)
+    {
+        response.status = STATUS_ILLEGAL_MOVE;
+        return;
+    }
+
+    BoardMask_t bit = static_cast<BoardMask_t>(1u << request.arg);
+    if ((session->client | session->engine) & bit)
+    {
+        response.status = STATUS_ILLEGAL_MOVE;
+        return;
+    }
+
+    session->client |= bit;
+    response.result = GetSessionResult(session->client, session->engine);
+    if (response.result != SESSION_ONGOING)
+    {
+        session->flags |= SESSION_FINISHED;
+        return;
+    }
+
+    session->flags |= SESSION_BUSY;
+    MoveJob job;
+    job.fd = fd;
+    job.connection = connection.id;
+    job.tag = request.tag;
+    job.session = request.session;
+    job.client = session->client;
+    job.engine = session->engine;
+    job.engineIndex = session->engineIndex;
+    job.move = NO_MOVE;
+    m_jobs.Push(job);
+}
+
+// Called on worker threads
+void GameServer::Complete(const MoveJob & job)
+{
+    {
+        QMutexLocker lock(&m_doneMutex);
+        m_done.push_back(job);
+    }
+    uint64_t one = 1;
+    ssize_t bytes = write(m_wakeFd, &one, sizeof(one));
+    (void)bytes;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : DrainCompletions
+//
+// @description             : Applies finished engine moves and answers the move
+//                            requests that were waiting for them
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void GameServer::DrainCompletions()
+{
+    uint64_t count;
+    ssize_t bytes = read(m_wakeFd, &count, sizeof(count));
+    (void)bytes;
+
+    std::vector<MoveJob> done;
+    {
+        QMutexLocker lock(&m_doneMutex);
+        done.swap(m_done);
+    }
+
+    std::vector<int> touched;
+    for (auto it = done.begin(); it != done.end(); it++)
+    {
+        auto connection = m_connections.find(it->fd);
+        if (connection == m_connections.end() || connection->second.id != it->connection)
+        {
+            continue;
+        }
+        Session * session = FindSession(it->session, it->connection);
+        if (!session)
+        {
+            continue;
+        }
+
+        session->engine |= static_cast<BoardMask_t>(1u << it->move);
+        session->flags &= static_cast<uint8_t>(~SESSION_BUSY);
+        m_stats.engineMoves++;
+
+        Response response;
+        response.tag = it->tag;
+        response.session = it->session;
+        response.status = STATUS_OK;
+        response.move = it->move;
+        response.result = GetSessionResult(session->client, session->engine);
+        response.value = 0;
+        if (response.result != SESSION_ONGOING)
+        {
+            session->flags |= SESSION_FINISHED;
+        }
+
+        Reply(connection->second, response);
+        touched.push_back(it->fd);
+    }
+
+    for (auto it = touched.begin(); it != touched.end(); it++)
+    {
+        auto connection = m_connections.find(*it);
+        if (connection != m_connections.end() && !connection->second.output.empty() && !connection->second.bWantWrite)
+        {
+            Flush(*it);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include "protocol.h"
+#include "engine.h"
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------
+// One game as the server stores it: the two players' masks plus a few
+// flags, 16 bytes instead of a Game with its std::map.
+//------------------------------------------------------------------------
+struct Session
+{
+    BoardMask_t client;
+    BoardMask_t engine;
+    uint8_t engineIndex;
+    uint8_t flags;
+    uint8_t generation;     // bumped on reuse so stale ids are rejected
+    uint32_t owner;         // id of the connection that opened it
+    int ownerFd;            // its socket, only valid while 'owner' matches
+};
+
+// Engine work handed from the event loop to the worker pool and back
+struct MoveJob
+{
+    int fd;
+    uint32_t connection;
+    uint32_t tag;
+    uint32_t session;
+    BoardMask_t client;
+    BoardMask_t engine;
+    uint8_t engineIndex;
+    uint8_t move;
+};
+
+//------------------------------------------------------------------------
+// Blocking queue of jobs for the workers
+//------------------------------------------------------------------------
+class JobQueue
+{
+private:
+    QMutex m_mutex;
+    QWaitCondition m_available;
+    std::deque<MoveJob> m_jobs;
+    bool m_stopped;
+
+public:
+    JobQueue() : m_stopped(false) {}
+    void Push(const MoveJob & job);
+    bool Pop(MoveJob & job);
+    void Stop();
+};
+
+class GameServer;
+
+//------------------------------------------------------------------------
+// Pool thread: picks the engine's move for queued jobs. Engines keep
+// per-instance state, so every worker creates its own.
+//------------------------------------------------------------------------
+class EngineWorker : public QThread
+{
+private:
+    GameServer & m_server;
+    JobQueue & m_jobs;
+    std::vector<std::unique_ptr<Engine> > m_engines;
+
+protected:
+    void run();
+
+public:
+    EngineWorker(GameServer & server, JobQueue & jobs) : m_server(server), m_jobs(jobs) {}
+};
+
+struct ServerStats
+{
+    unsigned long long connections;
+    unsigned long long requests;
+    unsigned long long engineMoves;
+    size_t peakSessions;
+};
+
+//------------------------------------------------------------------------
+// Headless server for many concurrent 3x3 games over a Unix domain socket.
+// A single epoll loop owns all sockets and sessions; engine moves run on
+// the worker pool and come back through an eventfd.
+//------------------------------------------------------------------------
+class GameServer
+{
+private:
+    struct Connection
+    {
+        uint32_t id;
+        std::vector<uint32_t> sessions;     // ids of the sessions it opened
+        bool bWantWrite;
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+        size_t outputOffset;
+    };
+
+    std::string m_path;
+    size_t m_maxSessions;
+    int m_listenFd;
+    int m_epollFd;
+    int m_wakeFd;
+    int m_signalFd;
+    uint32_t m_nextConnectionId;
+    size_t m_engineCount;
+    std::unordered_map<int, Connection> m_connections;
+    std::vector<Session> m_sessions;
+    std::vector<uint32_t> m_freeSessions;
+    size_t m_openSessions;
+    ServerStats m_stats;
+
+    JobQueue m_jobs;
+    std::vector<std::unique_ptr<EngineWorker> > m_workers;
+    QMutex m_doneMutex;
+    std::vector<MoveJob> m_done;
+
+    void Accept();
+    void CloseConnection(int fd);
+    void HandleRead(int fd);
+    void Flush(int fd);
+    void HandleRequest(int fd, Connection & connection, const Request & request);
+    void HandleMove(int fd, Connection & connection, const Request & request, Response & response);
+    void DrainCompletions();
+    Session * FindSession(uint32_t id, uint32_t owner);
+    void FreeSession(uint32_t id);
+    void Reply(Connection & connection, const Response & response);
+
+public:
+    GameServer(const std::string & path, size_t workers, size_t maxSessions);
+    ~GameServer();
+
+    bool Start();
+    void Run();
+    void Complete(const MoveJob & job);
+    const ServerStats & GetStats() const { return m_stats; }
+};
+
+#endif // SERVER_H
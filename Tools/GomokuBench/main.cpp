@@ -0,0 +1,287 @@
+//--------------------------------------------------------------------------------
+// GomokuBench: strength and move time of the 15x15 five-in-a-row engine.
+//
+// 1. Puzzles: positions with a forced win, the attacker must convert it.
+// 2. Against random: the engine has to win every game.
+// 3. Self-play: mean, p99 and slowest move time under the budget.
+//
+// With a network file (trained by Tools/EvalTrain) every engine adds the
+// network's score to its pattern evaluation.
+//
+// Usage: GomokuBench [budget ms] [games] [network file]
+//--------------------------------------------------------------------------------
+#include "gomoku.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+const int DEFAULT_BUDGET_MS = 100;
+const size_t DEFAULT_GAMES = 4;
+const size_t BOARD_SIZE = 15;
+
+// Attacker moves allowed to convert a puzzle
+const size_t PUZZLE_MAX_MOVES = 12;
+
+struct Puzzle
+{
+    const char * name;
+    int attacker[8][2];
+    int defender[8][2];
+    size_t stones;
+};
+
+// Attacker to move; stones are {row, column}, defender stones off to the side
+static const Puzzle PUZZLES[] =
+{
+    {"open three", {{7, 6}, {7, 7}, {7, 8}}, {{0, 0}, {1, 2}, {14, 14}}, 3},
+    {"broken three", {{7, 5}, {7, 6}, {7, 8}}, {{0, 0}, {1, 2}, {14, 14}}, 3},
+    {"double four", {{5, 5}, {5, 6}, {5, 7}, {6, 8}, {7, 8}, {8, 8}},
+                    {{5, 4}, {9, 8}, {0, 0}, {1, 2}, {0, 14}, {14, 0}}, 6},
+    {"four-three", {{5, 5}, {5, 6}, {5, 7}, {7, 8}, {8, 8}},
+                   {{5, 4}, {0, 0}, {1, 2}, {0, 14}, {14, 0}}, 5},
+    {"double three", {{7, 5}, {7, 6}, {5, 7}, {6, 7}},
+                     {{0, 0}, {1, 2}, {0, 14}, {14, 0}}, 4},
+};
+
+static size_t ToCell(int row, int column)
+{
+    return static_cast<size_t>(row) * BOARD_SIZE + static_cast<size_t>(column);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayEngineMove
+//
+// @description             : Lets the engine move and records how long it took
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void PlayEngineMove(GomokuEngine & engine, MnkGame & game, int budgetMs, std::vector<double> & times)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t move = engine.SelectMove(game, budgetMs);
+    times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    game.AddPlayerMarkToBoard(move);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayRandomMove
+//
+// @description             : Random move next to the stones already played
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void PlayRandomMove(MnkGame & game, std::mt19937_64 & rng)
+{
+    std::vector<size_t> moves;
+    std::vector<size_t> available = game.GetAvailableMoves();
+    for (auto it = available.begin(); it != available.end(); it++)
+    {
+        int row = static_cast<int>(*it / BOARD_SIZE);
+        int column = static_cast<int>(*it % BOARD_SIZE);
+        bool bNear = false;
+        for (int dr = -1; dr <= 1 && !bNear; dr++)
+        {
+            for (int dc = -1; dc <= 1 && !bNear; dc++)
+            {
+                int r = row + dr;
+                int c = column + dc;
+                bNear = r >= 0 && c >= 0 && r < static_cast<int>(BOARD_SIZE) && c < static_cast<int>(BOARD_SIZE) &&
+                        game.GetCell(ToCell(r, c)) != PLAYER_NONE;
+            }
+        }
+        if (bNear)
+        {
+            moves.push_back(*it);
+        }
+    }
+
+    if (moves.empty())
+    {
+        moves = available;
+    }
+    game.AddPlayerMarkToBoard(moves[rng() % moves.size()]);
+}
+
+static bool BenchPuzzles(int budgetMs, const EvalNetwork * network, std::vector<double> & times)
+{
+    GomokuEngine attacker;
+    GomokuEngine defender;
+    attacker.SetEvalNetwork(network);
+    defender.SetEvalNetwork(network);
+    bool bAllSolved = true;
+
+    std::cout << "Puzzles" << std::endl;
+    for (size_t i = 0; i < sizeof(PUZZLES) / sizeof(PUZZLES[0]); i++)
+    {
+        const Puzzle & puzzle = PUZZLES[i];
+        MnkGame game(BOARD_SIZE, BOARD_SIZE, GOMOKU_K);
+        for (size_t s = 0; s < puzzle.stones; s++)
+        {
+            game.AddPlayerMarkToBoard(ToCell(puzzle.attacker[s][0], puzzle.attacker[s][1]));
+            game.AddPlayerMarkToBoard(ToCell(puzzle.defender[s][0], puzzle.defender[s][1]));
+        }
+
+        Player_t attackerSide = game.GetTurn();
+        size_t moves = 0;
+        std::string firstReason;
+        while (!game.GameOver() && moves < PUZZLE_MAX_MOVES)
+        {
+            PlayEngineMove(attacker, game, budgetMs, times);
+            if (moves++ == 0)
+            {
+                firstReason = attacker.GetReason();
+            }
+            if (!game.GameOver())
+            {
+                PlayEngineMove(defender, game, budgetMs, times);
+            }
+        }
+
+        bool bSolved = (game.CheckWin() == attackerSide);
+        bAllSolved = bAllSolved && bSolved;
+        std::cout << "  " << std::left << std::setw(14) << puzzle.name << std::right
+                  << (bSolved ? "won" : "FAILED") << " in " << moves << " moves (" << firstReason << ")" << std::endl;
+    }
+
+    return bAllSolved;
+}
+
+static bool BenchAgainstRandom(int budgetMs, size_t games, const EvalNetwork * network, std::mt19937_64 & rng,
+                               std::vector<double> & times)
+{
+    GomokuEngine engine;
+    engine.SetEvalNetwork(network);
+    size_t wins = 0;
+    size_t totalMoves = 0;
+
+    for (size_t i = 0; i < games; i++)
+    {
+        // Alternate who moves first
+        Player_t engineSide = (i % 2 == 0) ? PLAYER_USER : PLAYER_COMPUTER;
+        MnkGame game(BOARD_SIZE, BOARD_SIZE, GOMOKU_K, PLAYER_USER);
+        while (!game.GameOver())
+        {
+            if (game.GetTurn() == engineSide)
+            {
+                PlayEngineMove(engine, game, budgetMs, times);
+            }
+            else
+            {
+                PlayRandomMove(game, rng);
+            }
+        }
+
+        totalMoves += game.GetMoveHistory().size();
+        if (game.CheckWin() == engineSide)
+        {
+            wins++;
+        }
+    }
+
+    std::cout << "Against random  : " << wins << "/" << games << " won, "
+              << std::fixed << std::setprecision(1) << static_cast<double>(totalMoves) / games
+              << " moves per game" << std::endl;
+    return wins == games;
+}
+
+static void BenchSelfPlay(int budgetMs, size_t games, const EvalNetwork * network, std::mt19937_64 & rng,
+                          std::vector<double> & times)
+{
+    GomokuEngine engine;
+    engine.SetEvalNetwork(network);
+    size_t firstWins = 0;
+    size_t secondWins = 0;
+    size_t totalMoves = 0;
+
+    for (size_t i = 0; i < games; i++)
+    {
+        // Two random opening moves near the centre keep the games apart
+        MnkGame game(BOARD_SIZE, BOARD_SIZE, GOMOKU_K);
+        game.AddPlayerMarkToBoard(ToCell(7, 7));
+        size_t second;
+        do
+        {
+            second = ToCell(6 + static_cast<int>(rng() % 3), 6 + static_cast<int>(rng() % 3));
+        } while (second == ToCell(7, 7));
+        game.AddPlayerMarkToBoard(second);
+
+        while (!game.GameOver())
+        {
+            PlayEngineMove(engine, game, budgetMs, times);
+        }
+
+        totalMoves += game.GetMoveHistory().size();
+        if (game.CheckWin() == PLAYER_USER)
+        {
+            firstWins++;
+        }
+        else if (game.CheckWin() == PLAYER_COMPUTER)
+        {
+            secondWins++;
+        }
+    }
+
+    std::cout << "Self-play       : " << games << " games, first player " << firstWins << ", second player "
+              << secondWins << ", draws " << games - firstWins - secondWins << ", "
+              << std::fixed << std::setprecision(1) << static_cast<double>(totalMoves) / games
+              << " moves per game" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int budgetMs = DEFAULT_BUDGET_MS;
+    size_t games = DEFAULT_GAMES;
+    if (argc > 1)
+    {
+        budgetMs = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        games = static_cast<size_t>(atoi(argv[2]));
+    }
+    EvalNetwork network;
+    bool bNetwork = (argc > 3);
+    if (bNetwork && (!network.Load(argv[3]) || network.GetSize() != static_cast<int>(BOARD_SIZE)))
+    {
+        std::cout << "Could not load a " << BOARD_SIZE << "x" << BOARD_SIZE << " network from " << argv[3] << std::endl;
+        return 1;
+    }
+    if (budgetMs < 1 || games < 1 || argc > 4)
+    {
+        std::cout << "Usage: " << argv[0] << " [budget ms] [games] [network file]" << std::endl;
+        return 1;
+    }
+    std::cout << "Evaluation      : " << (bNetwork ? "patterns + network" : "patterns") << std::endl;
+
+    // Fixed seed so runs are comparable
+    std::mt19937_64 rng(20200117);
+    std::vector<double> times;
+
+    const EvalNetwork * engineNetwork = bNetwork ? &network : nullptr;
+    bool bPuzzles = BenchPuzzles(budgetMs, engineNetwork, times);
+    bool bRandom = BenchAgainstRandom(budgetMs, games, engineNetwork, rng, times);
+    BenchSelfPlay(budgetMs, games, engineNetwork, rng, times);
+
+    std::sort(times.begin(), times.end());
+    double mean = 0.0;
+    for (auto it = times.begin(); it != times.end(); it++)
+    {
+        mean += *it;
+    }
+    mean /= times.size();
+    double p99 = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+    double slowest = times.back();
+
+    std::cout << "Move time       : " << times.size() << " moves, mean " << std::setprecision(2) << mean
+              << " ms, p99 " << p99 << " ms, slowest " << slowest << " ms (budget " << budgetMs << " ms)" << std::endl;
+
+    // Allow a little slack for the final node batch and timer resolution
+    bool bWithinBudget = slowest <= budgetMs + 10.0;
+    bool bOk = bPuzzles && bRandom && bWithinBudget;
+    std::cout << (bOk ? "OK" : (bWithinBudget ? "FAILED" : "OVER BUDGET")) << std::endl;
+
+    return bOk ? 0 : 1;
+}
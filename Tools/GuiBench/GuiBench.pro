@@ -0,0 +1,24 @@
+QT += widgets testlib
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../../TicTacToe/engine.pri)
+
+SOURCES += \
+    ../../TicTacToe/gametreedialog.cpp \
+    ../../TicTacToe/mainwindow.cpp \
+    ../../TicTacToe/qubicdialog.cpp \
+    ../../TicTacToe/ultimatedialog.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../TicTacToe/gametreedialog.h \
+    ../../TicTacToe/mainwindow.h \
+    ../../TicTacToe/qubicdialog.h \
+    ../../TicTacToe/ultimatedialog.h
+
+FORMS += \
+    ../../TicTacToe/mainwindow.ui
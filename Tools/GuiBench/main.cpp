@@ -0,0 +1,335 @@
+//--------------------------------------------------------------------------------
+// GuiBench: click-to-render latency of the main window.
+//
+// Runs MainWindow on Qt's offscreen platform, untimed, and plays it
+// through QTest clicks on the board buttons, picking random free
+// cells for X. For every click it times how long it takes until the
+// computer's mark has been painted and until the status bar has been
+// painted with its final message ("Your turn" or the result), which covers
+// MarkBoardPosition, EnableGame, UpdatePlayerTurn and the worker round trip.
+// Game statistics go to a temporary directory, not the working directory.
+//
+// Usage: GuiBench [--games N] [--engine NAME] [--max-p99 US]
+//--------------------------------------------------------------------------------
+#include "mainwindow.h"
+#include <QApplication>
+#include <QComboBox>
+#include <QEvent>
+#include <QEventLoop>
+#include <QLabel>
+#include <QPushButton>
+#include <QStatusBar>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// A click whose results are not painted by then counts as an error
+const int CLICK_TIMEOUT_MS = 5000;
+
+// Wakes the wait loop so timeouts are noticed even when nothing happens
+const int WAKE_INTERVAL_MS = 100;
+
+//------------------------------------------------------------------------
+// Watches paint events of the board and the status bar after a click
+//------------------------------------------------------------------------
+class PaintProbe : public QObject
+{
+private:
+    std::vector<QAbstractButton *> m_board;
+    QStatusBar * m_statusBar;
+    QLabel * m_result;
+    std::vector<bool> m_wasEmpty;
+
+    bool IsFinalStatus() const
+    {
+        return m_statusBar->currentMessage() == "Your turn" || !m_result->text().isEmpty();
+    }
+
+protected:
+    bool eventFilter(QObject * watched, QEvent * event)
+    {
+        if (event->type() != QEvent::Paint)
+        {
+            return false;
+        }
+
+        if (watched == m_statusBar)
+        {
+            if (!bStatusPainted && IsFinalStatus())
+            {
+                bStatusPainted = true;
+                statusPainted = Clock::now();
+            }
+            return false;
+        }
+
+        for (size_t i = 0; i < m_board.size(); i++)
+        {
+            if (watched == m_board[i] && m_wasEmpty[i] && !bMarkPainted && m_board[i]->text() == COMPUTER_MARK)
+            {
+                bMarkPainted = true;
+                markPainted = Clock::now();
+            }
+        }
+        return false;
+    }
+
+public:
+    bool bMarkPainted;
+    bool bStatusPainted;
+    Clock::time_point markPainted;
+    Clock::time_point statusPainted;
+
+    PaintProbe(const std::vector<QAbstractButton *> & board, QStatusBar * statusBar, QLabel * result)
+        : m_board(board), m_statusBar(statusBar), m_result(result), m_wasEmpty(board.size(), false),
+          bMarkPainted(false), bStatusPainted(false)
+    {
+        for (auto it = m_board.begin(); it != m_board.end(); it++)
+        {
+            (*it)->installEventFilter(this);
+        }
+        m_statusBar->installEventFilter(this);
+    }
+
+    // Called right before a click: remembers which cells are still free
+    void Arm()
+    {
+        for (size_t i = 0; i < m_board.size(); i++)
+        {
+            m_wasEmpty[i] = (m_board[i]->text() == ".");
+        }
+        bMarkPainted = false;
+        bStatusPainted = false;
+    }
+
+    size_t CountMarks(const QString & mark) const
+    {
+        size_t count = 0;
+        for (auto it = m_board.begin(); it != m_board.end(); it++)
+        {
+            if ((*it)->text() == mark)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool IsUserTurn() const
+    {
+        return m_statusBar->currentMessage() == "Your turn";
+    }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : WaitUntil
+//
+// @description             : Runs the event loop until 'done' returns true,
+//                            sleeping while there is nothing to process so the
+//                            engine's worker thread gets the CPU
+//
+// @return                  : false on timeout
+//--------------------------------------------------------------------------------
+template <typename Condition>
+static bool WaitUntil(Condition done)
+{
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(CLICK_TIMEOUT_MS);
+    QCoreApplication::processEvents();
+    while (!done())
+    {
+        if (Clock::now() > deadline)
+        {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+static double Percentile(const std::vector<double> & sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1));
+    return sorted[index];
+}
+
+static double MicrosecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--games N] [--engine NAME] [--max-p99 US]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    // No display on a build runner
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    size_t games = 2000;
+    std::string engineName = "heuristic";
+    double maxP99 = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = static_cast<size_t>(atol(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--engine") == 0 && hasValue)
+        {
+            engineName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max-p99") == 0 && hasValue)
+        {
+            maxP99 = atof(argv[++i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> names = GetEngineNames();
+    if (games < 1 || std::find(names.begin(), names.end(), engineName) == names.end())
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    QTemporaryDir dataDir;
+    if (!dataDir.isValid())
+    {
+        std::cout << "Could not create a directory for the statistics and tablebase" << std::endl;
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+
+    MainWindow window(nullptr, dataDir.filePath(STATS_FILE_NAME).toStdString(), dataDir.path().toStdString());
+    window.findChild<QComboBox *>("cmbEngine")->setCurrentText(QString::fromStdString(engineName));
+    window.show();
+    if (!QTest::qWaitForWindowExposed(&window))
+    {
+        std::cout << "Window was never exposed" << std::endl;
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+
+    std::vector<QAbstractButton *> board;
+    for (int i = 1; i <= 9; i++)
+    {
+        board.push_back(window.findChild<QPushButton *>(QString("btnPos%1").arg(i)));
+    }
+    QPushButton * newGame = window.findChild<QPushButton *>("btnNewGame");
+    QLabel * result = window.findChild<QLabel *>("lblResult");
+    PaintProbe probe(board, window.statusBar(), result);
+
+    QTimer wake;
+    wake.start(WAKE_INTERVAL_MS);
+
+    std::mt19937 rng(20200117);
+    std::vector<double> markLatencies;
+    std::vector<double> statusLatencies;
+    size_t clicks = 0;
+    size_t errors = 0;
+    Clock::time_point start = Clock::now();
+
+    for (size_t game = 0; game < games; game++)
+    {
+        QTest::mouseClick(newGame, Qt::LeftButton);
+
+        // The computer may open the game
+        if (!WaitUntil([&]() { return probe.IsUserTurn(); }))
+        {
+            errors++;
+            continue;
+        }
+
+        while (result->text().isEmpty())
+        {
+            std::vector<QAbstractButton *> freeCells;
+            for (auto it = board.begin(); it != board.end(); it++)
+            {
+                if ((*it)->isEnabled())
+                {
+                    freeCells.push_back(*it);
+                }
+            }
+            if (freeCells.empty())
+            {
+                errors++;
+                break;
+            }
+
+            size_t marksBefore = probe.CountMarks(COMPUTER_MARK);
+            probe.Arm();
+            Clock::time_point clicked = Clock::now();
+            QTest::mouseClick(freeCells[rng() % freeCells.size()], Qt::LeftButton);
+            clicks++;
+
+            // Done once the status is painted and, if the computer moved, its mark too
+            bool bPainted = WaitUntil([&]() {
+                return probe.bStatusPainted &&
+                       (probe.bMarkPainted || probe.CountMarks(COMPUTER_MARK) == marksBefore);
+            });
+            if (!bPainted)
+            {
+                errors++;
+                break;
+            }
+
+            statusLatencies.push_back(MicrosecondsBetween(clicked, probe.statusPainted));
+            if (probe.bMarkPainted)
+            {
+                markLatencies.push_back(MicrosecondsBetween(clicked, probe.markPainted));
+            }
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::sort(markLatencies.begin(), markLatencies.end());
+    std::sort(statusLatencies.begin(), statusLatencies.end());
+
+    std::cout << games << " games against '" << engineName << "' on the '"
+              << QApplication::platformName().toStdString() << "' platform, " << clicks << " clicks in "
+              << std::fixed << std::setprecision(2) << elapsed << " s" << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << "  click to computer mark painted: p50 " << Percentile(markLatencies, 0.50) << " us, p99 "
+              << Percentile(markLatencies, 0.99) << " us, max " << Percentile(markLatencies, 1.0) << " us"
+              << std::endl;
+    std::cout << "  click to status bar painted:    p50 " << Percentile(statusLatencies, 0.50) << " us, p99 "
+              << Percentile(statusLatencies, 0.99) << " us, max " << Percentile(statusLatencies, 1.0) << " us"
+              << std::endl;
+    std::cout << "  " << errors << " errors" << std::endl;
+
+    bool bOk = (errors == 0 && !markLatencies.empty());
+    if (maxP99 > 0 && (Percentile(markLatencies, 0.99) > maxP99 || Percentile(statusLatencies, 0.99) > maxP99))
+    {
+        std::cout << "  p99 above the " << std::setprecision(0) << maxP99 << " us limit" << std::endl;
+        bOk = false;
+    }
+    std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk ? 0 : 1;
+}
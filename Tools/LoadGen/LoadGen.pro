@@ -0,0 +1,18 @@
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../../TicTacToe/engine.pri)
+
+# Shares the wire format with the server
+INCLUDEPATH += ../GameServer
+
+SOURCES += \
+    main.cpp \
+    ../GameServer/protocol.cpp
+
+HEADERS += \
+    ../GameServer/protocol.h
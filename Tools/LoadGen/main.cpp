@@ -0,0 +1,398 @@
+//--------------------------------------------------------------------------------
+// LoadGen: drives a running GameServer with many concurrent games.
+//
+// Every session always has exactly one request in flight, so the number of
+// sessions is the number of games the server holds at once. Clients play
+// random legal moves and start a new game when one ends. Reports how many
+// sessions the server held, requests/sec, and move latency percentiles
+// (request sent to the engine's reply received).
+//
+// Usage: LoadGen [--socket PATH] [--sessions N] [--connections N]
+//                [--seconds S] [--engine NAME]
+//--------------------------------------------------------------------------------
+#include "protocol.h"
+#include "engine.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+// Tag of requests whose answer is not needed
+const uint32_t NO_GAME_TAG = 0xFFFFFFFF;
+
+static int Connect(const std::string & path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // A stalled server shows up as an error instead of a hang
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool SendAll(int fd, const std::vector<uint8_t> & data)
+{
+    for (size_t sent = 0; sent < data.size(); )
+    {
+        ssize_t bytes = send(fd, &data[sent], data.size() - sent, MSG_NOSIGNAL);
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        sent += static_cast<size_t>(bytes);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+// One client connection playing its share of the sessions
+//------------------------------------------------------------------------
+class LoadClient : public QThread
+{
+private:
+    struct ClientGame
+    {
+        uint32_t session;
+        BoardMask_t own;
+        BoardMask_t engine;
+        Clock::time_point sent;
+        bool bOpening;
+    };
+
+    std::string m_path;
+    size_t m_sessionCount;
+    uint8_t m_engineIndex;
+    Clock::time_point m_deadline;
+    std::mt19937 m_rng;
+    std::vector<ClientGame> m_games;
+    std::vector<uint8_t> m_output;
+
+    void Queue(uint32_t tag, uint32_t session, RequestType_t type, uint8_t arg);
+    void QueueMove(uint32_t tag);
+
+protected:
+    void run();
+
+public:
+    std::vector<double> latencies;
+    unsigned long long requests;
+    unsigned long long games;
+    unsigned long long errors;
+    size_t opened;
+
+    LoadClient(const std::string & path, size_t sessions, uint8_t engineIndex, Clock::time_point deadline,
+               unsigned seed)
+        : m_path(path), m_sessionCount(sessions), m_engineIndex(engineIndex), m_deadline(deadline), m_rng(seed)
+    {
+        requests = 0;
+        games = 0;
+        errors = 0;
+        opened = 0;
+    }
+};
+
+void LoadClient::Queue(uint32_t tag, uint32_t session, RequestType_t type, uint8_t arg)
+{
+    Request request;
+    request.tag = tag;
+    request.session = session;
+    request.type = static_cast<uint8_t>(type);
+    request.arg = arg;
+
+    size_t size = m_output.size();
+    m_output.resize(size + REQUEST_SIZE);
+    EncodeRequest(request, &m_output[size]);
+}
+
+// Plays a random empty cell; the tag is the index of the game
+void LoadClient::QueueMove(uint32_t tag)
+{
+    ClientGame & game = m_games[tag];
+    uint32_t empty = ~(game.own | game.engine) & FULL_BOARD_MASK;
+    for (int skip = static_cast<int>(m_rng() % static_cast<uint32_t>(CountBits(empty))); skip > 0; skip--)
+    {
+        empty &= empty - 1;
+    }
+    uint8_t cell = static_cast<uint8_t>(GetLowestBitIndex(empty));
+
+    game.own |= static_cast<BoardMask_t>(1u << cell);
+    game.sent = Clock::now();
+    Queue(tag, game.session, REQUEST_MOVE, cell);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : run
+//
+// @description             : Opens all sessions, then answers every response
+//                            with the next request until the deadline
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+void LoadClient::run()
+{
+    int fd = Connect(m_path);
+    if (fd < 0)
+    {
+        errors++;
+        return;
+    }
+
+    m_games.resize(m_sessionCount);
+    for (uint32_t tag = 0; tag < m_sessionCount; tag++)
+    {
+        m_games[tag].bOpening = true;
+        Queue(tag, 0, REQUEST_NEW_GAME, m_engineIndex);
+    }
+
+    std::vector<uint8_t> input;
+    uint8_t chunk[65536];
+    while (Clock::now() < m_deadline)
+    {
+        if (!SendAll(fd, m_output))
+        {
+            errors++;
+            break;
+        }
+        requests += m_output.size() / REQUEST_SIZE;
+        m_output.clear();
+
+        ssize_t bytes = recv(fd, chunk, sizeof(chunk), 0);
+        if (bytes <= 0)
+        {
+            errors++;
+            break;
+        }
+        input.insert(input.end(), chunk, chunk + bytes);
+
+        Clock::time_point now = Clock::now();
+        size_t offset = 0;
+        for (; offset + RESPONSE_SIZE <= input.size(); offset += RESPONSE_SIZE)
+        {
+            Response response;
+            DecodeResponse(&input[offset], response);
+            if (response.tag == NO_GAME_TAG)
+            {
+                // Answer to a close
+                continue;
+            }
+            if (response.status != STATUS_OK || response.tag >= m_games.size())
+            {
+                errors++;
+                continue;
+            }
+
+            ClientGame & game = m_games[response.tag];
+            if (game.bOpening)
+            {
+                game.bOpening = false;
+                game.session = response.session;
+                game.own = 0;
+                game.engine = 0;
+                opened++;
+                QueueMove(response.tag);
+                continue;
+            }
+
+            latencies.push_back(std::chrono::duration<double, std::micro>(now - game.sent).count());
+            if (response.move != NO_MOVE)
+            {
+                game.engine |= static_cast<BoardMask_t>(1u << response.move);
+            }
+
+            if (response.result == SESSION_ONGOING)
+            {
+                QueueMove(response.tag);
+            }
+            else
+            {
+                games++;
+                Queue(NO_GAME_TAG, game.session, REQUEST_CLOSE, 0);
+                game.bOpening = true;
+                Queue(response.tag, 0, REQUEST_NEW_GAME, m_engineIndex);
+            }
+        }
+        input.erase(input.begin(), input.begin() + offset);
+    }
+
+    close(fd);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : QueryOpenSessions
+//
+// @description             : Asks the server how many sessions it holds
+//
+// @return                  : number of sessions, or -1 on failure
+//--------------------------------------------------------------------------------
+static long QueryOpenSessions(const std::string & path)
+{
+    int fd = Connect(path);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    Request request = {0, 0, REQUEST_STATS, 0};
+    std::vector<uint8_t> frame(REQUEST_SIZE);
+    EncodeRequest(request, frame.data());
+
+    long sessions = -1;
+    uint8_t reply[RESPONSE_SIZE];
+    size_t received = 0;
+    if (SendAll(fd, frame))
+    {
+        while (received < RESPONSE_SIZE)
+        {
+            ssize_t bytes = recv(fd, reply + received, RESPONSE_SIZE - received, 0);
+            if (bytes <= 0)
+            {
+                break;
+            }
+            received += static_cast<size_t>(bytes);
+        }
+    }
+    if (received == RESPONSE_SIZE)
+    {
+        Response response;
+        DecodeResponse(reply, response);
+        sessions = static_cast<long>(response.value);
+    }
+
+    close(fd);
+    return sessions;
+}
+
+static double Percentile(const std::vector<double> & sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1));
+    return sorted[index];
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--socket PATH] [--sessions N] [--connections N] [--seconds S]"
+              << " [--engine NAME]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string path = "tictactoe.sock";
+    size_t sessions = 10240;
+    size_t connections = 8;
+    double seconds = 5;
+    std::string engineName = "heuristic";
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--socket") == 0 && hasValue)
+        {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--sessions") == 0 && hasValue)
+        {
+            sessions = static_cast<size_t>(atol(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--connections") == 0 && hasValue)
+        {
+            connections = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+        {
+            seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--engine") == 0 && hasValue)
+        {
+            engineName = argv[++i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> names = GetEngineNames();
+    auto engine = std::find(names.begin(), names.end(), engineName);
+    if (engine == names.end() || connections < 1 || sessions < connections || seconds <= 0)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::microseconds(static_cast<long long>(seconds * 1e6));
+    std::vector<std::unique_ptr<LoadClient> > clients;
+    for (size_t i = 0; i < connections; i++)
+    {
+        size_t share = sessions / connections + (i < sessions % connections ? 1 : 0);
+        clients.emplace_back(new LoadClient(path, share, static_cast<uint8_t>(engine - names.begin()), deadline,
+                                            static_cast<unsigned>(i + 1)));
+        clients.back()->start();
+    }
+
+    // Sample the server halfway through, when all sessions should be open
+    QThread::msleep(static_cast<unsigned long>(seconds * 500));
+    long serverSessions = QueryOpenSessions(path);
+
+    std::vector<double> latencies;
+    unsigned long long requests = 0;
+    unsigned long long games = 0;
+    unsigned long long errors = 0;
+    size_t opened = 0;
+    for (auto it = clients.begin(); it != clients.end(); it++)
+    {
+        (*it)->wait();
+        latencies.insert(latencies.end(), (*it)->latencies.begin(), (*it)->latencies.end());
+        requests += (*it)->requests;
+        games += (*it)->games;
+        errors += (*it)->errors;
+        opened += (*it)->opened;
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << sessions << " concurrent games against '" << engineName << "' over " << connections
+              << " connections" << std::endl;
+    std::cout << "  server held " << serverSessions << " sessions at the midpoint, " << opened
+              << " games opened in total" << std::endl;
+    std::cout << "  " << requests << " requests in " << std::fixed << std::setprecision(2) << elapsed << " s, "
+              << std::setprecision(0) << requests / elapsed << " requests/sec, " << games << " games finished"
+              << std::endl;
+    std::cout << "  move latency p50 " << std::setprecision(1) << Percentile(latencies, 0.50) << " us, p99 "
+              << Percentile(latencies, 0.99) << " us, max " << Percentile(latencies, 1.0) << " us" << std::endl;
+    std::cout << "  " << errors << " errors" << std::endl;
+
+    bool bOk = (errors == 0 && serverSessions >= static_cast<long>(sessions));
+    std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+//--------------------------------------------------------------------------------
+// OrderingBench: effect of move ordering on the m,n,k alpha-beta search.
+//
+// Builds a fixed set of positions for each board by playing random moves
+// from the empty board (the same set on every run) and solves every
+// position with each move ordering heuristic alone, with all of them and
+// with none (plain cell order). Reports nodes to solve, the effective
+// branching factor (the b for which b^depth equals the nodes searched) and
+// time, and checks that every ordering proves the same score.
+//
+// Usage: OrderingBench [--positions N] [--board WxHxK --stones N]
+//--------------------------------------------------------------------------------
+#include "mnkengine.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+
+struct BenchBoard
+{
+    size_t width;
+    size_t height;
+    size_t k;
+    size_t stones;
+};
+
+struct BenchPosition
+{
+    uint64_t own;           // side to move
+    uint64_t opponent;
+};
+
+struct OrderingResult
+{
+    unsigned long long nodes;
+    double ebf;             // mean over the positions
+    double seconds;
+    std::vector<int> scores;
+};
+
+static const struct
+{
+    const char * name;
+    unsigned ordering;
+} ORDERINGS[] =
+{
+    {"none", MNK_ORDER_NONE},
+    {"hash move", MNK_ORDER_HASH_MOVE},
+    {"killers", MNK_ORDER_KILLERS},
+    {"history", MNK_ORDER_HISTORY},
+    {"prior", MNK_ORDER_PRIOR},
+    {"all", MNK_ORDER_ALL},
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : MakePositions
+//
+// @description             : Plays random moves from the empty board until
+//                            'stones' are down, dropping games that end first
+//
+// @return                  : the positions, side to move first
+//--------------------------------------------------------------------------------
+static std::vector<BenchPosition> MakePositions(const BenchBoard & board, size_t count, std::mt19937 & rng)
+{
+    std::vector<BenchPosition> positions;
+    while (positions.size() < count)
+    {
+        MnkGame game(board.width, board.height, board.k);
+        while (!game.GameOver() && game.GetMoveHistory().size() < board.stones)
+        {
+            std::vector<size_t> moves = game.GetAvailableMoves();
+            std::uniform_int_distribution<size_t> pick(0, moves.size() - 1);
+            game.AddPlayerMarkToBoard(moves[pick(rng)]);
+        }
+        if (game.GameOver())
+        {
+            continue;
+        }
+
+        BenchPosition position = {0, 0};
+        for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+        {
+            if (game.GetCell(cell) == game.GetTurn())
+            {
+                position.own |= 1ULL << cell;
+            }
+            else if (game.GetCell(cell) != PLAYER_NONE)
+            {
+                position.opponent |= 1ULL << cell;
+            }
+        }
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Solve
+//
+// @description             : Solves every position with one ordering, each on
+//                            a fresh engine so no table carries over
+//
+// @return                  : OrderingResult
+//--------------------------------------------------------------------------------
+static OrderingResult Solve(const BenchBoard & board, const std::vector<BenchPosition> & positions, unsigned ordering)
+{
+    OrderingResult result;
+    result.nodes = 0;
+    result.ebf = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto it = positions.begin(); it != positions.end(); it++)
+    {
+        std::unique_ptr<MnkEngine> engine(new MnkEngine());
+        engine->SetBoard(board.width, board.height, board.k);
+        engine->SetMoveOrdering(ordering);
+
+        int score;
+        engine->Search(it->own, it->opponent, 0, 0, score);
+        const MnkSearchStats & stats = engine->GetStats();
+        result.nodes += stats.nodes;
+        result.ebf += std::pow(static_cast<double>(stats.nodes), 1.0 / std::max(stats.depth, 1));
+        result.scores.push_back(score);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.ebf /= positions.size();
+
+    return result;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--positions N] [--board WxHxK --stones N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 12;
+    std::vector<BenchBoard> boards;
+    boards.push_back({4, 4, 4, 4});
+    boards.push_back({5, 5, 4, 11});
+    BenchBoard custom = {0, 0, 0, 0};
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--positions") == 0 && hasValue)
+        {
+            count = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--board") == 0 && hasValue)
+        {
+            if (sscanf(argv[++i], "%zux%zux%zu", &custom.width, &custom.height, &custom.k) != 3)
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--stones") == 0 && hasValue)
+        {
+            custom.stones = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (custom.width > 0)
+    {
+        if (custom.width * custom.height > 64 || custom.k < 1 || custom.stones >= custom.width * custom.height)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        boards.assign(1, custom);
+    }
+    if (count < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(20200117);
+    bool bPassed = true;
+    for (auto board = boards.begin(); board != boards.end(); board++)
+    {
+        std::vector<BenchPosition> positions = MakePositions(*board, count, rng);
+        std::cout << board->width << "x" << board->height << " k=" << board->k << ": " << count
+                  << " positions with " << board->stones << " stones" << std::endl;
+        std::cout << "ordering      nodes to solve       EBF    seconds   nodes vs none" << std::endl;
+
+        OrderingResult baseline;
+        for (size_t i = 0; i < sizeof(ORDERINGS) / sizeof(ORDERINGS[0]); i++)
+        {
+            OrderingResult result = Solve(*board, positions, ORDERINGS[i].ordering);
+            if (i == 0)
+            {
+                baseline = result;
+            }
+
+            bool bSame = (result.scores == baseline.scores);
+            bPassed = bPassed && bSame;
+            std::cout << std::left << std::setw(12) << ORDERINGS[i].name << std::right << std::setw(16)
+                      << result.nodes << std::fixed << std::setprecision(2) << std::setw(10) << result.ebf
+                      << std::setprecision(3) << std::setw(11) << result.seconds << std::setprecision(1)
+                      << std::setw(15) << 100.0 * result.nodes / baseline.nodes << "%"
+                      << (bSame ? "" : "  SCORES DIFFER") << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}
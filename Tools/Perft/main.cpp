@@ -0,0 +1,314 @@
+//--------------------------------------------------------------------------------
+// Perft: exhaustive game-tree enumerator built on the Game move generator.
+//
+// Counts the nodes reached at every ply, the games completed at every ply and
+// how they ended. Run to full depth it reproduces the known 3x3 totals and
+// doubles as a regression check for AddPlayerMarkToBoard/CheckWin. It also
+// serves as the throughput number for move generation (nodes/sec).
+//
+// Usage: Perft [depth] [threads]
+//--------------------------------------------------------------------------------
+#include "game.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+const size_t MAX_PLY = 9;
+
+// Known totals for 3x3 when the first player is PLAYER_USER, indexed by ply
+const unsigned long long EXPECTED_NODES[MAX_PLY + 1] = {
+    1, 9, 72, 504, 3024, 15120, 54720, 148176, 200448, 127872
+};
+const unsigned long long EXPECTED_GAMES[MAX_PLY + 1] = {
+    0, 0, 0, 0, 0, 1440, 5328, 47952, 72576, 127872
+};
+const unsigned long long EXPECTED_TOTAL_GAMES = 255168;
+const unsigned long long EXPECTED_FIRST_PLAYER_WINS = 131184;
+const unsigned long long EXPECTED_SECOND_PLAYER_WINS = 77904;
+const unsigned long long EXPECTED_DRAWS = 46080;
+
+struct PerftCounters
+{
+    unsigned long long nodes[MAX_PLY + 1];
+    unsigned long long games[MAX_PLY + 1];
+    unsigned long long userWins;
+    unsigned long long computerWins;
+    unsigned long long draws;
+
+    PerftCounters()
+    {
+        for (size_t i = 0; i <= MAX_PLY; i++)
+        {
+            nodes[i] = 0;
+            games[i] = 0;
+        }
+        userWins = 0;
+        computerWins = 0;
+        draws = 0;
+    }
+
+    void Add(const PerftCounters & other)
+    {
+        for (size_t i = 0; i <= MAX_PLY; i++)
+        {
+            nodes[i] += other.nodes[i];
+            games[i] += other.games[i];
+        }
+        userWins += other.userWins;
+        computerWins += other.computerWins;
+        draws += other.draws;
+    }
+
+    unsigned long long TotalNodes() const
+    {
+        unsigned long long total = 0;
+        for (size_t i = 1; i <= MAX_PLY; i++)
+        {
+            total += nodes[i];
+        }
+        return total;
+    }
+
+    unsigned long long TotalGames() const
+    {
+        return userWins + computerWins + draws;
+    }
+};
+
+static Player_t Opponent(Player_t player)
+{
+    return (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Perft
+//
+// @description             : Plays every available move for 'player' on a copy
+//                            of the game and recurses until the game is over or
+//                            'maxDepth' plies have been played.
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void Perft(Game & game, Player_t player, size_t ply, size_t maxDepth, PerftCounters & counters)
+{
+    std::vector<size_t> moves = game.GetAvailableMoves();
+    for (auto it = moves.begin(); it != moves.end(); it++)
+    {
+        Game child = game;
+        child.AddPlayerMarkToBoard(*it, player);
+        counters.nodes[ply + 1]++;
+
+        if (child.GameOver())
+        {
+            counters.games[ply + 1]++;
+
+            Player_t winner = child.CheckWin();
+            if (winner == PLAYER_USER)
+            {
+                counters.userWins++;
+            }
+            else if (winner == PLAYER_COMPUTER)
+            {
+                counters.computerWins++;
+            }
+            else
+            {
+                counters.draws++;
+            }
+        }
+        else if (ply + 1 < maxDepth)
+        {
+            Perft(child, Opponent(player), ply + 1, maxDepth, counters);
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// Worker thread that enumerates the subtrees below a share of root moves
+//------------------------------------------------------------------------
+class PerftWorker: public QThread
+{
+private:
+    Game m_root;
+    std::vector<size_t> m_rootMoves;
+    size_t m_maxDepth;
+    PerftCounters m_counters;
+
+public:
+    PerftWorker(const Game & root, size_t maxDepth) : QThread()
+    {
+        m_root = root;
+        m_maxDepth = maxDepth;
+    }
+
+    void AddRootMove(size_t move)
+    {
+        m_rootMoves.push_back(move);
+    }
+
+    const PerftCounters & GetCounters()
+    {
+        return m_counters;
+    }
+
+    void run()
+    {
+        for (auto it = m_rootMoves.begin(); it != m_rootMoves.end(); it++)
+        {
+            Game child = m_root;
+            child.AddPlayerMarkToBoard(*it, PLAYER_USER);
+            m_counters.nodes[1]++;
+
+            if (child.GameOver())
+            {
+                m_counters.games[1]++;
+            }
+            else if (m_maxDepth > 1)
+            {
+                Perft(child, PLAYER_COMPUTER, 1, m_maxDepth, m_counters);
+            }
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : RunPerft
+//
+// @description             : Enumerates the tree from the empty board, splitting
+//                            the root moves across 'threads' workers.
+//
+// @return                  : Elapsed seconds
+//--------------------------------------------------------------------------------
+static double RunPerft(size_t maxDepth, size_t threads, PerftCounters & counters)
+{
+    Game root;
+    std::vector<size_t> rootMoves = root.GetAvailableMoves();
+    counters.nodes[0] = 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<PerftWorker *> workers;
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers.push_back(new PerftWorker(root, maxDepth));
+    }
+    for (size_t i = 0; i < rootMoves.size(); i++)
+    {
+        workers[i % threads]->AddRootMove(rootMoves[i]);
+    }
+    for (auto it = workers.begin(); it != workers.end(); it++)
+    {
+        (*it)->start();
+    }
+    for (auto it = workers.begin(); it != workers.end(); it++)
+    {
+        (*it)->wait();
+        counters.Add((*it)->GetCounters());
+        delete *it;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : VerifyCounters
+//
+// @description             : Compares the counters with the known 3x3 totals up
+//                            to 'maxDepth'.
+//
+// @return                  : true if everything matches
+//--------------------------------------------------------------------------------
+static bool VerifyCounters(const PerftCounters & counters, size_t maxDepth)
+{
+    bool ok = true;
+    for (size_t ply = 1; ply <= maxDepth; ply++)
+    {
+        if (counters.nodes[ply] != EXPECTED_NODES[ply] || counters.games[ply] != EXPECTED_GAMES[ply])
+        {
+            std::cout << "MISMATCH at ply " << ply << ": nodes " << counters.nodes[ply]
+                      << " (expected " << EXPECTED_NODES[ply] << "), games " << counters.games[ply]
+                      << " (expected " << EXPECTED_GAMES[ply] << ")" << std::endl;
+            ok = false;
+        }
+    }
+
+    if (maxDepth == MAX_PLY &&
+        (counters.TotalGames() != EXPECTED_TOTAL_GAMES ||
+         counters.userWins != EXPECTED_FIRST_PLAYER_WINS ||
+         counters.computerWins != EXPECTED_SECOND_PLAYER_WINS ||
+         counters.draws != EXPECTED_DRAWS))
+    {
+        std::cout << "MISMATCH in outcomes: games " << counters.TotalGames()
+                  << ", first player wins " << counters.userWins
+                  << ", second player wins " << counters.computerWins
+                  << ", draws " << counters.draws << std::endl;
+        ok = false;
+    }
+
+    return ok;
+}
+
+static void PrintCounters(const PerftCounters & counters, size_t maxDepth)
+{
+    std::cout << std::setw(5) << "ply" << std::setw(12) << "nodes" << std::setw(12) << "games" << std::endl;
+    for (size_t ply = 1; ply <= maxDepth; ply++)
+    {
+        std::cout << std::setw(5) << ply << std::setw(12) << counters.nodes[ply]
+                  << std::setw(12) << counters.games[ply] << std::endl;
+    }
+    std::cout << "Total nodes        : " << counters.TotalNodes() << std::endl;
+    std::cout << "Completed games    : " << counters.TotalGames() << std::endl;
+    std::cout << "First player wins  : " << counters.userWins << std::endl;
+    std::cout << "Second player wins : " << counters.computerWins << std::endl;
+    std::cout << "Draws              : " << counters.draws << std::endl;
+}
+
+static void PrintSpeed(const PerftCounters & counters, double seconds)
+{
+    double nps = (seconds > 0.0) ? counters.TotalNodes() / seconds : 0.0;
+    std::cout << std::fixed << std::setprecision(3) << seconds << " s, "
+              << std::setprecision(0) << nps << " nodes/sec" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxDepth = MAX_PLY;
+    size_t threads = static_cast<size_t>(QThread::idealThreadCount());
+
+    if (argc > 1)
+    {
+        maxDepth = static_cast<size_t>(atoi(argv[1]));
+    }
+    if (argc > 2)
+    {
+        threads = static_cast<size_t>(atoi(argv[2]));
+    }
+    if (maxDepth < 1 || maxDepth > MAX_PLY)
+    {
+        std::cout << "Usage: " << argv[0] << " [depth 1-9] [threads]" << std::endl;
+        return 1;
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    PerftCounters single;
+    double singleSeconds = RunPerft(maxDepth, 1, single);
+
+    PerftCounters split;
+    double splitSeconds = RunPerft(maxDepth, threads, split);
+
+    PrintCounters(single, maxDepth);
+    std::cout << "1 thread: ";
+    PrintSpeed(single, singleSeconds);
+    std::cout << threads << " threads: ";
+    PrintSpeed(split, splitSeconds);
+
+    bool ok = VerifyCounters(single, maxDepth) && VerifyCounters(split, maxDepth);
+    std::cout << (ok ? "OK" : "FAILED") << std::endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------------
+// QubicBench: throughput of the 4x4x4 bitboard engine.
+//
+// 1. Random playouts: positions/sec for move making and win detection.
+// 2. Search: positions/sec (nodes) and depth reached by QubicEngine on a fixed
+//    set of opening positions, each under the move time budget.
+//
+// Usage: QubicBench [budget ms] [positions]
+//--------------------------------------------------------------------------------
+#include "qubic.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+const int DEFAULT_BUDGET_MS = 200;
+const size_t DEFAULT_POSITIONS = 20;
+const size_t PLAYOUT_GAMES = 200000;
+const size_t OPENING_MOVES = 8;
+
+static Player_t Opponent(Player_t player)
+{
+    return (player == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchPlayouts
+//
+// @description             : Plays random games to the end on the bitboards
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void BenchPlayouts(std::mt19937_64 & rng)
+{
+    unsigned long long positions = 0;
+    unsigned long long decisive = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t game = 0; game < PLAYOUT_GAMES; game++)
+    {
+        uint64_t masks[2] = {0, 0};
+        uint64_t empty = ~0ULL;
+        int side = 0;
+        while (empty)
+        {
+            // Pick a random empty cell
+            int skip = static_cast<int>(rng() % static_cast<uint64_t>(CountBits(empty)));
+            uint64_t pick = empty;
+            for (int i = 0; i < skip; i++)
+            {
+                pick &= pick - 1;
+            }
+            size_t cell = GetLowestBitIndex(pick);
+
+            masks[side] |= 1ULL << cell;
+            empty &= ~(1ULL << cell);
+            positions++;
+
+            if (IsQubicWinAfterMove(masks[side], cell))
+            {
+                decisive++;
+                break;
+            }
+            side ^= 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Random playouts : " << PLAYOUT_GAMES << " games, " << positions << " positions, "
+              << decisive << " decisive" << std::endl;
+    std::cout << "                  " << std::fixed << std::setprecision(0)
+              << positions / seconds << " positions/sec, " << PLAYOUT_GAMES / seconds << " games/sec" << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : MakeOpening
+//
+// @description             : Random opening of OPENING_MOVES moves that leaves no
+//                            threat on the board
+//
+// @return                  : QubicGame
+//--------------------------------------------------------------------------------
+static QubicGame MakeOpening(std::mt19937_64 & rng)
+{
+    while (true)
+    {
+        QubicGame game;
+        Player_t turn = PLAYER_USER;
+        for (size_t i = 0; i < OPENING_MOVES; i++)
+        {
+            std::vector<size_t> moves = game.GetAvailableMoves();
+            game.AddPlayerMarkToBoard(moves[rng() % moves.size()], turn);
+            turn = Opponent(turn);
+        }
+
+        uint64_t user = game.GetPlayerMask(PLAYER_USER);
+        uint64_t computer = game.GetPlayerMask(PLAYER_COMPUTER);
+        if (!game.GameOver() && !GetQubicThreats(user, computer) && !GetQubicThreats(computer, user))
+        {
+            return game;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchSearch
+//
+// @description             : Searches every position under the time budget
+//
+// @return                  : true if every move was within budget
+//--------------------------------------------------------------------------------
+static bool BenchSearch(std::mt19937_64 & rng, int budgetMs, size_t positionCount)
+{
+    QubicEngine engine;
+    unsigned long long nodes = 0;
+    double seconds = 0.0;
+    double slowestMs = 0.0;
+    int depthTotal = 0;
+
+    for (size_t i = 0; i < positionCount; i++)
+    {
+        QubicGame game = MakeOpening(rng);
+
+        auto start = std::chrono::steady_clock::now();
+        engine.SelectMove(game, PLAYER_USER, budgetMs);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        nodes += engine.GetNodes();
+        seconds += elapsed;
+        depthTotal += engine.GetCompletedDepth();
+        slowestMs = std::max(slowestMs, elapsed * 1000.0);
+    }
+
+    std::cout << "Search          : " << positionCount << " positions, " << budgetMs << " ms budget" << std::endl;
+    std::cout << "                  " << std::fixed << std::setprecision(0) << nodes / seconds
+              << " positions/sec, average depth " << std::setprecision(1)
+              << static_cast<double>(depthTotal) / positionCount
+              << ", slowest move " << slowestMs << " ms" << std::endl;
+
+    return slowestMs <= budgetMs;
+}
+
+int main(int argc, char *argv[])
+{
+    int budgetMs = DEFAULT_BUDGET_MS;
+    size_t positions = DEFAULT_POSITIONS;
+    if (argc > 1)
+    {
+        budgetMs = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        positions = static_cast<size_t>(atoi(argv[2]));
+    }
+    if (budgetMs < 1 || positions < 1)
+    {
+        std::cout << "Usage: " << argv[0] << " [budget ms] [positions]" << std::endl;
+        return 1;
+    }
+
+    // Fixed seed so runs are comparable
+    std::mt19937_64 rng(20200117);
+
+    BenchPlayouts(rng);
+    bool bWithinBudget = BenchSearch(rng, budgetMs, positions);
+    std::cout << (bWithinBudget ? "OK" : "OVER BUDGET") << std::endl;
+
+    return bWithinBudget ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------
+// RulesBench: cost of rule policies.
+//
+// Solves the empty board with PolicySearch for several rule sets and compares
+// the standard 3x3 instantiation with a hand-written 3x3 search running the
+// same algorithm, to show the policies add no overhead.
+//
+// Usage: RulesBench [repeats]
+//--------------------------------------------------------------------------------
+#include "rules.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+typedef GameRules<BoardGeometry<3, 3>, KInARow<3>, MiserePlay, WildSymbols> WildMisereRules;
+typedef GameRules<BoardGeometry<4, 3>, KInARow<3>, NormalPlay, OwnSymbol> Board4x3Rules;
+typedef GameRules<BoardGeometry<4, 4>, KInARow<3>, NormalPlay, OwnSymbol> Board4x4K3Rules;
+
+//------------------------------------------------------------------------
+// Hand-written 3x3 search: same move order and pruning as PolicySearch
+//------------------------------------------------------------------------
+class HandWrittenSearch
+{
+private:
+    // Lines through each cell, 0 terminated
+    static const uint16_t CELL_LINES[9][5];
+
+    unsigned long long m_nodes;
+
+    static bool CompletesLine(uint16_t mask, size_t cell)
+    {
+        for (const uint16_t * line = CELL_LINES[cell]; *line; line++)
+        {
+            if ((mask & *line) == *line)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int Negamax(uint16_t own, uint16_t opponent, int ply, int alpha, int beta)
+    {
+        m_nodes++;
+
+        uint16_t empty = static_cast<uint16_t>(~(own | opponent) & 0x1FF);
+        if (empty == 0)
+        {
+            return 0;
+        }
+
+        for (uint16_t remaining = empty; remaining; remaining &= remaining - 1)
+        {
+            size_t cell = GetLowestBitIndex(remaining);
+            uint16_t placed = static_cast<uint16_t>(own | (1u << cell));
+
+            int score;
+            if (CompletesLine(placed, cell))
+            {
+                score = 100 - ply;
+            }
+            else
+            {
+                score = -Negamax(opponent, placed, ply + 1, -beta, -alpha);
+            }
+
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    return alpha;
+                }
+            }
+        }
+
+        return alpha;
+    }
+
+public:
+    HandWrittenSearch() : m_nodes(0) {}
+
+    unsigned long long GetNodes() const { return m_nodes; }
+
+    int Solve()
+    {
+        m_nodes = 0;
+        return Negamax(0, 0, 0, -101, 101);
+    }
+};
+
+const uint16_t HandWrittenSearch::CELL_LINES[9][5] = {
+    {0x007, 0x049, 0x111, 0},
+    {0x007, 0x092, 0},
+    {0x007, 0x124, 0x054, 0},
+    {0x038, 0x049, 0},
+    {0x038, 0x092, 0x111, 0x054},
+    {0x038, 0x124, 0},
+    {0x1C0, 0x049, 0x054, 0},
+    {0x1C0, 0x092, 0},
+    {0x1C0, 0x124, 0x111, 0}
+};
+
+static const char * Outcome(int score)
+{
+    return (score > 0) ? "first player wins" : (score < 0) ? "second player wins" : "draw";
+}
+
+static void PrintRow(const std::string & name, int score, unsigned long long nodes, double seconds, size_t repeats)
+{
+    std::cout << std::left << std::setw(22) << name << std::setw(20) << Outcome(score) << std::right
+              << std::setw(12) << nodes << std::fixed << std::setprecision(3)
+              << std::setw(12) << seconds * 1e6 / repeats
+              << std::setprecision(0) << std::setw(14) << nodes * repeats / seconds << std::endl;
+}
+
+template <class Rules>
+static double TimePolicy(size_t repeats, int & score, unsigned long long & nodes)
+{
+    PolicySearch<Rules> search;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repeats; i++)
+    {
+        score = search.Solve(0, 0, 0);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    nodes = search.GetNodes();
+    return seconds;
+}
+
+template <class Rules>
+static void RunPolicy(const std::string & name, size_t repeats)
+{
+    int score = 0;
+    unsigned long long nodes = 0;
+    double seconds = TimePolicy<Rules>(repeats, score, nodes);
+    PrintRow(name, score, nodes, seconds, repeats);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t repeats = (argc > 1) ? static_cast<size_t>(atoi(argv[1])) : 200;
+    if (repeats < 1)
+    {
+        std::cout << "Usage: " << argv[0] << " [repeats]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(22) << "rules" << std::setw(20) << "result" << std::right
+              << std::setw(12) << "nodes" << std::setw(12) << "us/solve" << std::setw(14) << "nodes/sec" << std::endl;
+
+    // Hand-written reference against the standard rule set, interleaved to
+    // even out frequency scaling
+    HandWrittenSearch handWritten;
+    unsigned long long policyNodes = 0;
+    double handSeconds = 0.0;
+    double policySeconds = 0.0;
+    int handScore = 0;
+    int policyScore = 0;
+    for (int round = 0; round < 3; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < repeats; i++)
+        {
+            handScore = handWritten.Solve();
+        }
+        handSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        policySeconds += TimePolicy<StandardRules>(repeats, policyScore, policyNodes);
+    }
+    PrintRow("3x3 (hand-written)", handScore, handWritten.GetNodes(), handSeconds / 3, repeats);
+    PrintRow("3x3 (policy)", policyScore, policyNodes, policySeconds / 3, repeats);
+
+    RunPolicy<MisereRules>("3x3 misere", repeats);
+    RunPolicy<WildRules>("3x3 wild", repeats);
+    RunPolicy<WildMisereRules>("3x3 wild misere", repeats);
+    RunPolicy<Board4x3Rules>("4x3 k=3", 1);
+    RunPolicy<Board4x4K3Rules>("4x4 k=3", 1);
+
+    bool bSameTree = (policyNodes == handWritten.GetNodes());
+    std::cout << std::endl << "Policy / hand-written time: " << std::setprecision(3)
+              << policySeconds / handSeconds << (bSameTree ? "" : " (node counts differ!)") << std::endl;
+
+    return bSameTree ? 0 : 1;
+}
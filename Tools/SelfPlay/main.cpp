@@ -0,0 +1,360 @@
+//--------------------------------------------------------------------------------
+// SelfPlay: plays the m,n,k engine against itself and exports the searched
+// positions as a training dataset.
+//
+// Every game opens with --random-plies random moves, after which the engine
+// picks each move with a --depth ply search (or --budget ms). Each searched
+// position becomes a row: the position, the side to move, the move played,
+// the final outcome for the side to move and the search value. Positions
+// already exported, in any symmetry, are dropped through a lock-free set
+// of canonical keys shared by all --threads workers; --no-dedup keeps them.
+// Rows are streamed to a chunked, compressed columnar file (see dataset.h)
+// by a writer thread, and the file is read back and checked at the end.
+//
+// Usage: SelfPlay [--board WxHxK] [--games N] [--threads N] [--depth N]
+//                 [--budget MS] [--random-plies N] [--out PATH] [--no-dedup]
+//--------------------------------------------------------------------------------
+#include "bitboard.h"
+#include "concurrentset.h"
+#include "dataset.h"
+#include "mnkengine.h"
+#include "openingbook.h"
+#include <QThread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <unordered_set>
+
+// Rows a worker collects before handing them to the writer
+const size_t SELFPLAY_BATCH_ROWS = 4096;
+
+class SelfPlayWorker: public QThread
+{
+private:
+    size_t m_width;
+    size_t m_height;
+    size_t m_k;
+    size_t m_games;
+    std::atomic<size_t> & m_next;
+    ConcurrentHashSet * m_seen;
+    const CanonicalHasher & m_hasher;
+    DatasetWriter & m_writer;
+    int m_depth;
+    int m_budgetMs;
+    size_t m_randomPlies;
+    unsigned m_seed;
+
+public:
+    unsigned long long positions;
+    unsigned long long duplicates;
+    unsigned long long nodes;
+
+    SelfPlayWorker(size_t width, size_t height, size_t k, size_t games, std::atomic<size_t> & next,
+                   ConcurrentHashSet * seen, const CanonicalHasher & hasher, DatasetWriter & writer, int depth,
+                   int budgetMs, size_t randomPlies, unsigned seed)
+        : QThread(), m_width(width), m_height(height), m_k(k), m_games(games), m_next(next), m_seen(seen),
+          m_hasher(hasher), m_writer(writer), m_depth(depth), m_budgetMs(budgetMs), m_randomPlies(randomPlies),
+          m_seed(seed), positions(0), duplicates(0), nodes(0)
+    {
+    }
+
+    void run()
+    {
+        MnkEngine engine;
+        engine.SetBoard(m_width, m_height, m_k);
+        std::mt19937 rng(m_seed);
+        std::vector<DatasetRow> batch;
+
+        while (m_next++ < m_games)
+        {
+            MnkGame game(m_width, m_height, m_k);
+            std::vector<DatasetRow> rows;
+            while (!game.GameOver())
+            {
+                size_t move;
+                if (game.GetMoveHistory().size() < m_randomPlies)
+                {
+                    std::vector<size_t> moves = game.GetAvailableMoves();
+                    move = moves[rng() % moves.size()];
+                }
+                else
+                {
+                    DatasetRow row = DatasetRow();
+                    for (size_t cell = 0; cell < game.GetCellCount(); cell++)
+                    {
+                        if (game.GetCell(cell) == PLAYER_USER)
+                        {
+                            row.first |= 1ULL << cell;
+                        }
+                        else if (game.GetCell(cell) == PLAYER_COMPUTER)
+                        {
+                            row.second |= 1ULL << cell;
+                        }
+                    }
+                    row.side = (game.GetTurn() == PLAYER_USER) ? 0 : 1;
+
+                    int score;
+                    uint64_t own = row.side ? row.second : row.first;
+                    uint64_t opponent = row.side ? row.first : row.second;
+                    move = engine.Search(own, opponent, m_budgetMs, m_depth, score);
+                    row.move = static_cast<uint8_t>(move);
+                    row.value = score;
+                    rows.push_back(row);
+                }
+                game.AddPlayerMarkToBoard(move);
+            }
+
+            // Outcomes are only known now; then each position is kept the
+            // first time any worker sees it
+            Player_t winner = game.CheckWin();
+            for (auto it = rows.begin(); it != rows.end(); it++)
+            {
+                Player_t mover = it->side ? PLAYER_COMPUTER : PLAYER_USER;
+                it->outcome = (winner == PLAYER_NONE) ? 0 : ((winner == mover) ? 1 : -1);
+                positions++;
+
+                int symmetry;
+                uint64_t key = m_hasher.GetKey(it->side ? it->second : it->first,
+                                               it->side ? it->first : it->second, symmetry);
+                if (m_seen && !m_seen->Insert(key))
+                {
+                    duplicates++;
+                    continue;
+                }
+                batch.push_back(*it);
+            }
+
+            if (batch.size() >= SELFPLAY_BATCH_ROWS)
+            {
+                m_writer.Append(batch);
+                batch.clear();
+            }
+        }
+
+        m_writer.Append(batch);
+        nodes = engine.GetStats().nodes;
+    }
+};
+
+static long long GetFileSize(const std::string & path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    return file ? static_cast<long long>(file.tellg()) : 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : VerifyDataset
+//
+// @description             : Reads the file back: row count, well formed rows
+//                            and, when deduplicated, no position twice
+//
+// @return                  : true if the dataset checks out
+//--------------------------------------------------------------------------------
+static bool VerifyDataset(const std::string & path, uint64_t expectedRows, bool bDeduplicated, double & seconds)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    DatasetReader reader;
+    if (!reader.Open(path) || reader.GetRowCount() != expectedRows)
+    {
+        return false;
+    }
+
+    CanonicalHasher hasher(reader.GetWidth(), reader.GetHeight());
+    std::unordered_set<uint64_t> keys;
+    uint64_t rows = 0;
+    std::vector<DatasetRow> chunk;
+    for (size_t i = 0; i < reader.GetChunkCount(); i++)
+    {
+        if (!reader.ReadChunk(i, chunk))
+        {
+            return false;
+        }
+
+        for (auto it = chunk.begin(); it != chunk.end(); it++)
+        {
+            // The first player is to move exactly when both have as many stones
+            bool bFirstToMove = (CountBits(it->first) == CountBits(it->second));
+            if ((it->first & it->second) != 0 || it->side > 1 || (it->side == 0) != bFirstToMove ||
+                it->outcome < -1 || it->outcome > 1 || ((it->first | it->second) & (1ULL << it->move)) != 0)
+            {
+                return false;
+            }
+
+            int symmetry;
+            uint64_t key = hasher.GetKey(it->side ? it->second : it->first, it->side ? it->first : it->second, symmetry);
+            if (!keys.insert(key).second && bDeduplicated)
+            {
+                return false;
+            }
+        }
+        rows += chunk.size();
+    }
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return rows == expectedRows;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--board WxHxK] [--games N] [--threads N] [--depth N]"
+              << " [--budget MS] [--random-plies N] [--out PATH] [--no-dedup]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t width = 4;
+    size_t height = 4;
+    size_t k = 4;
+    size_t games = 20000;
+    size_t threads = static_cast<size_t>(QThread::idealThreadCount());
+    int depth = 3;
+    int budgetMs = 0;
+    size_t randomPlies = 4;
+    std::string path;
+    bool bDeduplicate = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--board") == 0 && hasValue)
+        {
+            if (sscanf(argv[++i], "%zux%zux%zu", &width, &height, &k) != 3)
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--depth") == 0 && hasValue)
+        {
+            depth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && hasValue)
+        {
+            budgetMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--random-plies") == 0 && hasValue)
+        {
+            randomPlies = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+        {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-dedup") == 0)
+        {
+            bDeduplicate = false;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (width < 1 || height < 1 || k < 1 || width * height > 64 || games < 1 || threads < 1 || depth < 0 ||
+        budgetMs < 0 || (depth == 0 && budgetMs == 0))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (path.empty())
+    {
+        std::ostringstream name;
+        name << "selfplay_" << width << "x" << height << "x" << k << ".ttd";
+        path = name.str();
+    }
+
+    std::cout << width << "x" << height << " k=" << k << ": " << games << " games on " << threads
+              << " threads, " << randomPlies << " random plies, ";
+    if (depth > 0)
+    {
+        std::cout << "depth " << depth;
+    }
+    if (budgetMs > 0)
+    {
+        std::cout << (depth > 0 ? ", " : "") << budgetMs << " ms";
+    }
+    std::cout << " per move, dedup " << (bDeduplicate ? "on" : "off") << " -> " << path << std::endl;
+
+    DatasetWriter writer;
+    if (!writer.Open(path, width, height, k))
+    {
+        std::cout << "Could not create " << path << std::endl;
+        return 1;
+    }
+
+    // Every game adds at most one position per cell; half full at worst
+    CanonicalHasher hasher(width, height);
+    std::unique_ptr<ConcurrentHashSet> seen;
+    if (bDeduplicate)
+    {
+        seen.reset(new ConcurrentHashSet(2 * games * width * height));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> next(0);
+    std::vector<SelfPlayWorker *> workers;
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers.push_back(new SelfPlayWorker(width, height, k, games, next, seen.get(), hasher, writer, depth,
+                                             budgetMs, randomPlies, 20200117 + static_cast<unsigned>(i)));
+        workers.back()->start();
+    }
+
+    unsigned long long positions = 0;
+    unsigned long long duplicates = 0;
+    unsigned long long nodes = 0;
+    for (auto it = workers.begin(); it != workers.end(); it++)
+    {
+        (*it)->wait();
+        positions += (*it)->positions;
+        duplicates += (*it)->duplicates;
+        nodes += (*it)->nodes;
+        delete *it;
+    }
+
+    bool bClosed = writer.Close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const DatasetStats & stats = writer.GetStats();
+    long long fileBytes = GetFileSize(path);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Positions : " << positions << " searched, " << duplicates << " duplicates dropped ("
+              << (positions ? 100.0 * duplicates / positions : 0.0) << "%), " << stats.rows << " rows written"
+              << std::endl;
+    std::cout << "Speed     : " << std::setprecision(0) << positions / seconds << " positions/sec, "
+              << nodes / seconds << " nodes/sec, " << std::setprecision(2) << seconds << " s" << std::endl;
+    std::cout << "File      : " << fileBytes << " bytes in " << stats.chunks << " chunks, "
+              << (stats.rows ? static_cast<double>(fileBytes) / stats.rows : 0.0) << " bytes/row, "
+              << std::setprecision(1) << (stats.compressedBytes ? static_cast<double>(stats.rawBytes) / stats.compressedBytes : 0.0)
+              << "x compression" << std::endl;
+    std::cout << "Writer    : busy " << std::setprecision(3) << stats.writerSeconds << " s ("
+              << std::setprecision(1) << 100.0 * stats.writerSeconds / seconds << "% of the run), workers stalled "
+              << std::setprecision(3) << stats.stallSeconds << " s" << std::endl;
+
+    double readSeconds = 0.0;
+    bool bPassed = bClosed && VerifyDataset(path, stats.rows, bDeduplicate, readSeconds);
+    std::cout << "Read back : " << std::setprecision(0) << (readSeconds > 0.0 ? stats.rows / readSeconds : 0.0)
+              << " rows/sec" << std::endl;
+
+    std::cout << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,626 @@
+//--------------------------------------------------------------------------------
+// SelfPlayFarm: self-play across worker processes with live aggregation.
+//
+// Forks --processes workers that play the two engines against each other on
+// the 3x3 Game, alternating who moves first, until the coordinator stops
+// them after --seconds. Each worker owns one slot of a shared memory region
+// and adds its game results, game lengths and move time histograms there
+// with lock-free atomics; the coordinator reads all slots every --refresh
+// ms and prints the running totals. A worker that dies is reported and
+// restarted, its counts so far stay in its slot (--crash-after N makes
+// every worker abort after N games to show this). --pin binds worker i to
+// the i-th allowed CPU. --scaling repeats the run with 1, 2, 4, ... up to
+// --processes workers and reports games/sec and efficiency against linear.
+//
+// Usage: SelfPlayFarm [--processes N] [--seconds S] [--refresh MS] [--pin]
+//                     [--crash-after N] [--scaling] [engine engine]
+//--------------------------------------------------------------------------------
+#include "engine.h"
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+// Game lengths are counted per ply, 5 to 9 on the 3x3 board
+const size_t FARM_LENGTH_BUCKETS = 10;
+
+// Move times are counted in power of two buckets of microseconds
+const size_t FARM_LATENCY_BUCKETS = 32;
+
+typedef enum FarmResult_tag
+{
+    FARM_FIRST_ENGINE_WINS,
+    FARM_SECOND_ENGINE_WINS,
+    FARM_DRAW,
+    FARM_RESULTS
+}FarmResult_t;
+
+//------------------------------------------------------------------------
+// Counters of one worker process. Only that process writes them, so the
+// atomics never contend; they are atomic so the coordinator can read them
+// at any time. Slots sit on cache lines of their own to keep the workers
+// from invalidating each other's lines.
+//------------------------------------------------------------------------
+struct alignas(64) FarmSlot
+{
+    std::atomic<uint64_t> games;
+    std::atomic<uint64_t> moves;
+    std::atomic<uint64_t> results[FARM_RESULTS];
+    std::atomic<uint64_t> lengths[FARM_LENGTH_BUCKETS];
+    std::atomic<uint64_t> moveMicros[2];                        // per engine
+    std::atomic<uint64_t> latencies[2][FARM_LATENCY_BUCKETS];   // per engine
+    std::atomic<uint32_t> restarts;
+};
+
+//------------------------------------------------------------------------
+// The shared memory region: a stop flag the coordinator raises, then one
+// slot per worker
+//------------------------------------------------------------------------
+struct alignas(64) FarmControl
+{
+    std::atomic<int> stop;
+};
+
+class FarmRegion
+{
+private:
+    void * m_memory;
+    size_t m_bytes;
+    size_t m_slotCount;
+
+public:
+    // Anonymous shared mapping, inherited by every process forked afterwards
+    explicit FarmRegion(size_t slotCount) : m_slotCount(slotCount)
+    {
+        m_bytes = sizeof(FarmControl) + slotCount * sizeof(FarmSlot);
+        m_memory = mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (m_memory == MAP_FAILED)
+        {
+            m_memory = nullptr;
+            return;
+        }
+
+        new (m_memory) FarmControl();
+        for (size_t i = 0; i < slotCount; i++)
+        {
+            new (&GetSlot(i)) FarmSlot();
+        }
+    }
+
+    ~FarmRegion()
+    {
+        if (m_memory)
+        {
+            munmap(m_memory, m_bytes);
+        }
+    }
+
+    bool IsMapped() const { return m_memory != nullptr; }
+    FarmControl & GetControl() { return *static_cast<FarmControl *>(m_memory); }
+    FarmSlot & GetSlot(size_t index)
+    {
+        return reinterpret_cast<FarmSlot *>(static_cast<char *>(m_memory) + sizeof(FarmControl))[index];
+    }
+    size_t GetSlotCount() const { return m_slotCount; }
+};
+
+//------------------------------------------------------------------------
+// Sum of all slots, as read by the coordinator
+//------------------------------------------------------------------------
+struct FarmTotals
+{
+    uint64_t games;
+    uint64_t moves;
+    uint64_t results[FARM_RESULTS];
+    uint64_t lengths[FARM_LENGTH_BUCKETS];
+    uint64_t moveMicros[2];
+    uint64_t latencies[2][FARM_LATENCY_BUCKETS];
+    uint64_t restarts;
+};
+
+static FarmTotals ReadTotals(FarmRegion & region)
+{
+    FarmTotals totals = FarmTotals();
+    for (size_t i = 0; i < region.GetSlotCount(); i++)
+    {
+        FarmSlot & slot = region.GetSlot(i);
+        totals.games += slot.games.load(std::memory_order_relaxed);
+        totals.moves += slot.moves.load(std::memory_order_relaxed);
+        totals.restarts += slot.restarts.load(std::memory_order_relaxed);
+        for (size_t r = 0; r < FARM_RESULTS; r++)
+        {
+            totals.results[r] += slot.results[r].load(std::memory_order_relaxed);
+        }
+        for (size_t b = 0; b < FARM_LENGTH_BUCKETS; b++)
+        {
+            totals.lengths[b] += slot.lengths[b].load(std::memory_order_relaxed);
+        }
+        for (size_t e = 0; e < 2; e++)
+        {
+            totals.moveMicros[e] += slot.moveMicros[e].load(std::memory_order_relaxed);
+            for (size_t b = 0; b < FARM_LATENCY_BUCKETS; b++)
+            {
+                totals.latencies[e][b] += slot.latencies[e][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return totals;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetLatencyPercentile
+//
+// @description             : Move time that 'percent' of one engine's moves
+//                            stayed below, rounded up to a bucket bound
+//
+// @return                  : microseconds
+//--------------------------------------------------------------------------------
+static uint64_t GetLatencyPercentile(const FarmTotals & totals, size_t engine, int percent)
+{
+    uint64_t count = 0;
+    for (size_t b = 0; b < FARM_LATENCY_BUCKETS; b++)
+    {
+        count += totals.latencies[engine][b];
+    }
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < FARM_LATENCY_BUCKETS; b++)
+    {
+        seen += totals.latencies[engine][b];
+        if (count > 0 && seen * 100 >= count * static_cast<uint64_t>(percent))
+        {
+            // Bucket b holds times below 2^b us, bucket 0 only 0 us
+            return 1ULL << b;
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : RunWorker
+//
+// @description             : Body of a worker process. Plays game after game
+//                            into its slot until the stop flag is raised, then
+//                            exits without returning to the caller's stack.
+//                            Engines are created here, after the fork, so no
+//                            engine state is shared between processes.
+//
+// @return                  : Never returns
+//--------------------------------------------------------------------------------
+static void RunWorker(FarmRegion & region, size_t index, const std::string & firstName,
+                      const std::string & secondName, int cpu, unsigned long crashAfter)
+{
+    if (cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        sched_setaffinity(0, sizeof(cpus), &cpus);
+    }
+
+    FarmSlot & slot = region.GetSlot(index);
+    std::atomic<int> & stop = region.GetControl().stop;
+    std::unique_ptr<Engine> engines[2] = {std::unique_ptr<Engine>(CreateEngine(firstName)),
+                                          std::unique_ptr<Engine>(CreateEngine(secondName))};
+
+    // The first engine always plays PLAYER_USER; who moves first alternates
+    Player_t firstMover = (index % 2 == 0) ? PLAYER_USER : PLAYER_COMPUTER;
+    for (unsigned long played = 0; !stop.load(std::memory_order_relaxed); played++)
+    {
+        if (crashAfter > 0 && played == crashAfter)
+        {
+            abort();
+        }
+
+        Game game(firstMover);
+        Player_t turn = firstMover;
+        size_t plies = 0;
+        while (!game.GameOver())
+        {
+            size_t engine = (turn == PLAYER_USER) ? 0 : 1;
+
+            auto start = Clock::now();
+            size_t move = engines[engine]->SelectMove(game, turn);
+            uint64_t micros = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+
+            size_t bucket = 0;
+            for (uint64_t latency = micros; latency > 0 && bucket + 1 < FARM_LATENCY_BUCKETS; latency >>= 1)
+            {
+                bucket++;
+            }
+            slot.latencies[engine][bucket].fetch_add(1, std::memory_order_relaxed);
+            slot.moveMicros[engine].fetch_add(micros, std::memory_order_relaxed);
+
+            game.AddPlayerMarkToBoard(move, turn);
+            turn = (turn == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+            plies++;
+        }
+
+        Player_t winner = game.CheckWin();
+        FarmResult_t result = (winner == PLAYER_NONE) ? FARM_DRAW :
+                              (winner == PLAYER_USER) ? FARM_FIRST_ENGINE_WINS : FARM_SECOND_ENGINE_WINS;
+        slot.results[result].fetch_add(1, std::memory_order_relaxed);
+        slot.lengths[std::min(plies, FARM_LENGTH_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+        slot.moves.fetch_add(plies, std::memory_order_relaxed);
+        slot.games.fetch_add(1, std::memory_order_relaxed);
+
+        firstMover = (firstMover == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    }
+
+    // Skip the static destructors and atexit handlers of the parent's copy
+    _exit(0);
+}
+
+//------------------------------------------------------------------------
+// Forks, watches and restarts the worker processes of one run
+//------------------------------------------------------------------------
+class FarmCoordinator
+{
+private:
+    FarmRegion & m_region;
+    std::string m_firstName;
+    std::string m_secondName;
+    std::vector<int> m_cpus;            // empty unless workers are pinned
+    unsigned long m_crashAfter;
+    std::vector<pid_t> m_pids;
+
+    bool Spawn(size_t index)
+    {
+        int cpu = m_cpus.empty() ? -1 : m_cpus[index % m_cpus.size()];
+
+        // Whatever is buffered would otherwise be written again by the child
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            return false;
+        }
+        if (pid == 0)
+        {
+            RunWorker(m_region, index, m_firstName, m_secondName, cpu, m_crashAfter);
+        }
+
+        m_pids[index] = pid;
+        return true;
+    }
+
+public:
+    FarmCoordinator(FarmRegion & region, const std::string & firstName, const std::string & secondName,
+                    const std::vector<int> & cpus, unsigned long crashAfter)
+        : m_region(region), m_firstName(firstName), m_secondName(secondName), m_cpus(cpus),
+          m_crashAfter(crashAfter), m_pids(region.GetSlotCount(), -1)
+    {
+    }
+
+    bool Start()
+    {
+        m_region.GetControl().stop.store(0);
+        for (size_t i = 0; i < m_pids.size(); i++)
+        {
+            if (!Spawn(i))
+            {
+                Stop();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Reaps workers that died and starts a new process in their slot
+    void Supervise(bool bVerbose)
+    {
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            auto it = std::find(m_pids.begin(), m_pids.end(), pid);
+            if (it == m_pids.end())
+            {
+                continue;
+            }
+
+            size_t index = static_cast<size_t>(it - m_pids.begin());
+            m_pids[index] = -1;
+            if (bVerbose)
+            {
+                std::cout << "  worker " << index << " (pid " << pid << ") ";
+                if (WIFSIGNALED(status))
+                {
+                    std::cout << "killed by signal " << WTERMSIG(status);
+                }
+                else
+                {
+                    std::cout << "exited with status " << WEXITSTATUS(status);
+                }
+                std::cout << ", restarting" << std::endl;
+            }
+
+            m_region.GetSlot(index).restarts.fetch_add(1, std::memory_order_relaxed);
+            Spawn(index);
+        }
+    }
+
+    // Raises the stop flag and waits for every worker to finish its game
+    void Stop()
+    {
+        m_region.GetControl().stop.store(1);
+        for (auto it = m_pids.begin(); it != m_pids.end(); it++)
+        {
+            if (*it > 0)
+            {
+                waitpid(*it, nullptr, 0);
+                *it = -1;
+            }
+        }
+    }
+
+    size_t GetRunning() const
+    {
+        return static_cast<size_t>(std::count_if(m_pids.begin(), m_pids.end(), [](pid_t pid) { return pid > 0; }));
+    }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : RunFarm
+//
+// @description             : Plays for 'seconds' with 'processes' workers,
+//                            printing the running totals every 'refreshMs'
+//                            when verbose
+//
+// @return                  : false if the workers could not be started
+//--------------------------------------------------------------------------------
+static bool RunFarm(size_t processes, double seconds, int refreshMs, const std::vector<int> & cpus,
+                    unsigned long crashAfter, const std::string & first, const std::string & second,
+                    bool bVerbose, FarmTotals & totals, double & elapsed)
+{
+    FarmRegion region(processes);
+    if (!region.IsMapped())
+    {
+        std::cout << "Could not map the shared memory region" << std::endl;
+        return false;
+    }
+
+    FarmCoordinator coordinator(region, first, second, cpus, crashAfter);
+    auto start = Clock::now();
+    if (!coordinator.Start())
+    {
+        std::cout << "Could not start the workers" << std::endl;
+        return false;
+    }
+
+    uint64_t lastGames = 0;
+    auto lastTime = start;
+    auto deadline = start + std::chrono::microseconds(static_cast<long long>(seconds * 1e6));
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::min(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::milliseconds(refreshMs)), deadline - Clock::now()));
+        coordinator.Supervise(bVerbose);
+
+        if (bVerbose)
+        {
+            FarmTotals now = ReadTotals(region);
+            auto time = Clock::now();
+            double interval = std::chrono::duration<double>(time - lastTime).count();
+            std::cout << std::fixed << std::setprecision(1) << std::setw(6)
+                      << std::chrono::duration<double>(time - start).count() << " s  "
+                      << std::setw(10) << now.games << " games  " << std::setprecision(0) << std::setw(8)
+                      << (interval > 0.0 ? (now.games - lastGames) / interval : 0.0) << " games/sec  "
+                      << coordinator.GetRunning() << "/" << processes << " workers  "
+                      << now.restarts << " restarts" << std::endl;
+            lastGames = now.games;
+            lastTime = time;
+        }
+    }
+
+    coordinator.Stop();
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    totals = ReadTotals(region);
+    return true;
+}
+
+static void PrintTotals(const FarmTotals & totals, double elapsed, const std::string & first,
+                        const std::string & second)
+{
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "Games     : " << totals.games << " in " << std::setprecision(2) << elapsed << " s, "
+              << std::setprecision(0) << totals.games / elapsed << " games/sec, "
+              << totals.moves / elapsed << " moves/sec" << std::endl;
+    std::cout << "Results   : " << first << " " << totals.results[FARM_FIRST_ENGINE_WINS] << ", "
+              << second << " " << totals.results[FARM_SECOND_ENGINE_WINS] << ", draws "
+              << totals.results[FARM_DRAW] << std::endl;
+
+    std::cout << "Length    :";
+    for (size_t b = 0; b < FARM_LENGTH_BUCKETS; b++)
+    {
+        if (totals.lengths[b] > 0)
+        {
+            std::cout << " " << b << " plies " << std::setprecision(1)
+                      << 100.0 * totals.lengths[b] / totals.games << "%";
+        }
+    }
+    std::cout << std::endl;
+
+    const std::string names[2] = {first, second};
+    for (size_t e = 0; e < 2; e++)
+    {
+        uint64_t moves = 0;
+        for (size_t b = 0; b < FARM_LATENCY_BUCKETS; b++)
+        {
+            moves += totals.latencies[e][b];
+        }
+        std::cout << "Move time : " << std::left << std::setw(10) << names[e] << std::right
+                  << std::setprecision(1) << (moves ? static_cast<double>(totals.moveMicros[e]) / moves : 0.0)
+                  << " us mean, p50 under " << GetLatencyPercentile(totals, e, 50) << " us, p99 under "
+                  << GetLatencyPercentile(totals, e, 99) << " us" << std::endl;
+    }
+    std::cout << "Restarts  : " << totals.restarts << std::endl;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--processes N] [--seconds S] [--refresh MS] [--pin]"
+              << " [--crash-after N] [--scaling] [engine engine]" << std::endl;
+    std::cout << "Engines:";
+    std::vector<std::string> names = GetEngineNames();
+    for (auto it = names.begin(); it != names.end(); it++)
+    {
+        std::cout << " " << *it;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t processes = static_cast<size_t>(QThread::idealThreadCount());
+    double seconds = 5.0;
+    int refreshMs = 1000;
+    bool bPin = false;
+    unsigned long crashAfter = 0;
+    bool bScaling = false;
+    std::vector<std::string> engineNames;
+
+    std::vector<std::string> registered = GetEngineNames();
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--processes") == 0 && hasValue)
+        {
+            processes = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+        {
+            seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--refresh") == 0 && hasValue)
+        {
+            refreshMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--pin") == 0)
+        {
+            bPin = true;
+        }
+        else if (strcmp(argv[i], "--crash-after") == 0 && hasValue)
+        {
+            crashAfter = static_cast<unsigned long>(atol(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--scaling") == 0)
+        {
+            bScaling = true;
+        }
+        else if (std::find(registered.begin(), registered.end(), argv[i]) != registered.end())
+        {
+            engineNames.push_back(argv[i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (engineNames.empty())
+    {
+        engineNames.push_back("minimax");
+        engineNames.push_back("mcts");
+    }
+    if (processes < 1 || seconds <= 0.0 || refreshMs < 1 || engineNames.size() != 2)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    // The CPUs this process may run on, handed out to the workers in turn
+    std::vector<int> cpus;
+    if (bPin)
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    // Creating the engines once up front leaves any file they generate (the
+    // tablebase) in place before the workers start
+    for (auto it = engineNames.begin(); it != engineNames.end(); it++)
+    {
+        std::unique_ptr<Engine> engine(CreateEngine(*it));
+    }
+
+    const std::string & first = engineNames[0];
+    const std::string & second = engineNames[1];
+    std::cout << first << " vs " << second << " on " << processes << " processes"
+              << (bPin ? " pinned to CPUs" : "") << ", " << seconds << " s";
+    if (crashAfter > 0)
+    {
+        std::cout << ", workers abort after " << crashAfter << " games";
+    }
+    std::cout << std::endl;
+
+    FarmTotals totals;
+    double elapsed = 0.0;
+    bool bPassed = true;
+    if (!bScaling)
+    {
+        bPassed = RunFarm(processes, seconds, refreshMs, cpus, crashAfter, first, second, true, totals, elapsed);
+        if (bPassed)
+        {
+            PrintTotals(totals, elapsed, first, second);
+
+            uint64_t results = totals.results[FARM_FIRST_ENGINE_WINS] + totals.results[FARM_SECOND_ENGINE_WINS] +
+                               totals.results[FARM_DRAW];
+            bPassed = (totals.games > 0 && results == totals.games);
+        }
+    }
+    else
+    {
+        std::cout << "processes   games/sec   speedup   efficiency" << std::endl;
+        // Powers of two, then the full count
+        std::vector<size_t> counts;
+        for (size_t count = 1; count < processes; count *= 2)
+        {
+            counts.push_back(count);
+        }
+        counts.push_back(processes);
+
+        double baseRate = 0.0;
+        for (auto it = counts.begin(); it != counts.end() && bPassed; it++)
+        {
+            size_t count = *it;
+            bPassed = RunFarm(count, seconds, refreshMs, cpus, crashAfter, first, second, false, totals, elapsed);
+            double rate = totals.games / elapsed;
+            if (count == 1)
+            {
+                baseRate = rate;
+            }
+            double speedup = (baseRate > 0.0) ? rate / baseRate : 0.0;
+            std::cout << std::fixed << std::setprecision(0) << std::setw(9) << count << std::setw(12) << rate
+                      << std::setprecision(2) << std::setw(10) << speedup << std::setprecision(0)
+                      << std::setw(12) << 100.0 * speedup / count << "%" << std::endl;
+            bPassed = bPassed && totals.games > 0;
+        }
+    }
+
+    std::cout << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}
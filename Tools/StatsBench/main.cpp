@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------------
+// StatsBench: checks that the statistics store survives restarts and
+// crashes and that opening it does not slow down as games pile up.
+//
+// Random games are recorded up to --games. At every power of ten the store
+// is closed and reopened, and the time Record() takes on the caller's
+// thread and the time to open the store are reported. The totals are
+// checked against a tally kept by the benchmark. Finally a torn record is
+// appended to the log, as a crash in the middle of a write would leave
+// it, and the store must open with the torn record dropped and every
+// earlier game intact. A store whose log cannot be written must report
+// the failure from Flush().
+//
+// Usage: StatsBench [--games N] [--prefix PATH]
+//--------------------------------------------------------------------------------
+#include "statsstore.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+const char * const PLAYER_NAMES[] = {"human", "heuristic", "minimax", "mcts"};
+const size_t PLAYER_NAME_COUNT = sizeof(PLAYER_NAMES) / sizeof(PLAYER_NAMES[0]);
+
+static StatsGameRecord RandomGame(std::mt19937 & rng)
+{
+    std::uniform_int_distribution<size_t> player(0, PLAYER_NAME_COUNT - 1);
+    std::uniform_int_distribution<int> winner(PLAYER_USER, PLAYER_NONE);
+    std::uniform_int_distribution<uint32_t> latency(1, 50000);
+
+    StatsGameRecord game;
+    game.players[PLAYER_USER] = PLAYER_NAMES[player(rng)];
+    game.players[PLAYER_COMPUTER] = PLAYER_NAMES[1 + player(rng) % (PLAYER_NAME_COUNT - 1)];
+    game.winner = static_cast<Player_t>(winner(rng));
+    for (int move = 0; move < 9; move++)
+    {
+        if (move % 2 == 1 || game.players[PLAYER_USER] != "human")
+        {
+            game.latenciesUs[move % 2].push_back(latency(rng));
+        }
+    }
+    return game;
+}
+
+static long long GetFileSize(const std::string & path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    return file ? static_cast<long long>(file.tellg()) : 0;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CheckTotals
+//
+// @description             : Compares the store's totals with the benchmark's
+//                            own tally of wins, draws and losses
+//
+// @return                  : true if they agree
+//--------------------------------------------------------------------------------
+static bool CheckTotals(const StatsStore & store, const PlayerStats * expected, uint64_t games)
+{
+    bool bMatch = (store.GetGameCount() == games);
+    for (size_t i = 0; i < PLAYER_NAME_COUNT; i++)
+    {
+        PlayerStats stats = store.GetPlayerStats(PLAYER_NAMES[i]);
+        bMatch = bMatch && stats.wins == expected[i].wins && stats.draws == expected[i].draws &&
+                 stats.losses == expected[i].losses && stats.moves == expected[i].moves;
+    }
+    return bMatch;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--games N] [--prefix PATH]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t games = 1000000;
+    std::string prefix = "statsbench";
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--prefix") == 0 && hasValue)
+        {
+            prefix = argv[++i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (games < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::string snapshotPath = prefix + ".snapshot";
+    std::string logPath = prefix + ".log";
+    std::remove(snapshotPath.c_str());
+    std::remove(logPath.c_str());
+
+    std::mt19937 rng(20200117);
+    PlayerStats expected[PLAYER_NAME_COUNT] = {};
+    bool bPassed = true;
+
+    std::cout << std::right << std::setw(10) << "games" << std::setw(14) << "record ns"
+              << std::setw(12) << "open ms" << std::setw(12) << "snapshot" << std::setw(10) << "replayed"
+              << std::setw(14) << "log bytes" << std::setw(10) << "totals" << std::endl;
+
+    StatsStore * store = new StatsStore(prefix);
+    uint64_t recorded = 0;
+    for (uint64_t checkpoint = 1000; recorded < games; checkpoint *= 10)
+    {
+        checkpoint = std::min(checkpoint, games);
+
+        auto start = std::chrono::steady_clock::now();
+        for (; recorded < checkpoint; recorded++)
+        {
+            StatsGameRecord game = RandomGame(rng);
+            store->Record(game);
+
+            for (size_t i = 0; i < PLAYER_NAME_COUNT; i++)
+            {
+                for (int side = PLAYER_USER; side <= PLAYER_COMPUTER; side++)
+                {
+                    if (game.players[side] != PLAYER_NAMES[i])
+                    {
+                        continue;
+                    }
+                    expected[i].wins += (game.winner == side);
+                    expected[i].draws += (game.winner == PLAYER_NONE);
+                    expected[i].losses += (game.winner != side && game.winner != PLAYER_NONE);
+                    expected[i].moves += game.latenciesUs[side].size();
+                }
+            }
+        }
+        double recordSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t chunk = checkpoint - (checkpoint > 1000 ? checkpoint / 10 : 0);
+
+        // Closing writes everything queued; the reopened store reads it back
+        delete store;
+        long long logBytes = GetFileSize(logPath);
+        store = new StatsStore(prefix);
+        const StatsLoadInfo & info = store->GetLoadInfo();
+        bool bTotals = CheckTotals(*store, expected, recorded);
+        bPassed = bPassed && bTotals;
+
+        std::cout << std::setw(10) << recorded << std::fixed << std::setprecision(0)
+                  << std::setw(14) << 1e9 * recordSeconds / chunk << std::setprecision(2)
+                  << std::setw(12) << 1e3 * info.seconds << std::setw(12) << info.snapshotGames
+                  << std::setw(10) << info.replayedGames << std::setw(14) << logBytes
+                  << std::setw(10) << (bTotals ? "ok" : "WRONG") << std::endl;
+    }
+
+    // A crash in the middle of a write: a record header promising more
+    // bytes than follow it
+    delete store;
+    long long logBytes = GetFileSize(logPath);
+    {
+        std::ofstream log(logPath.c_str(), std::ios::binary | std::ios::app);
+        uint32_t size = 64;
+        uint32_t checksum = 0;
+        log.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        log.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        log.write("torn", 4);
+    }
+
+    store = new StatsStore(prefix);
+    const StatsLoadInfo & info = store->GetLoadInfo();
+    bool bRecovered = CheckTotals(*store, expected, recorded) && info.droppedBytes == 12 &&
+                      GetFileSize(logPath) == logBytes;
+    std::cout << std::endl << "Torn write: " << info.droppedBytes << " bytes dropped, "
+              << store->GetGameCount() << " games kept, " << (bRecovered ? "ok" : "WRONG") << std::endl;
+    bPassed = bPassed && bRecovered;
+
+    // Games recorded after recovery follow the last good record
+    StatsGameRecord game = RandomGame(rng);
+    store->Record(game);
+    bool bFlushed = store->Flush();
+    delete store;
+    store = new StatsStore(prefix);
+    bool bAppended = bFlushed && (store->GetGameCount() == recorded + 1 && store->GetLoadInfo().droppedBytes == 0);
+    std::cout << "Append after recovery: " << (bAppended ? "ok" : "WRONG") << std::endl;
+    bPassed = bPassed && bAppended;
+
+    // A log that cannot be written must not be reported as flushed
+    {
+        StatsStore unwritable(prefix + ".missing/stats");
+        unwritable.Record(RandomGame(rng));
+        bool bReported = !unwritable.Flush();
+        std::cout << "Failed append reported: " << (bReported ? "ok" : "WRONG") << std::endl;
+        bPassed = bPassed && bReported;
+    }
+
+    PlayerStats stats = store->GetPlayerStats("minimax");
+    std::cout << "minimax: " << stats.wins << " won, " << stats.draws << " drawn, " << stats.losses << " lost, "
+              << "longest streaks " << stats.longestWinStreak << " won / " << stats.longestLossStreak
+              << " lost, move latency p50 " << stats.GetLatencyPercentile(50) << " us, p99 "
+              << stats.GetLatencyPercentile(99) << " us" << std::endl;
+    delete store;
+
+    std::remove(snapshotPath.c_str());
+    std::remove(logPath.c_str());
+
+    std::cout << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+//--------------------------------------------------------------------------------
+// TablebaseGen: builds the 2-bit tablebases and checks them.
+//
+// For every board it reports generation time and throughput, the file size,
+// how long opening the mapped file takes and the cost of a probe. Random
+// positions reached in play are then cross-checked against the df-pn solver.
+//
+// Usage: TablebaseGen [--board WxHxK] [--threads N] [--verify N]
+//        Without --board the 3x3 k=3, 4x4 k=3 and 4x4 k=4 tablebases are built.
+//--------------------------------------------------------------------------------
+#include "tablebase.h"
+#include "dfpn.h"
+#include <QThread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+const size_t PROBE_COUNT = 1000000;
+const size_t DFPN_TABLE_MB = 16;
+
+struct BoardSpec
+{
+    size_t width;
+    size_t height;
+    size_t k;
+};
+
+static const char * ValueName(TablebaseValue_t value)
+{
+    switch (value)
+    {
+    case TABLEBASE_WIN:
+        return "win";
+    case TABLEBASE_LOSS:
+        return "loss";
+    case TABLEBASE_DRAW:
+        return "draw";
+    default:
+        return "illegal";
+    }
+}
+
+static TablebaseValue_t ToTablebaseValue(ProofResult_t result)
+{
+    switch (result)
+    {
+    case PROOF_WIN:
+        return TABLEBASE_WIN;
+    case PROOF_LOSS:
+        return TABLEBASE_LOSS;
+    case PROOF_DRAW:
+        return TABLEBASE_DRAW;
+    default:
+        return TABLEBASE_ILLEGAL;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchProbes
+//
+// @description             : Probes random positions with a legal stone count
+//
+// @return                  : nanoseconds per probe
+//--------------------------------------------------------------------------------
+static double BenchProbes(const Tablebase & tablebase, std::mt19937 & rng)
+{
+    size_t cells = tablebase.GetWidth() * tablebase.GetHeight();
+    std::vector<uint32_t> firsts;
+    std::vector<uint32_t> seconds;
+    for (size_t i = 0; i < 4096; i++)
+    {
+        uint32_t first = 0;
+        uint32_t second = 0;
+        size_t stones = rng() % (cells + 1);
+        for (size_t placed = 0; placed < stones; )
+        {
+            uint32_t bit = 1u << (rng() % cells);
+            if ((first | second) & bit)
+            {
+                continue;
+            }
+            (placed % 2 == 0 ? first : second) |= bit;
+            placed++;
+        }
+        firsts.push_back(first);
+        seconds.push_back(second);
+    }
+
+    unsigned long long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < PROBE_COUNT; i++)
+    {
+        checksum += tablebase.Probe(firsts[i & 4095], seconds[i & 4095]);
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    // Keeps the loop from being optimised away
+    if (checksum == ~0ULL)
+    {
+        std::cout << checksum;
+    }
+    return elapsed / PROBE_COUNT;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : VerifyPositions
+//
+// @description             : Solves random unfinished positions from play with
+//                            df-pn and compares with the tablebase. The stored
+//                            move must keep the value: a win wins or leaves the
+//                            opponent lost, a draw leaves them a draw.
+//
+// @return                  : number of mismatches
+//--------------------------------------------------------------------------------
+static size_t VerifyPositions(const Tablebase & tablebase, size_t count, std::mt19937 & rng)
+{
+    DfpnSolver solver(DFPN_TABLE_MB);
+    size_t mismatches = 0;
+    size_t cells = tablebase.GetWidth() * tablebase.GetHeight();
+
+    for (size_t i = 0; i < count; )
+    {
+        MnkGame game(tablebase.GetWidth(), tablebase.GetHeight(), tablebase.GetK());
+        size_t plies = rng() % cells;
+        while (game.GetMoveHistory().size() < plies && !game.GameOver())
+        {
+            std::vector<size_t> moves = game.GetAvailableMoves();
+            game.AddPlayerMarkToBoard(moves[rng() % moves.size()]);
+        }
+        if (game.GameOver())
+        {
+            continue;
+        }
+
+        TablebaseValue_t expected = ToTablebaseValue(solver.Solve(game));
+        TablebaseValue_t actual = tablebase.Probe(game.GetCells(), game.GetTurn());
+        Player_t mover = game.GetTurn();
+        game.AddPlayerMarkToBoard(tablebase.SelectMove(game.GetCells(), mover, rng));
+        TablebaseValue_t after = game.GameOver() ? (game.CheckWin() == mover ? TABLEBASE_LOSS : TABLEBASE_DRAW)
+                                                 : tablebase.Probe(game.GetCells(), game.GetTurn());
+        bool bMoveKept = (actual == TABLEBASE_LOSS) || (actual == TABLEBASE_WIN && after == TABLEBASE_LOSS) ||
+                         (actual == TABLEBASE_DRAW && after == TABLEBASE_DRAW);
+        if (expected != actual || !bMoveKept)
+        {
+            mismatches++;
+        }
+        i++;
+    }
+
+    return mismatches;
+}
+
+static bool RunBoard(const BoardSpec & board, size_t threads, size_t verifyCount, std::mt19937 & rng)
+{
+    std::string path = GetTablebaseFileName(board.width, board.height, board.k);
+    std::cout << board.width << "x" << board.height << " k=" << board.k << " -> " << path << std::endl;
+
+    TablebaseStats stats;
+    if (!GenerateTablebase(board.width, board.height, board.k, path, threads, stats))
+    {
+        std::cout << "  could not write " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "  generated " << stats.positions << " positions in " << std::fixed << std::setprecision(3)
+              << stats.seconds << " s on " << threads << " threads, " << std::setprecision(0)
+              << stats.positions / stats.seconds << " positions/sec" << std::endl;
+    std::cout << "  " << stats.counts[TABLEBASE_WIN] << " win, " << stats.counts[TABLEBASE_DRAW] << " draw, "
+              << stats.counts[TABLEBASE_LOSS] << " loss, " << stats.counts[TABLEBASE_ILLEGAL] << " illegal; "
+              << stats.fileBytes << " bytes on disk" << std::endl;
+
+    Tablebase tablebase;
+    auto start = std::chrono::steady_clock::now();
+    bool bOpened = tablebase.Open(path);
+    double openMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    if (!bOpened)
+    {
+        std::cout << "  could not open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Player_t> empty(board.width * board.height, PLAYER_NONE);
+    std::cout << "  opened in " << std::setprecision(1) << openMicros << " us, empty board is a "
+              << ValueName(tablebase.Probe(empty, PLAYER_USER)) << " for the first player, "
+              << std::setprecision(1) << BenchProbes(tablebase, rng) << " ns per probe" << std::endl;
+
+    size_t mismatches = VerifyPositions(tablebase, verifyCount, rng);
+    std::cout << "  verified " << verifyCount << " positions against df-pn: " << mismatches << " mismatches"
+              << std::endl;
+    return mismatches == 0;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--board WxHxK] [--threads N] [--verify N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<BoardSpec> boards;
+    size_t threads = static_cast<size_t>(QThread::idealThreadCount());
+    size_t verifyCount = 200;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--board") == 0 && hasValue)
+        {
+            BoardSpec board;
+            if (sscanf(argv[++i], "%zux%zux%zu", &board.width, &board.height, &board.k) != 3 ||
+                board.width * board.height == 0 || board.width * board.height > TABLEBASE_MAX_CELLS)
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            boards.push_back(board);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--verify") == 0 && hasValue)
+        {
+            verifyCount = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (threads < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (boards.empty())
+    {
+        boards = {{3, 3, 3}, {4, 4, 3}, {4, 4, 4}};
+    }
+
+    // Fixed seed so runs are comparable
+    std::mt19937 rng(20200117);
+    bool bOk = true;
+    for (auto it = boards.begin(); it != boards.end(); it++)
+    {
+        bOk = RunBoard(*it, threads, verifyCount, rng) && bOk;
+    }
+
+    std::cout << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+# Command line tools built on the TicTacToe game engine.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    Analyze \
+    BatchBench \
+    BookGen \
+    DfpnSolve \
+    EvalBench \
+    EvalTrain \
+    GomokuBench \
+    GuiBench \
+    OrderingBench \
+    Perft \
+    QubicBench \
+    RulesBench \
+    SelfPlay \
+    StatsBench \
+    TablebaseGen \
+    Tournament \
+    UltimateBench
+
+# epoll, eventfd, signalfd and sched_setaffinity are Linux only
+linux: SUBDIRS += \
+    GameServer \
+    LoadGen \
+    SelfPlayFarm
@@ -0,0 +1,15 @@
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../../TicTacToe/engine.pri)
+
+SOURCES += \
+    elo.cpp \
+    main.cpp
+
+HEADERS += \
+    elo.h
@@ -0,0 +1,152 @@
+#include "elo.h"
+#include <cmath>
+
+// Two sided 95% confidence
+const double Z_95 = 1.959964;
+
+//--------------------------------------------------------------------------------
+// @name                    : Score
+//
+// @description             : Mean points per game, a draw counting half
+//
+// @return                  : score in [0, 1]
+//--------------------------------------------------------------------------------
+double GameTally::Score() const
+{
+    if (Total() == 0)
+    {
+        return 0.5;
+    }
+
+    return (wins + 0.5 * draws) / Total();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Variance
+//
+// @description             : Per game variance of the points scored
+//
+// @return                  : variance
+//--------------------------------------------------------------------------------
+double GameTally::Variance() const
+{
+    if (Total() == 0)
+    {
+        return 0.0;
+    }
+
+    double s = Score();
+    return (wins * (1.0 - s) * (1.0 - s) +
+            draws * (0.5 - s) * (0.5 - s) +
+            losses * s * s) / Total();
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : ScoreToElo
+//
+// @description             : Logistic Elo difference for an expected score.
+//                            Scores of 0 and 1 are clamped to +/-1000.
+//
+// @return                  : Elo difference
+//--------------------------------------------------------------------------------
+double ScoreToElo(double score)
+{
+    if (score <= 0.0)
+    {
+        return -1000.0;
+    }
+    if (score >= 1.0)
+    {
+        return 1000.0;
+    }
+
+    double elo = -400.0 * std::log10(1.0 / score - 1.0);
+    return std::fmax(-1000.0, std::fmin(1000.0, elo));
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : EstimateElo
+//
+// @description             : Elo difference with a 95% confidence interval
+//
+// @return                  : EloEstimate
+//--------------------------------------------------------------------------------
+EloEstimate EstimateElo(const GameTally & tally)
+{
+    EloEstimate estimate;
+    double s = tally.Score();
+    double margin = (tally.Total() > 0) ? Z_95 * std::sqrt(tally.Variance() / tally.Total()) : 0.0;
+
+    estimate.elo = ScoreToElo(s);
+    estimate.lower = ScoreToElo(s - margin);
+    estimate.upper = ScoreToElo(s + margin);
+    return estimate;
+}
+
+static double EloToScore(double elo)
+{
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+Sprt::Sprt(double elo0, double elo1, double alpha, double beta)
+{
+    m_score0 = EloToScore(elo0);
+    m_score1 = EloToScore(elo1);
+    m_lowerBound = std::log(beta / (1.0 - alpha));
+    m_upperBound = std::log((1.0 - beta) / alpha);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : GetLlr
+//
+// @description             : Log likelihood ratio of H1 against H0 for the
+//                            games played so far. One virtual win and one
+//                            virtual loss are added to the games: without
+//                            them a pairing that only wins, only loses or
+//                            only draws has zero variance and the LLR is
+//                            stuck at 0 or runs off to infinity.
+//
+// @return                  : LLR, 0 before the first game
+//--------------------------------------------------------------------------------
+double Sprt::GetLlr(const GameTally & tally) const
+{
+    if (tally.Total() == 0)
+    {
+        return 0.0;
+    }
+
+    GameTally regularised = tally;
+    regularised.wins++;
+    regularised.losses++;
+
+    double variance = regularised.Variance();
+    if (variance <= 0.0)
+    {
+        return 0.0;
+    }
+
+    return regularised.Total() * (m_score1 - m_score0) *
+           (2.0 * regularised.Score() - m_score0 - m_score1) / (2.0 * variance);
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : Test
+//
+// @description             : Checks the LLR against the stopping bounds
+//
+// @return                  : SprtState_t
+//--------------------------------------------------------------------------------
+SprtState_t Sprt::Test(const GameTally & tally) const
+{
+    double llr = GetLlr(tally);
+    if (llr >= m_upperBound)
+    {
+        return SPRT_ACCEPT_H1;
+    }
+    if (llr <= m_lowerBound)
+    {
+        return SPRT_ACCEPT_H0;
+    }
+
+    return SPRT_CONTINUE;
+}
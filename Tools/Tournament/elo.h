@@ -0,0 +1,57 @@
+#ifndef ELO_H
+#define ELO_H
+
+//------------------------------------------------------------------------
+// Win/draw/loss count of a series of games, from one engine's view
+//------------------------------------------------------------------------
+struct GameTally
+{
+    unsigned long wins;
+    unsigned long draws;
+    unsigned long losses;
+
+    GameTally() : wins(0), draws(0), losses(0) {}
+    unsigned long Total() const { return wins + draws + losses; }
+    double Score() const;
+    double Variance() const;
+};
+
+struct EloEstimate
+{
+    double elo;
+    double lower;
+    double upper;
+};
+
+typedef enum SprtState_tag
+{
+    SPRT_CONTINUE,
+    SPRT_ACCEPT_H0,
+    SPRT_ACCEPT_H1
+}SprtState_t;
+
+double ScoreToElo(double score);
+EloEstimate EstimateElo(const GameTally & tally);
+
+//------------------------------------------------------------------------
+// Sequential probability ratio test of H0: elo = elo0 against
+// H1: elo = elo1, with false positive rate alpha and false negative
+// rate beta. Uses the normal approximation of the game score.
+//------------------------------------------------------------------------
+class Sprt
+{
+private:
+    double m_score0;
+    double m_score1;
+    double m_lowerBound;
+    double m_upperBound;
+
+public:
+    Sprt(double elo0, double elo1, double alpha, double beta);
+    double GetLowerBound() const { return m_lowerBound; }
+    double GetUpperBound() const { return m_upperBound; }
+    double GetLlr(const GameTally & tally) const;
+    SprtState_t Test(const GameTally & tally) const;
+};
+
+#endif // ELO_H
@@ -0,0 +1,389 @@
+//--------------------------------------------------------------------------------
+// Tournament: round-robin matches between registered engines.
+//
+// Every pairing is played in game pairs so both engines move first equally
+// often. Game pairs are spread over all cores and each pairing stops early
+// once the SPRT decides. Reports pairwise and overall Elo with 95% confidence
+// intervals, and mean/p99 time per move for every engine.
+//
+// Usage: Tournament [--games N] [--threads N] [--elo0 E] [--elo1 E]
+//                   [--alpha A] [--beta B] [engine ...]
+//--------------------------------------------------------------------------------
+#include "engine.h"
+#include "elo.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+typedef enum GameResult_tag
+{
+    RESULT_FIRST_ENGINE_WINS,
+    RESULT_SECOND_ENGINE_WINS,
+    RESULT_DRAW
+}GameResult_t;
+
+//------------------------------------------------------------------------
+// Shared state of one pairing, claimed and updated by the workers
+//------------------------------------------------------------------------
+class Match
+{
+private:
+    QMutex m_mutex;
+    const Sprt & m_sprt;
+    unsigned long m_maxGamePairs;
+    unsigned long m_gamePairsClaimed;
+    GameTally m_tally;
+    SprtState_t m_state;
+
+public:
+    Match(const Sprt & sprt, unsigned long maxGames) : m_sprt(sprt)
+    {
+        m_maxGamePairs = (maxGames + 1) / 2;
+        m_gamePairsClaimed = 0;
+        m_state = SPRT_CONTINUE;
+    }
+
+    // Reserves the next game pair, false once the match is decided or complete
+    bool ClaimGamePair()
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_state != SPRT_CONTINUE || m_gamePairsClaimed >= m_maxGamePairs)
+        {
+            return false;
+        }
+
+        m_gamePairsClaimed++;
+        return true;
+    }
+
+    void Record(GameResult_t result)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (result == RESULT_FIRST_ENGINE_WINS)
+        {
+            m_tally.wins++;
+        }
+        else if (result == RESULT_SECOND_ENGINE_WINS)
+        {
+            m_tally.losses++;
+        }
+        else
+        {
+            m_tally.draws++;
+        }
+
+        // Test on even game counts only, keeping colours close to balanced
+        if (m_state == SPRT_CONTINUE && m_tally.Total() % 2 == 0)
+        {
+            m_state = m_sprt.Test(m_tally);
+        }
+    }
+
+    GameTally GetTally()
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_tally;
+    }
+
+    SprtState_t GetState()
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_state;
+    }
+};
+
+//------------------------------------------------------------------------
+// Worker thread that plays game pairs of one match until it is decided.
+// Each worker owns its engine instances and move time samples.
+//------------------------------------------------------------------------
+class TournamentWorker: public QThread
+{
+private:
+    Match & m_match;
+    std::unique_ptr<Engine> m_first;
+    std::unique_ptr<Engine> m_second;
+    std::vector<double> m_firstMoveTimes;
+    std::vector<double> m_secondMoveTimes;
+
+    GameResult_t PlayGame(Player_t firstEngineSide, Player_t firstMover)
+    {
+        Game game(firstMover);
+        Player_t turn = firstMover;
+        while (!game.GameOver())
+        {
+            bool bFirstEngine = (turn == firstEngineSide);
+            Engine * engine = bFirstEngine ? m_first.get() : m_second.get();
+
+            auto start = std::chrono::steady_clock::now();
+            size_t move = engine->SelectMove(game, turn);
+            auto end = std::chrono::steady_clock::now();
+
+            double micros = std::chrono::duration<double, std::micro>(end - start).count();
+            (bFirstEngine ? m_firstMoveTimes : m_secondMoveTimes).push_back(micros);
+
+            game.AddPlayerMarkToBoard(move, turn);
+            turn = (turn == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+        }
+
+        Player_t winner = game.CheckWin();
+        if (winner == PLAYER_NONE)
+        {
+            return RESULT_DRAW;
+        }
+
+        return (winner == firstEngineSide) ? RESULT_FIRST_ENGINE_WINS : RESULT_SECOND_ENGINE_WINS;
+    }
+
+public:
+    TournamentWorker(Match & match, const std::string & first, const std::string & second)
+        : QThread(), m_match(match), m_first(CreateEngine(first)), m_second(CreateEngine(second))
+    {
+    }
+
+    const std::vector<double> & GetFirstMoveTimes() { return m_firstMoveTimes; }
+    const std::vector<double> & GetSecondMoveTimes() { return m_secondMoveTimes; }
+
+    void run()
+    {
+        while (m_match.ClaimGamePair())
+        {
+            // First engine always plays PLAYER_USER; who moves first alternates
+            m_match.Record(PlayGame(PLAYER_USER, PLAYER_USER));
+            m_match.Record(PlayGame(PLAYER_USER, PLAYER_COMPUTER));
+        }
+    }
+};
+
+static GameTally Invert(const GameTally & tally)
+{
+    GameTally inverted;
+    inverted.wins = tally.losses;
+    inverted.draws = tally.draws;
+    inverted.losses = tally.wins;
+    return inverted;
+}
+
+static void AddTally(GameTally & total, const GameTally & tally)
+{
+    total.wins += tally.wins;
+    total.draws += tally.draws;
+    total.losses += tally.losses;
+}
+
+static const char * SprtStateName(SprtState_t state)
+{
+    switch (state)
+    {
+    case SPRT_ACCEPT_H0:
+        return "H0";
+    case SPRT_ACCEPT_H1:
+        return "H1";
+    default:
+        return "-";
+    }
+}
+
+static void PrintElo(const EloEstimate & estimate)
+{
+    std::cout << std::fixed << std::setprecision(1) << std::setw(8) << estimate.elo
+              << "  [" << estimate.lower << ", " << estimate.upper << "]";
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CheckSprt
+//
+// @description             : Drawn pairings must not end the test at once:
+//                            a few draws, and the first games of any result,
+//                            leave the SPRT running with a finite LLR
+//
+// @return                  : true if the test keeps running
+//--------------------------------------------------------------------------------
+static bool CheckSprt()
+{
+    Sprt sprt(0.0, 10.0, 0.05, 0.05);
+    GameTally tallies[4];
+    tallies[0].draws = 2;
+    tallies[1].draws = 20;
+    tallies[2].wins = 2;
+    tallies[3].losses = 2;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        double llr = sprt.GetLlr(tallies[i]);
+        if (!std::isfinite(llr) || sprt.Test(tallies[i]) != SPRT_CONTINUE)
+        {
+            std::cout << "SPRT check failed: " << tallies[i].wins << "W " << tallies[i].draws << "D "
+                      << tallies[i].losses << "L gives LLR " << llr << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program << " [--games N] [--threads N] [--elo0 E] [--elo1 E]"
+              << " [--alpha A] [--beta B] [engine ...]" << std::endl;
+    std::cout << "Engines:";
+    std::vector<std::string> names = GetEngineNames();
+    for (auto it = names.begin(); it != names.end(); it++)
+    {
+        std::cout << " " << *it;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long maxGames = 2000;
+    size_t threads = static_cast<size_t>(QThread::idealThreadCount());
+    double elo0 = 0.0;
+    double elo1 = 10.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+    std::vector<std::string> engines;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            maxGames = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--elo0") == 0 && hasValue)
+        {
+            elo0 = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--elo1") == 0 && hasValue)
+        {
+            elo1 = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--alpha") == 0 && hasValue)
+        {
+            alpha = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--beta") == 0 && hasValue)
+        {
+            beta = atof(argv[++i]);
+        }
+        else if (argv[i][0] != '-')
+        {
+            std::unique_ptr<Engine> probe(CreateEngine(argv[i]));
+            if (!probe)
+            {
+                std::cout << "Unknown engine: " << argv[i] << std::endl;
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            engines.push_back(argv[i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (engines.empty())
+    {
+        engines = GetEngineNames();
+    }
+    if (engines.size() < 2 || threads < 1 || maxGames < 2)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (!CheckSprt())
+    {
+        return 1;
+    }
+
+    srand(static_cast<int>(time(nullptr)));
+
+    Sprt sprt(elo0, elo1, alpha, beta);
+    std::vector<GameTally> overall(engines.size());
+    std::vector<std::vector<double>> moveTimes(engines.size());
+
+    std::cout << "SPRT elo0=" << elo0 << " elo1=" << elo1 << " alpha=" << alpha << " beta=" << beta
+              << ", up to " << maxGames << " games per pairing on " << threads << " threads" << std::endl;
+    std::cout << std::left << std::setw(24) << "pairing" << std::right << std::setw(7) << "games"
+              << std::setw(6) << "W" << std::setw(6) << "D" << std::setw(6) << "L"
+              << std::setw(8) << "elo" << "  95% CI" << std::setw(16) << "LLR" << "  SPRT" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t a = 0; a < engines.size(); a++)
+    {
+        for (size_t b = a + 1; b < engines.size(); b++)
+        {
+            Match match(sprt, maxGames);
+
+            std::vector<TournamentWorker *> workers;
+            for (size_t i = 0; i < threads; i++)
+            {
+                workers.push_back(new TournamentWorker(match, engines[a], engines[b]));
+                workers.back()->start();
+            }
+            for (auto it = workers.begin(); it != workers.end(); it++)
+            {
+                (*it)->wait();
+                const std::vector<double> & first = (*it)->GetFirstMoveTimes();
+                const std::vector<double> & second = (*it)->GetSecondMoveTimes();
+                moveTimes[a].insert(moveTimes[a].end(), first.begin(), first.end());
+                moveTimes[b].insert(moveTimes[b].end(), second.begin(), second.end());
+                delete *it;
+            }
+
+            GameTally tally = match.GetTally();
+            AddTally(overall[a], tally);
+            AddTally(overall[b], Invert(tally));
+
+            std::string pairing = engines[a] + " vs " + engines[b];
+            std::cout << std::left << std::setw(24) << pairing << std::right << std::setw(7) << tally.Total()
+                      << std::setw(6) << tally.wins << std::setw(6) << tally.draws << std::setw(6) << tally.losses;
+            PrintElo(EstimateElo(tally));
+            std::cout << std::setprecision(2) << std::setw(10) << sprt.GetLlr(tally)
+                      << "  " << SprtStateName(match.GetState()) << std::endl;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::endl << std::left << std::setw(12) << "engine" << std::right << std::setw(7) << "games"
+              << std::setw(8) << "elo" << "  95% CI" << std::setw(22) << "mean us/move"
+              << std::setw(14) << "p99 us/move" << std::endl;
+    for (size_t i = 0; i < engines.size(); i++)
+    {
+        std::vector<double> & times = moveTimes[i];
+        std::sort(times.begin(), times.end());
+
+        double mean = 0.0;
+        for (auto it = times.begin(); it != times.end(); it++)
+        {
+            mean += *it;
+        }
+        mean = times.empty() ? 0.0 : mean / times.size();
+        double p99 = times.empty() ? 0.0 : times[std::min(times.size() - 1, times.size() * 99 / 100)];
+
+        std::cout << std::left << std::setw(12) << engines[i] << std::right << std::setw(7) << overall[i].Total();
+        PrintElo(EstimateElo(overall[i]));
+        std::cout << std::setprecision(2) << std::setw(14) << mean << std::setw(14) << p99 << std::endl;
+    }
+
+    std::cout << std::endl << "Elapsed " << std::setprecision(3) << seconds << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,432 @@
+//--------------------------------------------------------------------------------
+// UltimateBench: Ultimate tic-tac-toe on nested bitboards.
+//
+// 1. Rules: random games played on UltimateGame and on a plain 81 cell
+//    reference with the rules written out cell by cell, comparing the legal
+//    moves after every move and the result of every game. From every
+//    position a playout is checked to end in a position that agrees with
+//    its own marks.
+// 2. Playouts: random games from the empty board with PlayRandom, the
+//    inner loop of the search.
+// 3. Search: MCTS iterations per second from the empty board, and a match
+//    of the engine against itself with a tenth of the iterations.
+// 4. Alpha-beta: depth and nodes per second from the empty board, and a
+//    match of the fixed depth search against MCTS.
+//
+// Usage: UltimateBench [--games N] [--playouts N] [--budget MS]
+//                      [--match N] [--iterations N] [--depth N]
+//--------------------------------------------------------------------------------
+#include "ultimate.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+//------------------------------------------------------------------------
+// The rules without bitboards: one Player_t per cell, wins found by
+// checking the 8 lines of a sub-board or of the big board
+//------------------------------------------------------------------------
+class ReferenceGame
+{
+private:
+    Player_t m_cells[ULTIMATE_CELLS];
+    Player_t m_owners[ULTIMATE_BOARDS];     // winner of each sub-board
+    int m_nextBoard;                        // -1 when any sub-board is allowed
+    Player_t m_turn;
+    Player_t m_winner;
+
+    static bool HasLine(const Player_t * squares, Player_t player)
+    {
+        for (size_t i = 0; i < 8; i++)
+        {
+            size_t count = 0;
+            for (size_t square = 0; square < 9; square++)
+            {
+                if ((WIN_MASKS[i] & (1u << square)) && squares[square] == player)
+                {
+                    count++;
+                }
+            }
+            if (count == 3)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsClosed(size_t board) const
+    {
+        if (m_owners[board] != PLAYER_NONE)
+        {
+            return true;
+        }
+        for (size_t square = 0; square < 9; square++)
+        {
+            if (m_cells[board * 9 + square] == PLAYER_NONE)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    ReferenceGame()
+    {
+        for (size_t cell = 0; cell < ULTIMATE_CELLS; cell++)
+        {
+            m_cells[cell] = PLAYER_NONE;
+        }
+        for (size_t board = 0; board < ULTIMATE_BOARDS; board++)
+        {
+            m_owners[board] = PLAYER_NONE;
+        }
+        m_nextBoard = -1;
+        m_turn = PLAYER_USER;
+        m_winner = PLAYER_NONE;
+    }
+
+    std::vector<size_t> GetAvailableMoves() const
+    {
+        std::vector<size_t> moves;
+        if (m_winner != PLAYER_NONE)
+        {
+            return moves;
+        }
+        for (size_t cell = 0; cell < ULTIMATE_CELLS; cell++)
+        {
+            int board = static_cast<int>(cell / 9);
+            if ((m_nextBoard < 0 || m_nextBoard == board) && !IsClosed(board) && m_cells[cell] == PLAYER_NONE)
+            {
+                moves.push_back(cell);
+            }
+        }
+        return moves;
+    }
+
+    void AddPlayerMarkToBoard(size_t cell)
+    {
+        size_t board = cell / 9;
+        m_cells[cell] = m_turn;
+        if (HasLine(m_cells + board * 9, m_turn))
+        {
+            m_owners[board] = m_turn;
+            if (HasLine(m_owners, m_turn))
+            {
+                m_winner = m_turn;
+            }
+        }
+
+        m_nextBoard = IsClosed(cell % 9) ? -1 : static_cast<int>(cell % 9);
+        m_turn = (m_turn == PLAYER_USER) ? PLAYER_COMPUTER : PLAYER_USER;
+    }
+
+    Player_t CheckWin() const { return m_winner; }
+};
+
+//--------------------------------------------------------------------------------
+// @name                    : CheckPlayout
+//
+// @description             : Plays 'game' out with PlayRandom, which keeps its
+//                            own copy of the rules, and works out the won and
+//                            closed sub-boards and the winner again from the
+//                            marks it left
+//
+// @return                  : true if the end position is consistent
+//--------------------------------------------------------------------------------
+static bool CheckPlayout(UltimateGame game, UltimateRng & rng)
+{
+    Player_t winner = game.PlayRandom(rng);
+
+    size_t marks = 0;
+    BoardMask_t won[2] = {0, 0};
+    BoardMask_t closed = 0;
+    for (size_t board = 0; board < ULTIMATE_BOARDS; board++)
+    {
+        BoardMask_t user = game.GetBoardMask(PLAYER_USER, board);
+        BoardMask_t computer = game.GetBoardMask(PLAYER_COMPUTER, board);
+        marks += CountBits(user) + CountBits(computer);
+        if (IsWinMask(user))
+        {
+            won[PLAYER_USER] |= static_cast<BoardMask_t>(1u << board);
+        }
+        if (IsWinMask(computer))
+        {
+            won[PLAYER_COMPUTER] |= static_cast<BoardMask_t>(1u << board);
+        }
+        if (IsWinMask(user) || IsWinMask(computer) || (user | computer) == FULL_BOARD_MASK)
+        {
+            closed |= static_cast<BoardMask_t>(1u << board);
+        }
+    }
+
+    Player_t expected = IsWinMask(won[PLAYER_USER]) ? PLAYER_USER
+                      : (IsWinMask(won[PLAYER_COMPUTER]) ? PLAYER_COMPUTER : PLAYER_NONE);
+    return game.GameOver() && game.GetAvailableMoves().empty() && marks == game.GetMoveCount() &&
+           won[PLAYER_USER] == game.GetWonBoards(PLAYER_USER) &&
+           won[PLAYER_COMPUTER] == game.GetWonBoards(PLAYER_COMPUTER) && closed == game.GetClosedBoards() &&
+           winner == expected;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : CheckRules
+//
+// @description             : Plays the same random games on both boards
+//
+// @return                  : true if the legal moves and the results agree
+//--------------------------------------------------------------------------------
+static bool CheckRules(size_t games, std::mt19937 & rng)
+{
+    UltimateRng playoutRng(rng());
+    unsigned long long moves = 0;
+    for (size_t g = 0; g < games; g++)
+    {
+        UltimateGame game;
+        ReferenceGame reference;
+        while (true)
+        {
+            std::vector<size_t> available = game.GetAvailableMoves();
+            if (available != reference.GetAvailableMoves() || available.empty() != game.GameOver())
+            {
+                std::cout << "  game " << g << ", move " << game.GetMoveCount() << ": legal moves differ" << std::endl;
+                return false;
+            }
+            if (!CheckPlayout(game, playoutRng))
+            {
+                std::cout << "  game " << g << ", move " << game.GetMoveCount() << ": playout ends inconsistent"
+                          << std::endl;
+                return false;
+            }
+            if (available.empty())
+            {
+                break;
+            }
+
+            size_t cell = available[rng() % available.size()];
+            game.AddPlayerMarkToBoard(cell);
+            reference.AddPlayerMarkToBoard(cell);
+            moves++;
+        }
+
+        if (game.CheckWin() != reference.CheckWin())
+        {
+            std::cout << "  game " << g << ": results differ" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "Rules           : " << games << " random games, " << moves
+              << " moves, same as the reference, playouts consistent" << std::endl;
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : BenchPlayouts
+//
+// @description             : Random playouts from the empty board
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void BenchPlayouts(size_t playouts)
+{
+    UltimateRng rng(20200117);
+    unsigned long long moves = 0;
+    unsigned long long results[3] = {0, 0, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < playouts; i++)
+    {
+        UltimateGame game;
+        results[game.PlayRandom(rng)]++;
+        moves += game.GetMoveCount();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Playouts        : " << playouts << " games, " << std::fixed << std::setprecision(1)
+              << static_cast<double>(moves) / playouts << " moves each, first player " << std::setprecision(1)
+              << 100.0 * results[PLAYER_USER] / playouts << "%, second " << 100.0 * results[PLAYER_COMPUTER] / playouts
+              << "%, drawn " << 100.0 * results[PLAYER_NONE] / playouts << "%" << std::endl;
+    std::cout << "                  " << std::setprecision(0) << playouts / seconds << " playouts/sec, "
+              << moves / seconds << " moves/sec" << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayMatch
+//
+// @description             : Engine with 'iterations' a move against the same
+//                            engine with a tenth of them, first move
+//                            alternating
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void PlayMatch(size_t games, unsigned long long iterations)
+{
+    UltimateEngine engines[2];
+    unsigned long long budgets[2] = {iterations, iterations / 10};
+    int wins[2] = {0, 0};
+    int draws = 0;
+
+    for (size_t g = 0; g < games; g++)
+    {
+        // Engine 'first' plays PLAYER_USER, who moves first
+        int first = static_cast<int>(g % 2);
+        UltimateGame game;
+        while (!game.GameOver())
+        {
+            int side = (game.GetTurn() == PLAYER_USER) ? first : 1 - first;
+            game.AddPlayerMarkToBoard(engines[side].SelectMove(game, 0, budgets[side]));
+        }
+
+        if (game.CheckWin() == PLAYER_NONE)
+        {
+            draws++;
+        }
+        else
+        {
+            wins[(game.CheckWin() == PLAYER_USER) ? first : 1 - first]++;
+        }
+    }
+
+    std::cout << "Match           : " << iterations << " against " << budgets[1] << " iterations a move, " << games
+              << " games: " << wins[0] << " won, " << draws << " drawn, " << wins[1] << " lost" << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+// @name                    : PlayAlphaBetaMatch
+//
+// @description             : Alpha-beta to 'depth' against MCTS with
+//                            'iterations' a move, first move alternating
+//
+// @return                  : Nothing
+//--------------------------------------------------------------------------------
+static void PlayAlphaBetaMatch(size_t games, unsigned long long iterations, int depth)
+{
+    UltimateAlphaBeta alphaBeta;
+    UltimateEngine mcts;
+    int wins = 0;
+    int losses = 0;
+    int draws = 0;
+
+    for (size_t g = 0; g < games; g++)
+    {
+        // Alpha-beta plays PLAYER_USER, who moves first, in even games
+        Player_t alphaBetaSide = (g % 2 == 0) ? PLAYER_USER : PLAYER_COMPUTER;
+        UltimateGame game;
+        while (!game.GameOver())
+        {
+            if (game.GetTurn() == alphaBetaSide)
+            {
+                // The budget only backs up the depth limit
+                game.AddPlayerMarkToBoard(alphaBeta.SelectMove(game, 60000, depth));
+            }
+            else
+            {
+                game.AddPlayerMarkToBoard(mcts.SelectMove(game, 0, iterations));
+            }
+        }
+
+        if (game.CheckWin() == PLAYER_NONE)
+        {
+            draws++;
+        }
+        else if (game.CheckWin() == alphaBetaSide)
+        {
+            wins++;
+        }
+        else
+        {
+            losses++;
+        }
+    }
+
+    std::cout << "Alpha-beta match: depth " << depth << " against " << iterations << " iterations a move, " << games
+              << " games: " << wins << " won, " << draws << " drawn, " << losses << " lost" << std::endl;
+}
+
+static void PrintUsage(const char * program)
+{
+    std::cout << "Usage: " << program
+              << " [--games N] [--playouts N] [--budget MS] [--match N] [--iterations N] [--depth N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t games = 2000;
+    size_t playouts = 1000000;
+    int budgetMs = 1000;
+    size_t matchGames = 20;
+    unsigned long long iterations = 20000;
+    int depth = 6;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--games") == 0 && hasValue)
+        {
+            games = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--playouts") == 0 && hasValue)
+        {
+            playouts = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && hasValue)
+        {
+            budgetMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--match") == 0 && hasValue)
+        {
+            matchGames = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+        {
+            iterations = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--depth") == 0 && hasValue)
+        {
+            depth = atoi(argv[++i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (playouts < 1 || budgetMs < 1 || iterations < 10 || depth < 1)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(20200117);
+    bool bPassed = CheckRules(games, rng);
+
+    BenchPlayouts(playouts);
+
+    UltimateEngine engine;
+    engine.SelectMove(UltimateGame(), budgetMs);
+    const UltimateStats & stats = engine.GetStats();
+    std::cout << "Search          : " << budgetMs << " ms from the empty board, " << std::fixed << std::setprecision(0)
+              << stats.iterations * 1000.0 / budgetMs << " iterations/sec, " << std::setprecision(1)
+              << static_cast<double>(stats.playoutMoves) / stats.iterations << " playout moves each" << std::endl;
+
+    UltimateAlphaBeta alphaBeta;
+    auto start = std::chrono::steady_clock::now();
+    alphaBeta.SelectMove(UltimateGame(), budgetMs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Alpha-beta      : " << budgetMs << " ms from the empty board, depth "
+              << alphaBeta.GetCompletedDepth() << ", " << std::setprecision(0) << alphaBeta.GetNodes() / seconds
+              << " nodes/sec" << std::endl;
+
+    if (matchGames > 0)
+    {
+        PlayMatch(matchGames, iterations);
+        PlayAlphaBetaMatch(matchGames, iterations, depth);
+    }
+
+    std::cout << (bPassed ? "OK" : "FAILED") << std::endl;
+    return bPassed ? 0 : 1;
+}